@@ -0,0 +1,101 @@
+#include "AllocStats.h"
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+// Plain zero-initialized TLS: usable from operator new at any point in a
+// thread's life, with no lazy-init wrapper that could itself allocate
+thread_local int t_current = AllocStats::Other;
+thread_local uint64_t t_allocs[AllocStats::SUBSYSTEM_COUNT];
+thread_local uint64_t t_bytes[AllocStats::SUBSYSTEM_COUNT];
+
+} // namespace
+
+AllocStats::Counts AllocStats::Totals::total() const {
+    Counts sum;
+    for (const auto& c : by) {
+        sum.allocs += c.allocs;
+        sum.bytes += c.bytes;
+    }
+    return sum;
+}
+
+AllocStats::Scope::Scope(Subsystem s) : previous_(t_current) {
+    t_current = s;
+}
+
+AllocStats::Scope::~Scope() {
+    t_current = previous_;
+}
+
+bool AllocStats::enabled() {
+#ifdef ALLOC_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+AllocStats::Totals AllocStats::snapshot() {
+    Totals t;
+    for (int i = 0; i < SUBSYSTEM_COUNT; ++i) {
+        t.by[i].allocs = t_allocs[i];
+        t.by[i].bytes = t_bytes[i];
+    }
+    return t;
+}
+
+AllocStats::Totals AllocStats::delta(const Totals& before, const Totals& after) {
+    Totals d;
+    for (int i = 0; i < SUBSYSTEM_COUNT; ++i) {
+        d.by[i].allocs = after.by[i].allocs - before.by[i].allocs;
+        d.by[i].bytes = after.by[i].bytes - before.by[i].bytes;
+    }
+    return d;
+}
+
+const char* AllocStats::name(Subsystem s) {
+    switch (s) {
+        case Events:   return "events";
+        case Network:  return "network";
+        case Dropbear: return "dropbear";
+        case Render:   return "render";
+        default:       return "other";
+    }
+}
+
+void AllocStats::record(size_t bytes) {
+    t_allocs[t_current]++;
+    t_bytes[t_current] += bytes;
+}
+
+#ifdef ALLOC_STATS
+
+void* operator new(std::size_t size) {
+    AllocStats::record(size);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+#endif
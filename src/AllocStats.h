@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Heap allocation accounting for the instrumentation build (make ALLOC_STATS=1).
+// AllocStats.cpp then replaces global operator new/delete and charges every
+// allocation to the calling thread's current subsystem, set with Scope.
+// Counts are per thread, so the render loop's frame totals aren't mixed with
+// the metrics exporter thread's. In normal builds nothing is hooked and all
+// counts stay zero; Scope is just a thread-local store.
+class AllocStats {
+public:
+    enum Subsystem { Other, Events, Network, Dropbear, Render, SUBSYSTEM_COUNT };
+
+    struct Counts {
+        uint64_t allocs = 0;
+        uint64_t bytes = 0;
+    };
+
+    struct Totals {
+        Counts by[SUBSYSTEM_COUNT];
+        Counts total() const;
+    };
+
+    // Charges allocations on this thread to s until destroyed
+    class Scope {
+    public:
+        explicit Scope(Subsystem s);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        int previous_;
+    };
+
+    // True when operator new is hooked in this binary
+    static bool enabled();
+
+    // Cumulative counts for the calling thread
+    static Totals snapshot();
+    static Totals delta(const Totals& before, const Totals& after);
+
+    static const char* name(Subsystem s);
+
+    // Called by the replacement operator new
+    static void record(size_t bytes);
+};
@@ -1,7 +1,17 @@
 #include "Application.h"
 #include "Constants.h"
+#include "PathHelper.h"
+#include "SamplingProfiler.h"
+#include "StartupTrace.h"
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <cerrno>
+#include <csignal>
 #include <cstring>
 
 Application::Application() = default;
@@ -11,51 +21,102 @@ Application::~Application() {
 }
 
 bool Application::initialize() {
+    StartupTrace::Scope traceInit("Application::initialize");
+
+    // SSH comes first: the host key check and launch run alongside SDL,
+    // the GL context and the font instead of after them
+    network_manager_ = std::make_unique<NetworkManager>();
+    dropbear_manager_ = std::make_unique<DropbearManager>([this](const std::string& line) {
+        if (booting_) boot_log_.push_back(line);
+        else pushLogLine(line);
+    });
+    boot_wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    booting_ = true;
+    boot_thread_ = std::thread(&Application::bootDropbear, this);
+
     // Configure before SDL init / window creation (video driver on these devices is finicky)
     SDL_SetHint(SDL_HINT_VIDEODRIVER, "mali");
 
-    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER) != 0) {
-        std::cerr << "SDL_Init Error: " << SDL_GetError() << std::endl;
-        return false;
+    {
+        StartupTrace::Scope trace("SDL_Init (mali video driver)");
+        if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER) != 0) {
+            std::cerr << "SDL_Init Error: " << SDL_GetError() << std::endl;
+            return false;
+        }
     }
-    if (TTF_Init() == -1) {
-        std::cerr << "TTF_Init Error: " << TTF_GetError() << std::endl;
-        SDL_Quit();
-        return false;
+#ifndef USE_BAKED_FONT
+    {
+        StartupTrace::Scope trace("TTF_Init");
+        if (TTF_Init() == -1) {
+            std::cerr << "TTF_Init Error: " << TTF_GetError() << std::endl;
+            SDL_Quit();
+            return false;
+        }
     }
+#endif
 
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_ES);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 0);
 
-    window_ = SDL_CreateWindow("Dropbear SSH",
-                              SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-                              Display::WIDTH, Display::HEIGHT, SDL_WINDOW_SHOWN);
-    if (!window_) { sdlFail("SDL_CreateWindow"); return false; }
+    {
+        StartupTrace::Scope trace("SDL_CreateWindow");
+        window_ = SDL_CreateWindow("Dropbear SSH",
+                                  SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+                                  Display::WIDTH, Display::HEIGHT, SDL_WINDOW_SHOWN);
+        if (!window_) { sdlFail("SDL_CreateWindow"); return false; }
+    }
+    {
+        StartupTrace::Scope trace("SDL_CreateRenderer (GLES)");
+        sdl_renderer_ = SDL_CreateRenderer(window_, -1, SDL_RENDERER_ACCELERATED);
+        if (!sdl_renderer_) { sdlFail("SDL_CreateRenderer"); return false; }
+    }
+#ifndef USE_BAKED_FONT
+    {
+        StartupTrace::Scope trace("TTF_OpenFont");
+        font_ = TTF_OpenFont("res/arial.ttf", LogDisplay::FONT_SIZE);
+        if (!font_) {
+            std::cerr << "TTF_OpenFont Error: " << TTF_GetError() << std::endl;
+            return false;
+        }
+    }
+#endif
+
+    renderer_ = std::make_unique<Renderer>(sdl_renderer_, font_);
 
-    sdl_renderer_ = SDL_CreateRenderer(window_, -1, SDL_RENDERER_ACCELERATED);
-    if (!sdl_renderer_) { sdlFail("SDL_CreateRenderer"); return false; }
+    {
+        StartupTrace::Scope trace("initController");
+        initController();
+    }
 
-    font_ = TTF_OpenFont("res/arial.ttf", LogDisplay::FONT_SIZE);
-    if (!font_) {
-        std::cerr << "TTF_OpenFont Error: " << TTF_GetError() << std::endl;
-        return false;
+    if (AllocStats::enabled()) registerAllocMetrics();
+    metrics_exporter_ = std::make_unique<MetricsExporter>(
+        Metrics::global(), PathHelper::metricsFilePath(),
+        MetricsExport::SOCKET_PATH, MetricsExport::FILE_PERIOD_MS);
+    if (!metrics_exporter_->start()) {
+        pushLogLine(std::string("metrics socket unavailable at ") + MetricsExport::SOCKET_PATH);
     }
 
-    // Initialize managers
-    network_manager_ = std::make_unique<NetworkManager>();
-    dropbear_manager_ = std::make_unique<DropbearManager>(
-        [this](const std::string& line) { pushLogLine(line); }
-    );
-    renderer_ = std::make_unique<Renderer>(sdl_renderer_, font_);
+    std::string signalError;
+    if (!SamplingProfiler::installToggleSignal(SIGUSR2, signalError)) {
+        pushLogLine("SIGUSR2 profiler toggle unavailable: " + signalError);
+    }
+
+    // Hand dropbear back to the frame loop and show what it logged meanwhile
+    finishBoot();
+    configureLogHistory();
+    for (const std::string& line : boot_log_) pushLogLine(line);
+    boot_log_.clear();
+    boot_log_.shrink_to_fit();
+    configurePowerSave();
+    applyUiSchedPolicy();
+    refreshStatus();
 
-    initController();
-    
-    // Start Dropbear
-    dropbear_manager_->start();
-    
     // Initial IP snapshot
-    refreshIPAddrs();
+    {
+        StartupTrace::Scope trace("refreshIPAddrs");
+        refreshIPAddrs();
+    }
 
     running_ = true;
     return true;
@@ -64,25 +125,103 @@ bool Application::initialize() {
 void Application::run() {
     SDL_Event e;
     while (running_) {
-        while (SDL_PollEvent(&e)) {
-            handleEvent(e);
+        const auto frameStart = std::chrono::steady_clock::now();
+        const AllocStats::Totals allocsBefore = AllocStats::snapshot();
+        {
+            AllocStats::Scope scope(AllocStats::Events);
+            while (SDL_PollEvent(&e)) {
+                handleEvent(e);
+            }
+            if (SamplingProfiler::consumeToggleRequest()) toggleProfiler();
         }
 
-        // Update IPs periodically in case WLAN/ETH comes up later
+        // Update IPs periodically in case WLAN/ETH comes up later. This builds
+        // the status lines as strings, so it is the one part of an idle frame
+        // that allocates (see the idle frame test in test_AllocStats.cpp)
         Uint32 now = SDL_GetTicks();
         if (now - last_ip_refresh_ms_ >= Network::IP_REFRESH_PERIOD_MS) {
+            AllocStats::Scope scope(AllocStats::Network);
             refreshIPAddrs();
+            network_manager_->sampleRtt(now);
+            refreshStatus();
+            publishLogHistoryStats();
             last_ip_refresh_ms_ = now;
         }
 
-        dropbear_manager_->pumpLogs();
-        renderer_->render(ip_addrs_, users_, log_lines_);
+        {
+            AllocStats::Scope scope(AllocStats::Dropbear);
+            dropbear_manager_->pumpLogs();
+            dropbear_manager_->checkHealth();
+        }
+        {
+            AllocStats::Scope scope(AllocStats::Network);
+            updatePowerSave();
+        }
+        {
+            AllocStats::Scope scope(AllocStats::Render);
+            if (log_view_dirty_) refreshLogView();
+            renderer_->render(ip_addrs_, users_, status_lines_, log_view_,
+                              dropbear_manager_->probeHealth(), log_scroll_,
+                              metric_last_frame_allocs_ ? &last_frame_allocs_ : nullptr);
+        }
+        if (!startup_trace_written_) recordStartupProgress();
+        if (metric_last_frame_allocs_) {
+            recordFrameAllocs(AllocStats::delta(allocsBefore, AllocStats::snapshot()));
+        }
+
+        const int64_t frameUs = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - frameStart).count();
+        metric_frames_.inc();
+        metric_frame_time_us_.inc(frameUs);
+        metric_last_frame_us_.set(frameUs);
         SDL_Delay(Display::FRAME_DELAY_MS);
     }
 }
 
+void Application::bootDropbear() {
+    {
+        StartupTrace::Scope trace("dropbear boot");
+        dropbear_manager_->start();
+    }
+    // Keep reading its log until the UI takes over, so the listen marker is
+    // seen (and the port timed) as soon as dropbear prints it
+    while (!ui_ready_.load()) {
+        std::vector<struct pollfd> pfds = {{boot_wake_fd_, POLLIN, 0},
+                                           {dropbear_manager_->logFd(), POLLIN, 0}};
+        for (int fd : dropbear_manager_->acceptFds()) pfds.push_back({fd, POLLIN, 0});
+        const int timeoutMs = dropbear_manager_->awaitingPortOpen() ? Trace::PORT_CHECK_MS
+                                                                    : Dropbear::BOOT_POLL_MS;
+        if (poll(pfds.data(), pfds.size(), timeoutMs) == -1 && errno != EINTR) break;
+        if (ui_ready_.load()) break;
+        dropbear_manager_->pumpLogs();
+    }
+}
+
+void Application::finishBoot() {
+    if (!boot_thread_.joinable()) return;
+    ui_ready_ = true;
+    const uint64_t one = 1;
+    if (write(boot_wake_fd_, &one, sizeof(one)) == -1) {
+        // Full counter or bad fd; the poll timeout still ends the loop
+    }
+    boot_thread_.join();
+    booting_ = false;
+    close(boot_wake_fd_);
+    boot_wake_fd_ = -1;
+}
+
 void Application::cleanup() {
+    // An early initialize() failure leaves the boot thread running
+    finishBoot();
+    // A profile still running on exit is written rather than lost
+    if (SamplingProfiler::running() && dropbear_manager_) toggleProfiler();
+    // Keep whatever was captured if we exit before dropbear came up
+    if (!startup_trace_written_ && StartupTrace::has("first frame")) {
+        StartupTrace::writeFile(PathHelper::startupTracePath());
+        startup_trace_written_ = true;
+    }
     dropbear_manager_.reset();
+    metrics_exporter_.reset();
     renderer_.reset();
     network_manager_.reset();
     cleanupSDLResources();
@@ -93,10 +232,12 @@ void Application::cleanupSDLResources() {
         SDL_GameControllerClose(controller_);
         controller_ = nullptr;
     }
+#ifndef USE_BAKED_FONT
     if (font_) {
         TTF_CloseFont(font_);
         font_ = nullptr;
     }
+#endif
     if (sdl_renderer_) {
         SDL_DestroyRenderer(sdl_renderer_);
         sdl_renderer_ = nullptr;
@@ -105,7 +246,9 @@ void Application::cleanupSDLResources() {
         SDL_DestroyWindow(window_);
         window_ = nullptr;
     }
+#ifndef USE_BAKED_FONT
     TTF_Quit();
+#endif
     SDL_Quit();
 }
 
@@ -134,6 +277,14 @@ void Application::handleEvent(const SDL_Event& e) {
                 bool startPressed = SDL_GameControllerGetButton(controller_, SDL_CONTROLLER_BUTTON_START);
                 bool backPressed  = SDL_GameControllerGetButton(controller_, SDL_CONTROLLER_BUTTON_BACK);
                 if (startPressed && backPressed) running_ = false;
+                else if (backPressed && e.cbutton.button == SDL_CONTROLLER_BUTTON_X) toggleProfiler();
+                else if (e.cbutton.button == SDL_CONTROLLER_BUTTON_Y) restartDropbear();
+                else if (e.cbutton.button == SDL_CONTROLLER_BUTTON_DPAD_UP) scrollLogs(LogDisplay::SCROLL_STEP);
+                else if (e.cbutton.button == SDL_CONTROLLER_BUTTON_DPAD_DOWN) scrollLogs(-static_cast<long>(LogDisplay::SCROLL_STEP));
+                else if (e.cbutton.button == SDL_CONTROLLER_BUTTON_LEFTSHOULDER) scrollLogs(LogDisplay::SCROLL_PAGE);
+                else if (e.cbutton.button == SDL_CONTROLLER_BUTTON_RIGHTSHOULDER) scrollLogs(-static_cast<long>(LogDisplay::SCROLL_PAGE));
+                else if (e.cbutton.button == SDL_CONTROLLER_BUTTON_DPAD_LEFT) scrollLogs(static_cast<long>(log_history_.size()));
+                else if (e.cbutton.button == SDL_CONTROLLER_BUTTON_DPAD_RIGHT) scrollLogs(-static_cast<long>(log_scroll_));
             }
             break;
         default:
@@ -158,13 +309,146 @@ void Application::refreshIPAddrs() {
     }
 }
 
+void Application::recordStartupProgress() {
+    if (!StartupTrace::has("first frame")) {
+        StartupTrace::instant("first frame");
+        // Compare baked-font and TTF builds (BAKED_FONT=0) at the same point
+        struct rusage ru{};
+        if (getrusage(RUSAGE_SELF, &ru) == 0) metric_first_frame_rss_kib_.set(ru.ru_maxrss);
+    }
+    if (StartupTrace::has(Trace::DROPBEAR_LISTENING) ||
+        StartupTrace::has(Trace::DROPBEAR_LISTEN_FAILED)) {
+        const std::string path = PathHelper::startupTracePath();
+        if (StartupTrace::writeFile(path)) {
+            pushLogLine("Startup trace written to " + path);
+        }
+        startup_trace_written_ = true;
+    }
+}
+
+void Application::refreshStatus() {
+    status_lines_ = dropbear_manager_->statusLines();
+    for (auto& line : network_manager_->powerSaveStatusLines()) status_lines_.push_back(std::move(line));
+}
+
+void Application::restartDropbear() {
+    // Picks up any edits to dropbear.conf; connected sessions survive
+    dropbear_manager_->restartListener();
+    configureLogHistory();
+    configurePowerSave();
+    applyUiSchedPolicy();
+    refreshStatus();
+}
+
+void Application::applyUiSchedPolicy() {
+    // Runs on the render thread, which owns the frame loop
+    const SchedPolicy& policy = dropbear_manager_->uiSchedPolicy();
+    if (policy.empty()) return;
+    if (const char* step = policy.apply()) {
+        pushLogLine(std::string("UI scheduling: ") + step + " failed: " + strerror(errno));
+    }
+}
+
+void Application::registerAllocMetrics() {
+    // Looked up once: Metrics::counter() builds strings, which would count
+    for (int i = 0; i < AllocStats::SUBSYSTEM_COUNT; ++i) {
+        const std::string labels = std::string("subsystem=\"") +
+            AllocStats::name(static_cast<AllocStats::Subsystem>(i)) + "\"";
+        metric_allocs_[i] = &Metrics::global().counter(
+            "dropbear_app_allocations_total", "Heap allocations on the UI thread", labels);
+        metric_alloc_bytes_[i] = &Metrics::global().counter(
+            "dropbear_app_allocated_bytes_total", "Bytes requested from the heap on the UI thread", labels);
+    }
+    metric_last_frame_allocs_ = &Metrics::global().gauge(
+        "dropbear_app_last_frame_allocations", "Heap allocations during the most recent frame");
+}
+
+void Application::recordFrameAllocs(const AllocStats::Totals& frame) {
+    for (int i = 0; i < AllocStats::SUBSYSTEM_COUNT; ++i) {
+        metric_allocs_[i]->inc(static_cast<int64_t>(frame.by[i].allocs));
+        metric_alloc_bytes_[i]->inc(static_cast<int64_t>(frame.by[i].bytes));
+    }
+    metric_last_frame_allocs_->set(static_cast<int64_t>(frame.total().allocs));
+    last_frame_allocs_ = frame;
+}
+
 void Application::pushLogLine(const std::string& line) {
-    log_lines_.push_back(line);
-    if (log_lines_.size() > LogDisplay::MAX_LINES) {
-        // Trim oldest
-        log_lines_.erase(log_lines_.begin(),
-                        log_lines_.begin() + (log_lines_.size() - LogDisplay::MAX_LINES));
+    // The history's hot ring recycles line buffers once full
+    log_history_.append(line);
+    if (log_scroll_ > 0) ++log_scroll_;   // keep a scrolled view on the same lines
+    log_view_dirty_ = true;
+}
+
+void Application::configureLogHistory() {
+    const DropbearConfig& config = dropbear_manager_->config();
+    LogHistory::Settings settings;
+    settings.hot_lines = LogDisplay::MAX_LINES;
+    settings.block_bytes = static_cast<size_t>(config.log_block_kb) * 1024;
+    settings.cold_budget_bytes = static_cast<size_t>(config.log_history_kb) * 1024;
+    log_history_.configure(settings);
+    log_view_dirty_ = true;
+}
+
+void Application::configurePowerSave() {
+    const DropbearConfig& config = dropbear_manager_->config();
+    NetworkManager::PowerSaveSettings settings;
+    settings.manage = config.wifi_powersave_off;
+    settings.interface = config.wifi_interface;
+    settings.command = config.wifi_powersave_cmd;
+    settings.ssh_port = config.port;
+    settings.restore_delay_ms = Network::POWER_SAVE_RESTORE_DELAY_MS;
+    const std::string line = network_manager_->configurePowerSave(settings, SDL_GetTicks());
+    if (!line.empty()) pushLogLine(line);
+}
+
+void Application::updatePowerSave() {
+    const std::string line = network_manager_->updateSessions(dropbear_manager_->activeSessions(), SDL_GetTicks());
+    if (line.empty()) return;
+    pushLogLine(line);
+    refreshStatus();
+}
+
+void Application::scrollLogs(long lines) {
+    const long maxScroll = log_history_.size() > 0 ? static_cast<long>(log_history_.size()) - 1 : 0;
+    log_scroll_ = static_cast<size_t>(std::max(0L, std::min(maxScroll, static_cast<long>(log_scroll_) + lines)));
+    log_view_dirty_ = true;
+}
+
+void Application::refreshLogView() {
+    // Only a screenful is copied; scrolled-back lines decode one block at a time
+    const uint64_t first = log_history_.begin();
+    if (log_scroll_ >= log_history_.size()) {
+        log_scroll_ = log_history_.size() > 0 ? log_history_.size() - 1 : 0;
+    }
+    const uint64_t bottom = log_history_.end() - log_scroll_;
+    const uint64_t top = bottom - std::min<uint64_t>(bottom - first, LogDisplay::VIEW_LINES);
+    log_view_.resize(static_cast<size_t>(bottom - top));
+    for (uint64_t i = top; i < bottom; ++i) {
+        if (!log_history_.line(i, log_view_[static_cast<size_t>(i - top)])) {
+            log_view_[static_cast<size_t>(i - top)].assign("(log history unavailable)");
+        }
     }
+    log_view_dirty_ = false;
+}
+
+void Application::publishLogHistoryStats() {
+    const LogHistory::Stats s = log_history_.stats();
+    metric_history_lines_.set(static_cast<int64_t>(s.lines));
+    metric_history_blocks_.set(static_cast<int64_t>(s.blocks));
+    metric_history_raw_bytes_.set(static_cast<int64_t>(s.raw_bytes));
+    metric_history_compressed_bytes_.set(static_cast<int64_t>(s.compressed_bytes));
+    metric_history_footprint_bytes_.set(static_cast<int64_t>(s.footprint_bytes));
+    metric_history_decodes_.set(static_cast<int64_t>(s.decodes));
+    metric_history_decode_ns_.set(static_cast<int64_t>(s.decode_ns));
+}
+
+void Application::toggleProfiler() {
+    const DropbearConfig& config = dropbear_manager_->config();
+    SamplingProfiler::Settings settings;
+    settings.hz = config.profile_hz;
+    settings.children = config.profile_children;
+    const std::string line = SamplingProfiler::toggle(settings, PathHelper::profilePath());
+    pushLogLine(line);
 }
 
 void Application::sdlFail(const char* what) {
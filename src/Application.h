@@ -1,12 +1,18 @@
 #pragma once
 
+#include "AllocStats.h"
 #include "NetworkManager.h"
 #include "DropbearManager.h"
+#include "LogHistory.h"
 #include "Renderer.h"
+#include "Metrics.h"
+#include "MetricsExporter.h"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
+#include <atomic>
 #include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 class Application {
@@ -27,7 +33,22 @@ private:
     void initController();
     void handleEvent(const SDL_Event& e);
     void refreshIPAddrs();
+    void refreshStatus();
+    void recordStartupProgress();
+    void restartDropbear();
+    void applyUiSchedPolicy();
+    void registerAllocMetrics();
+    void recordFrameAllocs(const AllocStats::Totals& frame);
     void pushLogLine(const std::string& line);
+    void configureLogHistory();
+    void configurePowerSave();
+    void updatePowerSave();
+    void scrollLogs(long lines);
+    void refreshLogView();
+    void publishLogHistoryStats();
+    void toggleProfiler();
+    void bootDropbear();
+    void finishBoot();
     
     static void sdlFail(const char* what);
 
@@ -41,11 +62,55 @@ private:
     std::unique_ptr<NetworkManager> network_manager_;
     std::unique_ptr<DropbearManager> dropbear_manager_;
     std::unique_ptr<Renderer> renderer_;
+    std::unique_ptr<MetricsExporter> metrics_exporter_;
+
+    // Dropbear starts on boot_thread_ while SDL and the renderer come up; its
+    // log lines wait in boot_log_ until the log view exists
+    std::thread boot_thread_;
+    std::atomic<bool> ui_ready_{false};
+    int boot_wake_fd_ = -1;
+    bool booting_ = false;
+    std::vector<std::string> boot_log_;
 
     // State
     bool running_ = false;
     std::vector<std::string> ip_addrs_;
     std::vector<std::string> users_;
-    std::vector<std::string> log_lines_;
+    std::vector<std::string> status_lines_;
+    LogHistory log_history_;
+    std::vector<std::string> log_view_;       // lines on screen, copied out of log_history_
+    size_t log_scroll_ = 0;                   // lines back from the newest, 0 = live
+    bool log_view_dirty_ = true;
     Uint32 last_ip_refresh_ms_ = 0;
+    bool startup_trace_written_ = false;
+
+    // UI counters exported through MetricsExporter
+    Metrics::Metric& metric_frames_ = Metrics::global().counter(
+        "dropbear_app_frames_total", "Frames rendered");
+    Metrics::Metric& metric_frame_time_us_ = Metrics::global().counter(
+        "dropbear_app_frame_time_microseconds_total", "Time spent producing frames, excluding sleep");
+    Metrics::Metric& metric_last_frame_us_ = Metrics::global().gauge(
+        "dropbear_app_last_frame_time_microseconds", "Duration of the most recent frame");
+    Metrics::Metric& metric_first_frame_rss_kib_ = Metrics::global().gauge(
+        "dropbear_app_first_frame_peak_rss_kibibytes", "Peak resident set size when the first frame was drawn");
+    Metrics::Metric& metric_history_lines_ = Metrics::global().gauge(
+        "dropbear_app_log_history_lines", "Log lines retained for scrollback");
+    Metrics::Metric& metric_history_blocks_ = Metrics::global().gauge(
+        "dropbear_app_log_history_blocks", "Compressed log history blocks");
+    Metrics::Metric& metric_history_raw_bytes_ = Metrics::global().gauge(
+        "dropbear_app_log_history_raw_bytes", "Uncompressed size of the compressed log blocks");
+    Metrics::Metric& metric_history_compressed_bytes_ = Metrics::global().gauge(
+        "dropbear_app_log_history_compressed_bytes", "Compressed size of the log blocks");
+    Metrics::Metric& metric_history_footprint_bytes_ = Metrics::global().gauge(
+        "dropbear_app_log_history_footprint_bytes", "Heap held by the log history, including the on-screen lines");
+    Metrics::Metric& metric_history_decodes_ = Metrics::global().counter(
+        "dropbear_app_log_history_decodes_total", "Log history blocks decompressed for scrollback or search");
+    Metrics::Metric& metric_history_decode_ns_ = Metrics::global().counter(
+        "dropbear_app_log_history_decode_nanoseconds_total", "Time spent decompressing log history blocks");
+
+    // Per-frame heap accounting, only registered in ALLOC_STATS builds
+    AllocStats::Totals last_frame_allocs_;
+    Metrics::Metric* metric_allocs_[AllocStats::SUBSYSTEM_COUNT] = {};
+    Metrics::Metric* metric_alloc_bytes_[AllocStats::SUBSYSTEM_COUNT] = {};
+    Metrics::Metric* metric_last_frame_allocs_ = nullptr;
 };
@@ -0,0 +1,168 @@
+#include "AuthGuard.h"
+#include <arpa/inet.h>
+#include <cmath>
+#include <cstdlib>
+
+constexpr size_t AuthGuard::CAPACITY;
+constexpr size_t AuthGuard::PROBE_WINDOW;
+
+AuthGuard::AuthGuard() : AuthGuard(Settings()) {
+}
+
+AuthGuard::AuthGuard(const Settings& settings) : table_(CAPACITY) {
+    configure(settings);
+}
+
+void AuthGuard::configure(const Settings& settings) {
+    settings_ = settings;
+    allow_ = parseRules(settings.allowlist);
+    deny_ = parseRules(settings.denylist);
+}
+
+uint64_t AuthGuard::hashKey(const std::string& ip) {
+    // FNV-1a; 0 is reserved for empty slots
+    uint64_t h = 1469598103934665603ULL;
+    for (unsigned char c : ip) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    return h ? h : 1;
+}
+
+std::vector<AuthGuard::Rule> AuthGuard::parseRules(const std::string& list) {
+    std::vector<Rule> rules;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t comma = list.find(',', start);
+        if (comma == std::string::npos) comma = list.size();
+
+        std::string item = list.substr(start, comma - start);
+        size_t b = item.find_first_not_of(" \t");
+        size_t e = item.find_last_not_of(" \t");
+        item = (b == std::string::npos) ? "" : item.substr(b, e - b + 1);
+
+        if (!item.empty()) {
+            Rule rule;
+            size_t slash = item.find('/');
+            struct in_addr addr{};
+            if (slash != std::string::npos &&
+                inet_pton(AF_INET, item.substr(0, slash).c_str(), &addr) == 1) {
+                int bits = std::atoi(item.c_str() + slash + 1);
+                if (bits < 0) bits = 0;
+                if (bits > 32) bits = 32;
+                rule.cidr = true;
+                rule.mask = bits == 0 ? 0 : htonl(0xFFFFFFFFu << (32 - bits));
+                rule.network = addr.s_addr & rule.mask;
+            } else {
+                rule.exact = item;
+            }
+            rules.push_back(rule);
+        }
+        start = comma + 1;
+    }
+    return rules;
+}
+
+bool AuthGuard::matches(const std::vector<Rule>& rules, const std::string& ip) {
+    if (rules.empty()) return false;
+
+    struct in_addr addr{};
+    const bool isV4 = inet_pton(AF_INET, ip.c_str(), &addr) == 1;
+    for (const auto& rule : rules) {
+        if (rule.cidr) {
+            if (isV4 && (addr.s_addr & rule.mask) == rule.network) return true;
+        } else if (rule.exact == ip) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool AuthGuard::isAllowlisted(const std::string& ip) const {
+    return matches(allow_, ip);
+}
+
+float AuthGuard::decayedScore(const Entry& e, uint32_t nowSecs) const {
+    if (e.key == 0 || e.score <= 0.0f) return 0.0f;
+    const uint32_t elapsed = nowSecs > e.updated_secs ? nowSecs - e.updated_secs : 0;
+    if (settings_.decay_half_life_secs <= 0) return e.score;
+    return e.score * std::exp2(-static_cast<float>(elapsed) / settings_.decay_half_life_secs);
+}
+
+const AuthGuard::Entry* AuthGuard::find(uint64_t key) const {
+    const size_t mask = CAPACITY - 1;
+    for (size_t i = 0; i < PROBE_WINDOW; ++i) {
+        const Entry& e = table_[(key + i) & mask];
+        if (e.key == key) return &e;
+    }
+    return nullptr;
+}
+
+AuthGuard::Entry& AuthGuard::findOrRecycle(uint64_t key, uint32_t nowSecs) {
+    const size_t mask = CAPACITY - 1;
+    Entry* empty = nullptr;
+    Entry* victim = nullptr;
+    bool victimBlocked = false;
+    float victimRank = 0.0f;
+
+    for (size_t i = 0; i < PROBE_WINDOW; ++i) {
+        Entry& e = table_[(key + i) & mask];
+        if (e.key == key) return e;
+        if (e.key == 0) {
+            if (!empty) empty = &e;
+            continue;
+        }
+
+        // Recycle unblocked entries with the lowest decayed score first,
+        // then blocked entries that expire soonest
+        const bool blocked = e.blocked_until_secs > nowSecs;
+        const float rank = blocked ? static_cast<float>(e.blocked_until_secs - nowSecs)
+                                   : decayedScore(e, nowSecs);
+        if (!victim || (victimBlocked && !blocked) ||
+            (victimBlocked == blocked && rank < victimRank)) {
+            victim = &e;
+            victimBlocked = blocked;
+            victimRank = rank;
+        }
+    }
+
+    Entry& slot = empty ? *empty : *victim;
+    slot = Entry();
+    slot.key = key;
+    slot.updated_secs = nowSecs;
+    return slot;
+}
+
+bool AuthGuard::recordFailure(const std::string& ip, uint32_t nowSecs) {
+    if (settings_.max_failures <= 0 || ip.empty() || isAllowlisted(ip)) return false;
+
+    Entry& e = findOrRecycle(hashKey(ip), nowSecs);
+    e.score = decayedScore(e, nowSecs) + 1.0f;
+    e.updated_secs = nowSecs;
+
+    // Compare the rounded score so a burst of failures a few seconds apart
+    // still blocks on exactly the max_failures-th one
+    if (e.blocked_until_secs <= nowSecs && e.score + 0.5f >= settings_.max_failures) {
+        e.blocked_until_secs = nowSecs + static_cast<uint32_t>(settings_.block_secs);
+        return true;
+    }
+    return false;
+}
+
+bool AuthGuard::isBlocked(const std::string& ip, uint32_t nowSecs) const {
+    if (ip.empty() || isAllowlisted(ip)) return false;
+    if (matches(deny_, ip)) return true;
+
+    const Entry* e = find(hashKey(ip));
+    return e && e->blocked_until_secs > nowSecs;
+}
+
+AuthGuard::Stats AuthGuard::stats(uint32_t nowSecs) const {
+    Stats s;
+    for (const auto& e : table_) {
+        if (e.key == 0) continue;
+        if (e.blocked_until_secs > nowSecs) s.blocked++;
+        if (decayedScore(e, nowSecs) >= 0.5f) s.tracked++;
+    }
+    return s;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Tracks failed authentications per source address and decides which
+// addresses are blocked. State lives in a fixed-size open-addressing table
+// with a bounded probe window, so lookups and updates are O(1) regardless of
+// how many distinct attackers show up; when the window is full the least
+// suspicious unblocked entry is recycled.
+//
+// Failure scores decay exponentially (halving every decay_half_life_secs),
+// so a few typos spread over a day never add up to a block.
+class AuthGuard {
+public:
+    struct Settings {
+        int max_failures = 5;            // decayed score that triggers a block, 0 disables
+        int decay_half_life_secs = 300;
+        int block_secs = 600;
+        std::string allowlist;           // comma-separated IPs or IPv4 CIDRs, never blocked
+        std::string denylist;            // comma-separated IPs or IPv4 CIDRs, always blocked
+    };
+
+    struct Stats {
+        size_t tracked = 0;              // addresses with a live score
+        size_t blocked = 0;              // addresses currently blocked
+    };
+
+    static constexpr size_t CAPACITY = 2048;   // power of two
+    static constexpr size_t PROBE_WINDOW = 8;
+
+    AuthGuard();
+    explicit AuthGuard(const Settings& settings);
+
+    void configure(const Settings& settings);
+
+    // Records a failure; returns true when this failure caused a new block
+    bool recordFailure(const std::string& ip, uint32_t nowSecs);
+    bool isBlocked(const std::string& ip, uint32_t nowSecs) const;
+    bool isAllowlisted(const std::string& ip) const;
+
+    // O(CAPACITY) scan, meant for periodic status display only
+    Stats stats(uint32_t nowSecs) const;
+
+private:
+    struct Entry {
+        uint64_t key = 0;                // 0 marks an empty slot
+        float score = 0.0f;
+        uint32_t updated_secs = 0;
+        uint32_t blocked_until_secs = 0;
+    };
+
+    struct Rule {
+        bool cidr = false;
+        uint32_t network = 0;
+        uint32_t mask = 0;
+        std::string exact;
+    };
+
+    static uint64_t hashKey(const std::string& ip);
+    static std::vector<Rule> parseRules(const std::string& list);
+    static bool matches(const std::vector<Rule>& rules, const std::string& ip);
+
+    float decayedScore(const Entry& e, uint32_t nowSecs) const;
+    const Entry* find(uint64_t key) const;
+    Entry& findOrRecycle(uint64_t key, uint32_t nowSecs);
+
+    Settings settings_;
+    std::vector<Rule> allow_;
+    std::vector<Rule> deny_;
+    std::vector<Entry> table_;
+};
@@ -0,0 +1,87 @@
+#include "AuthLatencyTracker.h"
+#include <algorithm>
+
+constexpr size_t AuthLatencyTracker::MAX_PENDING;
+constexpr size_t AuthLatencyTracker::MAX_CLIENTS;
+
+void AuthLatencyTracker::onConnection(int pid, const std::string& clientIp, uint64_t nowUs) {
+    if (pid <= 0) return;
+    if (pending_.size() >= MAX_PENDING && pending_.find(pid) == pending_.end()) {
+        evictOldestPending();
+    }
+
+    Pending& p = pending_[pid];
+    p.client_ip = clientIp;
+    p.accepted_us = nowUs;
+    p.authed_us = 0;
+}
+
+void AuthLatencyTracker::onAuthSuccess(int pid, uint64_t nowUs) {
+    auto it = pending_.find(pid);
+    if (it == pending_.end() || it->second.authed_us != 0) return;
+
+    Pending& p = it->second;
+    p.authed_us = nowUs;
+    const uint64_t latency = nowUs > p.accepted_us ? nowUs - p.accepted_us : 0;
+    time_to_auth_.record(latency);
+    clientFor(p.client_ip, nowUs).time_to_auth.record(latency);
+}
+
+void AuthLatencyTracker::onSessionExit(int pid, uint64_t nowUs) {
+    auto it = pending_.find(pid);
+    if (it == pending_.end()) return;
+
+    const Pending& p = it->second;
+    if (p.authed_us != 0) {
+        session_length_.record(nowUs > p.authed_us ? nowUs - p.authed_us : 0);
+    }
+    pending_.erase(it);
+}
+
+void AuthLatencyTracker::forget(int pid) {
+    pending_.erase(pid);
+}
+
+void AuthLatencyTracker::evictOldestPending() {
+    // Only reached when exits go missing (e.g. dropbear restarted mid-session)
+    auto oldest = pending_.begin();
+    for (auto it = pending_.begin(); it != pending_.end(); ++it) {
+        if (it->second.accepted_us < oldest->second.accepted_us) oldest = it;
+    }
+    if (oldest != pending_.end()) pending_.erase(oldest);
+}
+
+AuthLatencyTracker::Client& AuthLatencyTracker::clientFor(const std::string& ip, uint64_t nowUs) {
+    auto it = clients_.find(ip);
+    if (it == clients_.end()) {
+        if (clients_.size() >= MAX_CLIENTS) {
+            auto stalest = clients_.begin();
+            for (auto c = clients_.begin(); c != clients_.end(); ++c) {
+                if (c->second.last_seen_us < stalest->second.last_seen_us) stalest = c;
+            }
+            clients_.erase(stalest);
+        }
+        it = clients_.emplace(ip, Client()).first;
+    }
+    it->second.last_seen_us = nowUs;
+    return it->second;
+}
+
+std::vector<AuthLatencyTracker::ClientSummary>
+AuthLatencyTracker::clientSummaries(size_t limit) const {
+    std::vector<std::pair<uint64_t, const std::pair<const std::string, Client>*>> order;
+    for (const auto& c : clients_) order.push_back({c.second.last_seen_us, &c});
+    std::sort(order.begin(), order.end(),
+              [](const decltype(order)::value_type& a, const decltype(order)::value_type& b) {
+                  return a.first > b.first;
+              });
+
+    std::vector<ClientSummary> out;
+    for (size_t i = 0; i < order.size() && i < limit; ++i) {
+        const auto& c = *order[i].second;
+        out.push_back({c.first, c.second.time_to_auth.count(),
+                       c.second.time_to_auth.percentile(0.50),
+                       c.second.time_to_auth.percentile(0.99)});
+    }
+    return out;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "LatencyHistogram.h"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Correlates dropbear log events by session child pid to measure, per client
+// and overall:
+//   time to auth     "Child connection from" -> "... auth succeeded"
+//   session length   auth succeeded -> "Exit (user)"
+// Timestamps are taken when the app reads each line (dropbear's own log
+// timestamps only have one-second resolution).
+class AuthLatencyTracker {
+public:
+    static constexpr size_t MAX_PENDING = 256;   // connections awaiting auth/exit
+    static constexpr size_t MAX_CLIENTS = 32;    // per-client histograms kept
+
+    struct ClientSummary {
+        std::string client_ip;
+        uint64_t count;
+        uint64_t p50_us;
+        uint64_t p99_us;
+    };
+
+    void onConnection(int pid, const std::string& clientIp, uint64_t nowUs);
+    void onAuthSuccess(int pid, uint64_t nowUs);
+    void onSessionExit(int pid, uint64_t nowUs);
+
+    // Pre-auth exits and killed connections; no latency is recorded
+    void forget(int pid);
+
+    const LatencyHistogram& timeToAuth() const { return time_to_auth_; }
+    const LatencyHistogram& sessionLength() const { return session_length_; }
+    size_t pendingCount() const { return pending_.size(); }
+
+    // Most recently active clients first
+    std::vector<ClientSummary> clientSummaries(size_t limit) const;
+
+private:
+    struct Pending {
+        std::string client_ip;
+        uint64_t accepted_us = 0;
+        uint64_t authed_us = 0;   // 0 until auth succeeded
+    };
+
+    struct Client {
+        LatencyHistogram time_to_auth;
+        uint64_t last_seen_us = 0;
+    };
+
+    void evictOldestPending();
+    Client& clientFor(const std::string& ip, uint64_t nowUs);
+
+    std::unordered_map<int, Pending> pending_;
+    std::map<std::string, Client> clients_;
+    LatencyHistogram time_to_auth_;
+    LatencyHistogram session_length_;
+};
@@ -0,0 +1,20 @@
+#include "BitmapFont.h"
+
+const BitmapFont::Glyph& BitmapFont::glyph(const Face& face, char c) {
+    unsigned idx = static_cast<unsigned char>(c) - face.first;
+    if (idx >= face.count) idx = static_cast<unsigned>('?' - face.first);
+    if (idx >= face.count) idx = 0;
+    return face.glyphs[idx];
+}
+
+bool BitmapFont::pixel(const Face& face, int x, int y) {
+    if (x < 0 || y < 0 || x >= face.atlas_width || y >= face.height) return false;
+    const uint8_t byte = face.bits[static_cast<size_t>(y) * rowBytes(face) + static_cast<size_t>(x) / 8];
+    return (byte >> (7 - x % 8)) & 1;
+}
+
+int BitmapFont::textWidth(const Face& face, const char* text) {
+    int width = 0;
+    for (const char* p = text; *p; ++p) width += glyph(face, *p).advance;
+    return width;
+}
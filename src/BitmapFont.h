@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// A 1-bit font face rasterized at build time by tools/font_bake (see the
+// Makefile's BAKED_FONT). All glyphs live in one atlas strip, face.height
+// pixels tall, with each glyph already placed relative to the ascent line, so
+// drawing a character is a single rect copy at (pen + bearing_x, top).
+class BitmapFont {
+public:
+    struct Glyph {
+        uint16_t atlas_x;     // left edge of the glyph's cell in the atlas
+        uint8_t width;        // cell width (0 for blank glyphs such as ' ')
+        int8_t bearing_x;     // cell offset from the pen position
+        uint8_t advance;      // pen advance after this glyph
+    };
+
+    struct Face {
+        uint8_t first;            // code of glyphs[0]
+        uint8_t count;
+        uint8_t height;           // line height (ascent + descent)
+        uint8_t ascent;
+        uint16_t atlas_width;
+        const Glyph* glyphs;
+        const uint8_t* bits;      // rows of (atlas_width + 7) / 8 bytes, MSB first
+    };
+
+    // Glyph for c; characters outside the baked range map to '?'
+    static const Glyph& glyph(const Face& face, char c);
+    static bool pixel(const Face& face, int x, int y);
+    static int textWidth(const Face& face, const char* text);
+    static size_t rowBytes(const Face& face) { return (face.atlas_width + 7u) / 8u; }
+};
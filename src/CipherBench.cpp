@@ -0,0 +1,187 @@
+#include "CipherBench.h"
+#include "SpawnHelper.h"
+#include <sys/auxv.h>
+#include <sys/utsname.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+constexpr const char* CACHE_HEADER = "# dropbear-app cipher benchmark v1";
+constexpr size_t MAX_HELPER_OUTPUT = 4096;
+
+bool isAead(const std::string& cipher) {
+    return cipher.find("poly1305") != std::string::npos || cipher.find("gcm") != std::string::npos;
+}
+
+std::string shortName(const std::string& name) {
+    const size_t at = name.find('@');
+    return at == std::string::npos ? name : name.substr(0, at);
+}
+
+double combined(double a, double b) {
+    return (a > 0 && b > 0) ? 1.0 / (1.0 / a + 1.0 / b) : 0;
+}
+
+} // namespace
+
+bool CipherBench::run(const std::string& helperPath, int msPerAlgorithm, Report& report, std::string& error) {
+    SpawnHelper::Request request;
+    request.path = helperPath;
+    request.args = {helperPath, std::to_string(msPerAlgorithm)};
+    request.log_pipe = true;
+    pid_t pid = -1;
+    int fd = -1;
+    if (!SpawnHelper::global().spawn(request, pid, fd, error)) return false;
+
+    // A handful of lines, then EOF when the helper exits
+    std::string output;
+    char buf[256];
+    for (;;) {
+        const ssize_t n = read(fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        if (output.size() < MAX_HELPER_OUTPUT) output.append(buf, static_cast<size_t>(n));
+    }
+    close(fd);
+    int status = 0;
+    if (SpawnHelper::global().wait(pid, &status, 0) != pid) {
+        error = std::string("waitpid failed: ") + strerror(errno);
+        return false;
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        error = helperPath + " exited with status " +
+                std::to_string(WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status));
+        return false;
+    }
+
+    Report measured;
+    measured.cpu = cpuSignature();
+    std::istringstream in(output);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!parseLine(line, measured)) {
+            error = "unexpected benchmark output: " + line;
+            return false;
+        }
+    }
+    if (measured.ciphers.empty() || measured.macs.empty()) {
+        error = helperPath + " measured no " + (measured.ciphers.empty() ? "ciphers" : "MACs");
+        return false;
+    }
+    report = std::move(measured);
+    return true;
+}
+
+bool CipherBench::parseLine(const std::string& line, Report& report) {
+    std::istringstream fields(line);
+    std::string kind;
+    Measurement m;
+    if (!(fields >> kind >> m.name >> m.mib_per_sec)) return false;
+    if (kind == "cipher") report.ciphers.push_back(m);
+    else if (kind == "mac") report.macs.push_back(m);
+    else return false;
+    return true;
+}
+
+bool CipherBench::save(const Report& report, const std::string& path, std::string& error) {
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) {
+        error = "cannot open " + path + ": " + strerror(errno);
+        return false;
+    }
+    fprintf(f, "%s\ncpu %s\n", CACHE_HEADER, report.cpu.c_str());
+    for (const auto& m : report.ciphers) fprintf(f, "cipher %s %.2f\n", m.name.c_str(), m.mib_per_sec);
+    for (const auto& m : report.macs) fprintf(f, "mac %s %.2f\n", m.name.c_str(), m.mib_per_sec);
+    if (fclose(f) != 0) {
+        error = "write " + path + " failed: " + strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+bool CipherBench::load(const std::string& path, Report& report) {
+    std::ifstream in(path);
+    std::string line;
+    if (!in || !std::getline(in, line) || line != CACHE_HEADER) return false;
+
+    Report loaded;
+    while (std::getline(in, line)) {
+        if (line.compare(0, 4, "cpu ") == 0) {
+            loaded.cpu = line.substr(4);
+            continue;
+        }
+        if (!parseLine(line, loaded)) return false;
+    }
+    if (loaded.cpu != cpuSignature() || loaded.ciphers.empty() || loaded.macs.empty()) return false;
+    report = std::move(loaded);
+    return true;
+}
+
+std::string CipherBench::cpuSignature() {
+    struct utsname u{};
+    std::string machine = uname(&u) == 0 ? u.machine : "unknown";
+    char buf[96];
+    snprintf(buf, sizeof(buf), " hwcap=0x%lx hwcap2=0x%lx", getauxval(AT_HWCAP), getauxval(AT_HWCAP2));
+    return machine + buf;
+}
+
+std::vector<CipherBench::Measurement> CipherBench::rankCiphers(const Report& report) {
+    const std::vector<Measurement> macs = rankMacs(report);
+    const double bestMac = macs.empty() ? 0 : macs.front().mib_per_sec;
+    std::vector<Measurement> ranked;
+    for (const auto& c : report.ciphers) {
+        ranked.push_back({c.name, isAead(c.name) ? c.mib_per_sec : combined(c.mib_per_sec, bestMac)});
+    }
+    std::stable_sort(ranked.begin(), ranked.end(), [](const Measurement& a, const Measurement& b) {
+        return a.mib_per_sec > b.mib_per_sec;
+    });
+    return ranked;
+}
+
+std::vector<CipherBench::Measurement> CipherBench::rankMacs(const Report& report) {
+    std::vector<Measurement> ranked = report.macs;
+    std::stable_sort(ranked.begin(), ranked.end(), [](const Measurement& a, const Measurement& b) {
+        return a.mib_per_sec > b.mib_per_sec;
+    });
+    return ranked;
+}
+
+std::string CipherBench::clientOptions(const Report& report) {
+    std::string out = "-c ";
+    const std::vector<Measurement> ciphers = rankCiphers(report);
+    for (size_t i = 0; i < ciphers.size(); ++i) out += (i ? "," : "") + ciphers[i].name;
+    out += " -m ";
+    const std::vector<Measurement> macs = rankMacs(report);
+    for (size_t i = 0; i < macs.size(); ++i) out += (i ? "," : "") + macs[i].name;
+    return out;
+}
+
+std::vector<std::string> CipherBench::describe(const Report& report) {
+    std::vector<std::string> lines;
+    const std::vector<Measurement> ciphers = rankCiphers(report);
+    const std::vector<Measurement> macs = rankMacs(report);
+    if (ciphers.empty() || macs.empty()) return lines;
+
+    char buf[160];
+    std::string best = shortName(ciphers.front().name);
+    if (!isAead(ciphers.front().name)) best += " + " + macs.front().name;
+    snprintf(buf, sizeof(buf), "Fastest cipher: %s (%.0f MiB/s)", best.c_str(), ciphers.front().mib_per_sec);
+    lines.push_back(buf);
+
+    std::string line = "  ";
+    for (size_t i = 1; i < ciphers.size(); ++i) {
+        snprintf(buf, sizeof(buf), "%s%s %.0f", i > 1 ? ", " : "", shortName(ciphers[i].name).c_str(),
+                 ciphers[i].mib_per_sec);
+        line += buf;
+    }
+    lines.push_back(line + " MiB/s");
+    lines.push_back("  ssh " + clientOptions(report));
+    return lines;
+}
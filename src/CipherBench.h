@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Measures how fast this CPU runs the SSH ciphers and MACs the bundled
+// dropbear offers, so the fastest can be recommended. AES in CTR mode vs
+// ChaCha20-Poly1305 varies a lot between SoCs.
+//
+// The timing is done by the bundled cipher-bench helper
+// (tools/cipher_bench.cpp), which is linked against the libtomcrypt built for
+// dropbear, so the ranking is of the code dropbear itself runs. This class
+// runs it and parses, caches and ranks its "cipher NAME MIBS" lines.
+//
+// Results are cached in a small text file keyed by CPU signature, so the
+// benchmark runs on first launch only (or after moving to another device).
+class CipherBench {
+public:
+    struct Measurement {
+        std::string name;                // SSH algorithm name
+        double mib_per_sec;
+    };
+
+    struct Report {
+        std::string cpu;                 // cpuSignature() at measurement time
+        std::vector<Measurement> ciphers;   // AEAD ciphers include their MAC
+        std::vector<Measurement> macs;
+    };
+
+    // Runs the helper at helperPath, which times each algorithm for about
+    // msPerAlgorithm. Blocks until it exits.
+    static bool run(const std::string& helperPath, int msPerAlgorithm, Report& report, std::string& error);
+    // Appends one "cipher NAME MIBS" or "mac NAME MIBS" line
+    static bool parseLine(const std::string& line, Report& report);
+
+    static bool save(const Report& report, const std::string& path, std::string& error);
+    // False if missing, unreadable, or measured on a different CPU
+    static bool load(const std::string& path, Report& report);
+
+    // Machine plus hardware capability bits, e.g. "aarch64 hwcap=0x...".
+    static std::string cpuSignature();
+
+    // Ciphers fastest first, with the best MAC charged to non-AEAD ciphers
+    static std::vector<Measurement> rankCiphers(const Report& report);
+    static std::vector<Measurement> rankMacs(const Report& report);
+    // ssh(1) options that put the measured order first, e.g. "-c a,b -m x,y"
+    static std::string clientOptions(const Report& report);
+    static std::vector<std::string> describe(const Report& report);
+};
@@ -25,5 +25,6 @@ struct Color {
     static constexpr Color Yellow() { return {255, 255, 100, 255}; }
     static constexpr Color LightGreen() { return {180, 255, 180, 255}; }
     static constexpr Color LightBlue() { return {200, 200, 255, 255}; }
+    static constexpr Color LightRed() { return {255, 150, 150, 255}; }
     static constexpr Color DarkBackground() { return {40, 40, 60, 255}; }
 };
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 // Display constants
 namespace Display {
     constexpr int WIDTH = 1280;
@@ -10,18 +13,106 @@ namespace Display {
 
 // Log display constants
 namespace LogDisplay {
-    constexpr size_t MAX_LINES = 300;
+    constexpr size_t MAX_LINES = 300;         // hot (uncompressed) lines in LogHistory
+    constexpr size_t VIEW_LINES = 32;         // at most a screenful is copied out per change
+    constexpr size_t SCROLL_STEP = 5;         // D-pad up/down
+    constexpr size_t SCROLL_PAGE = 25;        // L1/R1
+    constexpr int MAX_HISTORY_KB = 64 * 1024;
+    constexpr int MAX_BLOCK_KB = 1024;
     constexpr int LINE_HEIGHT = 22;
     constexpr int FONT_SIZE = 18;
 }
 
+// Dropbear's log pipe and the relay thread draining it (LogRelay)
+namespace LogPipe {
+    constexpr int MAX_PIPE_KB = 16 * 1024;
+    constexpr int MIN_BUFFER_KB = 4;          // at least one line of MAX_LINE_BYTES fits
+    constexpr int MAX_BUFFER_KB = 16 * 1024;
+    constexpr size_t READ_CHUNK = 16 * 1024;
+    constexpr int READS_PER_FLUSH = 16;
+    constexpr size_t MAX_LINE_BYTES = 4096;   // longer lines are forwarded in pieces
+    constexpr int IOV_BATCH = 64;
+    constexpr size_t SPARE_LINES = 256;       // line buffers kept for reuse
+}
+
 // Network refresh settings
 namespace Network {
     constexpr uint32_t IP_REFRESH_PERIOD_MS = 2000;
+    constexpr uint32_t POWER_SAVE_RESTORE_DELAY_MS = 5000;   // bridges back-to-back scp runs
+    constexpr uint32_t RTT_SETTLE_MS = 2000;   // smoothed RTT still reflects the old power save state
+    constexpr int POWER_SAVE_COMMAND_TIMEOUT_MS = 2000;   // a wifi_powersave_cmd run is killed after this
+    constexpr uint32_t POWER_SAVE_POLL_MS = 50;   // headless wake-up while a command switch runs
 }
 
+// Compile-time SFTPSERVER_PATH baked into dropbear (see Makefile)
+#ifndef SFTP_SERVER_LINK
+#define SFTP_SERVER_LINK "/tmp/dropbear-app/sftp-server"
+#endif
+
 // Dropbear process constants
 namespace Dropbear {
     constexpr int MAX_WAIT_ATTEMPTS = 20;
     constexpr int WAIT_DELAY_MS = 10;
+    constexpr const char* SFTP_SERVER_LINK_PATH = SFTP_SERVER_LINK;
+    // Fixed path tools/delta_sync runs over SSH (`delta_sync push --remote`)
+    constexpr const char* DELTA_SYNC_LINK_PATH = "/tmp/dropbear-app/delta-sync";
+    // Boot thread's log poll; finishBoot() wakes it sooner through an eventfd
+    constexpr int BOOT_POLL_MS = 100;
+}
+
+// Limits accepted in dropbear.conf
+namespace DropbearTuning {
+    constexpr long MAX_RECEIVE_WINDOW = 10 * 1024 * 1024; // dropbear's MAX_RECV_WINDOW
+    constexpr long MAX_TIMEOUT_SECS = 24 * 60 * 60;
+    constexpr long MAX_AUTH_TRIES = 100;
+}
+
+// Metrics export settings
+namespace MetricsExport {
+    constexpr int FILE_PERIOD_MS = 5000;
+    constexpr int POLL_INTERVAL_MS = 250;   // only used if the wake pipe can't be created
+    constexpr const char* SOCKET_PATH = "/tmp/dropbear-app/metrics.sock";
+}
+
+// Built-in SSH liveness probe (connects to the local listener)
+namespace Probe {
+    constexpr int TIMEOUT_MS = 2000;          // no banner by then counts as a failure
+    constexpr int SPIKE_MS = 1000;            // slower banners count toward a restart
+    constexpr int MAX_INTERVAL_SECS = 3600;
+    constexpr int MAX_FAILURES = 100;
+    // A probe's dropbear child that hasn't logged its exit by then was killed
+    constexpr uint64_t CHILD_EXPIRY_MS = 60000;
+}
+
+// --headless daemon settings
+namespace Headless {
+    constexpr uint32_t REFRESH_PERIOD_MS = 10000;     // IP / guard status housekeeping
+    constexpr uint32_t RESTART_BACKOFF_MS = 5000;     // before relaunching a dead dropbear
+    constexpr size_t LOG_MAX_BYTES = 1024 * 1024;     // rotate to <log>.1 beyond this
+}
+
+// Built-in sampling profiler (SELECT + X or SIGUSR2)
+namespace Profiler {
+    constexpr int DEFAULT_HZ = 99;            // off the 100 Hz tick so samples don't alias
+    constexpr int MAX_HZ = 1000;
+    constexpr size_t MAX_SAMPLES = 16384;     // preallocated per run; ~2.7 min of one busy core
+    constexpr int MAX_DEPTH = 32;             // frames kept per sample
+    constexpr uint32_t CHILD_RESCAN_MS = 1000;
+}
+
+// First-launch cipher/MAC throughput benchmark
+namespace CipherBenchmark {
+    constexpr int MS_PER_ALGORITHM = 150;     // six timed primitives: about a second on one core
+}
+
+// Startup trace event names shared between components
+namespace Trace {
+    // Dropbear logs this right before binding its listening sockets
+    constexpr const char* DROPBEAR_LISTEN_MARKER = "Not backgrounding";
+    constexpr const char* DROPBEAR_LISTEN_FAILED_MARKER = "Failed listening";
+    constexpr const char* DROPBEAR_LISTENING = "dropbear listening";
+    constexpr const char* DROPBEAR_LISTEN_FAILED = "dropbear listen failed";
+    constexpr const char* SSH_PORT_OPEN = "ssh port open";
+    constexpr int PORT_OPEN_WAIT_MS = 1000;   // after the listen marker, for the LISTEN socket
+    constexpr int PORT_CHECK_MS = 2;          // loop wake-up while waiting for it
 }
@@ -0,0 +1,455 @@
+#include "DeltaSync.h"
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+constexpr size_t OUT_BUFFER = 1024 * 1024;
+
+uint64_t rotl(uint64_t v, int r) {
+    return (v << r) | (v >> (64 - r));
+}
+
+uint64_t fmix(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xFF51AFD7ED558CCDull;
+    k ^= k >> 33;
+    k *= 0xC4CEB9FE1A85EC53ull;
+    k ^= k >> 33;
+    return k;
+}
+
+uint64_t nowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Fills buf from fd until len bytes or EOF; returns bytes read or -1
+ssize_t readFully(int fd, char* buf, size_t len) {
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = read(fd, buf + got, len - got);
+        if (n == 0) break;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        got += static_cast<size_t>(n);
+    }
+    return static_cast<ssize_t>(got);
+}
+
+bool writeFully(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+uint64_t blockLen(const DeltaSync::Signature& sig, size_t idx) {
+    if (idx + 1 < sig.blocks.size()) return sig.block_size;
+    return sig.file_size - static_cast<uint64_t>(idx) * sig.block_size;
+}
+
+} // namespace
+
+// --- hashing ---------------------------------------------------------------
+
+void DeltaSync::Hasher::mix(uint64_t w) {
+    w *= 0x87C37B91114253D5ull;
+    w = rotl(w, 31);
+    w *= 0x4CF5AD432745937Full;
+    h_ ^= w;
+    h_ = rotl(h_, 27) * 5 + 0x52DCE729;
+}
+
+void DeltaSync::Hasher::update(const char* data, size_t len) {
+    total_ += len;
+    if (tail_len_ > 0) {
+        while (tail_len_ < 8 && len > 0) {
+            tail_[tail_len_++] = static_cast<unsigned char>(*data++);
+            --len;
+        }
+        if (tail_len_ < 8) return;
+        uint64_t w;
+        std::memcpy(&w, tail_, 8);
+        mix(w);
+        tail_len_ = 0;
+    }
+    while (len >= 8) {
+        uint64_t w;
+        std::memcpy(&w, data, 8);
+        mix(w);
+        data += 8;
+        len -= 8;
+    }
+    std::memcpy(tail_, data, len);
+    tail_len_ = static_cast<unsigned>(len);
+}
+
+uint64_t DeltaSync::Hasher::digest() const {
+    uint64_t h = h_;
+    if (tail_len_ > 0) {
+        uint64_t w = 0;
+        std::memcpy(&w, tail_, tail_len_);
+        w *= 0x87C37B91114253D5ull;
+        w = rotl(w, 31);
+        w *= 0x4CF5AD432745937Full;
+        h ^= w;
+    }
+    return fmix(h ^ total_);
+}
+
+uint64_t DeltaSync::strongHash(const char* data, size_t len) {
+    Hasher h;
+    h.update(data, len);
+    return h.digest();
+}
+
+// rsync's checksum: a = sum of bytes, b = sum of running a, both mod 2^16
+uint32_t DeltaSync::weakChecksum(const char* data, size_t len) {
+    uint32_t a = 0, b = 0;
+    for (size_t i = 0; i < len; ++i) {
+        a += static_cast<unsigned char>(data[i]);
+        b += a;
+    }
+    return (a & 0xFFFF) | (b << 16);
+}
+
+uint32_t DeltaSync::rollWeak(uint32_t weak, unsigned char out, unsigned char in, size_t len) {
+    uint32_t a = weak & 0xFFFF;
+    uint32_t b = weak >> 16;
+    a = (a - out + in) & 0xFFFF;
+    b = (b - static_cast<uint32_t>(len) * out + a) & 0xFFFF;
+    return a | (b << 16);
+}
+
+uint32_t DeltaSync::blockSizeFor(uint64_t fileSize) {
+    uint64_t bs = static_cast<uint64_t>(std::sqrt(static_cast<double>(fileSize)));
+    bs = (bs + 1023) & ~static_cast<uint64_t>(1023);
+    return static_cast<uint32_t>(std::min<uint64_t>(MAX_BLOCK, std::max<uint64_t>(MIN_BLOCK, bs)));
+}
+
+// --- signatures ------------------------------------------------------------
+
+DeltaSync::Signature DeltaSync::signBuffer(const char* data, size_t len, uint32_t blockSize) {
+    Signature sig;
+    sig.exists = true;
+    sig.block_size = blockSize;
+    sig.file_size = len;
+    for (size_t off = 0; off < len; off += blockSize) {
+        const size_t n = std::min<size_t>(blockSize, len - off);
+        BlockSig b;
+        b.weak = weakChecksum(data + off, n);
+        b.strong = strongHash(data + off, n);
+        sig.blocks.push_back(b);
+    }
+    return sig;
+}
+
+bool DeltaSync::sign(const std::vector<std::string>& paths, std::vector<Signature>& out,
+                     const SignOptions& options, SignStats* stats, std::string& error) {
+    const uint64_t start = nowMicros();
+    out.assign(paths.size(), Signature());
+
+    unsigned threads = options.threads ? options.threads : std::thread::hardware_concurrency();
+    threads = std::max(1u, threads);
+    const size_t bufSize = std::max<size_t>(options.read_size, MAX_BLOCK);
+
+    struct Job {
+        size_t file;
+        uint64_t first_block;
+        char* buf;
+        size_t len;
+    };
+
+    // Two buffers per worker: one being hashed, one being filled
+    std::vector<std::vector<char>> storage(threads * 2, std::vector<char>(bufSize));
+    std::vector<char*> freeBufs;
+    for (auto& s : storage) freeBufs.push_back(s.data());
+    std::deque<Job> jobs;
+    std::mutex mutex;
+    std::condition_variable jobReady, bufFree;
+    bool done = false;
+
+    auto worker = [&]() {
+        for (;;) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                jobReady.wait(lock, [&]() { return done || !jobs.empty(); });
+                if (jobs.empty()) return;
+                job = jobs.front();
+                jobs.pop_front();
+            }
+            Signature& sig = out[job.file];
+            uint64_t idx = job.first_block;
+            for (size_t off = 0; off < job.len; off += sig.block_size, ++idx) {
+                const size_t n = std::min<size_t>(sig.block_size, job.len - off);
+                sig.blocks[idx].weak = weakChecksum(job.buf + off, n);
+                sig.blocks[idx].strong = strongHash(job.buf + off, n);
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                freeBufs.push_back(job.buf);
+            }
+            bufFree.notify_one();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned i = 0; i < threads; ++i) pool.emplace_back(worker);
+
+    uint64_t totalBytes = 0;
+    std::vector<uint64_t> actualSize(paths.size(), 0);
+    bool ok = true;
+    for (size_t f = 0; f < paths.size() && ok; ++f) {
+        int fd = open(paths[f].c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) continue;   // missing: no old copy
+        struct stat st;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            close(fd);
+            continue;
+        }
+        Signature& sig = out[f];
+        sig.exists = true;
+        sig.file_size = static_cast<uint64_t>(st.st_size);
+        sig.block_size = blockSizeFor(sig.file_size);
+        sig.blocks.resize(static_cast<size_t>((sig.file_size + sig.block_size - 1) / sig.block_size));
+#ifdef POSIX_FADV_SEQUENTIAL
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        const size_t chunk = bufSize / sig.block_size * sig.block_size;
+        uint64_t offset = 0;
+        while (offset < sig.file_size) {
+            char* buf;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                bufFree.wait(lock, [&]() { return !freeBufs.empty(); });
+                buf = freeBufs.back();
+                freeBufs.pop_back();
+            }
+            const size_t want = static_cast<size_t>(std::min<uint64_t>(chunk, sig.file_size - offset));
+            const ssize_t got = readFully(fd, buf, want);
+            if (got < 0) {
+                error = paths[f] + ": " + strerror(errno);
+                ok = false;
+            }
+            if (got <= 0) {
+                std::lock_guard<std::mutex> lock(mutex);
+                freeBufs.push_back(buf);
+                break;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                jobs.push_back({f, offset / sig.block_size, buf, static_cast<size_t>(got)});
+            }
+            jobReady.notify_one();
+            offset += static_cast<uint64_t>(got);
+            if (static_cast<size_t>(got) < want) break;   // file shrank while reading
+        }
+        actualSize[f] = offset;
+        totalBytes += offset;
+        close(fd);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+    }
+    jobReady.notify_all();
+    for (auto& t : pool) t.join();
+
+    // Trim files that shrank under us, now that no worker writes to them
+    for (size_t f = 0; f < out.size(); ++f) {
+        Signature& sig = out[f];
+        if (!sig.exists || actualSize[f] == sig.file_size) continue;
+        // The worker hashed the short final chunk as a short last block
+        sig.file_size = actualSize[f];
+        sig.blocks.resize(static_cast<size_t>((sig.file_size + sig.block_size - 1) / sig.block_size));
+    }
+
+    if (stats) {
+        stats->bytes = totalBytes;
+        stats->elapsed_us = nowMicros() - start;
+        stats->threads = threads;
+    }
+    return ok;
+}
+
+// --- delta -------------------------------------------------------------------
+
+bool DeltaSync::diff(const Signature& sig, const char* data, size_t len, Sink& sink) {
+    if (!sig.exists || sig.blocks.empty() || sig.block_size == 0) {
+        return len == 0 || sink.literal(data, len);
+    }
+
+    const size_t bs = sig.block_size;
+    const size_t nb = sig.blocks.size();
+
+    // Chained hash table over weak checksums, chains in ascending block order
+    size_t tableSize = 1;
+    while (tableSize < nb * 2) tableSize <<= 1;
+    const size_t mask = tableSize - 1;
+    std::vector<int64_t> head(tableSize, -1);
+    std::vector<int64_t> next(nb, -1);
+    for (size_t i = nb; i-- > 0;) {
+        const size_t slot = (sig.blocks[i].weak * 2654435761u) & mask;
+        next[i] = head[slot];
+        head[slot] = static_cast<int64_t>(i);
+    }
+
+    // Finds a block equal to p[0, n); tries `preferred` first so runs stay contiguous
+    auto find = [&](uint32_t weak, const char* p, size_t n, uint64_t preferred) -> int64_t {
+        bool haveStrong = false;
+        uint64_t strong = 0;
+        auto matches = [&](size_t i) {
+            if (sig.blocks[i].weak != weak || blockLen(sig, i) != n) return false;
+            if (!haveStrong) {
+                strong = strongHash(p, n);
+                haveStrong = true;
+            }
+            return sig.blocks[i].strong == strong;
+        };
+        if (preferred < nb && matches(static_cast<size_t>(preferred))) return static_cast<int64_t>(preferred);
+        for (int64_t i = head[(weak * 2654435761u) & mask]; i >= 0; i = next[i]) {
+            if (matches(static_cast<size_t>(i))) return i;
+        }
+        return -1;
+    };
+
+    uint64_t runFirst = 0, runCount = 0;
+    auto flushRun = [&]() {
+        bool ok = runCount == 0 || sink.copyBlocks(runFirst, runCount);
+        runCount = 0;
+        return ok;
+    };
+    auto addBlock = [&](uint64_t idx) {
+        if (runCount > 0 && idx == runFirst + runCount) {
+            ++runCount;
+            return true;
+        }
+        if (!flushRun()) return false;
+        runFirst = idx;
+        runCount = 1;
+        return true;
+    };
+    auto emitLiteral = [&](size_t from, size_t to) {
+        if (from == to) return true;
+        return flushRun() && sink.literal(data + from, to - from);
+    };
+
+    size_t pos = 0;
+    size_t lit = 0;   // start of pending literal bytes
+    uint32_t weak = len >= bs ? weakChecksum(data, bs) : 0;
+    while (pos + bs <= len) {
+        const int64_t idx = find(weak, data + pos, bs, runCount ? runFirst + runCount : nb);
+        if (idx >= 0) {
+            if (!emitLiteral(lit, pos) || !addBlock(static_cast<uint64_t>(idx))) return false;
+            pos += bs;
+            lit = pos;
+            if (pos + bs <= len) weak = weakChecksum(data + pos, bs);
+        } else {
+            if (pos + bs < len) {
+                weak = rollWeak(weak, static_cast<unsigned char>(data[pos]),
+                                static_cast<unsigned char>(data[pos + bs]), bs);
+            }
+            ++pos;
+        }
+    }
+
+    // A tail as long as the old short last block may still match it
+    const size_t tail = len - pos;
+    if (tail > 0 && tail < bs) {
+        const int64_t idx = find(weakChecksum(data + pos, tail), data + pos, tail, nb - 1);
+        if (idx >= 0) {
+            if (!emitLiteral(lit, pos) || !addBlock(static_cast<uint64_t>(idx))) return false;
+            lit = len;
+        }
+    }
+    return emitLiteral(lit, len) && flushRun();
+}
+
+// --- patching ----------------------------------------------------------------
+
+DeltaSync::Patcher::Patcher(int oldFd, uint32_t blockSize, uint64_t oldSize, int outFd)
+    : old_fd_(oldFd), block_size_(blockSize), old_size_(oldSize), out_fd_(outFd) {
+    out_.reserve(OUT_BUFFER);
+}
+
+bool DeltaSync::Patcher::put(const char* data, size_t len) {
+    hasher_.update(data, len);
+    if (out_.size() + len > OUT_BUFFER && !flush()) return false;
+    if (len >= OUT_BUFFER) {
+        if (!writeFully(out_fd_, data, len)) {
+            error_ = std::string("write: ") + strerror(errno);
+            return false;
+        }
+        return true;
+    }
+    out_.insert(out_.end(), data, data + len);
+    return true;
+}
+
+bool DeltaSync::Patcher::flush() {
+    if (!out_.empty() && !writeFully(out_fd_, out_.data(), out_.size())) {
+        error_ = std::string("write: ") + strerror(errno);
+        return false;
+    }
+    out_.clear();
+    return true;
+}
+
+bool DeltaSync::Patcher::copyBlocks(uint64_t first, uint64_t count) {
+    if (old_fd_ < 0 || block_size_ == 0) {
+        error_ = "block reference without an old copy";
+        return false;
+    }
+    uint64_t off = first * block_size_;
+    const uint64_t end = std::min(old_size_, (first + count) * block_size_);
+    if (count == 0 || off >= end) {
+        error_ = "block reference out of range";
+        return false;
+    }
+    if (in_.empty()) in_.resize(OUT_BUFFER);
+    while (off < end) {
+        const size_t want = static_cast<size_t>(std::min<uint64_t>(in_.size(), end - off));
+        ssize_t n = pread(old_fd_, in_.data(), want, static_cast<off_t>(off));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            error_ = n < 0 ? std::string("read: ") + strerror(errno) : "old copy shrank";
+            return false;
+        }
+        if (!put(in_.data(), static_cast<size_t>(n))) return false;
+        off += static_cast<uint64_t>(n);
+        copied_ += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+bool DeltaSync::Patcher::literal(const char* data, size_t len) {
+    literal_ += len;
+    return put(data, len);
+}
+
+bool DeltaSync::Patcher::finish(uint64_t& digest) {
+    if (!flush()) return false;
+    digest = hasher_.digest();
+    return true;
+}
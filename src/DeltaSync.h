@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// rsync-style delta transfer primitives behind tools/delta_sync.
+//
+// The side that holds the old copy splits it into fixed-size blocks and sends
+// a signature: a rolling weak checksum and a 64-bit strong hash per block.
+// The side with the new copy slides a window over its file. Every offset
+// whose weak checksum (and then strong hash) matches an old block becomes a
+// block reference; the remaining bytes are sent as literals. A Patcher
+// rebuilds the new file from the old one plus that stream, and a whole-file
+// digest catches any false match.
+//
+// The hash is not cryptographic: both ends are already inside an
+// authenticated SSH session, and the digest only guards against collisions.
+class DeltaSync {
+public:
+    struct BlockSig {
+        uint32_t weak = 0;
+        uint64_t strong = 0;
+    };
+
+    struct Signature {
+        bool exists = false;             // false: no old copy, send everything
+        uint32_t block_size = 0;
+        uint64_t file_size = 0;
+        std::vector<BlockSig> blocks;    // last block may be short
+    };
+
+    struct SignOptions {
+        unsigned threads = 0;            // hashing workers, 0 = one per core
+        size_t read_size = 1024 * 1024;  // bytes per sequential read()
+    };
+
+    struct SignStats {
+        uint64_t bytes = 0;
+        uint64_t elapsed_us = 0;
+        unsigned threads = 0;
+    };
+
+    // Receives a delta: runs of old blocks and literal bytes, in file order
+    class Sink {
+    public:
+        virtual ~Sink() = default;
+        virtual bool copyBlocks(uint64_t first, uint64_t count) = 0;
+        virtual bool literal(const char* data, size_t len) = 0;
+    };
+
+    // Incremental form of strongHash(); feeding the same bytes in any
+    // chunking gives the same digest
+    class Hasher {
+    public:
+        void update(const char* data, size_t len);
+        uint64_t digest() const;
+
+    private:
+        void mix(uint64_t word);
+
+        uint64_t h_ = 0x243F6A8885A308D3ull;
+        uint64_t total_ = 0;
+        unsigned char tail_[8];
+        unsigned tail_len_ = 0;
+    };
+
+    // Writes the new file to outFd from the old copy (oldFd, -1 if none) and
+    // a delta. Output is buffered into large writes.
+    class Patcher : public Sink {
+    public:
+        Patcher(int oldFd, uint32_t blockSize, uint64_t oldSize, int outFd);
+
+        bool copyBlocks(uint64_t first, uint64_t count) override;
+        bool literal(const char* data, size_t len) override;
+
+        // Flushes; the digest of everything written
+        bool finish(uint64_t& digest);
+
+        uint64_t copiedBytes() const { return copied_; }
+        uint64_t literalBytes() const { return literal_; }
+        const std::string& error() const { return error_; }
+
+    private:
+        bool put(const char* data, size_t len);
+        bool flush();
+
+        int old_fd_;
+        uint32_t block_size_;
+        uint64_t old_size_;
+        int out_fd_;
+        std::vector<char> out_;
+        std::vector<char> in_;
+        Hasher hasher_;
+        uint64_t copied_ = 0;
+        uint64_t literal_ = 0;
+        std::string error_;
+    };
+
+    static constexpr uint32_t MIN_BLOCK = 2 * 1024;
+    static constexpr uint32_t MAX_BLOCK = 128 * 1024;
+
+    static uint32_t weakChecksum(const char* data, size_t len);
+    // Slides a len-byte window one byte: drops out, appends in
+    static uint32_t rollWeak(uint32_t weak, unsigned char out, unsigned char in, size_t len);
+    static uint64_t strongHash(const char* data, size_t len);
+
+    // ~sqrt(size) rounded up to 1 KiB, within [MIN_BLOCK, MAX_BLOCK]
+    static uint32_t blockSizeFor(uint64_t fileSize);
+
+    // Signatures for several files. One thread reads each file front to back
+    // in read_size chunks (sequential I/O suits SD cards); a pool of workers
+    // hashes the chunks. Unreadable or missing files get exists = false.
+    static bool sign(const std::vector<std::string>& paths, std::vector<Signature>& out,
+                     const SignOptions& options, SignStats* stats, std::string& error);
+
+    // Single-threaded signature of an in-memory copy
+    static Signature signBuffer(const char* data, size_t len, uint32_t blockSize);
+
+    // Emits the delta that turns sig's file into data[0, len)
+    static bool diff(const Signature& sig, const char* data, size_t len, Sink& sink);
+};
@@ -0,0 +1,197 @@
+#include "DropbearConfig.h"
+#include "Constants.h"
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+
+namespace {
+
+struct IntOption {
+    const char* key;
+    int DropbearConfig::* field;
+    long min;
+    long max;
+};
+
+struct StringOption {
+    const char* key;
+    std::string DropbearConfig::* field;
+};
+
+struct BoolOption {
+    const char* key;
+    bool DropbearConfig::* field;
+};
+
+const IntOption kIntOptions[] = {
+    {"port",                    &DropbearConfig::port,                         1, 65535},
+    {"receive_window",          &DropbearConfig::receive_window,               0, DropbearTuning::MAX_RECEIVE_WINDOW},
+    {"keepalive",               &DropbearConfig::keepalive_secs,               0, DropbearTuning::MAX_TIMEOUT_SECS},
+    {"idle_timeout",            &DropbearConfig::idle_timeout_secs,            0, DropbearTuning::MAX_TIMEOUT_SECS},
+    {"max_auth_tries",          &DropbearConfig::max_auth_tries,               0, DropbearTuning::MAX_AUTH_TRIES},
+    {"bruteforce_max_failures", &DropbearConfig::bruteforce_max_failures,      0, DropbearTuning::MAX_AUTH_TRIES},
+    {"bruteforce_half_life",    &DropbearConfig::bruteforce_half_life_secs,    1, DropbearTuning::MAX_TIMEOUT_SECS},
+    {"bruteforce_block_time",   &DropbearConfig::bruteforce_block_secs,        1, DropbearTuning::MAX_TIMEOUT_SECS},
+    {"probe_interval",          &DropbearConfig::probe_interval_secs,          0, Probe::MAX_INTERVAL_SECS},
+    {"probe_failures",          &DropbearConfig::probe_failures,               0, Probe::MAX_FAILURES},
+    {"dropbear_nice",           &DropbearConfig::dropbear_nice,              -20, 19},
+    {"ui_nice",                 &DropbearConfig::ui_nice,                    -20, 19},
+    {"log_history_kb",          &DropbearConfig::log_history_kb,               0, LogDisplay::MAX_HISTORY_KB},
+    {"log_block_kb",            &DropbearConfig::log_block_kb,                 1, LogDisplay::MAX_BLOCK_KB},
+    {"log_pipe_kb",             &DropbearConfig::log_pipe_kb,                  0, LogPipe::MAX_PIPE_KB},
+    {"log_buffer_kb",           &DropbearConfig::log_buffer_kb,                LogPipe::MIN_BUFFER_KB, LogPipe::MAX_BUFFER_KB},
+    {"profile_hz",              &DropbearConfig::profile_hz,                   0, Profiler::MAX_HZ},
+};
+
+const StringOption kStringOptions[] = {
+    {"allowlist",       &DropbearConfig::allowlist},
+    {"denylist",        &DropbearConfig::denylist},
+    {"record_log",      &DropbearConfig::record_log},
+    {"log_overflow",    &DropbearConfig::log_overflow},
+    {"dropbear_cpus",   &DropbearConfig::dropbear_cpus},
+    {"dropbear_ioprio", &DropbearConfig::dropbear_ioprio},
+    {"ui_cpus",         &DropbearConfig::ui_cpus},
+    {"wifi_interface",  &DropbearConfig::wifi_interface},
+    {"wifi_powersave_cmd", &DropbearConfig::wifi_powersave_cmd},
+};
+
+const BoolOption kBoolOptions[] = {
+    {"password_auth", &DropbearConfig::password_auth},
+    {"root_login",    &DropbearConfig::root_login},
+    {"inetd",         &DropbearConfig::inetd},
+    {"inetd_spare",   &DropbearConfig::inetd_spare},
+    {"profile_children", &DropbearConfig::profile_children},
+    {"wifi_powersave_off", &DropbearConfig::wifi_powersave_off},
+};
+
+std::string trim(const std::string& s) {
+    const char* ws = " \t\r\n";
+    size_t b = s.find_first_not_of(ws);
+    if (b == std::string::npos) return "";
+    size_t e = s.find_last_not_of(ws);
+    return s.substr(b, e - b + 1);
+}
+
+bool parseInt(const std::string& value, long min, long max, int& out) {
+    if (value.empty()) return false;
+    char* end = nullptr;
+    errno = 0;
+    long v = std::strtol(value.c_str(), &end, 10);
+    if (errno != 0 || *end != '\0' || v < min || v > max) return false;
+    out = static_cast<int>(v);
+    return true;
+}
+
+bool parseBool(const std::string& value, bool& out) {
+    if (value == "yes" || value == "true" || value == "on" || value == "1") {
+        out = true;
+        return true;
+    }
+    if (value == "no" || value == "false" || value == "off" || value == "0") {
+        out = false;
+        return true;
+    }
+    return false;
+}
+
+bool applyOption(DropbearConfig& cfg, const std::string& key, const std::string& value,
+                 std::string& error) {
+    for (const auto& opt : kIntOptions) {
+        if (key != opt.key) continue;
+        if (!parseInt(value, opt.min, opt.max, cfg.*opt.field)) {
+            error = "expected integer in [" + std::to_string(opt.min) + ", " +
+                    std::to_string(opt.max) + "]";
+        }
+        return true;
+    }
+    for (const auto& opt : kBoolOptions) {
+        if (key != opt.key) continue;
+        if (!parseBool(value, cfg.*opt.field)) error = "expected yes/no";
+        return true;
+    }
+    for (const auto& opt : kStringOptions) {
+        if (key != opt.key) continue;
+        cfg.*opt.field = value;
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+DropbearConfig DropbearConfig::parse(std::istream& in, std::vector<std::string>& warnings) {
+    DropbearConfig cfg;
+    std::string raw;
+    int lineNo = 0;
+
+    while (std::getline(in, raw)) {
+        ++lineNo;
+        std::string line = trim(raw.substr(0, raw.find('#')));
+        if (line.empty()) continue;
+
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) {
+            warnings.push_back("line " + std::to_string(lineNo) + ": missing '='");
+            continue;
+        }
+
+        const std::string key = trim(line.substr(0, eq));
+        const std::string value = trim(line.substr(eq + 1));
+        std::string error;
+        if (!applyOption(cfg, key, value, error)) {
+            warnings.push_back("line " + std::to_string(lineNo) + ": unknown key '" + key + "'");
+        } else if (!error.empty()) {
+            warnings.push_back("line " + std::to_string(lineNo) + ": " + key + ": " + error);
+        } else if (key == "ui_nice") {
+            // The thread keeps whatever nice it was given last, so an explicit
+            // 0 has to be applied to undo an earlier value
+            cfg.ui_nice_set = true;
+        }
+    }
+    return cfg;
+}
+
+DropbearConfig DropbearConfig::loadFile(const std::string& path,
+                                        std::vector<std::string>& warnings) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return DropbearConfig();
+    }
+    return parse(file, warnings);
+}
+
+std::vector<std::string> DropbearConfig::toArgs(const std::string& keyPath) const {
+    std::vector<std::string> args = {
+        "dropbear",
+        "-E",         // log to stderr
+        "-F",         // no daemonize
+        "-r", keyPath,
+        "-p", std::to_string(port),
+    };
+
+    if (receive_window > 0) { args.push_back("-W"); args.push_back(std::to_string(receive_window)); }
+    if (keepalive_secs > 0) { args.push_back("-K"); args.push_back(std::to_string(keepalive_secs)); }
+    if (idle_timeout_secs > 0) { args.push_back("-I"); args.push_back(std::to_string(idle_timeout_secs)); }
+    if (max_auth_tries > 0) { args.push_back("-T"); args.push_back(std::to_string(max_auth_tries)); }
+    if (!password_auth) args.push_back("-s");
+    if (!root_login) args.push_back("-w");
+    if (inetd) args.push_back("-i");
+
+    return args;
+}
+
+std::vector<std::string> DropbearConfig::describe() const {
+    auto orDefault = [](int v, const std::string& unit) {
+        return v > 0 ? std::to_string(v) + unit : std::string("default");
+    };
+
+    return {
+        "Port: " + std::to_string(port) +
+            "  Window: " + orDefault(receive_window, " B") +
+            "  Keepalive: " + orDefault(keepalive_secs, " s") +
+            "  Idle timeout: " + orDefault(idle_timeout_secs, " s"),
+        "Max auth tries: " + orDefault(max_auth_tries, "") +
+            "  Password auth: " + (password_auth ? "yes" : "no") +
+            "  Root login: " + (root_login ? "yes" : "no"),
+    };
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <istream>
+#include <string>
+#include <vector>
+
+// Typed view of dropbear.conf, the optional tuning file that lives next to the
+// executable. Every field maps onto a dropbear command line flag; a value of 0
+// means "leave dropbear's built-in default alone".
+struct DropbearConfig {
+    int port = 22;                // -p
+    int receive_window = 0;       // -W, per-channel receive window in bytes
+    int keepalive_secs = 0;       // -K
+    int idle_timeout_secs = 0;    // -I
+    int max_auth_tries = 0;       // -T
+    bool password_auth = true;    // -s when false
+    bool root_login = true;       // -w when false
+    bool inetd = false;           // -i: app listens, one dropbear per connection
+    bool inetd_spare = true;      // keep one process forked ahead for the next connection
+
+    // Brute-force guard (enforced by the app, not passed to dropbear)
+    int bruteforce_max_failures = 5;       // 0 disables blocking
+    int bruteforce_half_life_secs = 300;   // failure score halves this often
+    int bruteforce_block_secs = 600;
+    std::string allowlist;                 // comma-separated IPs / IPv4 CIDRs
+    std::string denylist;
+
+    // Liveness probe against the local listener (enforced by the app)
+    int probe_interval_secs = 5;           // 0 disables probing
+    int probe_failures = 3;                // consecutive bad probes before restart, 0 = never
+
+    // CPU / I/O scheduling (applied by the app; dropbear's sessions inherit it)
+    int dropbear_nice = 0;                 // -20..19, 0 = unchanged
+    std::string dropbear_cpus;             // affinity list, e.g. "2-3"
+    std::string dropbear_ioprio;           // idle, best-effort[:N], realtime[:N]
+    int ui_nice = 0;                       // render thread
+    bool ui_nice_set = false;              // ui_nice present, so 0 is applied too
+    std::string ui_cpus;
+
+    // On-device log history: compressed blocks beyond the on-screen lines
+    int log_history_kb = 1024;             // budget for compressed blocks, 0 = on-screen lines only
+    int log_block_kb = 16;                 // uncompressed text per block
+
+    // Dropbear's log pipe, drained by a relay thread so a stalled UI never
+    // blocks dropbear's log writes
+    int log_pipe_kb = 1024;                // F_SETPIPE_SZ, 0 = kernel default (64 KiB)
+    int log_buffer_kb = 256;               // lines held while the UI is behind
+    std::string log_overflow = "drop-oldest";   // or drop-newest, once that is full
+
+    // Sampling profiler, toggled with SELECT + X or SIGUSR2
+    int profile_hz = 99;                   // 0 disables the toggle
+    bool profile_children = true;          // also sample dropbear and its sessions via /proc
+
+    // WLAN power save, switched off while SSH sessions are connected
+    bool wifi_powersave_off = true;
+    std::string wifi_interface;            // empty = every wireless interface
+    std::string wifi_powersave_cmd;        // empty = nl80211; else e.g. "iw dev %i set power_save %s"
+
+    // Raw dropbear log stream capture for tools/log_replay (empty = off)
+    std::string record_log;
+
+    // Parse "key = value" lines. Unknown keys and invalid values are reported
+    // through warnings and leave the corresponding default in place.
+    static DropbearConfig parse(std::istream& in, std::vector<std::string>& warnings);
+    static DropbearConfig loadFile(const std::string& path, std::vector<std::string>& warnings);
+
+    // Full argv (including argv[0]) for launching dropbear with this config
+    std::vector<std::string> toArgs(const std::string& keyPath) const;
+
+    // Short human-readable summary lines for the on-screen status section
+    std::vector<std::string> describe() const;
+};
@@ -0,0 +1,95 @@
+#include "DropbearLogParser.h"
+#include <cstdlib>
+
+namespace {
+
+bool startsWith(const std::string& s, size_t pos, const char* prefix) {
+    return s.compare(pos, std::char_traits<char>::length(prefix), prefix) == 0;
+}
+
+// Text between the first pair of single quotes at or after pos
+std::string quotedUser(const std::string& msg, size_t pos) {
+    size_t open = msg.find('\'', pos);
+    if (open == std::string::npos) return "";
+    size_t close = msg.find('\'', open + 1);
+    if (close == std::string::npos) return "";
+    return msg.substr(open + 1, close - open - 1);
+}
+
+// Address following the last " from " in the message, up to ':' of "<addr>: reason"
+std::string clientAfterFrom(const std::string& msg) {
+    size_t from = msg.rfind(" from ");
+    if (from == std::string::npos) return "";
+    std::string rest = msg.substr(from + 6);
+    size_t end = rest.find(">:");
+    if (end != std::string::npos) rest.resize(end + 1);
+    size_t space = rest.find(' ');
+    if (space != std::string::npos) rest.resize(space);
+    return DropbearLogParser::hostFromAddress(rest);
+}
+
+} // namespace
+
+std::string DropbearLogParser::hostFromAddress(const std::string& address) {
+    std::string addr = address;
+    if (!addr.empty() && addr.front() == '<') addr.erase(0, 1);
+    if (!addr.empty() && addr.back() == '>') addr.pop_back();
+    size_t colon = addr.rfind(':');
+    if (colon != std::string::npos) addr.resize(colon);
+    return addr;
+}
+
+int DropbearLogParser::portFromAddress(const std::string& address) {
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos) return 0;
+    return std::atoi(address.c_str() + colon + 1);
+}
+
+DropbearLogEvent DropbearLogParser::parse(const std::string& line) {
+    DropbearLogEvent ev;
+
+    // "[pid] Mon DD HH:MM:SS message"
+    size_t msgStart = 0;
+    if (!line.empty() && line[0] == '[') {
+        size_t close = line.find(']');
+        if (close == std::string::npos) return ev;
+        ev.pid = std::atoi(line.c_str() + 1);
+
+        // Skip the three timestamp fields
+        msgStart = close + 1;
+        for (int field = 0; field < 4 && msgStart != std::string::npos; ++field) {
+            msgStart = line.find_first_not_of(' ', msgStart);
+            if (field < 3 && msgStart != std::string::npos) msgStart = line.find(' ', msgStart);
+        }
+        if (msgStart == std::string::npos) return ev;
+    }
+
+    const std::string msg = line.substr(msgStart);
+
+    if (startsWith(msg, 0, "Child connection from ")) {
+        ev.type = DropbearLogEvent::Type::ChildConnection;
+        ev.client_ip = hostFromAddress(msg.substr(22));
+        ev.client_port = portFromAddress(msg.substr(22));
+    } else if (msg.find(" auth succeeded for ") != std::string::npos) {
+        ev.type = DropbearLogEvent::Type::AuthSuccess;
+        ev.user = quotedUser(msg, 0);
+        ev.client_ip = clientAfterFrom(msg);
+    } else if (startsWith(msg, 0, "Bad password attempt for ") ||
+               startsWith(msg, 0, "Login attempt for nonexistent user") ||
+               startsWith(msg, 0, "Bad public key attempt")) {
+        ev.type = DropbearLogEvent::Type::AuthFailure;
+        ev.user = quotedUser(msg, 0);
+        ev.client_ip = clientAfterFrom(msg);
+    } else if (startsWith(msg, 0, "Exit before auth")) {
+        ev.type = DropbearLogEvent::Type::PreAuthExit;
+        ev.user = quotedUser(msg, 0);
+        ev.client_ip = clientAfterFrom(msg);
+    } else if (startsWith(msg, 0, "Exit (")) {
+        ev.type = DropbearLogEvent::Type::SessionExit;
+        size_t close = msg.find(')');
+        if (close != std::string::npos) ev.user = msg.substr(6, close - 6);
+        ev.client_ip = clientAfterFrom(msg);
+    }
+
+    return ev;
+}
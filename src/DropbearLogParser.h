@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+
+// Classifies a single dropbear log line (as written with -E) into the events
+// the app cares about. Lines look like:
+//   [1234] Jan 01 12:00:00 Child connection from 192.168.1.2:51234
+struct DropbearLogEvent {
+    enum class Type {
+        Other,
+        ChildConnection,   // new TCP connection accepted, pid is the session child
+        AuthSuccess,
+        AuthFailure,
+        SessionExit,       // authenticated session ended
+        PreAuthExit,       // connection closed before authenticating
+    };
+
+    Type type = Type::Other;
+    int pid = -1;          // dropbear process that logged the line
+    std::string user;      // empty when not present in the message
+    std::string client_ip; // remote address without port, empty when not present
+    int client_port = 0;   // remote port, ChildConnection only
+};
+
+class DropbearLogParser {
+public:
+    static DropbearLogEvent parse(const std::string& line);
+
+    // "1.2.3.4:5678" -> "1.2.3.4"; also strips surrounding <> used by Exit lines
+    static std::string hostFromAddress(const std::string& address);
+
+    // "1.2.3.4:5678" -> 5678; 0 when there is no port
+    static int portFromAddress(const std::string& address);
+};
@@ -1,62 +1,226 @@
 #include "DropbearManager.h"
 #include "PathHelper.h"
 #include "Constants.h"
-#include <SDL2/SDL.h>
+#include "StartupTrace.h"
+#include "SpawnHelper.h"
 #include <sys/stat.h>
 #include <sys/wait.h>
+#include <dirent.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <signal.h>
+#include <limits.h>
+#include <algorithm>
 #include <cerrno>
+#include <cstdlib>
 #include <cstring>
 #include <cstdio>
+#include <ctime>
 
 DropbearManager::DropbearManager(LogCallback logCallback)
-    : log_callback_(std::move(logCallback)) {
+    : log_callback_(std::move(logCallback)),
+      on_line_([this](const std::string& line) { handleLogLine(line); }),
+      metric_up_(Metrics::global().gauge(
+          "dropbear_app_dropbear_up", "1 while the dropbear listener process is running")),
+      metric_restarts_(Metrics::global().counter(
+          "dropbear_app_dropbear_restarts_total", "Dropbear restarts requested")),
+      metric_listener_restart_us_(Metrics::global().gauge(
+          "dropbear_app_listener_restart_microseconds", "Port unavailable during the last listener-only restart")),
+      metric_launch_to_port_us_(Metrics::global().gauge(
+          "dropbear_app_launch_to_ssh_port_microseconds", "Process launch to the SSH port accepting connections")),
+      metric_log_lines_(Metrics::global().counter(
+          "dropbear_app_log_lines_total", "Log lines ingested from dropbear")),
+      metric_log_bytes_(Metrics::global().counter(
+          "dropbear_app_log_bytes_total", "Log bytes ingested from dropbear")),
+      metric_log_pipe_bytes_(Metrics::global().gauge(
+          "dropbear_app_log_pipe_capacity_bytes", "Capacity of dropbear's log pipe")),
+      metric_log_dropped_lines_(Metrics::global().counter(
+          "dropbear_app_log_dropped_lines_total", "Dropbear log lines dropped while the reader was stalled")),
+      metric_sessions_total_(Metrics::global().counter(
+          "dropbear_app_sessions_total", "Connections accepted by dropbear")),
+      metric_sessions_active_(Metrics::global().gauge(
+          "dropbear_app_sessions_active", "Connections currently open")),
+      metric_auth_success_(Metrics::global().counter(
+          "dropbear_app_auth_success_total", "Successful authentications")),
+      metric_auth_failures_(Metrics::global().counter(
+          "dropbear_app_auth_failures_total", "Failed authentication attempts")),
+      metric_blocked_connections_(Metrics::global().counter(
+          "dropbear_app_blocked_connections_total", "Connections dropped by the brute-force guard")),
+      metric_blocked_ips_(Metrics::global().gauge(
+          "dropbear_app_blocked_ips", "Addresses currently blocked by the brute-force guard")),
+      metric_time_to_auth_p50_us_(Metrics::global().gauge(
+          "dropbear_app_time_to_auth_p50_microseconds", "Median time from connection accepted to auth success")),
+      metric_time_to_auth_p99_us_(Metrics::global().gauge(
+          "dropbear_app_time_to_auth_p99_microseconds", "99th percentile time from connection accepted to auth success")),
+      metric_session_length_p50_us_(Metrics::global().gauge(
+          "dropbear_app_session_length_p50_microseconds", "Median authenticated session length")),
+      metric_probe_up_(Metrics::global().gauge(
+          "dropbear_app_probe_up", "1 when the last liveness probe got an SSH banner")),
+      metric_probe_latency_us_(Metrics::global().gauge(
+          "dropbear_app_probe_latency_microseconds", "Time to SSH banner on the last liveness probe")),
+      metric_probe_failures_(Metrics::global().counter(
+          "dropbear_app_probe_failures_total", "Liveness probes without an SSH banner")),
+      metric_probe_restarts_(Metrics::global().counter(
+          "dropbear_app_probe_restarts_total", "Dropbear restarts triggered by the liveness probe")),
+      metric_inetd_spawns_(Metrics::global().counter(
+          "dropbear_app_inetd_spawns_total", "Dropbear processes started for accepted connections (inetd mode)")),
+      metric_inetd_spare_hits_(Metrics::global().counter(
+          "dropbear_app_inetd_spare_hits_total", "Connections handed to the pre-forked spare (inetd mode)")),
+      metric_inetd_spawn_us_(Metrics::global().gauge(
+          "dropbear_app_inetd_spawn_microseconds", "accept() to dropbear holding the connection, last spawn")) {
 }
 
 DropbearManager::~DropbearManager() {
     stop();
+    if (cipher_bench_thread_.joinable()) cipher_bench_thread_.join();
 }
 
 bool DropbearManager::start() {
-    const std::string db_path = PathHelper::bundledDropbearPath();
+    StartupTrace::Scope trace("DropbearManager::start");
+    LaunchPlan plan;
+    return prepareLaunch(plan) && launch(plan);
+}
+
+bool DropbearManager::prepareLaunch(LaunchPlan& plan) {
+    plan.path = PathHelper::bundledDropbearPath();
     
-    if (!isExecutable(db_path)) {
-        log_callback_("dropbear not found or not executable at: " + db_path);
+    if (!isExecutable(plan.path)) {
+        log_callback_("dropbear not found or not executable at: " + plan.path);
         return false;
     }
     
-    log_callback_("starting bundled dropbear at: " + db_path);
+    log_callback_("starting bundled dropbear at: " + plan.path);
 
     // Make sure we have a host key next to the binary
-    if (!ensureHostKey()) {
-        log_callback_("WARNING: could not create host key, Dropbear may fail.");
+    {
+        StartupTrace::Scope traceKey("host key check");
+        if (!ensureHostKey()) {
+            log_callback_("WARNING: could not create host key, Dropbear may fail.");
+        }
     }
 
-    int pipefd[2];
-    if (!createLogPipe(pipefd)) {
+    ensureSftpServerLink();
+    ensureDeltaSyncLink();
+    loadCipherBench();
+
+    loadConfig();
+    openRecording();
+    plan.args = config_.toArgs(PathHelper::hostKeyPath());
+    return true;
+}
+
+bool DropbearManager::launch(LaunchPlan& plan) {
+    if (config_.inetd) return launchInetd(plan);
+
+    // Dropbear's stdout and stderr go to a pipe the helper creates; we get
+    // the read end for streaming logs
+    SpawnHelper::Request request;
+    request.path = plan.path;
+    request.args = plan.args;
+    request.sched = sched_policy_.settings();
+    request.log_pipe = true;
+
+    const uint64_t spawnStart = StartupTrace::nowMicros();
+    std::string error;
+    int logFd = -1;
+    if (!SpawnHelper::global().spawn(request, dropbear_pid_, logFd, error)) {
+        log_callback_(error);
+        dropbear_pid_ = -1;
         return false;
     }
+    StartupTrace::complete("spawn dropbear", spawnStart, StartupTrace::nowMicros());
 
-    dropbear_pid_ = fork();
-    if (dropbear_pid_ == -1) {
-        log_callback_(std::string("fork failed: ") + strerror(errno));
+    relayLogs(logFd);
+    if (fcntl(logFd, F_SETFL, O_NONBLOCK) == -1) {
+        log_callback_(std::string("fcntl(O_NONBLOCK) failed: ") + strerror(errno));
+    }
+    dropbear_fd_ = logFd;
+    watch_listen_marker_ = true;
+    metric_up_.set(1);
+    probe_pids_.clear();
+    probe_.reset(StartupTrace::nowMicros());
+    return true;
+}
+
+bool DropbearManager::launchInetd(LaunchPlan& plan) {
+    int pipefd[2];
+    if (!createLogPipe(pipefd)) return false;
+
+    InetdSpawner::Settings settings;
+    settings.port = config_.port;
+    settings.path = plan.path;
+    settings.args = plan.args;
+    settings.log_fd = pipefd[1];
+    settings.warm_spare = config_.inetd_spare;
+    settings.sched = &sched_policy_;
+    std::string error;
+    if (!inetd_.open(settings, error)) {
+        log_callback_("inetd mode: " + error);
         close(pipefd[0]);
         close(pipefd[1]);
+        onListening(false);
         return false;
     }
 
-    if (dropbear_pid_ == 0) {
-        executeDropbear(pipefd, db_path);
-    } else {
-        // Parent keeps the read end for streaming logs
-        close(pipefd[1]);
-        dropbear_fd_ = pipefd[0];
-        return true;
+    // Our copy of the write end stays open for the children still to come
+    fcntl(pipefd[1], F_SETFD, FD_CLOEXEC);
+    inetd_log_fd_ = pipefd[1];
+    int logFd = pipefd[0];
+    relayLogs(logFd);
+    dropbear_fd_ = logFd;
+    metric_up_.set(1);
+    log_callback_("Listening on port " + std::to_string(inetd_.port()) +
+                  ", dropbear starts per connection" +
+                  (inetd_.sparePid() > 0 ? " (spare ready)" : ""));
+    onListening(true);
+    return true;
+}
+
+void DropbearManager::closeInetd() {
+    inetd_.close();
+    if (inetd_log_fd_ >= 0) {
+        close(inetd_log_fd_);
+        inetd_log_fd_ = -1;
+    }
+}
+
+void DropbearManager::acceptInetd() {
+    // The guard runs before a process exists, unlike the listener mode where
+    // the session child is killed once it logs the connection
+    const uint32_t now = monotonicSecs();
+    size_t refused = 0;
+    std::string error;
+    const std::vector<InetdSpawner::Spawned> spawned = inetd_.acceptPending(
+        [this, now](const std::string& ip) { return !auth_guard_.isBlocked(ip, now); }, refused, error);
+    if (refused > 0) metric_blocked_connections_.inc(static_cast<int64_t>(refused));
+    if (!error.empty()) log_callback_("inetd mode: " + error);
+
+    for (const auto& s : spawned) {
+        inetd_children_[s.pid] = false;
+        inetd_spawn_latency_.record(s.spawn_us);
+        metric_inetd_spawns_.inc();
+        metric_inetd_spawn_us_.set(static_cast<int64_t>(s.spawn_us));
+        if (s.from_spare) metric_inetd_spare_hits_.inc();
     }
-    
-    return false; // Should never reach here
+}
+
+void DropbearManager::reapInetd() {
+    for (auto it = inetd_children_.begin(); it != inetd_children_.end(); ) {
+        if (SpawnHelper::global().wait(it->first, nullptr, WNOHANG) == 0) {
+            ++it;
+            continue;
+        }
+        // Crashed or was killed without logging its exit
+        if (it->second && metric_sessions_active_.value() > 0) metric_sessions_active_.dec();
+        it = inetd_children_.erase(it);
+    }
+}
+
+void DropbearManager::attachLogSource(int fd) {
+    stop();
+    line_splitter_.clear();
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    dropbear_fd_ = fd;
 }
 
 void DropbearManager::stop() {
@@ -64,59 +228,354 @@ void DropbearManager::stop() {
         close(dropbear_fd_);
         dropbear_fd_ = -1;
     }
+    for (auto& d : draining_) close(d.fd);
+    draining_.clear();
+    relay_.reset();
+    closeInetd();
+    listener_restart_started_us_ = 0;
+    port_open_deadline_us_ = 0;
+    recording_.close();
     
     if (dropbear_pid_ > 0) {
         stopDropbearGracefully();
         dropbear_pid_ = -1;
     }
+
+    metric_up_.set(0);
+    metric_sessions_active_.set(0);
+}
+
+bool DropbearManager::restart() {
+    log_callback_("Restarting dropbear...");
+    metric_restarts_.inc();
+    stop();
+    line_splitter_.clear();
+    return start();
+}
+
+bool DropbearManager::restartListener() {
+    const int64_t sessions = metric_sessions_active_.value();
+    log_callback_("Restarting dropbear listener (" + std::to_string(sessions) +
+                  " sessions stay connected)...");
+    metric_restarts_.inc();
+
+    // Everything slow (host key, config, pipe) happens while the old listener
+    // is still accepting; the port is only unavailable from here on
+    LaunchPlan plan;
+    if (!prepareLaunch(plan)) return false;
+
+    listener_restart_started_us_ = StartupTrace::nowMicros();
+    retireListener();
+    if (!launch(plan)) {
+        listener_restart_started_us_ = 0;
+        return false;
+    }
+    return true;
+}
+
+void DropbearManager::retireListener() {
+    if (dropbear_fd_ >= 0) {
+        DrainingPipe d{dropbear_fd_, std::move(line_splitter_), std::move(relay_), dropbear_pid_,
+                       dropbear_pid_ > 0 ? childPids(dropbear_pid_) : std::vector<pid_t>()};
+        draining_.push_back(std::move(d));
+        line_splitter_.clear();
+        dropbear_fd_ = -1;
+    }
+    relay_.reset();
+    // Dropbear puts each session in its own session (setsid), so SIGTERM to
+    // the listener pid leaves them running
+    if (dropbear_pid_ > 0) {
+        stopDropbearGracefully();
+        dropbear_pid_ = -1;
+    }
+    // Sessions keep their own sockets; our write end must close for the
+    // retired pipe to reach EOF once they are gone
+    closeInetd();
+    watch_listen_marker_ = false;
+    metric_up_.set(0);
+}
+
+std::vector<int> DropbearManager::drainingFds() const {
+    std::vector<int> fds;
+    for (const auto& d : draining_) fds.push_back(d.fd);
+    return fds;
+}
+
+void DropbearManager::loadConfig() {
+    const std::string path = PathHelper::dropbearConfigPath();
+    std::vector<std::string> warnings;
+    config_ = DropbearConfig::loadFile(path, warnings);
+    for (const auto& w : warnings) {
+        log_callback_("dropbear.conf " + w);
+    }
+
+    AuthGuard::Settings guard;
+    guard.max_failures = config_.bruteforce_max_failures;
+    guard.decay_half_life_secs = config_.bruteforce_half_life_secs;
+    guard.block_secs = config_.bruteforce_block_secs;
+    guard.allowlist = config_.allowlist;
+    guard.denylist = config_.denylist;
+    auth_guard_.configure(guard);
+
+    SshProbe::Settings probe;
+    probe.port = config_.port;
+    probe.interval_secs = config_.probe_interval_secs;
+    probe.failures_to_restart = config_.probe_failures;
+    probe.timeout_ms = Probe::TIMEOUT_MS;
+    probe.spike_ms = Probe::SPIKE_MS;
+    probe_.configure(probe);
+
+    relay_settings_.buffer_bytes = static_cast<size_t>(config_.log_buffer_kb) * 1024;
+    if (!LogRelay::parseOverflow(config_.log_overflow, relay_settings_.overflow)) {
+        log_callback_("dropbear.conf log_overflow ignored: expected drop-oldest or drop-newest");
+        relay_settings_.overflow = LogRelay::Overflow::DropOldest;
+    }
+
+    SchedPolicy::Settings sched;
+    sched.nice = config_.dropbear_nice;
+    sched.cpus = config_.dropbear_cpus;
+    sched.ioprio = config_.dropbear_ioprio;
+    std::string error;
+    if (!sched_policy_.configure(sched, error)) {
+        log_callback_("dropbear.conf dropbear scheduling ignored: " + error);
+    }
+    SchedPolicy::Settings ui;
+    ui.nice = config_.ui_nice;
+    ui.nice_set = config_.ui_nice_set;
+    ui.cpus = config_.ui_cpus;
+    if (!ui_sched_policy_.configure(ui, error)) {
+        log_callback_("dropbear.conf ui scheduling ignored: " + error);
+    }
+}
+
+void DropbearManager::openRecording() {
+    if (config_.record_log.empty()) return;
+
+    if (recording_.open(config_.record_log)) {
+        log_callback_("Recording dropbear log stream to " + config_.record_log);
+    } else {
+        log_callback_("Cannot record log stream to " + config_.record_log + ": " + strerror(errno));
+    }
+}
+
+std::vector<std::string> DropbearManager::statusLines() {
+    std::vector<std::string> lines = config_.describe();
+
+    if (!sched_policy_.empty() || !ui_sched_policy_.empty()) {
+        lines.push_back("Scheduling: dropbear " + sched_policy_.describe() +
+                        "  UI " + ui_sched_policy_.describe());
+    }
+
+    if (launch_to_port_us_ > 0) {
+        lines.push_back("SSH up " + LatencyHistogram::formatMicros(launch_to_port_us_) + " after launch");
+    }
+
+    if (metric_log_dropped_lines_.value() > 0) {
+        lines.push_back("Log overflow: " + std::to_string(metric_log_dropped_lines_.value()) +
+                        " lines dropped (" + LogRelay::overflowName(relay_settings_.overflow) +
+                        ", pipe " + std::to_string(log_pipe_bytes_ / 1024) + " KiB)");
+    }
+
+    const SpawnHelper& spawner = SpawnHelper::global();
+    if (spawner.latency().count() > 0) {
+        lines.push_back(std::string("Spawn: ") + (spawner.running() ? "helper" : "direct fork") +
+                        ", p50 " + LatencyHistogram::formatMicros(spawner.latency().percentile(0.50)) +
+                        " (" + std::to_string(spawner.latency().count()) + ")");
+    }
+
+    const AuthGuard::Stats stats = auth_guard_.stats(monotonicSecs());
+    metric_blocked_ips_.set(static_cast<int64_t>(stats.blocked));
+    if (config_.bruteforce_max_failures > 0) {
+        lines.push_back("Brute-force guard: " + std::to_string(stats.blocked) + " blocked, " +
+                        std::to_string(stats.tracked) + " tracked, " +
+                        std::to_string(metric_blocked_connections_.value()) +
+                        " connections dropped");
+    } else {
+        lines.push_back("Brute-force guard: disabled");
+    }
+
+    if (inetd_.isOpen()) {
+        std::string inetdLine = "On demand (inetd): " + std::to_string(metric_inetd_spawns_.value()) + " started";
+        if (inetd_spawn_latency_.count() > 0) {
+            inetdLine += ", spawn p50 " + LatencyHistogram::formatMicros(inetd_spawn_latency_.percentile(0.50));
+        }
+        inetdLine += inetd_.sparePid() > 0 ? ", spare ready" : ", no spare";
+        lines.push_back(inetdLine);
+    }
+
+    if (probe_.enabled() && probe_.health() != SshProbe::Health::Unknown) {
+        std::string probeLine = std::string("SSH probe: ") + SshProbe::healthName(probe_.health());
+        if (probe_.lastSample().ok) {
+            probeLine += ", banner in " + LatencyHistogram::formatMicros(probe_.lastSample().latency_us) +
+                         " (p99 " + LatencyHistogram::formatMicros(probe_.percentileLatency(0.99)) + ")";
+        } else {
+            probeLine += ": " + probe_.lastError();
+        }
+        lines.push_back(probeLine);
+    }
+
+    if (cipher_report_valid_) {
+        for (const auto& line : CipherBench::describe(cipher_report_)) lines.push_back(line);
+    } else if (cipher_bench_thread_.joinable()) {
+        lines.push_back("Fastest cipher: measuring...");
+    }
+
+    const LatencyHistogram& toAuth = latency_tracker_.timeToAuth();
+    if (toAuth.count() > 0) {
+        lines.push_back("Time to auth: p50 " + LatencyHistogram::formatMicros(toAuth.percentile(0.50)) +
+                        ", p99 " + LatencyHistogram::formatMicros(toAuth.percentile(0.99)) +
+                        " (" + std::to_string(toAuth.count()) + " logins)");
+        for (const auto& c : latency_tracker_.clientSummaries(3)) {
+            lines.push_back("  " + c.client_ip + ": p50 " + LatencyHistogram::formatMicros(c.p50_us) +
+                            ", p99 " + LatencyHistogram::formatMicros(c.p99_us) +
+                            " (" + std::to_string(c.count) + ")");
+        }
+    }
+    return lines;
+}
+
+void DropbearManager::loadCipherBench() {
+    if (cipher_report_valid_ || cipher_bench_thread_.joinable()) return;
+    if (CipherBench::load(PathHelper::cipherBenchPath(), cipher_report_)) {
+        cipher_report_valid_ = true;
+        publishCipherBench();
+    } else {
+        cipher_bench_wanted_ = true;
+    }
+}
+
+void DropbearManager::startCipherBench() {
+    if (!cipher_bench_wanted_) return;
+    cipher_bench_wanted_ = false;
+    const std::string helper = PathHelper::bundledCipherBenchPath();
+    if (!isExecutable(helper)) {
+        log_callback_("Cipher benchmark skipped: " + helper + " not found");
+        return;
+    }
+    log_callback_("Benchmarking ciphers (first launch on this CPU)");
+    cipher_bench_done_ = false;
+    cipher_bench_thread_ = std::thread([this, helper]() {
+        cipher_bench_ok_ = CipherBench::run(helper, CipherBenchmark::MS_PER_ALGORITHM,
+                                            cipher_bench_result_, cipher_bench_error_);
+        cipher_bench_done_ = true;
+    });
+}
+
+void DropbearManager::collectCipherBench() {
+    if (!cipher_bench_thread_.joinable() || !cipher_bench_done_) return;
+    cipher_bench_thread_.join();
+    if (!cipher_bench_ok_) {
+        log_callback_("Cipher benchmark failed: " + cipher_bench_error_);
+        return;
+    }
+    cipher_report_ = std::move(cipher_bench_result_);
+    cipher_report_valid_ = true;
+    publishCipherBench();
+
+    std::string error;
+    if (!CipherBench::save(cipher_report_, PathHelper::cipherBenchPath(), error)) {
+        log_callback_("Cannot cache cipher benchmark: " + error);
+    }
+    for (const auto& line : CipherBench::describe(cipher_report_)) log_callback_(line);
+}
+
+void DropbearManager::publishCipherBench() {
+    for (const auto& m : cipher_report_.ciphers) {
+        Metrics::global().gauge("dropbear_app_cipher_throughput_kib", "Measured cipher throughput in KiB/s",
+                                "algorithm=\"" + m.name + "\"").set(static_cast<int64_t>(m.mib_per_sec * 1024));
+    }
+    for (const auto& m : cipher_report_.macs) {
+        Metrics::global().gauge("dropbear_app_mac_throughput_kib", "Measured MAC throughput in KiB/s",
+                                "algorithm=\"" + m.name + "\"").set(static_cast<int64_t>(m.mib_per_sec * 1024));
+    }
+}
+
+uint32_t DropbearManager::monotonicSecs() {
+    struct timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint32_t>(ts.tv_sec);
 }
 
 void DropbearManager::stopDropbearGracefully() {
     kill(dropbear_pid_, SIGTERM);
     
-    // Give it a moment to exit cleanly
-    for (int i = 0; i < Dropbear::MAX_WAIT_ATTEMPTS; ++i) {
+    // Give it a moment to exit cleanly. Checked every millisecond since the
+    // port stays unavailable until the listener is gone.
+    for (int i = 0; i < Dropbear::MAX_WAIT_ATTEMPTS * Dropbear::WAIT_DELAY_MS; ++i) {
         int status;
-        if (waitpid(dropbear_pid_, &status, WNOHANG) > 0) {
+        if (SpawnHelper::global().wait(dropbear_pid_, &status, WNOHANG) > 0) {
             return; // Process exited cleanly
         }
-        SDL_Delay(Dropbear::WAIT_DELAY_MS);
+        usleep(1000);
     }
     
     // Force kill if still running
     kill(dropbear_pid_, SIGKILL);
     int status;
-    waitpid(dropbear_pid_, &status, 0);
+    SpawnHelper::global().wait(dropbear_pid_, &status, 0);
 }
 
 void DropbearManager::pumpLogs() {
-    if (dropbear_fd_ < 0) return;
+    if (dropbear_fd_ >= 0 && readLogs(dropbear_fd_, line_splitter_)) {
+        metric_up_.set(0);
+    }
+    for (size_t i = 0; i < draining_.size(); ) {
+        if (readLogs(draining_[i].fd, draining_[i].splitter)) {
+            draining_.erase(draining_.begin() + static_cast<long>(i));
+        } else {
+            ++i;
+        }
+    }
+    reapListener();
+    if (port_open_deadline_us_ != 0) checkPortOpen();
+    if (inetd_.isOpen()) acceptInetd();
+    if (!inetd_children_.empty()) reapInetd();
+}
 
+bool DropbearManager::readLogs(int& fd, LogLineSplitter& splitter) {
     char buf[1024];
     for (;;) {
-        ssize_t n = read(dropbear_fd_, buf, sizeof(buf));
+        ssize_t n = read(fd, buf, sizeof(buf));
         if (n > 0) {
-            pending_chunk_.append(buf, buf + n);
-            flushPendingLines(false);
+            metric_log_bytes_.inc(n);
+            if (recording_.isOpen()) {
+                recording_.append(buf, static_cast<size_t>(n), StartupTrace::nowMicros());
+            }
+            splitter.feed(buf, static_cast<size_t>(n), on_line_);
         } else if (n == 0) {
-            // EOF from child; flush remainder and stop
-            flushPendingLines(true);
-            close(dropbear_fd_);
-            dropbear_fd_ = -1;
-            break;
+            // EOF: the writer and every session holding the pipe are gone
+            splitter.flush(on_line_);
+            close(fd);
+            fd = -1;
+            return true;
         } else if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
             // No more data right now
-            break;
+            return false;
         } else if (n == -1 && errno == EINTR) {
             continue;
         } else {
             // Unexpected read error
             log_callback_(std::string("read error: ") + strerror(errno));
-            break;
+            return false;
         }
     }
 }
 
+void DropbearManager::reapListener() {
+    // Live sessions keep the pipe open, so EOF alone doesn't mean the
+    // listener is still there
+    if (dropbear_pid_ <= 0) return;
+    int status = 0;
+    if (SpawnHelper::global().wait(dropbear_pid_, &status, WNOHANG) != dropbear_pid_) return;
+
+    if (metric_sessions_active_.value() > 0) {
+        log_callback_("dropbear listener exited; " +
+                      std::to_string(metric_sessions_active_.value()) + " sessions still connected");
+    }
+    dropbear_pid_ = -1;
+    retireListener();
+}
+
 bool DropbearManager::ensureHostKey() {
     const std::string keyPath = PathHelper::hostKeyPath();
 
@@ -148,35 +607,25 @@ bool DropbearManager::generateHostKey(const std::string& keyPath) {
     }
 
     log_callback_("Generating RSA host key (first run may take a while)...");
-    
-    pid_t pid = fork();
-    if (pid < 0) {
-        log_callback_(std::string("fork for dropbearkey failed: ") + strerror(errno));
-        return false;
-    }
+    StartupTrace::Scope trace("dropbearkey");
 
-    if (pid == 0) {
-        executeDropbearKeygen(keygenPath, keyPath);
+    SpawnHelper::Request request;
+    request.path = keygenPath;
+    request.args = {"dropbearkey", "-t", "rsa", "-f", keyPath};
+    pid_t pid;
+    int unused;
+    std::string error;
+    if (!SpawnHelper::global().spawn(request, pid, unused, error)) {
+        log_callback_("dropbearkey: " + error);
+        return false;
     }
 
     return waitForKeygenCompletion(pid, keyPath);
 }
 
-[[noreturn]] void DropbearManager::executeDropbearKeygen(const std::string& keygenPath, 
-                                                          const std::string& keyPath) {
-    execl(keygenPath.c_str(),
-          "dropbearkey", "-t", "rsa", "-f", keyPath.c_str(),
-          (char*)nullptr);
-    
-    int err = errno;
-    dprintf(STDERR_FILENO, "exec %s failed: %s\n",
-            keygenPath.c_str(), strerror(err));
-    _exit(127);
-}
-
 bool DropbearManager::waitForKeygenCompletion(pid_t pid, const std::string& keyPath) {
     int status = 0;
-    if (waitpid(pid, &status, 0) < 0) {
+    if (SpawnHelper::global().wait(pid, &status, 0) < 0) {
         log_callback_(std::string("waitpid(dropbearkey) failed: ") + strerror(errno));
         return false;
     }
@@ -190,6 +639,56 @@ bool DropbearManager::waitForKeygenCompletion(pid_t pid, const std::string& keyP
     return true;
 }
 
+void DropbearManager::ensureSftpServerLink() {
+    const std::string target = PathHelper::bundledSftpServerPath();
+    const std::string link = Dropbear::SFTP_SERVER_LINK_PATH;
+
+    if (!isExecutable(target)) {
+        log_callback_("sftp-server not bundled, SFTP clients will fall back to scp");
+        return;
+    }
+    if (linkHelper(target, link)) {
+        log_callback_("SFTP subsystem enabled via " + link);
+    }
+}
+
+void DropbearManager::ensureDeltaSyncLink() {
+    const std::string target = PathHelper::bundledDeltaSyncPath();
+    const std::string link = Dropbear::DELTA_SYNC_LINK_PATH;
+
+    if (!isExecutable(target)) {
+        return; // optional: delta_sync push falls back to an explicit --remote
+    }
+    if (linkHelper(target, link)) {
+        log_callback_("delta-sync available at " + link);
+    }
+}
+
+// Points link at target, creating its directory; false if unchanged or failed
+bool DropbearManager::linkHelper(const std::string& target, const std::string& link) {
+    // Dropbear runs what the link points at as root, so a directory someone
+    // else created (or can write to) first is refused, not reused
+    const std::string dir = link.substr(0, link.find_last_of('/'));
+    std::string error;
+    if (!dir.empty() && !PathHelper::ensurePrivateDir(dir, error)) {
+        log_callback_("not linking " + link + ": " + error);
+        return false;
+    }
+
+    char current[PATH_MAX] = {0};
+    ssize_t n = readlink(link.c_str(), current, sizeof(current) - 1);
+    if (n > 0 && target == std::string(current, n)) {
+        return false; // already pointing at our binary
+    }
+
+    unlink(link.c_str());
+    if (symlink(target.c_str(), link.c_str()) == -1) {
+        log_callback_("symlink " + link + " failed: " + strerror(errno));
+        return false;
+    }
+    return true;
+}
+
 bool DropbearManager::createLogPipe(int pipefd[2]) {
     if (pipe(pipefd) == -1) {
         log_callback_(std::string("pipe failed: ") + strerror(errno));
@@ -206,49 +705,294 @@ bool DropbearManager::createLogPipe(int pipefd[2]) {
     return true;
 }
 
-[[noreturn]] void DropbearManager::executeDropbear(int pipefd[2], const std::string& db_path) {
-    // Child: connect stdout/stderr to pipe's write end
-    close(pipefd[0]);
-    dup2(pipefd[1], STDOUT_FILENO);
-    dup2(pipefd[1], STDERR_FILENO);
-    close(pipefd[1]);
+void DropbearManager::relayLogs(int& fd) {
+    // Dropbear blocks in write(stderr) once the pipe is full, and every
+    // session with it; a bigger pipe and the relay thread keep it writing
+    // whatever the frame loop is doing
+    const int capacity = LogRelay::setPipeCapacity(fd, config_.log_pipe_kb * 1024);
+    if (capacity > 0) {
+        log_pipe_bytes_ = capacity;
+        metric_log_pipe_bytes_.set(capacity);
+    }
 
-    const std::string keyPath = PathHelper::hostKeyPath();
-    
-    // Run Dropbear in foreground, with explicit host key
-    execl(db_path.c_str(),
-          "dropbear",
-          "-E",         // log to stderr
-          "-F",         // no daemonize
-          "-r", keyPath.c_str(),
-          (char*)nullptr);
+    std::unique_ptr<LogRelay> relay(new LogRelay());
+    int out = -1;
+    std::string error;
+    if (!relay->start(fd, relay_settings_, out, error)) {
+        log_callback_("log relay unavailable, reading dropbear's pipe directly: " + error);
+        return;
+    }
+    relay_ = std::move(relay);
+    fd = out;
+}
+
+void DropbearManager::checkListenMarker(const std::string& line) {
+    const bool listening = line.find(Trace::DROPBEAR_LISTEN_MARKER) != std::string::npos;
+    const bool failed = !listening &&
+                        line.find(Trace::DROPBEAR_LISTEN_FAILED_MARKER) != std::string::npos;
+    if (!listening && !failed) return;
 
-    int err = errno;
-    dprintf(STDERR_FILENO, "exec %s failed: %s\n",
-            db_path.c_str(), strerror(err));
-    _exit(127);
+    onListening(listening);
 }
 
-void DropbearManager::trimCR(std::string& s) {
-    while (!s.empty() && (s.back() == '\r' || s.back() == '\n')) s.pop_back();
+void DropbearManager::onListening(bool listening) {
+    StartupTrace::instant(listening ? Trace::DROPBEAR_LISTENING : Trace::DROPBEAR_LISTEN_FAILED);
+    watch_listen_marker_ = false;
+    if (listening) {
+        // First launch and listener restarts both stop their clock once the
+        // port accepts connections, not at the marker
+        if (!port_open_recorded_ || listener_restart_started_us_ != 0) {
+            port_open_deadline_us_ = StartupTrace::nowMicros() + Trace::PORT_OPEN_WAIT_MS * 1000ULL;
+            checkPortOpen();
+        }
+        startCipherBench();
+    } else if (listener_restart_started_us_ != 0) {
+        const uint64_t us = StartupTrace::nowMicros() - listener_restart_started_us_;
+        listener_restart_started_us_ = 0;
+        log_callback_("Listener restart failed after " + LatencyHistogram::formatMicros(us));
+    }
 }
 
-void DropbearManager::flushPendingLines(bool force) {
-    size_t start = 0;
-    for (;;) {
-        size_t pos = pending_chunk_.find('\n', start);
-        if (pos == std::string::npos) break;
-        std::string line = pending_chunk_.substr(start, pos - start);
-        trimCR(line);
-        if (!line.empty()) log_callback_(line);
-        start = pos + 1;
-    }
-    if (force) {
-        std::string tail = pending_chunk_.substr(start);
-        trimCR(tail);
-        if (!tail.empty()) log_callback_(tail);
-        pending_chunk_.clear();
-    } else if (start > 0) {
-        pending_chunk_.erase(0, start); // keep incomplete line
+void DropbearManager::checkPortOpen() {
+    // Dropbear logs the marker around binding; the figure should mean "a
+    // client can connect", so wait for the kernel to show the LISTEN socket.
+    // One look per call: this runs on whichever loop pumps the log.
+    if (!portListening(config_.port)) {
+        if (StartupTrace::nowMicros() < port_open_deadline_us_) return;
+        port_open_deadline_us_ = 0;
+        port_open_recorded_ = true;
+        listener_restart_started_us_ = 0;
+        log_callback_("SSH port " + std::to_string(config_.port) + " not seen listening " +
+                      std::to_string(Trace::PORT_OPEN_WAIT_MS) + " ms after dropbear's listen marker");
+        return;
+    }
+    port_open_deadline_us_ = 0;
+
+    if (listener_restart_started_us_ != 0) {
+        // From SIGTERM to the old listener until the new one's port is open
+        const uint64_t us = StartupTrace::nowMicros() - listener_restart_started_us_;
+        listener_restart_started_us_ = 0;
+        metric_listener_restart_us_.set(static_cast<int64_t>(us));
+        log_callback_("Listener accepting again after " + LatencyHistogram::formatMicros(us));
+    }
+    if (port_open_recorded_) return;
+
+    port_open_recorded_ = true;
+    StartupTrace::instant(Trace::SSH_PORT_OPEN);
+    launch_to_port_us_ = StartupTrace::sinceLaunchMicros();
+    if (launch_to_port_us_ == 0) return;
+    metric_launch_to_port_us_.set(static_cast<int64_t>(launch_to_port_us_));
+    log_callback_("SSH port " + std::to_string(config_.port) + " open " +
+                  LatencyHistogram::formatMicros(launch_to_port_us_) + " after launch");
+}
+
+bool DropbearManager::portListening(int port) {
+    for (const char* path : {"/proc/net/tcp", "/proc/net/tcp6"}) {
+        FILE* f = fopen(path, "r");
+        if (!f) continue;
+        char line[256];
+        bool found = false;
+        while (!found && fgets(line, sizeof(line), f)) {
+            unsigned localPort = 0, state = 0;
+            // "  sl  local_address rem_address   st ..."; TCP_LISTEN is 0x0A
+            if (sscanf(line, " %*d: %*[0-9A-Fa-f]:%x %*[0-9A-Fa-f]:%*x %x", &localPort, &state) == 2 &&
+                static_cast<int>(localPort) == port && state == 0x0A) {
+                found = true;
+            }
+        }
+        fclose(f);
+        if (found) return true;
+    }
+    return false;
+}
+
+void DropbearManager::recordLogEvent(const DropbearLogEvent& ev) {
+    const uint64_t nowUs = StartupTrace::nowMicros();
+    switch (ev.type) {
+        case DropbearLogEvent::Type::ChildConnection:
+            metric_sessions_total_.inc();
+            metric_sessions_active_.inc();
+            if (inetd_children_.count(ev.pid)) inetd_children_[ev.pid] = true;
+            latency_tracker_.onConnection(ev.pid, ev.client_ip, nowUs);
+            enforceAuthGuard(ev);
+            break;
+        case DropbearLogEvent::Type::AuthSuccess:
+            metric_auth_success_.inc();
+            latency_tracker_.onAuthSuccess(ev.pid, nowUs);
+            publishLatencyMetrics();
+            break;
+        case DropbearLogEvent::Type::AuthFailure:
+            metric_auth_failures_.inc();
+            enforceAuthGuard(ev);
+            break;
+        case DropbearLogEvent::Type::SessionExit:
+            forgetRetiredSession(ev.pid);
+            if (metric_sessions_active_.value() > 0) metric_sessions_active_.dec();
+            if (inetd_children_.count(ev.pid)) inetd_children_[ev.pid] = false;
+            latency_tracker_.onSessionExit(ev.pid, nowUs);
+            publishLatencyMetrics();
+            break;
+        case DropbearLogEvent::Type::PreAuthExit:
+            forgetRetiredSession(ev.pid);
+            if (metric_sessions_active_.value() > 0) metric_sessions_active_.dec();
+            if (inetd_children_.count(ev.pid)) inetd_children_[ev.pid] = false;
+            latency_tracker_.forget(ev.pid);
+            break;
+        default:
+            break;
+    }
+}
+
+void DropbearManager::publishLatencyMetrics() {
+    const LatencyHistogram& toAuth = latency_tracker_.timeToAuth();
+    metric_time_to_auth_p50_us_.set(static_cast<int64_t>(toAuth.percentile(0.50)));
+    metric_time_to_auth_p99_us_.set(static_cast<int64_t>(toAuth.percentile(0.99)));
+    metric_session_length_p50_us_.set(
+        static_cast<int64_t>(latency_tracker_.sessionLength().percentile(0.50)));
+}
+
+void DropbearManager::enforceAuthGuard(const DropbearLogEvent& ev) {
+    const uint32_t now = monotonicSecs();
+
+    if (ev.type == DropbearLogEvent::Type::AuthFailure &&
+        auth_guard_.recordFailure(ev.client_ip, now)) {
+        log_callback_("Blocking " + ev.client_ip + " for " +
+                      std::to_string(config_.bruteforce_block_secs) + "s after repeated failures");
+        dropConnection(ev.pid);
+        return;
+    }
+
+    // Dropbear has no ACL hook, so new connections from blocked addresses are
+    // cut off as soon as the session child announces itself, before any key
+    // exchange, signature or crypt() work happens.
+    if (ev.type == DropbearLogEvent::Type::ChildConnection &&
+        auth_guard_.isBlocked(ev.client_ip, now)) {
+        dropConnection(ev.pid);
+    }
+}
+
+void DropbearManager::dropConnection(int pid) {
+    // Only ever signal session children of our dropbear, of a listener retired
+    // by restartListener() whose sessions are still draining, or our own in
+    // inetd mode; the pid comes from log text, which may be a replayed
+    // recording from another boot
+    auto inetd = inetd_children_.find(pid);
+    const bool ours = inetd != inetd_children_.end() ||
+                      (pid > 1 && dropbear_pid_ > 0 && pid != dropbear_pid_ && parentPid(pid) == dropbear_pid_) ||
+                      isRetiredSession(pid);
+    if (!ours) return;
+
+    if (kill(pid, SIGKILL) == 0) {
+        if (inetd != inetd_children_.end()) inetd->second = false;
+        latency_tracker_.forget(pid);
+        metric_blocked_connections_.inc();
+        if (metric_sessions_active_.value() > 0) metric_sessions_active_.dec();
+    }
+}
+
+void DropbearManager::forgetRetiredSession(pid_t pid) {
+    for (auto& d : draining_) {
+        d.sessions.erase(std::remove(d.sessions.begin(), d.sessions.end(), pid), d.sessions.end());
+    }
+}
+
+bool DropbearManager::isRetiredSession(pid_t pid) const {
+    if (pid <= 1) return false;
+    for (const auto& d : draining_) {
+        if (d.listener_pid > 0 && pid != d.listener_pid && parentPid(pid) == d.listener_pid) return true;
+        for (pid_t session : d.sessions) {
+            // Dropbear's sessions lead their own session (setsid), which a
+            // recycled pid is unlikely to
+            if (session == pid) return getsid(pid) == pid;
+        }
+    }
+    return false;
+}
+
+std::vector<pid_t> DropbearManager::childPids(pid_t parent) {
+    std::vector<pid_t> children;
+    DIR* dir = opendir("/proc");
+    if (!dir) return children;
+    while (dirent* entry = readdir(dir)) {
+        const pid_t pid = static_cast<pid_t>(atoi(entry->d_name));
+        if (pid > 0 && parentPid(pid) == parent) children.push_back(pid);
+    }
+    closedir(dir);
+    return children;
+}
+
+pid_t DropbearManager::parentPid(pid_t pid) {
+    char path[32];
+    snprintf(path, sizeof(path), "/proc/%d/stat", static_cast<int>(pid));
+    FILE* f = fopen(path, "r");
+    if (!f) return -1;
+
+    // "pid (comm) state ppid ..."; comm may contain spaces, so skip to the last ')'
+    char buf[512];
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[n] = '\0';
+    const char* paren = strrchr(buf, ')');
+    int ppid = -1;
+    if (!paren || sscanf(paren + 1, " %*c %d", &ppid) != 1) return -1;
+    return ppid;
+}
+
+void DropbearManager::handleLogLine(const std::string& line) {
+    metric_log_lines_.inc();
+    if (watch_listen_marker_) checkListenMarker(line);
+
+    const DropbearLogEvent ev = DropbearLogParser::parse(line);
+    if (isProbeTraffic(ev)) return;
+
+    recordLogEvent(ev);
+    log_callback_(line);
+}
+
+bool DropbearManager::isProbeTraffic(const DropbearLogEvent& ev) {
+    if (ev.type == DropbearLogEvent::Type::ChildConnection) {
+        if (ev.client_ip != "127.0.0.1" || !probe_.isProbePort(ev.client_port)) return false;
+        // Children killed before logging their exit would otherwise pile up;
+        // the rest keep hiding their lines until they exit
+        const uint64_t nowUs = StartupTrace::nowMicros();
+        for (auto it = probe_pids_.begin(); it != probe_pids_.end();) {
+            if (nowUs - it->second > Probe::CHILD_EXPIRY_MS * 1000) it = probe_pids_.erase(it);
+            else ++it;
+        }
+        probe_pids_[ev.pid] = nowUs;
+        return true;
+    }
+
+    auto it = probe_pids_.find(ev.pid);
+    if (it == probe_pids_.end()) return false;
+    if (ev.type == DropbearLogEvent::Type::PreAuthExit ||
+        ev.type == DropbearLogEvent::Type::SessionExit) {
+        probe_pids_.erase(it);
+    }
+    return true;
+}
+
+void DropbearManager::checkHealth() {
+    collectCipherBench();
+
+    // Nothing to probe while dropbear is down, or when replaying a recording
+    if (dropbear_fd_ < 0 || dropbear_pid_ <= 0) return;
+
+    const SshProbe::Result result = probe_.poll(StartupTrace::nowMicros());
+    if (result == SshProbe::Result::None) return;
+
+    const SshProbe::Sample& sample = probe_.lastSample();
+    metric_probe_up_.set(sample.ok ? 1 : 0);
+    metric_probe_latency_us_.set(static_cast<int64_t>(sample.latency_us));
+    if (result == SshProbe::Result::Failed) {
+        metric_probe_failures_.inc();
+        log_callback_("SSH probe failed: " + probe_.lastError());
+    }
+
+    if (probe_.needsRestart()) {
+        log_callback_("SSH listener unhealthy (" + std::to_string(config_.probe_failures) +
+                      " bad probes in a row), restarting dropbear");
+        metric_probe_restarts_.inc();
+        restartListener();
     }
 }
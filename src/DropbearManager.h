@@ -1,6 +1,23 @@
 #pragma once
 
+#include "AuthGuard.h"
+#include "AuthLatencyTracker.h"
+#include "CipherBench.h"
+#include "DropbearConfig.h"
+#include "DropbearLogParser.h"
+#include "InetdSpawner.h"
+#include "LogLineSplitter.h"
+#include "LogRecording.h"
+#include "LogRelay.h"
+#include "Metrics.h"
+#include "SchedPolicy.h"
+#include "SshProbe.h"
+#include <atomic>
+#include <memory>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 #include <functional>
 #include <sys/types.h>
 
@@ -16,27 +33,184 @@ public:
     DropbearManager& operator=(const DropbearManager&) = delete;
 
     bool start();
+    // Stops the listener (SIGTERM, then SIGKILL) and closes every log pipe.
+    // Sessions run in their own session (setsid) and keep going; they are no
+    // longer tracked or counted.
     void stop();
+    bool restart();
+
+    // Replaces only the listener: config is reloaded and a new dropbear is
+    // launched, while sessions forked by the old one stay connected and their
+    // log output keeps streaming from the old pipe until the last one exits.
+    // Also used to bring the listener back after it died on its own.
+    bool restartListener();
+
     void pumpLogs();
 
+    // Read end of dropbear's log pipe for poll(); -1 once the listener is gone
+    int logFd() const { return dropbear_fd_; }
+    // Pipes of previous listeners still carrying session output
+    std::vector<int> drainingFds() const;
+    // Listening sockets in inetd mode, where the app accepts for dropbear;
+    // pumpLogs() accepts when they are readable
+    const std::vector<int>& acceptFds() const { return inetd_.fds(); }
+
+    // Runs the liveness probe against the local listener; restarts dropbear
+    // after sustained failures. Call often (every frame, or when probeFd() is
+    // readable / nextProbeWakeUs() passes)
+    void checkHealth();
+    SshProbe::Health probeHealth() const { return probe_.health(); }
+    int probeFd() const { return probe_.fd(); }
+    uint64_t nextProbeWakeUs() const { return probe_.nextWakeUs(); }
+    // True between the listen marker and the port showing up as listening;
+    // each pumpLogs() checks once, so loops should wake every
+    // Trace::PORT_CHECK_MS meanwhile
+    bool awaitingPortOpen() const { return port_open_deadline_us_ != 0; }
+
+    // Ingests dropbear-format log bytes from fd (e.g. a replay pipe) instead of
+    // launching dropbear; pumpLogs() then drives the usual parse/guard/callback
+    // path. Takes ownership of fd.
+    void attachLogSource(int fd);
+
+    // Connections dropbear has accepted and not yet closed
+    int64_t activeSessions() const { return metric_sessions_active_.value(); }
+
+    // Settings dropbear was last launched with
+    const DropbearConfig& config() const { return config_; }
+
+    // ui_nice / ui_cpus from the same config, for the render thread to apply
+    const SchedPolicy& uiSchedPolicy() const { return ui_sched_policy_; }
+
+    // Active settings, brute-force guard state and connect latency for the
+    // status section
+    std::vector<std::string> statusLines();
+
 private:
+    struct LaunchPlan {
+        std::string path;
+        std::vector<std::string> args;
+    };
+
+    // Session children inherit the log pipe, so a retired listener's pipe is
+    // read until they have all exited
+    struct DrainingPipe {
+        int fd;
+        LogLineSplitter splitter;
+        std::unique_ptr<LogRelay> relay;
+        pid_t listener_pid;
+        // Its children when it was stopped; they are reparented once it
+        // exits, so parentPid() no longer ties them to it
+        std::vector<pid_t> sessions;
+    };
+
+    bool prepareLaunch(LaunchPlan& plan);
+    bool launch(LaunchPlan& plan);
+    bool launchInetd(LaunchPlan& plan);
+    void closeInetd();
+    void acceptInetd();
+    void reapInetd();
+    void onListening(bool listening);
+    void retireListener();
+    void reapListener();
+    bool readLogs(int& fd, LogLineSplitter& splitter);
+
     bool ensureHostKey();
     bool fileExists(const std::string& path) const;
     bool isExecutable(const std::string& path) const;
     bool generateHostKey(const std::string& keyPath);
-    [[noreturn]] void executeDropbearKeygen(const std::string& keygenPath, const std::string& keyPath);
     bool waitForKeygenCompletion(pid_t pid, const std::string& keyPath);
+    void ensureSftpServerLink();
+    void ensureDeltaSyncLink();
+    bool linkHelper(const std::string& target, const std::string& link);
     
-    void startDropbear();
+    void loadConfig();
+    void openRecording();
     bool createLogPipe(int pipefd[2]);
-    [[noreturn]] void executeDropbear(int pipefd[2], const std::string& db_path);
+    void relayLogs(int& fd);
     void stopDropbearGracefully();
     
-    void flushPendingLines(bool force);
-    static void trimCR(std::string& s);
+    void handleLogLine(const std::string& line);
+    void checkListenMarker(const std::string& line);
+    bool isProbeTraffic(const DropbearLogEvent& ev);
+    void recordLogEvent(const DropbearLogEvent& ev);
+    void enforceAuthGuard(const DropbearLogEvent& ev);
+    void dropConnection(int pid);
+    void publishLatencyMetrics();
+    void loadCipherBench();
+    void startCipherBench();
+    void collectCipherBench();
+    void publishCipherBench();
+    void checkPortOpen();
+    static bool portListening(int port);
+    void forgetRetiredSession(pid_t pid);
+    bool isRetiredSession(pid_t pid) const;
+    static pid_t parentPid(pid_t pid);
+    static std::vector<pid_t> childPids(pid_t parent);
+    static uint32_t monotonicSecs();
 
     LogCallback log_callback_;
+    DropbearConfig config_;
     pid_t dropbear_pid_ = -1;
     int dropbear_fd_ = -1;
-    std::string pending_chunk_;
+    LogLineSplitter line_splitter_;
+    LogLineSplitter::LineCallback on_line_;
+    bool watch_listen_marker_ = false;
+    uint64_t listener_restart_started_us_ = 0;   // 0 = no listener restart in flight
+    bool port_open_recorded_ = false;            // launch-to-port is measured once
+    uint64_t port_open_deadline_us_ = 0;         // 0 = not waiting for the LISTEN socket
+    uint64_t launch_to_port_us_ = 0;
+    std::vector<DrainingPipe> draining_;
+    std::unique_ptr<LogRelay> relay_;            // drains the pipe behind dropbear_fd_
+    LogRelay::Settings relay_settings_;
+    int log_pipe_bytes_ = 0;
+    AuthGuard auth_guard_;
+    LogRecording recording_;
+    AuthLatencyTracker latency_tracker_;
+    SshProbe probe_;
+    SchedPolicy sched_policy_;            // applied by SpawnHelper in the dropbear child
+    SchedPolicy ui_sched_policy_;
+    std::unordered_map<int, uint64_t> probe_pids_;   // dropbear children serving our probes -> seen (us)
+
+    // inetd mode: we are the parent of every session, so we reap them too
+    InetdSpawner inetd_;
+    int inetd_log_fd_ = -1;                // write end handed to each child
+    std::unordered_map<int, bool> inetd_children_;   // pid -> counted in sessions_active
+    LatencyHistogram inetd_spawn_latency_;
+
+    // First-launch cipher benchmark: runs on its own thread once dropbear is
+    // listening, so it never delays the port coming up
+    CipherBench::Report cipher_report_;
+    bool cipher_report_valid_ = false;
+    bool cipher_bench_wanted_ = false;     // no usable cache; run after listen
+    std::thread cipher_bench_thread_;
+    CipherBench::Report cipher_bench_result_;   // written by the thread
+    std::string cipher_bench_error_;
+    bool cipher_bench_ok_ = false;
+    std::atomic<bool> cipher_bench_done_{false};
+
+    // Counters exported through MetricsExporter
+    Metrics::Metric& metric_up_;
+    Metrics::Metric& metric_restarts_;
+    Metrics::Metric& metric_listener_restart_us_;
+    Metrics::Metric& metric_launch_to_port_us_;
+    Metrics::Metric& metric_log_lines_;
+    Metrics::Metric& metric_log_bytes_;
+    Metrics::Metric& metric_log_pipe_bytes_;
+    Metrics::Metric& metric_log_dropped_lines_;
+    Metrics::Metric& metric_sessions_total_;
+    Metrics::Metric& metric_sessions_active_;
+    Metrics::Metric& metric_auth_success_;
+    Metrics::Metric& metric_auth_failures_;
+    Metrics::Metric& metric_blocked_connections_;
+    Metrics::Metric& metric_blocked_ips_;
+    Metrics::Metric& metric_time_to_auth_p50_us_;
+    Metrics::Metric& metric_time_to_auth_p99_us_;
+    Metrics::Metric& metric_session_length_p50_us_;
+    Metrics::Metric& metric_probe_up_;
+    Metrics::Metric& metric_probe_latency_us_;
+    Metrics::Metric& metric_probe_failures_;
+    Metrics::Metric& metric_probe_restarts_;
+    Metrics::Metric& metric_inetd_spawns_;
+    Metrics::Metric& metric_inetd_spare_hits_;
+    Metrics::Metric& metric_inetd_spawn_us_;
 };
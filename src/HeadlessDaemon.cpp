@@ -0,0 +1,265 @@
+#include "HeadlessDaemon.h"
+#include "Constants.h"
+#include "Metrics.h"
+#include "PathHelper.h"
+#include "SamplingProfiler.h"
+#include "StartupTrace.h"
+#include <poll.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+
+volatile sig_atomic_t HeadlessDaemon::stop_requested_ = 0;
+volatile sig_atomic_t HeadlessDaemon::restart_requested_ = 0;
+volatile sig_atomic_t HeadlessDaemon::profile_requested_ = 0;
+
+HeadlessDaemon::HeadlessDaemon()
+    : log_file_(PathHelper::daemonLogPath(), Headless::LOG_MAX_BYTES) {
+    sigemptyset(&run_mask_);
+}
+
+HeadlessDaemon::~HeadlessDaemon() {
+    if (SamplingProfiler::running() && dropbear_manager_) toggleProfiler();
+    if (!startup_trace_written_ && StartupTrace::has("HeadlessDaemon::initialize")) {
+        StartupTrace::writeFile(PathHelper::startupTracePath());
+    }
+    dropbear_manager_.reset();
+    metrics_exporter_.reset();
+    network_manager_.reset();
+    log("Headless daemon stopped");
+}
+
+bool HeadlessDaemon::initialize() {
+    StartupTrace::Scope traceInit("HeadlessDaemon::initialize");
+
+    // Must happen before any thread starts so only ppoll() ever sees them
+    if (!installSignalHandlers()) {
+        std::cerr << "sigaction failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    if (!log_file_.open()) {
+        // Keep going: log() falls back to stderr
+        std::cerr << "Cannot open " << log_file_.path() << ": " << strerror(errno) << std::endl;
+    }
+    log("Headless daemon starting (pid " + std::to_string(getpid()) + ")");
+
+    network_manager_ = std::make_unique<NetworkManager>();
+    dropbear_manager_ = std::make_unique<DropbearManager>(
+        [this](const std::string& line) { log(line); }
+    );
+    // SSH before the exporter and the rest; a failed start is retried by
+    // superviseDropbear()
+    dropbear_manager_->start();
+
+    metrics_exporter_ = std::make_unique<MetricsExporter>(
+        Metrics::global(), PathHelper::metricsFilePath(),
+        MetricsExport::SOCKET_PATH, MetricsExport::FILE_PERIOD_MS);
+    if (!metrics_exporter_->start()) {
+        log(std::string("metrics socket unavailable at ") + MetricsExport::SOCKET_PATH);
+    }
+
+    configurePowerSave();
+    refreshStatus();
+
+    {
+        StartupTrace::Scope trace("refreshIPAddrs");
+        refreshIPAddrs();
+    }
+    return true;
+}
+
+int HeadlessDaemon::run() {
+    uint64_t nextRefresh = nowMs() + Headless::REFRESH_PERIOD_MS;
+
+    while (!stop_requested_) {
+        uint64_t now = nowMs();
+        superviseDropbear(now);
+
+        uint64_t deadline = nextRefresh;
+        if (dropbear_down_since_ms_ != 0) {
+            deadline = std::min<uint64_t>(deadline,
+                                          dropbear_down_since_ms_ + Headless::RESTART_BACKOFF_MS);
+        }
+        // Wake in time for the liveness probe too (CLOCK_MONOTONIC, like nowMs())
+        const uint64_t probeWakeUs = dropbear_manager_->nextProbeWakeUs();
+        if (probeWakeUs != UINT64_MAX) {
+            deadline = std::min<uint64_t>(deadline, (probeWakeUs + 999) / 1000);
+        }
+        // updateSessions() reaps a running wifi_powersave_cmd switch
+        if (network_manager_->powerSaveSwitching()) {
+            deadline = std::min<uint64_t>(deadline, now + Network::POWER_SAVE_POLL_MS);
+        }
+        // pumpLogs() looks for the SSH port once per wake-up until it opens
+        if (dropbear_manager_->awaitingPortOpen()) {
+            deadline = std::min<uint64_t>(deadline, now + Trace::PORT_CHECK_MS);
+        }
+
+        const uint64_t waitMs = deadline > now ? deadline - now : 0;
+        struct timespec timeout = {static_cast<time_t>(waitMs / 1000),
+                                   static_cast<long>((waitMs % 1000) * 1000000)};
+
+        // fd -1 (dropbear down / no probe in flight) is ignored by ppoll.
+        // Pipes of replaced listeners stay open while their sessions live.
+        std::vector<struct pollfd> pfds = {{dropbear_manager_->probeFd(), POLLIN, 0},
+                                           {dropbear_manager_->logFd(), POLLIN, 0}};
+        for (int fd : dropbear_manager_->drainingFds()) pfds.push_back({fd, POLLIN, 0});
+        for (int fd : dropbear_manager_->acceptFds()) pfds.push_back({fd, POLLIN, 0});
+        int ready = ppoll(pfds.data(), pfds.size(), &timeout, &run_mask_);
+        if (ready == -1 && errno != EINTR) {
+            log(std::string("ppoll failed: ") + strerror(errno));
+            return 1;
+        }
+
+        // Unconditional: also notices a listener that died while its sessions
+        // keep the pipe open
+        dropbear_manager_->pumpLogs();
+        dropbear_manager_->checkHealth();
+        if (!startup_trace_written_) recordStartupProgress();
+
+        // Session open/close lines wake us; a pending restore is caught by
+        // the next wake-up after its delay
+        const std::string powerSave =
+            network_manager_->updateSessions(dropbear_manager_->activeSessions(), nowMs());
+        if (!powerSave.empty()) log(powerSave);
+
+        if (restart_requested_) {
+            restart_requested_ = 0;
+            log("SIGHUP: restarting dropbear listener");
+            dropbear_manager_->restartListener();
+            dropbear_down_since_ms_ = 0;
+            configurePowerSave();
+            refreshStatus();
+        }
+
+        if (profile_requested_) {
+            profile_requested_ = 0;
+            toggleProfiler();
+        }
+
+        now = nowMs();
+        if (now >= nextRefresh) {
+            refreshIPAddrs();
+            network_manager_->sampleRtt(now);
+            refreshStatus();
+            nextRefresh = now + Headless::REFRESH_PERIOD_MS;
+        }
+    }
+
+    log("Received stop signal");
+    return 0;
+}
+
+bool HeadlessDaemon::installSignalHandlers() {
+    struct sigaction sa{};
+    sa.sa_handler = &HeadlessDaemon::onSignal;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGTERM, &sa, nullptr) == -1 ||
+        sigaction(SIGINT, &sa, nullptr) == -1 ||
+        sigaction(SIGHUP, &sa, nullptr) == -1 ||
+        sigaction(SIGUSR2, &sa, nullptr) == -1) {
+        return false;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    // Blocked everywhere except inside ppoll(), so a signal can never slip in
+    // between checking the flags and going to sleep
+    sigset_t block;
+    sigemptyset(&block);
+    sigaddset(&block, SIGTERM);
+    sigaddset(&block, SIGINT);
+    sigaddset(&block, SIGHUP);
+    sigaddset(&block, SIGUSR2);
+    return sigprocmask(SIG_BLOCK, &block, &run_mask_) == 0;
+}
+
+void HeadlessDaemon::onSignal(int sig) {
+    if (sig == SIGHUP) restart_requested_ = 1;
+    else if (sig == SIGUSR2) profile_requested_ = 1;
+    else stop_requested_ = 1;
+}
+
+void HeadlessDaemon::superviseDropbear(uint64_t nowMs) {
+    if (dropbear_manager_->logFd() >= 0) {
+        dropbear_down_since_ms_ = 0;
+        return;
+    }
+    if (dropbear_down_since_ms_ == 0) {
+        dropbear_down_since_ms_ = nowMs;
+        log("dropbear is not running; restarting in " +
+            std::to_string(Headless::RESTART_BACKOFF_MS / 1000) + "s");
+        return;
+    }
+    if (nowMs - dropbear_down_since_ms_ >= Headless::RESTART_BACKOFF_MS) {
+        dropbear_manager_->restartListener();
+        dropbear_down_since_ms_ = dropbear_manager_->logFd() >= 0 ? 0 : nowMs;
+    }
+}
+
+void HeadlessDaemon::toggleProfiler() {
+    const DropbearConfig& config = dropbear_manager_->config();
+    SamplingProfiler::Settings settings;
+    settings.hz = config.profile_hz;
+    settings.children = config.profile_children;
+    log(SamplingProfiler::toggle(settings, PathHelper::profilePath()));
+}
+
+void HeadlessDaemon::configurePowerSave() {
+    const DropbearConfig& config = dropbear_manager_->config();
+    NetworkManager::PowerSaveSettings settings;
+    settings.manage = config.wifi_powersave_off;
+    settings.interface = config.wifi_interface;
+    settings.command = config.wifi_powersave_cmd;
+    settings.ssh_port = config.port;
+    settings.restore_delay_ms = Network::POWER_SAVE_RESTORE_DELAY_MS;
+    const std::string line = network_manager_->configurePowerSave(settings, nowMs());
+    if (!line.empty()) log(line);
+}
+
+void HeadlessDaemon::refreshIPAddrs() {
+    auto addrs = network_manager_->getIPv4Addresses();
+    if (addrs == ip_addrs_) return;
+
+    ip_addrs_ = std::move(addrs);
+    std::string joined;
+    for (const auto& ip : ip_addrs_) {
+        if (!joined.empty()) joined += ", ";
+        joined += ip;
+    }
+    log("IP addresses: " + (joined.empty() ? std::string("none") : joined));
+}
+
+void HeadlessDaemon::refreshStatus() {
+    // Only log changes, so an idle daemon doesn't grow its log file
+    auto lines = dropbear_manager_->statusLines();
+    for (auto& line : network_manager_->powerSaveStatusLines()) lines.push_back(std::move(line));
+    if (lines == status_lines_) return;
+
+    status_lines_ = std::move(lines);
+    for (const auto& line : status_lines_) log("Status: " + line);
+}
+
+void HeadlessDaemon::recordStartupProgress() {
+    if (StartupTrace::has(Trace::DROPBEAR_LISTENING) ||
+        StartupTrace::has(Trace::DROPBEAR_LISTEN_FAILED)) {
+        const std::string path = PathHelper::startupTracePath();
+        if (StartupTrace::writeFile(path)) {
+            log("Startup trace written to " + path);
+        }
+        startup_trace_written_ = true;
+    }
+}
+
+void HeadlessDaemon::log(const std::string& line) {
+    if (log_file_.isOpen()) log_file_.write(line);
+    else std::cerr << line << std::endl;
+}
+
+uint64_t HeadlessDaemon::nowMs() {
+    struct timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000 + static_cast<uint64_t>(ts.tv_nsec) / 1000000;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "NetworkManager.h"
+#include "DropbearManager.h"
+#include "LogFile.h"
+#include "MetricsExporter.h"
+#include <csignal>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// --headless frontend: supervises dropbear (host key, log capture, brute-force
+// guard, metrics) without SDL, a window, a GPU context or a font. The loop
+// sleeps in ppoll() on dropbear's log pipe, so an idle server only wakes for
+// housekeeping every Headless::REFRESH_PERIOD_MS and for the liveness probe
+// (probe_interval in dropbear.conf). Log lines go to PathHelper::daemonLogPath().
+//
+// Signals: SIGTERM/SIGINT exit, SIGHUP restarts dropbear (re-reads dropbear.conf),
+// SIGUSR2 starts/stops the sampling profiler (see SamplingProfiler.h).
+class HeadlessDaemon {
+public:
+    HeadlessDaemon();
+    ~HeadlessDaemon();
+
+    // Delete copy operations
+    HeadlessDaemon(const HeadlessDaemon&) = delete;
+    HeadlessDaemon& operator=(const HeadlessDaemon&) = delete;
+
+    bool initialize();
+    int run();
+
+private:
+    bool installSignalHandlers();
+    void superviseDropbear(uint64_t nowMs);
+    void refreshIPAddrs();
+    void refreshStatus();
+    void recordStartupProgress();
+    void toggleProfiler();
+    void configurePowerSave();
+    void log(const std::string& line);
+
+    static void onSignal(int sig);
+    static uint64_t nowMs();
+
+    static volatile sig_atomic_t stop_requested_;
+    static volatile sig_atomic_t restart_requested_;
+    static volatile sig_atomic_t profile_requested_;
+
+    LogFile log_file_;
+    std::unique_ptr<NetworkManager> network_manager_;
+    std::unique_ptr<DropbearManager> dropbear_manager_;
+    std::unique_ptr<MetricsExporter> metrics_exporter_;
+
+    sigset_t run_mask_;                  // mask ppoll() waits with (signals unblocked)
+    std::vector<std::string> ip_addrs_;
+    std::vector<std::string> status_lines_;
+    uint64_t dropbear_down_since_ms_ = 0;
+    bool startup_trace_written_ = false;
+};
@@ -0,0 +1,167 @@
+#include "InetdSpawner.h"
+#include "StartupTrace.h"
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <signal.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+InetdSpawner::~InetdSpawner() {
+    close();
+}
+
+bool InetdSpawner::open(const Settings& settings, std::string& error) {
+    close();
+    settings_ = settings;
+    port_ = settings.port;
+
+    std::string v4Error, v6Error;
+    const bool v4 = listenOn(AF_INET, v4Error);
+    const bool v6 = listenOn(AF_INET6, v6Error);
+    if (!v4 && !v6) {
+        error = v4Error;
+        return false;
+    }
+
+    if (settings_.warm_spare) startSpare();
+    return true;
+}
+
+void InetdSpawner::close() {
+    for (int fd : fds_) ::close(fd);
+    fds_.clear();
+    stopSpare();
+}
+
+bool InetdSpawner::listenOn(int family, std::string& error) {
+    const int fd = socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        error = std::string("socket: ") + strerror(errno);
+        return false;
+    }
+    const int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_storage addr{};
+    socklen_t len;
+    if (family == AF_INET6) {
+        setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &one, sizeof(one));
+        sockaddr_in6* a = reinterpret_cast<sockaddr_in6*>(&addr);
+        a->sin6_family = AF_INET6;
+        a->sin6_addr = in6addr_any;
+        a->sin6_port = htons(static_cast<uint16_t>(port_));
+        len = sizeof(*a);
+    } else {
+        sockaddr_in* a = reinterpret_cast<sockaddr_in*>(&addr);
+        a->sin_family = AF_INET;
+        a->sin_addr.s_addr = htonl(INADDR_ANY);
+        a->sin_port = htons(static_cast<uint16_t>(port_));
+        len = sizeof(*a);
+    }
+
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), len) == -1 || listen(fd, SOMAXCONN) == -1) {
+        error = "listen on port " + std::to_string(port_) + ": " + strerror(errno);
+        ::close(fd);
+        return false;
+    }
+
+    // An ephemeral port picked for the first family is reused for the second
+    if (port_ == 0 && getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) == 0) {
+        port_ = ntohs(family == AF_INET6 ? reinterpret_cast<sockaddr_in6*>(&addr)->sin6_port
+                                         : reinterpret_cast<sockaddr_in*>(&addr)->sin_port);
+    }
+    fds_.push_back(fd);
+    return true;
+}
+
+std::vector<InetdSpawner::Spawned> InetdSpawner::acceptPending(
+    const std::function<bool(const std::string&)>& allow, size_t& refused, std::string& error) {
+    std::vector<Spawned> spawned;
+    refused = 0;
+    for (int listenFd : fds_) {
+        for (;;) {
+            sockaddr_storage peer{};
+            socklen_t peerLen = sizeof(peer);
+            const int conn = accept4(listenFd, reinterpret_cast<sockaddr*>(&peer), &peerLen, SOCK_CLOEXEC);
+            if (conn < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) error = std::string("accept: ") + strerror(errno);
+                break;
+            }
+            const uint64_t acceptedUs = StartupTrace::nowMicros();
+
+            char host[NI_MAXHOST] = "";
+            getnameinfo(reinterpret_cast<sockaddr*>(&peer), peerLen, host, sizeof(host), nullptr, 0, NI_NUMERICHOST);
+            if (allow && !allow(host)) {
+                ::close(conn);
+                ++refused;
+                continue;
+            }
+
+            Spawned s{-1, host, 0, false};
+            s.from_spare = spare_pid_ > 0 && handToSpare(conn, s.pid);
+            const bool ok = s.from_spare || spawnFresh(conn, s.pid, error);
+            s.spawn_us = StartupTrace::nowMicros() - acceptedUs;
+            ::close(conn);
+            if (ok) spawned.push_back(s);
+
+            // Off the connect path: the client is already talking to dropbear
+            if (settings_.warm_spare && spare_pid_ <= 0) startSpare();
+        }
+    }
+    return spawned;
+}
+
+SpawnHelper::Request InetdSpawner::request() const {
+    SpawnHelper::Request r;
+    r.path = settings_.path;
+    r.args = settings_.args;
+    if (settings_.sched) r.sched = settings_.sched->settings();
+    r.stderr_fd = settings_.log_fd;
+    return r;
+}
+
+bool InetdSpawner::spawnFresh(int conn, pid_t& pid, std::string& error) {
+    SpawnHelper::Request r = request();
+    r.stdio_fd = conn;
+    int unused;
+    return SpawnHelper::global().spawn(r, pid, unused, error);
+}
+
+bool InetdSpawner::handToSpare(int conn, pid_t& pid) {
+    if (!SpawnHelper::sendFd(spare_fd_, conn)) {
+        stopSpare();   // died or was killed; fall back to a fresh spawn
+        return false;
+    }
+    pid = spare_pid_;
+    ::close(spare_fd_);
+    spare_fd_ = -1;
+    spare_pid_ = -1;
+    return true;
+}
+
+void InetdSpawner::startSpare() {
+    SpawnHelper::Request r = request();
+    r.await_stdio = true;
+    std::string error;
+    pid_t pid;
+    int fd;
+    if (!SpawnHelper::global().spawn(r, pid, fd, error)) return;
+    spare_fd_ = fd;
+    spare_pid_ = pid;
+}
+
+void InetdSpawner::stopSpare() {
+    if (spare_fd_ >= 0) {
+        ::close(spare_fd_);
+        spare_fd_ = -1;
+    }
+    if (spare_pid_ > 0) {
+        kill(spare_pid_, SIGKILL);
+        SpawnHelper::global().wait(spare_pid_, nullptr, 0);
+        spare_pid_ = -1;
+    }
+}
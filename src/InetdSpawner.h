@@ -0,0 +1,78 @@
+#pragma once
+
+#include "SchedPolicy.h"
+#include "SpawnHelper.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+// On-demand dropbear: the app owns the listening sockets and starts
+// `dropbear -i` for each accepted connection, with the connection as its
+// stdin/stdout and the log pipe as stderr. Nothing of dropbear stays in memory
+// while nobody is connected.
+//
+// Processes are started through SpawnHelper. With warm_spare, one is started
+// in advance and blocks on a socketpair. Each connection is handed to it with
+// SCM_RIGHTS, and it execs dropbear right away. Another spare is started after
+// the handoff. This takes the spawn off the connect path, and the spare
+// pre-reads the dropbear binary into the page cache. Exec, host key load and
+// key exchange still happen per connection, as with any inetd service.
+//
+// Both IPv4 and IPv6 are listened on with separate sockets, like dropbear
+// does, so IPv4 clients show up as plain dotted quads to the auth guard.
+class InetdSpawner {
+public:
+    struct Settings {
+        int port = 22;                        // 0 = ephemeral (tests)
+        std::string path;                     // dropbear binary
+        std::vector<std::string> args;        // full argv, "-i" included
+        int log_fd = -1;                      // stderr of every child; not owned
+        bool warm_spare = true;
+        const SchedPolicy* sched = nullptr;   // applied in each child before exec
+    };
+
+    struct Spawned {
+        pid_t pid;
+        std::string client_ip;
+        uint64_t spawn_us;                    // accept() return to child handed the socket
+        bool from_spare;
+    };
+
+    InetdSpawner() = default;
+    ~InetdSpawner();
+
+    InetdSpawner(const InetdSpawner&) = delete;
+    InetdSpawner& operator=(const InetdSpawner&) = delete;
+
+    bool open(const Settings& settings, std::string& error);
+    // Stops listening and ends the spare; spawned sessions keep running
+    void close();
+    bool isOpen() const { return !fds_.empty(); }
+
+    // Listening sockets to poll for POLLIN
+    const std::vector<int>& fds() const { return fds_; }
+    int port() const { return port_; }
+    pid_t sparePid() const { return spare_pid_; }
+
+    // Accepts every pending connection. Connections for which allow(ip)
+    // returns false are closed before any process exists; refused counts them.
+    // The caller reaps the returned pids with SpawnHelper::wait().
+    std::vector<Spawned> acceptPending(const std::function<bool(const std::string&)>& allow,
+                                       size_t& refused, std::string& error);
+
+private:
+    bool listenOn(int family, std::string& error);
+    bool spawnFresh(int conn, pid_t& pid, std::string& error);
+    bool handToSpare(int conn, pid_t& pid);
+    void startSpare();
+    void stopSpare();
+    SpawnHelper::Request request() const;
+
+    Settings settings_;
+    std::vector<int> fds_;
+    int port_ = 0;
+    pid_t spare_pid_ = -1;
+    int spare_fd_ = -1;                       // our end of the spare's socketpair
+};
@@ -0,0 +1,53 @@
+#include "LatencyHistogram.h"
+#include <cmath>
+#include <cstdio>
+
+constexpr size_t LatencyHistogram::BUCKETS;
+
+size_t LatencyHistogram::bucketFor(uint64_t micros) {
+    if (micros < 1000) return 0;
+    const double quarterOctaves = 4.0 * std::log2(static_cast<double>(micros) / 1000.0);
+    const size_t bucket = static_cast<size_t>(quarterOctaves) + 1;
+    return bucket < BUCKETS ? bucket : BUCKETS - 1;
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t bucket) {
+    return static_cast<uint64_t>(1000.0 * std::exp2(bucket / 4.0));
+}
+
+void LatencyHistogram::record(uint64_t micros) {
+    buckets_[bucketFor(micros)]++;
+    count_++;
+    sum_us_ += micros;
+    if (micros > max_us_) max_us_ = micros;
+}
+
+void LatencyHistogram::clear() {
+    *this = LatencyHistogram();
+}
+
+uint64_t LatencyHistogram::percentile(double p) const {
+    if (count_ == 0) return 0;
+
+    const uint64_t rank = static_cast<uint64_t>(std::ceil(p * count_));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        seen += buckets_[i];
+        if (seen >= rank && buckets_[i] > 0) {
+            if (i == BUCKETS - 1) return max_us_;   // overflow bucket has no upper bound
+            const uint64_t bound = bucketUpperBound(i);
+            return bound < max_us_ ? bound : max_us_;
+        }
+    }
+    return max_us_;
+}
+
+std::string LatencyHistogram::formatMicros(uint64_t micros) {
+    char buf[32];
+    if (micros < 1000000) {
+        snprintf(buf, sizeof(buf), "%llu ms", static_cast<unsigned long long>((micros + 500) / 1000));
+    } else {
+        snprintf(buf, sizeof(buf), "%.1f s", micros / 1e6);
+    }
+    return buf;
+}
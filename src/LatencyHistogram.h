@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Fixed-size log-scale latency histogram: four buckets per doubling from 1 ms
+// up to ~4 minutes, so percentiles are within ~19% of the true value while
+// recording stays O(1) and allocation-free.
+class LatencyHistogram {
+public:
+    static constexpr size_t BUCKETS = 74;   // [0] < 1 ms, [73] overflow
+
+    void record(uint64_t micros);
+    void clear();
+
+    uint64_t count() const { return count_; }
+    uint64_t maxMicros() const { return max_us_; }
+    uint64_t meanMicros() const { return count_ ? sum_us_ / count_ : 0; }
+
+    // Upper bound of the bucket holding the p-th sample (0 < p <= 1), capped at
+    // the largest sample seen; 0 when empty
+    uint64_t percentile(double p) const;
+
+    // "120 ms", "1.4 s"
+    static std::string formatMicros(uint64_t micros);
+
+private:
+    static size_t bucketFor(uint64_t micros);
+    static uint64_t bucketUpperBound(size_t bucket);
+
+    uint64_t buckets_[BUCKETS] = {};
+    uint64_t count_ = 0;
+    uint64_t sum_us_ = 0;
+    uint64_t max_us_ = 0;
+};
@@ -0,0 +1,68 @@
+#include "LogFile.h"
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+
+LogFile::LogFile(const std::string& path, size_t maxBytes)
+    : path_(path), max_bytes_(maxBytes) {
+}
+
+LogFile::~LogFile() {
+    close();
+}
+
+bool LogFile::open() {
+    close();
+    fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ < 0) return false;
+
+    struct stat st{};
+    size_ = fstat(fd_, &st) == 0 ? static_cast<size_t>(st.st_size) : 0;
+    return true;
+}
+
+void LogFile::close() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    size_ = 0;
+}
+
+void LogFile::write(const std::string& line) {
+    if (fd_ < 0) return;
+
+    char stamp[32];
+    time_t now = time(nullptr);
+    struct tm tm{};
+    localtime_r(&now, &tm);
+    size_t len = strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S ", &tm);
+
+    std::string record(stamp, len);
+    record += line;
+    record += '\n';
+
+    if (max_bytes_ > 0 && size_ > 0 && size_ + record.size() > max_bytes_) {
+        rotate();
+        if (fd_ < 0) return;
+    }
+
+    size_t off = 0;
+    while (off < record.size()) {
+        ssize_t n = ::write(fd_, record.data() + off, record.size() - off);
+        if (n > 0) off += static_cast<size_t>(n);
+        else if (n == -1 && errno == EINTR) continue;
+        else break;   // disk full etc.; drop the rest rather than block
+    }
+    size_ += off;
+}
+
+void LogFile::rotate() {
+    close();
+    const std::string old = path_ + ".1";
+    rename(path_.c_str(), old.c_str());
+    open();
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Append-only, timestamped log file that survives restarts. When the file
+// grows past maxBytes it is renamed to "<path>.1" (replacing any older
+// rotation) and a fresh file is started, bounding disk use to ~2x maxBytes.
+class LogFile {
+public:
+    LogFile(const std::string& path, size_t maxBytes);
+    ~LogFile();
+
+    // Delete copy operations
+    LogFile(const LogFile&) = delete;
+    LogFile& operator=(const LogFile&) = delete;
+
+    bool open();
+    void close();
+    bool isOpen() const { return fd_ >= 0; }
+
+    // Writes "YYYY-MM-DD HH:MM:SS <line>\n" with a single write(2)
+    void write(const std::string& line);
+
+    size_t size() const { return size_; }
+    const std::string& path() const { return path_; }
+
+private:
+    void rotate();
+
+    const std::string path_;
+    const size_t max_bytes_;
+    int fd_ = -1;
+    size_t size_ = 0;
+};
@@ -0,0 +1,219 @@
+#include "LogHistory.h"
+#include "Lz4Block.h"
+#include <algorithm>
+#include <chrono>
+
+LogHistory::LogHistory() {
+    configure(Settings());
+}
+
+LogHistory::LogHistory(const Settings& settings) {
+    configure(settings);
+}
+
+void LogHistory::configure(const Settings& settings) {
+    // Linearize the ring (oldest first) before resizing it
+    std::vector<std::string> lines;
+    lines.reserve(ring_count_);
+    for (size_t i = 0; i < ring_count_; ++i) {
+        lines.push_back(std::move(ring_[(ring_head_ + i) % ring_.size()]));
+    }
+
+    settings_ = settings;
+    settings_.hot_lines = std::max<size_t>(1, settings_.hot_lines);
+    settings_.block_bytes = std::max<size_t>(256, settings_.block_bytes);
+
+    const uint64_t firstHot = next_ - ring_count_;
+    size_t keep = std::min(lines.size(), settings_.hot_lines);
+    for (size_t i = 0; i < lines.size() - keep; ++i) spill(lines[i], firstHot + i);
+
+    ring_.clear();
+    ring_.resize(settings_.hot_lines);
+    for (size_t i = 0; i < keep; ++i) {
+        ring_[i] = std::move(lines[lines.size() - keep + i]);
+    }
+    ring_head_ = 0;
+    ring_count_ = keep;
+
+    if (open_.size() >= settings_.block_bytes) seal();
+    evict();
+}
+
+void LogHistory::append(const std::string& line) {
+    if (ring_count_ < ring_.size()) {
+        ring_[(ring_head_ + ring_count_) % ring_.size()].assign(line);
+        ++ring_count_;
+    } else {
+        // Oldest hot line moves to the open block; its buffer takes the new line
+        std::string& oldest = ring_[ring_head_];
+        spill(oldest, next_ - ring_count_);
+        oldest.assign(line);
+        ring_head_ = (ring_head_ + 1) % ring_.size();
+    }
+    ++next_;
+}
+
+void LogHistory::spill(const std::string& line, uint64_t index) {
+    if (open_offsets_.empty()) open_first_ = index;
+    open_offsets_.push_back(static_cast<uint32_t>(open_.size()));
+    const size_t start = open_.size();
+    open_ += line;
+    std::replace(open_.begin() + start, open_.end(), '\n', ' ');   // '\n' delimits lines
+    open_.push_back('\n');
+    if (open_.size() >= settings_.block_bytes) seal();
+}
+
+void LogHistory::seal() {
+    if (open_offsets_.empty()) return;
+    const uint32_t count = static_cast<uint32_t>(open_offsets_.size());
+
+    if (settings_.cold_budget_bytes == 0) {
+        evicted_lines_ += count;
+    } else {
+        Block block;
+        block.first = open_first_;
+        block.lines = count;
+        block.raw_size = static_cast<uint32_t>(open_.size());
+        Lz4Block::compress(open_.data(), open_.size(), scratch_);
+        block.data.assign(scratch_);   // exact-size copy; scratch_ keeps the worst-case capacity
+        compressed_bytes_ += block.data.size();
+        raw_bytes_ += block.raw_size;
+        blocks_.push_back(std::move(block));
+    }
+
+    open_.clear();
+    open_offsets_.clear();
+    evict();
+}
+
+void LogHistory::evict() {
+    while (!blocks_.empty() && compressed_bytes_ > settings_.cold_budget_bytes) {
+        const Block& oldest = blocks_.front();
+        if (oldest.first == cache_first_) cache_first_ = UINT64_MAX;
+        compressed_bytes_ -= oldest.data.size();
+        raw_bytes_ -= oldest.raw_size;
+        evicted_lines_ += oldest.lines;
+        blocks_.pop_front();
+    }
+}
+
+uint64_t LogHistory::begin() const {
+    if (!blocks_.empty()) return blocks_.front().first;
+    if (!open_offsets_.empty()) return open_first_;
+    return next_ - ring_count_;
+}
+
+bool LogHistory::decodeBlock(size_t blockIdx) {
+    const Block& block = blocks_[blockIdx];
+    if (block.first == cache_first_) return true;
+
+    const auto start = std::chrono::steady_clock::now();
+    cache_.resize(block.raw_size);
+    if (!Lz4Block::decompress(block.data.data(), block.data.size(), &cache_[0], block.raw_size)) {
+        cache_first_ = UINT64_MAX;
+        return false;
+    }
+    cache_offsets_.clear();
+    size_t pos = 0;
+    while (pos < cache_.size()) {
+        cache_offsets_.push_back(static_cast<uint32_t>(pos));
+        pos = cache_.find('\n', pos);
+        if (pos == std::string::npos) break;
+        ++pos;
+    }
+    decode_ns_ += std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    ++decodes_;
+    cache_first_ = block.first;
+    return cache_offsets_.size() == block.lines;
+}
+
+bool LogHistory::lineSpan(uint64_t index, const char*& text, size_t& len) {
+    if (index >= next_ || index < begin()) return false;
+
+    const uint64_t ringFirst = next_ - ring_count_;
+    if (index >= ringFirst) {
+        const std::string& s = ring_[(ring_head_ + (index - ringFirst)) % ring_.size()];
+        text = s.data();
+        len = s.size();
+        return true;
+    }
+
+    const std::string* buf;
+    const std::vector<uint32_t>* offsets;
+    size_t k;
+    if (!open_offsets_.empty() && index >= open_first_) {
+        buf = &open_;
+        offsets = &open_offsets_;
+        k = static_cast<size_t>(index - open_first_);
+    } else {
+        // Index: last block starting at or before index
+        auto it = std::upper_bound(blocks_.begin(), blocks_.end(), index,
+                                   [](uint64_t i, const Block& b) { return i < b.first; });
+        if (it == blocks_.begin()) return false;
+        --it;
+        if (!decodeBlock(static_cast<size_t>(it - blocks_.begin()))) return false;
+        buf = &cache_;
+        offsets = &cache_offsets_;
+        k = static_cast<size_t>(index - it->first);
+    }
+
+    const size_t start = (*offsets)[k];
+    const size_t stop = k + 1 < offsets->size() ? (*offsets)[k + 1] : buf->size();
+    text = buf->data() + start;
+    len = stop - start - 1;   // without '\n'
+    return true;
+}
+
+bool LogHistory::line(uint64_t index, std::string& out) {
+    const char* text;
+    size_t len;
+    if (!lineSpan(index, text, len)) return false;
+    out.assign(text, len);
+    return true;
+}
+
+uint64_t LogHistory::find(const std::string& needle, uint64_t from, bool backward) {
+    const uint64_t first = begin();
+    if (first == next_) return next_;
+    if (from < first) {
+        if (backward) return next_;
+        from = first;
+    }
+    if (from >= next_) {
+        if (!backward) return next_;
+        from = next_ - 1;
+    }
+
+    for (uint64_t i = from;; backward ? --i : ++i) {
+        const char* text;
+        size_t len;
+        if (lineSpan(i, text, len) &&
+            std::search(text, text + len, needle.begin(), needle.end()) != text + len) {
+            return i;
+        }
+        if (backward ? i == first : i + 1 == next_) break;
+    }
+    return next_;
+}
+
+LogHistory::Stats LogHistory::stats() const {
+    Stats s;
+    s.lines = size();
+    s.blocks = blocks_.size();
+    for (const auto& b : blocks_) {
+        s.cold_lines += b.lines;
+        s.footprint_bytes += sizeof(Block) + b.data.capacity();
+    }
+    s.raw_bytes = raw_bytes_;
+    s.compressed_bytes = compressed_bytes_;
+    s.evicted_lines = evicted_lines_;
+    s.decodes = decodes_;
+    s.decode_ns = decode_ns_;
+
+    for (const auto& r : ring_) s.footprint_bytes += sizeof(r) + r.capacity();
+    s.footprint_bytes += open_.capacity() + open_offsets_.capacity() * sizeof(uint32_t) +
+                         cache_.capacity() + cache_offsets_.capacity() * sizeof(uint32_t) +
+                         scratch_.capacity();
+    return s;
+}
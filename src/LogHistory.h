@@ -0,0 +1,110 @@
+#pragma once
+
+#include "Constants.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+// Long-running log store in bounded RAM. The newest lines sit uncompressed in
+// a ring (what the log view shows live). Lines falling out of the ring
+// collect in an open block, which is sealed with Lz4Block once it reaches
+// block_bytes. Sealed blocks are dropped oldest first when they exceed
+// cold_budget_bytes.
+//
+// Lines are addressed by a sequence number that never resets: [begin(), end())
+// is what is still retained. A per-block index (first line, line count, sizes)
+// finds the block for a line, and only that block is decoded. The most recent
+// decode is cached, so scrolling and searching within it are free.
+class LogHistory {
+public:
+    struct Settings {
+        size_t hot_lines = LogDisplay::MAX_LINES;
+        size_t block_bytes = 16 * 1024;          // uncompressed text per block
+        size_t cold_budget_bytes = 1024 * 1024;  // compressed blocks; 0 keeps only hot/open lines
+    };
+
+    struct Stats {
+        uint64_t lines = 0;              // retained, end() - begin()
+        uint64_t cold_lines = 0;         // in sealed blocks
+        uint64_t blocks = 0;
+        uint64_t raw_bytes = 0;          // sealed text before compression
+        uint64_t compressed_bytes = 0;
+        uint64_t evicted_lines = 0;
+        uint64_t decodes = 0;
+        uint64_t decode_ns = 0;
+        size_t footprint_bytes = 0;      // ring + open block + blocks + decode cache
+
+        double ratio() const {
+            return compressed_bytes ? static_cast<double>(raw_bytes) / compressed_bytes : 0.0;
+        }
+        double decodeMicrosPerBlock() const {
+            return decodes ? decode_ns / 1000.0 / decodes : 0.0;
+        }
+    };
+
+    LogHistory();
+    explicit LogHistory(const Settings& settings);
+
+    // Resizing the ring or budget keeps every line that still fits
+    void configure(const Settings& settings);
+    const Settings& settings() const { return settings_; }
+
+    void append(const std::string& line);
+
+    uint64_t begin() const;
+    uint64_t end() const { return next_; }
+    uint64_t size() const { return end() - begin(); }
+
+    // Copies line index into out (reusing its buffer); false if not retained.
+    // Not const: may decode a block into the cache.
+    bool line(uint64_t index, std::string& out);
+
+    // Nearest retained line containing needle, scanning from `from` towards
+    // older (backward) or newer lines; end() when there is none
+    uint64_t find(const std::string& needle, uint64_t from, bool backward);
+
+    Stats stats() const;
+
+private:
+    struct Block {
+        uint64_t first;
+        uint32_t lines;
+        uint32_t raw_size;
+        std::string data;
+    };
+
+    // Points at the text of a retained line (valid until the next call)
+    bool lineSpan(uint64_t index, const char*& text, size_t& len);
+    bool decodeBlock(size_t blockIdx);
+    void spill(const std::string& line, uint64_t index);
+    void seal();
+    void evict();
+
+    Settings settings_;
+    uint64_t next_ = 0;                  // sequence number of the next line
+
+    // Newest lines, oldest at ring_head_
+    std::vector<std::string> ring_;
+    size_t ring_head_ = 0;
+    size_t ring_count_ = 0;
+
+    // Lines awaiting compression, '\n'-terminated
+    std::string open_;
+    std::vector<uint32_t> open_offsets_;
+    uint64_t open_first_ = 0;
+
+    std::deque<Block> blocks_;
+    uint64_t compressed_bytes_ = 0;
+    uint64_t raw_bytes_ = 0;
+    uint64_t evicted_lines_ = 0;
+
+    // Last decoded block
+    uint64_t cache_first_ = UINT64_MAX;
+    std::string cache_;
+    std::vector<uint32_t> cache_offsets_;
+    std::string scratch_;                // compression output
+    uint64_t decodes_ = 0;
+    uint64_t decode_ns_ = 0;
+};
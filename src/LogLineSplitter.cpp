@@ -0,0 +1,29 @@
+#include "LogLineSplitter.h"
+
+void LogLineSplitter::trimCR(std::string& s) {
+    while (!s.empty() && (s.back() == '\r' || s.back() == '\n')) s.pop_back();
+}
+
+void LogLineSplitter::feed(const char* data, size_t len, const LineCallback& onLine) {
+    pending_.append(data, len);
+
+    size_t start = 0;
+    for (;;) {
+        size_t pos = pending_.find('\n', start);
+        if (pos == std::string::npos) break;
+        line_.assign(pending_, start, pos - start);   // reuses line_'s capacity
+        trimCR(line_);
+        if (!line_.empty()) onLine(line_);
+        start = pos + 1;
+    }
+    if (start > 0) {
+        pending_.erase(0, start); // keep incomplete line
+    }
+}
+
+void LogLineSplitter::flush(const LineCallback& onLine) {
+    std::string tail;
+    tail.swap(pending_);
+    trimCR(tail);
+    if (!tail.empty()) onLine(tail);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+// Reassembles newline-terminated log lines from arbitrary read() chunks.
+// Trailing CR/LF is trimmed and empty lines are dropped.
+class LogLineSplitter {
+public:
+    using LineCallback = std::function<void(const std::string&)>;
+
+    // Appends data and emits every complete line; a partial tail is kept
+    void feed(const char* data, size_t len, const LineCallback& onLine);
+
+    // Emits the incomplete tail (e.g. on EOF) and resets
+    void flush(const LineCallback& onLine);
+
+    void clear() { pending_.clear(); }
+    size_t pendingBytes() const { return pending_.size(); }
+
+    static void trimCR(std::string& s);
+
+private:
+    std::string pending_;
+    std::string line_;   // scratch for the line being emitted
+};
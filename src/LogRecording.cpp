@@ -0,0 +1,109 @@
+#include "LogRecording.h"
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+const char kHeader[] = "# dropbear-app log recording v1\n";
+
+bool writeAll(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n > 0) {
+            data += n;
+            len -= static_cast<size_t>(n);
+        } else if (n == -1 && errno == EINTR) {
+            continue;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+LogRecording::~LogRecording() {
+    close();
+}
+
+bool LogRecording::open(const std::string& path) {
+    close();
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ < 0) return false;
+
+    struct stat st{};
+    if (fstat(fd_, &st) == 0 && st.st_size == 0 &&
+        !writeAll(fd_, kHeader, sizeof(kHeader) - 1)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void LogRecording::close() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+void LogRecording::append(const char* data, size_t len, uint64_t monotonicUs) {
+    if (fd_ < 0 || len == 0) return;
+
+    // One buffer per chunk so concurrent readers never see a torn record
+    char head[48];
+    int headLen = snprintf(head, sizeof(head), "%" PRIu64 " %zu\n", monotonicUs, len);
+    std::string record;
+    record.reserve(static_cast<size_t>(headLen) + len + 1);
+    record.append(head, static_cast<size_t>(headLen));
+    record.append(data, len);
+    record.push_back('\n');
+
+    if (!writeAll(fd_, record.data(), record.size())) close();
+}
+
+bool LogRecording::load(const std::string& path, std::vector<Chunk>& chunks,
+                        std::string& error) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        error = "cannot open " + path;
+        return false;
+    }
+    const std::string content((std::istreambuf_iterator<char>(in)),
+                              std::istreambuf_iterator<char>());
+
+    if (content.compare(0, sizeof(kHeader) - 1, kHeader) != 0) {
+        error = "not a log recording (missing header)";
+        return false;
+    }
+
+    chunks.clear();
+    uint64_t first = 0;
+    size_t pos = sizeof(kHeader) - 1;
+    while (pos < content.size()) {
+        size_t eol = content.find('\n', pos);
+        unsigned long long ts = 0;
+        size_t len = 0;
+        if (eol == std::string::npos ||
+            sscanf(content.c_str() + pos, "%llu %zu", &ts, &len) != 2 ||
+            eol + 1 + len + 1 > content.size() || content[eol + 1 + len] != '\n') {
+            error = "truncated or corrupt record at byte " + std::to_string(pos);
+            return false;
+        }
+
+        if (chunks.empty()) first = ts;
+        Chunk chunk;
+        chunk.offset_us = ts >= first ? ts - first : 0;
+        chunk.data = content.substr(eol + 1, len);
+        chunks.push_back(std::move(chunk));
+        pos = eol + 1 + len + 1;
+    }
+    return true;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Raw capture of dropbear's log byte stream, chunk by chunk as read() returned
+// it, with a monotonic timestamp per chunk. Used to replay realistic load
+// (brute-force bursts, busy sessions) through DropbearManager's ingest path.
+//
+// File format: a "# dropbear-app log recording v1" header line, then per chunk
+// "<monotonic_us> <len>\n" followed by len raw bytes and "\n". Recordings are
+// appended to, so restarts simply show up as gaps.
+class LogRecording {
+public:
+    struct Chunk {
+        uint64_t offset_us;   // relative to the first chunk
+        std::string data;
+    };
+
+    LogRecording() = default;
+    ~LogRecording();
+
+    // Delete copy operations
+    LogRecording(const LogRecording&) = delete;
+    LogRecording& operator=(const LogRecording&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return fd_ >= 0; }
+
+    void append(const char* data, size_t len, uint64_t monotonicUs);
+
+    static bool load(const std::string& path, std::vector<Chunk>& chunks, std::string& error);
+
+private:
+    int fd_ = -1;
+};
@@ -0,0 +1,278 @@
+#include "LogRelay.h"
+#include "Constants.h"
+#include <sys/prctl.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+LogRelay::LogRelay()
+    : metric_dropped_lines_(Metrics::global().counter(
+          "dropbear_app_log_dropped_lines_total", "Dropbear log lines dropped while the reader was stalled")),
+      metric_dropped_bytes_(Metrics::global().counter(
+          "dropbear_app_log_dropped_bytes_total", "Dropbear log bytes dropped while the reader was stalled")) {
+}
+
+LogRelay::~LogRelay() {
+    stop();
+}
+
+bool LogRelay::start(int source, const Settings& settings, int& out, std::string& error) {
+    if (thread_.joinable()) {
+        error = "log relay already running";
+        return false;
+    }
+    int pipefd[2];
+    if (pipe2(pipefd, O_CLOEXEC | O_NONBLOCK) == -1) {
+        error = std::string("pipe failed: ") + strerror(errno);
+        return false;
+    }
+    if (pipe2(wake_pipe_, O_CLOEXEC | O_NONBLOCK) == -1) {
+        error = std::string("pipe failed: ") + strerror(errno);
+        close(pipefd[0]);
+        close(pipefd[1]);
+        wake_pipe_[0] = wake_pipe_[1] = -1;
+        return false;
+    }
+    fcntl(source, F_SETFL, fcntl(source, F_GETFL) | O_NONBLOCK);
+
+    settings_ = settings;
+    source_ = source;
+    out_ = pipefd[1];
+    thread_ = std::thread(&LogRelay::threadMain, this);
+    out = pipefd[0];
+    return true;
+}
+
+void LogRelay::stop() {
+    if (thread_.joinable()) {
+        const char byte = 0;
+        ssize_t ignored = write(wake_pipe_[1], &byte, 1);
+        (void)ignored;
+        thread_.join();
+    }
+    for (int& fd : wake_pipe_) {
+        if (fd >= 0) close(fd);
+        fd = -1;
+    }
+    if (source_ >= 0) {
+        close(source_);
+        source_ = -1;
+    }
+}
+
+LogRelay::Stats LogRelay::stats() const {
+    Stats s;
+    s.relayed_lines = relayed_lines_.load(std::memory_order_relaxed);
+    s.dropped_lines = dropped_lines_.load(std::memory_order_relaxed);
+    s.dropped_bytes = dropped_bytes_.load(std::memory_order_relaxed);
+    s.peak_buffered_bytes = peak_buffered_.load(std::memory_order_relaxed);
+    return s;
+}
+
+bool LogRelay::parseOverflow(const std::string& value, Overflow& out) {
+    if (value == "drop-oldest") out = Overflow::DropOldest;
+    else if (value == "drop-newest") out = Overflow::DropNewest;
+    else return false;
+    return true;
+}
+
+const char* LogRelay::overflowName(Overflow overflow) {
+    return overflow == Overflow::DropOldest ? "drop-oldest" : "drop-newest";
+}
+
+int LogRelay::setPipeCapacity(int fd, int bytes) {
+    if (bytes > 0 && fcntl(fd, F_SETPIPE_SZ, bytes) == -1 && errno == EPERM) {
+        // Beyond pipe-max-size needs CAP_SYS_RESOURCE; take the most we may
+        int max = 0;
+        if (FILE* f = fopen("/proc/sys/fs/pipe-max-size", "r")) {
+            if (fscanf(f, "%d", &max) != 1) max = 0;
+            fclose(f);
+        }
+        if (max > 0 && max < bytes) fcntl(fd, F_SETPIPE_SZ, max);
+    }
+    return fcntl(fd, F_GETPIPE_SZ);
+}
+
+void LogRelay::threadMain() {
+    // Signals stay with the main thread; a closed consumer shows up as EPIPE
+    sigset_t all;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, nullptr);
+    prctl(PR_SET_NAME, "log-relay", 0, 0, 0);
+
+    bool sourceOpen = true;
+    while (sourceOpen || !queue_.empty()) {
+        struct pollfd pfds[3] = {
+            {wake_pipe_[0], POLLIN, 0},
+            {sourceOpen ? source_ : -1, POLLIN, 0},
+            {out_, static_cast<short>(queue_.empty() ? 0 : POLLOUT), 0},
+        };
+        if (poll(pfds, 3, -1) == -1) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (pfds[0].revents) break;
+        if (pfds[2].revents & POLLERR) break;   // consumer closed its end
+        if (pfds[1].revents) sourceOpen = readSource();
+        if (!flush()) break;
+    }
+    // The consumer sees EOF once everything before it was delivered
+    close(out_);
+    out_ = -1;
+}
+
+bool LogRelay::readSource() {
+    char buf[LogPipe::READ_CHUNK];
+    // Bounded so a flooding writer can't keep the consumer from being fed
+    for (int round = 0; round < LogPipe::READS_PER_FLUSH; ++round) {
+        const ssize_t n = read(source_, buf, sizeof(buf));
+        if (n == -1 && errno == EINTR) continue;
+        if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        if (n <= 0) {
+            if (!partial_.empty()) enqueue();
+            return false;
+        }
+        const char* p = buf;
+        const char* end = buf + n;
+        while (p < end) {
+            const char* nl = static_cast<const char*>(memchr(p, '\n', static_cast<size_t>(end - p)));
+            const char* stop = nl ? nl + 1 : end;
+            partial_.append(p, static_cast<size_t>(stop - p));
+            p = stop;
+            if (nl || partial_.size() >= LogPipe::MAX_LINE_BYTES) enqueue();
+        }
+    }
+    return true;
+}
+
+bool LogRelay::flush() {
+    while (!queue_.empty()) {
+        struct iovec iov[LogPipe::IOV_BATCH];
+        int n = 0;
+        for (size_t i = 0; i < queue_.size() && n < LogPipe::IOV_BATCH; ++i, ++n) {
+            Slot& s = queue_[i];
+            if (isOpenMarker(i)) {
+                char text[160];
+                snprintf(text, sizeof(text),
+                         "log relay: %llu lines (%llu bytes) dropped while the log reader was stalled (%s)\n",
+                         static_cast<unsigned long long>(s.lines), static_cast<unsigned long long>(s.bytes),
+                         overflowName(settings_.overflow));
+                s.text.assign(text);
+            }
+            const size_t offset = i == 0 ? head_sent_ : 0;
+            iov[n].iov_base = &s.text[offset];
+            iov[n].iov_len = s.text.size() - offset;
+        }
+        const ssize_t written = writev(out_, iov, n);
+        if (written == -1) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+
+        size_t left = static_cast<size_t>(written);
+        while (left > 0) {
+            Slot& head = queue_.front();
+            const size_t remaining = head.text.size() - head_sent_;
+            if (left < remaining) {
+                head_sent_ += left;
+                break;
+            }
+            left -= remaining;
+            if (!head.marker) {
+                buffered_ -= head.text.size();
+                relayed_lines_.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (spare_.size() < LogPipe::SPARE_LINES) spare_.push_back(std::move(head.text));
+            queue_.pop_front();
+            head_sent_ = 0;
+        }
+    }
+    return true;
+}
+
+void LogRelay::enqueue() {
+    const size_t len = partial_.size();
+    if (len > settings_.buffer_bytes) {
+        dropIncoming();
+        return;
+    }
+    while (buffered_ + len > settings_.buffer_bytes) {
+        if (settings_.overflow == Overflow::DropNewest || !evictOldest()) {
+            dropIncoming();
+            return;
+        }
+    }
+    Slot& slot = newSlot();
+    slot.text.swap(partial_);
+    partial_.clear();
+    buffered_ += len;
+    if (buffered_ > peak_buffered_.load(std::memory_order_relaxed)) {
+        peak_buffered_.store(buffered_, std::memory_order_relaxed);
+    }
+}
+
+bool LogRelay::evictOldest() {
+    // A line partly written already has to be finished; the report goes
+    // right after it, in place of the lines it stands for
+    const size_t at = head_sent_ > 0 ? 1 : 0;
+    if (at < queue_.size() && isOpenMarker(at)) {
+        if (at + 1 >= queue_.size() || queue_[at + 1].marker) return false;
+        Slot& victim = queue_[at + 1];
+        buffered_ -= victim.text.size();
+        recordDrop(queue_[at], victim.text.size());
+        if (spare_.size() < LogPipe::SPARE_LINES) spare_.push_back(std::move(victim.text));
+        queue_.erase(queue_.begin() + static_cast<long>(at + 1));
+        return true;
+    }
+    if (at >= queue_.size()) return false;
+
+    // The oldest line becomes the report
+    Slot& victim = queue_[at];
+    const size_t len = victim.text.size();
+    buffered_ -= len;
+    victim.text.clear();
+    victim.marker = true;
+    victim.lines = 0;
+    victim.bytes = 0;
+    recordDrop(victim, len);
+    return true;
+}
+
+void LogRelay::dropIncoming() {
+    if (queue_.empty() || !isOpenMarker(queue_.size() - 1)) {
+        Slot& marker = newSlot();
+        marker.marker = true;
+    }
+    recordDrop(queue_.back(), partial_.size());
+    partial_.clear();
+}
+
+void LogRelay::recordDrop(Slot& marker, size_t bytes) {
+    ++marker.lines;
+    marker.bytes += bytes;
+    dropped_lines_.fetch_add(1, std::memory_order_relaxed);
+    dropped_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    metric_dropped_lines_.inc();
+    metric_dropped_bytes_.inc(static_cast<int64_t>(bytes));
+}
+
+bool LogRelay::isOpenMarker(size_t index) const {
+    // A report still counts drops until its first byte is written
+    return queue_[index].marker && !(index == 0 && head_sent_ > 0);
+}
+
+LogRelay::Slot& LogRelay::newSlot() {
+    queue_.emplace_back();
+    Slot& slot = queue_.back();
+    if (!spare_.empty()) {
+        slot.text.swap(spare_.back());
+        spare_.pop_back();
+        slot.text.clear();
+    }
+    return slot;
+}
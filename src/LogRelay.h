@@ -0,0 +1,102 @@
+#pragma once
+
+#include "Metrics.h"
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Keeps dropbear's log pipe drained no matter what the consumer is doing.
+// Dropbear writes its log to stderr with blocking writes; once the pipe is full
+// (a slow frame, a hang, a blocking waitpid in the UI) every session stalls on
+// that write. A relay thread reads the pipe as fast as dropbear fills it and
+// forwards whole lines into a second pipe the consumer polls and reads like
+// before. While the consumer is behind, lines wait in a bounded buffer; when
+// that is full, lines are dropped by the overflow policy:
+//
+//   - DropOldest keeps the most recent lines (what is happening now)
+//   - DropNewest keeps the lines from before the stall (what caused it)
+//
+// Every loss is counted and reported in the stream itself, as one line in
+// place of the lines dropped, once the consumer catches up. EOF on the source
+// reaches the consumer after the buffered lines.
+class LogRelay {
+public:
+    enum class Overflow { DropOldest, DropNewest };
+
+    struct Settings {
+        size_t buffer_bytes = 256 * 1024;   // whole lines waiting for the consumer
+        Overflow overflow = Overflow::DropOldest;
+    };
+
+    struct Stats {
+        uint64_t relayed_lines;
+        uint64_t dropped_lines;
+        uint64_t dropped_bytes;
+        size_t peak_buffered_bytes;
+    };
+
+    LogRelay();
+    ~LogRelay();
+
+    LogRelay(const LogRelay&) = delete;
+    LogRelay& operator=(const LogRelay&) = delete;
+
+    // Takes ownership of source. out is the read end for the consumer
+    // (non-blocking, CLOEXEC); the consumer owns and closes it.
+    bool start(int source, const Settings& settings, int& out, std::string& error);
+    // Ends the thread; lines not yet forwarded are discarded
+    void stop();
+
+    Stats stats() const;
+
+    // "drop-oldest" / "drop-newest"
+    static bool parseOverflow(const std::string& value, Overflow& out);
+    static const char* overflowName(Overflow overflow);
+
+    // F_SETPIPE_SZ, clamped to /proc/sys/fs/pipe-max-size when not privileged.
+    // Returns the capacity in effect afterwards, or -1 if it can't be read.
+    static int setPipeCapacity(int fd, int bytes);
+
+private:
+    // A log line, or (marker) the report standing in for dropped lines
+    struct Slot {
+        std::string text;
+        bool marker = false;
+        uint64_t lines = 0;
+        uint64_t bytes = 0;
+    };
+
+    void threadMain();
+    bool readSource();        // false once the source is at EOF
+    bool flush();             // false once the consumer closed its end
+    void completeLine();
+    void enqueue();
+    bool evictOldest();
+    void dropIncoming();
+    void recordDrop(Slot& marker, size_t bytes);
+    bool isOpenMarker(size_t index) const;
+    Slot& newSlot();
+
+    Settings settings_;
+    int source_ = -1;
+    int out_ = -1;                      // write end
+    int wake_pipe_[2] = {-1, -1};
+    std::thread thread_;
+
+    // Relay thread only
+    std::deque<Slot> queue_;
+    std::vector<std::string> spare_;    // recycled line buffers
+    std::string partial_;               // incoming line without its newline yet
+    size_t buffered_ = 0;               // bytes of lines in queue_
+    size_t head_sent_ = 0;              // bytes of queue_.front() already written
+
+    std::atomic<uint64_t> relayed_lines_{0};
+    std::atomic<uint64_t> dropped_lines_{0};
+    std::atomic<uint64_t> dropped_bytes_{0};
+    std::atomic<size_t> peak_buffered_{0};
+    Metrics::Metric& metric_dropped_lines_;
+    Metrics::Metric& metric_dropped_bytes_;
+};
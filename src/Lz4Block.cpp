@@ -0,0 +1,125 @@
+#include "Lz4Block.h"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+constexpr size_t MIN_MATCH = 4;
+constexpr size_t LAST_LITERALS = 5;   // the block always ends with literals
+constexpr size_t MF_LIMIT = 12;       // no match may start in the last 12 bytes
+constexpr size_t MAX_OFFSET = 65535;
+constexpr int HASH_BITS = 12;
+constexpr uint32_t NO_POS = 0xFFFFFFFFu;
+
+uint32_t read32(const char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+uint32_t hash32(uint32_t v) {
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+void putLength(std::string& out, size_t n) {
+    while (n >= 255) {
+        out.push_back(static_cast<char>(255));
+        n -= 255;
+    }
+    out.push_back(static_cast<char>(n));
+}
+
+void putSequence(std::string& out, const char* literals, size_t litLen,
+                 size_t offset, size_t matchLen) {
+    const size_t ml = matchLen - MIN_MATCH;
+    const uint8_t token = static_cast<uint8_t>((litLen >= 15 ? 15 : litLen) << 4 |
+                                               (ml >= 15 ? 15 : ml));
+    out.push_back(static_cast<char>(token));
+    if (litLen >= 15) putLength(out, litLen - 15);
+    out.append(literals, litLen);
+    out.push_back(static_cast<char>(offset & 0xFF));
+    out.push_back(static_cast<char>(offset >> 8));
+    if (ml >= 15) putLength(out, ml - 15);
+}
+
+void putLastLiterals(std::string& out, const char* literals, size_t litLen) {
+    out.push_back(static_cast<char>((litLen >= 15 ? 15 : litLen) << 4));
+    if (litLen >= 15) putLength(out, litLen - 15);
+    out.append(literals, litLen);
+}
+
+// Reads a 15+255+... extended length; false when it runs off the input
+bool getLength(const uint8_t*& ip, const uint8_t* end, size_t& n) {
+    if (n != 15) return true;
+    uint8_t b;
+    do {
+        if (ip >= end) return false;
+        b = *ip++;
+        n += b;
+    } while (b == 255);
+    return true;
+}
+
+} // namespace
+
+void Lz4Block::compress(const char* src, size_t len, std::string& out) {
+    out.clear();
+    out.reserve(bound(len));
+
+    size_t anchor = 0;
+    if (len > MF_LIMIT) {
+        std::vector<uint32_t> table(1u << HASH_BITS, NO_POS);
+        const size_t matchLimit = len - LAST_LITERALS;
+        size_t ip = 0;
+        while (ip < len - MF_LIMIT) {
+            const uint32_t seq = read32(src + ip);
+            uint32_t& slot = table[hash32(seq)];
+            const uint32_t ref = slot;
+            slot = static_cast<uint32_t>(ip);
+            if (ref == NO_POS || ip - ref > MAX_OFFSET || read32(src + ref) != seq) {
+                ++ip;
+                continue;
+            }
+            size_t matchLen = MIN_MATCH;
+            while (ip + matchLen < matchLimit && src[ref + matchLen] == src[ip + matchLen]) {
+                ++matchLen;
+            }
+            putSequence(out, src + anchor, ip - anchor, ip - ref, matchLen);
+            ip += matchLen;
+            anchor = ip;
+        }
+    }
+    putLastLiterals(out, src + anchor, len - anchor);
+}
+
+bool Lz4Block::decompress(const char* src, size_t len, char* dst, size_t rawLen) {
+    const uint8_t* ip = reinterpret_cast<const uint8_t*>(src);
+    const uint8_t* const end = ip + len;
+    size_t op = 0;
+
+    while (ip < end) {
+        const uint8_t token = *ip++;
+        size_t litLen = token >> 4;
+        if (!getLength(ip, end, litLen)) return false;
+        if (litLen > static_cast<size_t>(end - ip) || litLen > rawLen - op) return false;
+        std::memcpy(dst + op, ip, litLen);
+        ip += litLen;
+        op += litLen;
+        if (ip == end) break;   // last sequence carries literals only
+
+        if (end - ip < 2) return false;
+        const size_t offset = ip[0] | static_cast<size_t>(ip[1]) << 8;
+        ip += 2;
+        size_t matchLen = token & 0x0F;
+        if (!getLength(ip, end, matchLen)) return false;
+        matchLen += MIN_MATCH;
+        if (offset == 0 || offset > op || matchLen > rawLen - op) return false;
+
+        // Byte-wise: source and destination overlap when offset < matchLen
+        const char* ref = dst + op - offset;
+        for (size_t i = 0; i < matchLen; ++i) dst[op + i] = ref[i];
+        op += matchLen;
+    }
+    return op == rawLen;
+}
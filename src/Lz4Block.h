@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Minimal LZ4 block-format codec (no frame header, no checksum) for sealing
+// log history blocks. Greedy single-probe matching: text logs compress about
+// as well as with the reference encoder's fast mode, and decoding is a plain
+// byte copy loop with every length and offset bounds-checked.
+class Lz4Block {
+public:
+    // Replaces out with the compressed form of src[0, len)
+    static void compress(const char* src, size_t len, std::string& out);
+
+    // Decodes exactly rawLen bytes into dst; false on malformed input
+    static bool decompress(const char* src, size_t len, char* dst, size_t rawLen);
+
+    // Worst-case compressed size for len input bytes
+    static size_t bound(size_t len) { return len + len / 255 + 16; }
+};
@@ -0,0 +1,56 @@
+#include "Metrics.h"
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+Metrics& Metrics::global() {
+    static Metrics instance;
+    return instance;
+}
+
+Metrics::Metric& Metrics::counter(const std::string& name, const std::string& help,
+                                  const std::string& labels) {
+    return lookup(name, help, labels, Metric::Type::Counter);
+}
+
+Metrics::Metric& Metrics::gauge(const std::string& name, const std::string& help,
+                                const std::string& labels) {
+    return lookup(name, help, labels, Metric::Type::Gauge);
+}
+
+Metrics::Metric& Metrics::lookup(const std::string& name, const std::string& help,
+                                 const std::string& labels, Metric::Type type) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& m : metrics_) {
+        if (m.name() == name && m.labels() == labels) return m;
+    }
+    metrics_.emplace_back(name, help, labels, type);
+    return metrics_.back();
+}
+
+std::string Metrics::renderPrometheus() const {
+    std::vector<const Metric*> sorted;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& m : metrics_) sorted.push_back(&m);
+    }
+
+    // Group series of the same family so HELP/TYPE are emitted once
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const Metric* a, const Metric* b) { return a->name() < b->name(); });
+
+    std::ostringstream out;
+    const std::string* family = nullptr;
+    for (const Metric* m : sorted) {
+        if (!family || *family != m->name()) {
+            family = &m->name();
+            out << "# HELP " << m->name() << ' ' << m->help() << '\n';
+            out << "# TYPE " << m->name() << ' '
+                << (m->type() == Metric::Type::Counter ? "counter" : "gauge") << '\n';
+        }
+        out << m->name();
+        if (!m->labels().empty()) out << '{' << m->labels() << '}';
+        out << ' ' << m->value() << '\n';
+    }
+    return out.str();
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+
+// Process-wide registry of counters and gauges. Registration takes a lock and
+// returns a reference that stays valid for the life of the process, so hot
+// paths look a metric up once and then only do relaxed atomic updates.
+class Metrics {
+public:
+    class Metric {
+    public:
+        enum class Type { Counter, Gauge };
+
+        Metric(const std::string& name, const std::string& help,
+               const std::string& labels, Type type)
+            : name_(name), help_(help), labels_(labels), type_(type) {}
+
+        Metric(const Metric&) = delete;
+        Metric& operator=(const Metric&) = delete;
+
+        void inc(int64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+        void dec(int64_t n = 1) { value_.fetch_sub(n, std::memory_order_relaxed); }
+        void set(int64_t v) { value_.store(v, std::memory_order_relaxed); }
+        int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+        const std::string& name() const { return name_; }
+        const std::string& help() const { return help_; }
+        const std::string& labels() const { return labels_; }
+        Type type() const { return type_; }
+
+    private:
+        const std::string name_;
+        const std::string help_;
+        const std::string labels_;   // Prometheus label set without braces, e.g. interface="wlan0"
+        const Type type_;
+        std::atomic<int64_t> value_{0};
+    };
+
+    static Metrics& global();
+
+    // Returns the existing metric when name and labels were registered before
+    Metric& counter(const std::string& name, const std::string& help,
+                    const std::string& labels = "");
+    Metric& gauge(const std::string& name, const std::string& help,
+                  const std::string& labels = "");
+
+    // Prometheus text exposition format (version 0.0.4)
+    std::string renderPrometheus() const;
+
+private:
+    Metric& lookup(const std::string& name, const std::string& help,
+                   const std::string& labels, Metric::Type type);
+
+    mutable std::mutex mutex_;
+    std::deque<Metric> metrics_;   // deque: references survive growth
+};
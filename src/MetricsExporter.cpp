@@ -0,0 +1,145 @@
+#include "MetricsExporter.h"
+#include "Constants.h"
+#include "Metrics.h"
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+MetricsExporter::MetricsExporter(Metrics& metrics, const std::string& filePath,
+                                 const std::string& socketPath, int filePeriodMs)
+    : metrics_(metrics), file_path_(filePath), socket_path_(socketPath),
+      file_period_ms_(filePeriodMs) {
+}
+
+MetricsExporter::~MetricsExporter() {
+    stop();
+}
+
+bool MetricsExporter::start() {
+    if (running_) return true;
+
+    // The socket is optional; the file is still written if it can't be bound
+    const bool socketOk = socket_path_.empty() || openSocket();
+    if (pipe2(wake_pipe_, O_CLOEXEC | O_NONBLOCK) == -1) {
+        wake_pipe_[0] = wake_pipe_[1] = -1;
+    }
+
+    running_ = true;
+    thread_ = std::thread(&MetricsExporter::threadMain, this);
+    return socketOk;
+}
+
+void MetricsExporter::stop() {
+    if (!running_) return;
+    running_ = false;
+    if (wake_pipe_[1] >= 0) {
+        const char byte = 0;
+        ssize_t ignored = write(wake_pipe_[1], &byte, 1);
+        (void)ignored;
+    }
+    if (thread_.joinable()) thread_.join();
+
+    for (int& fd : wake_pipe_) {
+        if (fd >= 0) close(fd);
+        fd = -1;
+    }
+
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+        listen_fd_ = -1;
+        unlink(socket_path_.c_str());
+    }
+}
+
+bool MetricsExporter::openSocket() {
+    struct sockaddr_un addr{};
+    if (socket_path_.size() >= sizeof(addr.sun_path)) return false;
+
+    const std::string dir = socket_path_.substr(0, socket_path_.find_last_of('/'));
+    if (!dir.empty()) mkdir(dir.c_str(), 0755);
+
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (listen_fd_ < 0) return false;
+
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_path_.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(socket_path_.c_str());   // stale socket from a previous run
+
+    if (bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == -1 ||
+        listen(listen_fd_, 4) == -1) {
+        close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+    return true;
+}
+
+void MetricsExporter::threadMain() {
+    auto nextWrite = std::chrono::steady_clock::now();
+
+    while (running_) {
+        auto now = std::chrono::steady_clock::now();
+        if (!file_path_.empty() && now >= nextWrite) {
+            writeFile();
+            nextWrite = now + std::chrono::milliseconds(file_period_ms_);
+        }
+
+        // Sleep until a client connects, stop() wakes us or the file is due;
+        // without a wake pipe fall back to a short timer so stop() is noticed
+        int timeoutMs = -1;
+        if (!file_path_.empty()) {
+            timeoutMs = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                nextWrite - now).count());
+        }
+        if (wake_pipe_[0] < 0 && (timeoutMs < 0 || timeoutMs > MetricsExport::POLL_INTERVAL_MS)) {
+            timeoutMs = MetricsExport::POLL_INTERVAL_MS;
+        }
+
+        struct pollfd pfds[2] = {{wake_pipe_[0], POLLIN, 0}, {listen_fd_, POLLIN, 0}};
+        int ready = poll(pfds, 2, timeoutMs);
+        if (ready > 0 && (pfds[1].revents & POLLIN)) {
+            serveClient();
+        }
+    }
+
+    if (!file_path_.empty()) writeFile();
+}
+
+void MetricsExporter::writeFile() {
+    const std::string tmp = file_path_ + ".tmp";
+    {
+        std::ofstream file(tmp, std::ios::trunc);
+        if (!file.is_open()) return;
+        file << metrics_.renderPrometheus();
+    }
+    rename(tmp.c_str(), file_path_.c_str());
+}
+
+void MetricsExporter::serveClient() {
+    for (;;) {
+        int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) return;   // EAGAIN: drained all pending clients
+
+        // Bounded send so a stuck reader can't wedge the exporter thread
+        struct timeval tv = {1, 0};
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+        const std::string body = metrics_.renderPrometheus();
+        size_t off = 0;
+        while (off < body.size()) {
+            ssize_t n = send(fd, body.data() + off, body.size() - off, MSG_NOSIGNAL);
+            if (n > 0) off += static_cast<size_t>(n);
+            else if (n == -1 && errno == EINTR) continue;
+            else break;
+        }
+        close(fd);
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+class Metrics;
+
+// Publishes a Metrics registry from a background thread, so scraping never
+// touches the render loop:
+//  - a Prometheus text file rewritten atomically every filePeriodMs
+//  - a Unix domain socket that answers each connection with a fresh snapshot
+class MetricsExporter {
+public:
+    MetricsExporter(Metrics& metrics, const std::string& filePath,
+                    const std::string& socketPath, int filePeriodMs);
+    ~MetricsExporter();
+
+    // Delete copy operations
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    bool start();
+    void stop();
+
+private:
+    bool openSocket();
+    void threadMain();
+    void writeFile();
+    void serveClient();
+
+    Metrics& metrics_;
+    const std::string file_path_;
+    const std::string socket_path_;
+    const int file_period_ms_;
+
+    int listen_fd_ = -1;
+    int wake_pipe_[2] = {-1, -1};   // stop() writes here so the thread never polls on a timer
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+};
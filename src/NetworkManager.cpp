@@ -1,13 +1,37 @@
 #include "NetworkManager.h"
+#include "Constants.h"
+#include "Metrics.h"
 #include <arpa/inet.h>
 #include <ifaddrs.h>
 #include <net/if.h>
+#include <linux/if_link.h>
+#include <linux/inet_diag.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/sock_diag.h>
+#include <netinet/tcp.h>
+#include <netpacket/packet.h>
 #include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
 #include <algorithm>
+#include <cerrno>
 #include <cstring>
 #include <fstream>
 #include <sstream>
 
+NetworkManager::NetworkManager() {
+}
+
+NetworkManager::NetworkManager(std::unique_ptr<WifiPowerSave> backend)
+    : power_save_(std::move(backend)), fixed_backend_(true) {
+}
+
+NetworkManager::~NetworkManager() {
+    // Never leave the radio awake after we exit
+    restorePowerSave(0);
+}
+
 std::vector<std::string> NetworkManager::getIPv4Addresses() const {
     std::vector<std::string> addrs;
     struct ifaddrs* ifaddr = nullptr;
@@ -17,6 +41,7 @@ std::vector<std::string> NetworkManager::getIPv4Addresses() const {
     }
 
     collectIPv4Addresses(ifaddr, addrs);
+    recordInterfaceStats(ifaddr);
     freeifaddrs(ifaddr);
     
     sortIPAddressesByPriority(addrs);
@@ -102,3 +127,299 @@ void NetworkManager::sortIPAddressesByPriority(std::vector<std::string>& addrs)
                   return getInterfacePriority(a) < getInterfacePriority(b);
               });
 }
+
+void NetworkManager::recordInterfaceStats(struct ifaddrs* ifaddr) const {
+    // getifaddrs() already returns per-link counters on the AF_PACKET entries
+    Metrics& metrics = Metrics::global();
+    for (struct ifaddrs* ifa = ifaddr; ifa != nullptr; ifa = ifa->ifa_next) {
+        if (!ifa->ifa_addr || ifa->ifa_addr->sa_family != AF_PACKET || !ifa->ifa_data) continue;
+        if (ifa->ifa_flags & IFF_LOOPBACK) continue;
+
+        const auto* stats = static_cast<const struct rtnl_link_stats*>(ifa->ifa_data);
+        const std::string labels = std::string("interface=\"") + ifa->ifa_name + "\"";
+        metrics.gauge("dropbear_app_interface_rx_bytes",
+                      "Bytes received per interface (kernel counter)", labels)
+            .set(stats->rx_bytes);
+        metrics.gauge("dropbear_app_interface_tx_bytes",
+                      "Bytes transmitted per interface (kernel counter)", labels)
+            .set(stats->tx_bytes);
+    }
+}
+
+std::string NetworkManager::configurePowerSave(const PowerSaveSettings& settings, uint64_t nowMs) {
+    const bool backendChanged = !fixed_backend_ && (!power_save_ || settings.command != settings_.command);
+    std::string line;
+    if (!switched_off_.empty() &&
+        (!settings.manage || backendChanged || settings.interface != settings_.interface)) {
+        line = restorePowerSave(nowMs);
+    }
+    if (backendChanged) {
+        switches_running_ = 0;   // the old backend finishes them as it is destroyed
+        power_save_ = settings.command.empty() ? WifiPowerSave::nl80211()
+                                               : WifiPowerSave::command(settings.command);
+    }
+    settings_ = settings;
+    if (switched_off_.empty()) sessions_active_ = false;   // re-evaluated on the next update
+    return line;
+}
+
+std::string NetworkManager::updateSessions(int64_t active, uint64_t nowMs) {
+    std::string line = collectPowerSave(nowMs);
+    const std::string switched = switchForSessions(active, nowMs);
+    if (!switched.empty()) line += (line.empty() ? "" : "; ") + switched;
+    return line;
+}
+
+std::string NetworkManager::switchForSessions(int64_t active, uint64_t nowMs) {
+    if (!settings_.manage) return "";
+
+    if (active > 0) {
+        idle_pending_ = false;
+        if (sessions_active_) return "";
+        sessions_active_ = true;
+        // Connections made so far have only seen power save on
+        sampleRtt(nowMs);
+        return disablePowerSave(active, nowMs);
+    }
+
+    if (!sessions_active_) return "";
+    if (!idle_pending_) {
+        idle_pending_ = true;
+        idle_since_ms_ = nowMs;
+    }
+    if (nowMs - idle_since_ms_ < settings_.restore_delay_ms) return "";
+    idle_pending_ = false;
+    sessions_active_ = false;
+    return restorePowerSave(nowMs);
+}
+
+std::vector<std::string> NetworkManager::powerSaveInterfaces() {
+    if (!settings_.interface.empty()) return {settings_.interface};
+    return power_save_->interfaces();
+}
+
+std::string NetworkManager::disablePowerSave(int64_t active, uint64_t nowMs) {
+    std::string switched, failures;
+    for (const auto& iface : powerSaveInterfaces()) {
+        bool enabled = true;   // unreadable (command backend): assume the usual default
+        std::string error;
+        power_save_->get(iface, enabled, error);
+        if (!enabled) continue;
+        if (!power_save_->set(iface, false, error)) {
+            failures += (failures.empty() ? "" : "; ") + iface + ": " + error;
+            continue;
+        }
+        switched_off_.push_back(iface);
+        last_switch_ms_ = nowMs;
+        if (power_save_->async()) {
+            ++switches_running_;   // logged by collectPowerSave()
+            continue;
+        }
+        publishPowerSave(iface, false);
+        switched += (switched.empty() ? "" : ", ") + iface;
+    }
+
+    std::string line;
+    if (!switched.empty()) {
+        line = "WiFi power save off on " + switched + " (" + std::to_string(active) +
+               (active == 1 ? " session)" : " sessions)");
+    }
+    if (!failures.empty()) {
+        line += (line.empty() ? "" : "; ") + std::string("Cannot disable WiFi power save (") +
+                power_save_->name() + "): " + failures;
+    }
+    return line;
+}
+
+std::string NetworkManager::restorePowerSave(uint64_t nowMs) {
+    if (switched_off_.empty()) return "";
+    std::string restored, failures;
+    for (const auto& iface : switched_off_) {
+        std::string error;
+        if (power_save_->set(iface, true, error)) {
+            if (power_save_->async()) {
+                ++switches_running_;
+                continue;
+            }
+            publishPowerSave(iface, true);
+            restored += (restored.empty() ? "" : ", ") + iface;
+        } else {
+            failures += (failures.empty() ? "" : "; ") + iface + ": " + error;
+        }
+    }
+    switched_off_.clear();
+    last_switch_ms_ = nowMs;
+
+    std::string line;
+    if (!restored.empty()) line = "WiFi power save restored on " + restored;
+    if (!failures.empty()) {
+        line += (line.empty() ? "" : "; ") + std::string("Cannot restore WiFi power save: ") + failures;
+    }
+    return line;
+}
+
+std::string NetworkManager::collectPowerSave(uint64_t nowMs) {
+    if (switches_running_ == 0) return "";
+    std::string line;
+    WifiPowerSave::Completion done;
+    while (power_save_->poll(done)) {
+        --switches_running_;
+        std::string part;
+        if (done.ok) {
+            publishPowerSave(done.iface, done.enabled);
+            last_switch_ms_ = nowMs;
+            part = std::string("WiFi power save ") + (done.enabled ? "restored on " : "off on ") + done.iface;
+        } else {
+            // A failed switch off leaves nothing to restore
+            if (!done.enabled) {
+                switched_off_.erase(std::remove(switched_off_.begin(), switched_off_.end(), done.iface),
+                                    switched_off_.end());
+            }
+            part = std::string("Cannot ") + (done.enabled ? "restore" : "disable") + " WiFi power save (" +
+                   power_save_->name() + "): " + done.iface + ": " + done.error;
+        }
+        line += (line.empty() ? "" : "; ") + part;
+    }
+    return line;
+}
+
+int NetworkManager::currentPowerSaveState() {
+    if (!switched_off_.empty()) return 0;
+    if (!power_save_) return -1;
+    const std::vector<std::string> ifaces = powerSaveInterfaces();
+    if (ifaces.empty()) return -1;
+    // Unreadable (command backend): the default, as disablePowerSave() assumes
+    bool enabled = true;
+    std::string error;
+    power_save_->get(ifaces.front(), enabled, error);
+    return enabled ? 1 : 0;
+}
+
+void NetworkManager::sampleRtt(uint64_t nowMs) {
+    if (!power_save_ || nowMs < last_switch_ms_ + Network::RTT_SETTLE_MS) return;
+    std::vector<uint32_t> rtts;
+    std::string error;
+    if (!tcpRtts(settings_.ssh_port, false, rtts, error) || rtts.empty()) return;
+
+    const int state = currentPowerSaveState();
+    if (state < 0) return;
+    LatencyHistogram& histogram = state ? rtt_ps_on_ : rtt_ps_off_;
+    for (uint32_t us : rtts) histogram.record(us);
+    publishRtt();
+}
+
+std::vector<std::string> NetworkManager::powerSaveStatusLines() const {
+    std::vector<std::string> lines;
+    if (settings_.manage) {
+        lines.push_back(switched_off_.empty()
+                            ? std::string("WiFi power save: managed (") + power_save_->name() + ")"
+                            : std::string("WiFi power save: off while sessions are connected"));
+    }
+    if (rtt_ps_on_.count() > 0 || rtt_ps_off_.count() > 0) {
+        auto summary = [](const LatencyHistogram& h) {
+            if (h.count() == 0) return std::string("-");
+            return "p50 " + LatencyHistogram::formatMicros(h.percentile(0.50)) +
+                   " (" + std::to_string(h.count()) + ")";
+        };
+        lines.push_back("WiFi RTT: power save on " + summary(rtt_ps_on_) + ", off " + summary(rtt_ps_off_));
+    }
+    return lines;
+}
+
+void NetworkManager::publishPowerSave(const std::string& iface, bool enabled) {
+    Metrics::global().gauge("dropbear_app_wifi_power_save",
+                            "1 while WLAN power save is on, as last set by the app",
+                            "interface=\"" + iface + "\"").set(enabled ? 1 : 0);
+}
+
+void NetworkManager::publishRtt() {
+    Metrics& metrics = Metrics::global();
+    const struct { const char* label; const LatencyHistogram& h; } sets[] = {
+        {"power_save=\"on\"", rtt_ps_on_}, {"power_save=\"off\"", rtt_ps_off_}};
+    for (const auto& s : sets) {
+        if (s.h.count() == 0) continue;
+        metrics.gauge("dropbear_app_ssh_rtt_p50_microseconds",
+                      "Median smoothed RTT of SSH connections by WLAN power save state", s.label)
+            .set(static_cast<int64_t>(s.h.percentile(0.50)));
+        metrics.gauge("dropbear_app_ssh_rtt_p99_microseconds",
+                      "99th percentile smoothed RTT of SSH connections by WLAN power save state", s.label)
+            .set(static_cast<int64_t>(s.h.percentile(0.99)));
+    }
+}
+
+bool NetworkManager::tcpRtts(int port, bool includeLoopback, std::vector<uint32_t>& rttUs, std::string& error) {
+    // The same sock_diag dump `ss -ti` uses: tcp_info for every socket, filtered here
+    const int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+    if (fd < 0) {
+        error = std::string("sock_diag socket: ") + strerror(errno);
+        return false;
+    }
+
+    bool ok = true;
+    for (const int family : {AF_INET, AF_INET6}) {
+        struct {
+            nlmsghdr nlh;
+            inet_diag_req_v2 req;
+        } msg{};
+        msg.nlh.nlmsg_len = sizeof(msg);
+        msg.nlh.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+        msg.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+        msg.req.sdiag_family = static_cast<uint8_t>(family);
+        msg.req.sdiag_protocol = IPPROTO_TCP;
+        msg.req.idiag_states = 1u << TCP_ESTABLISHED;
+        msg.req.idiag_ext = 1u << (INET_DIAG_INFO - 1);
+        if (send(fd, &msg, sizeof(msg), 0) < 0) {
+            error = std::string("sock_diag send: ") + strerror(errno);
+            ok = false;
+            break;
+        }
+
+        bool done = false;
+        char buf[16384];
+        while (!done) {
+            const ssize_t n = recv(fd, buf, sizeof(buf), 0);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                error = std::string("sock_diag recv: ") + strerror(errno);
+                ok = false;
+                break;
+            }
+            int len = static_cast<int>(n);
+            for (nlmsghdr* nlh = reinterpret_cast<nlmsghdr*>(buf); NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len)) {
+                if (nlh->nlmsg_type == NLMSG_DONE) { done = true; break; }
+                if (nlh->nlmsg_type == NLMSG_ERROR) {
+                    // No IPv6 in this kernel is not a failure
+                    const nlmsgerr* err = static_cast<const nlmsgerr*>(NLMSG_DATA(nlh));
+                    if (family == AF_INET) {
+                        error = std::string("sock_diag dump: ") + strerror(-err->error);
+                        ok = false;
+                    }
+                    done = true;
+                    break;
+                }
+                const inet_diag_msg* diag = static_cast<const inet_diag_msg*>(NLMSG_DATA(nlh));
+                if (ntohs(diag->id.idiag_sport) != port) continue;
+                if (!includeLoopback) {
+                    const uint8_t* dst = reinterpret_cast<const uint8_t*>(diag->id.idiag_dst);
+                    const bool v4Loop = family == AF_INET && dst[0] == 127;
+                    static const uint8_t v6Loop[16] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1};
+                    const bool mappedLoop = family == AF_INET6 && memcmp(dst, v6Loop, 10) == 0 &&
+                                            dst[10] == 0xff && dst[11] == 0xff && dst[12] == 127;
+                    if (v4Loop || mappedLoop || (family == AF_INET6 && memcmp(dst, v6Loop, 16) == 0)) continue;
+                }
+
+                int attrLen = static_cast<int>(nlh->nlmsg_len - NLMSG_LENGTH(sizeof(*diag)));
+                for (const rtattr* attr = reinterpret_cast<const rtattr*>(diag + 1); RTA_OK(attr, attrLen);
+                     attr = RTA_NEXT(attr, attrLen)) {
+                    if (attr->rta_type != INET_DIAG_INFO) continue;
+                    struct tcp_info info{};
+                    memcpy(&info, RTA_DATA(attr), std::min<size_t>(RTA_PAYLOAD(attr), sizeof(info)));
+                    if (info.tcpi_rtt > 0) rttUs.push_back(info.tcpi_rtt);
+                }
+            }
+        }
+        if (!ok) break;
+    }
+    close(fd);
+    return ok;
+}
@@ -1,5 +1,9 @@
 #pragma once
 
+#include "LatencyHistogram.h"
+#include "WifiPowerSave.h"
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -7,12 +11,74 @@ struct ifaddrs;
 
 class NetworkManager {
 public:
+    // WLAN power save while SSH sessions are connected. Power save adds tens to
+    // hundreds of ms per packet, so it is switched off on the first session and
+    // restored restore_delay_ms after the last one, only on interfaces that had
+    // it on.
+    struct PowerSaveSettings {
+        bool manage = false;
+        std::string interface;            // empty = every wireless interface
+        std::string command;              // empty = nl80211, else a WifiPowerSave::command() template
+        int ssh_port = 22;                // whose connections' RTT is sampled
+        uint32_t restore_delay_ms = 0;
+    };
+
+    NetworkManager();   // backend created by configurePowerSave()
+    // Fixed backend, kept across configurePowerSave() calls (tests)
+    explicit NetworkManager(std::unique_ptr<WifiPowerSave> backend);
+    ~NetworkManager();   // restores power save
+
+    NetworkManager(const NetworkManager&) = delete;
+    NetworkManager& operator=(const NetworkManager&) = delete;
+
     std::vector<std::string> getIPv4Addresses() const;
     std::vector<std::string> getSystemUsers() const;
 
+    // Each returns a line for the log, or "" when nothing happened
+    std::string configurePowerSave(const PowerSaveSettings& settings, uint64_t nowMs);
+    // Call whenever the session count may have changed (cheap when it hasn't),
+    // and every Network::POWER_SAVE_POLL_MS while powerSaveSwitching(): it
+    // also reports switches a command backend has finished since
+    std::string updateSessions(int64_t active, uint64_t nowMs);
+    bool powerSaveSwitching() const { return switches_running_ > 0; }
+
+    // Adds the kernel's smoothed RTT of every non-loopback connection on the
+    // SSH port to the histogram of the current power save state. Samples taken
+    // within Network::RTT_SETTLE_MS of a switch still carry the old state and
+    // are skipped.
+    void sampleRtt(uint64_t nowMs);
+    const LatencyHistogram& rttPowerSaveOn() const { return rtt_ps_on_; }
+    const LatencyHistogram& rttPowerSaveOff() const { return rtt_ps_off_; }
+    std::vector<std::string> powerSaveStatusLines() const;
+
+    // tcpi_rtt of established TCP connections whose local port is port
+    static bool tcpRtts(int port, bool includeLoopback, std::vector<uint32_t>& rttUs, std::string& error);
+
 private:
+    std::vector<std::string> powerSaveInterfaces();
+    std::string switchForSessions(int64_t active, uint64_t nowMs);
+    std::string disablePowerSave(int64_t active, uint64_t nowMs);
+    std::string restorePowerSave(uint64_t nowMs);
+    std::string collectPowerSave(uint64_t nowMs);   // finished async switches
+    int currentPowerSaveState();          // 1 on, 0 off, -1 no interface
+    void publishPowerSave(const std::string& iface, bool enabled);
+    void publishRtt();
+
     void collectIPv4Addresses(struct ifaddrs* ifaddr, std::vector<std::string>& addrs) const;
     bool isValidNetworkInterface(const struct ifaddrs* ifa) const;
     std::string formatIPv4Address(const struct ifaddrs* ifa) const;
     void sortIPAddressesByPriority(std::vector<std::string>& addrs) const;
+    void recordInterfaceStats(struct ifaddrs* ifaddr) const;
+
+    std::unique_ptr<WifiPowerSave> power_save_;
+    bool fixed_backend_ = false;
+    PowerSaveSettings settings_;
+    std::vector<std::string> switched_off_;  // interfaces we turned power save off on
+    int switches_running_ = 0;               // async set()s not yet polled to completion
+    bool sessions_active_ = false;
+    bool idle_pending_ = false;              // last session gone, restore timer running
+    uint64_t idle_since_ms_ = 0;
+    uint64_t last_switch_ms_ = 0;
+    LatencyHistogram rtt_ps_on_;
+    LatencyHistogram rtt_ps_off_;
 };
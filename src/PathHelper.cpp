@@ -1,12 +1,29 @@
 #include "PathHelper.h"
+#include <sys/stat.h>
 #include <unistd.h>
 #include <limits.h>
+#include <cerrno>
+#include <cstring>
 
 #ifdef USE_SDL
 #include <SDL2/SDL.h>
 #endif
 
+namespace {
+
+std::string& baseDirOverride() {
+    static std::string dir;
+    return dir;
+}
+
+} // namespace
+
+void PathHelper::setBaseDir(const std::string& dir) {
+    baseDirOverride() = dir;
+}
+
 std::string PathHelper::appBaseDir() {
+    if (!baseDirOverride().empty()) return baseDirOverride();
 #ifdef USE_SDL
     char* base = SDL_GetBasePath();
     if (base) {
@@ -38,6 +55,68 @@ std::string PathHelper::bundledDropbearKeygenPath() {
     return appBaseDir() + "dropbearkey";
 }
 
+std::string PathHelper::bundledSftpServerPath() {
+    return appBaseDir() + "sftp-server";
+}
+
+std::string PathHelper::bundledDeltaSyncPath() {
+    return appBaseDir() + "delta-sync";
+}
+
+std::string PathHelper::bundledCipherBenchPath() {
+    return appBaseDir() + "cipher-bench";
+}
+
 std::string PathHelper::hostKeyPath() {
     return appBaseDir() + "dropbear_rsa_host_key";
 }
+
+std::string PathHelper::dropbearConfigPath() {
+    return appBaseDir() + "dropbear.conf";
+}
+
+std::string PathHelper::startupTracePath() {
+    return appBaseDir() + "startup_trace.json";
+}
+
+std::string PathHelper::metricsFilePath() {
+    return appBaseDir() + "metrics.prom";
+}
+
+std::string PathHelper::daemonLogPath() {
+    return appBaseDir() + "dropbear-app.log";
+}
+
+std::string PathHelper::profilePath() {
+    return appBaseDir() + "profile.folded";
+}
+
+std::string PathHelper::cipherBenchPath() {
+    const std::string key = hostKeyPath();
+    return key.substr(0, key.rfind('/') + 1) + "cipher_bench.txt";
+}
+
+bool PathHelper::ensurePrivateDir(const std::string& dir, std::string& error) {
+    if (mkdir(dir.c_str(), 0755) == -1 && errno != EEXIST) {
+        error = "mkdir " + dir + " failed: " + strerror(errno);
+        return false;
+    }
+    struct stat st{};
+    if (lstat(dir.c_str(), &st) == -1) {
+        error = "lstat " + dir + " failed: " + strerror(errno);
+        return false;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        error = dir + " is not a directory";
+        return false;
+    }
+    if (st.st_uid != geteuid()) {
+        error = dir + " is owned by uid " + std::to_string(st.st_uid) + ", not us";
+        return false;
+    }
+    if (st.st_mode & (S_IWGRP | S_IWOTH)) {
+        error = dir + " is writable by others";
+        return false;
+    }
+    return true;
+}
@@ -6,8 +6,26 @@ class PathHelper {
 public:
     // Resolve base directory where our executable + dropbear binaries live
     static std::string appBaseDir();
+    // Replaces appBaseDir() ("" restores it); tests point the app at a
+    // directory of stub binaries. Ends with '/'.
+    static void setBaseDir(const std::string& dir);
     
     static std::string bundledDropbearPath();
     static std::string bundledDropbearKeygenPath();
+    static std::string bundledSftpServerPath();
+    static std::string bundledDeltaSyncPath();
+    static std::string bundledCipherBenchPath();
     static std::string hostKeyPath();
+    static std::string dropbearConfigPath();
+    static std::string startupTracePath();
+    static std::string metricsFilePath();
+    static std::string daemonLogPath();
+    static std::string profilePath();
+    // Benchmark cache, kept in the host key's directory
+    static std::string cipherBenchPath();
+
+    // Creates dir (0755) if missing and checks it is a real directory owned
+    // by us that nobody else can write to. Links dropbear runs as root live
+    // under /tmp, where anyone could have created the directory first.
+    static bool ensurePrivateDir(const std::string& dir, std::string& error);
 };
@@ -1,21 +1,71 @@
 #include "Renderer.h"
 #include "Constants.h"
+#include "StartupTrace.h"
 #include <algorithm>
+#include <cstdio>
+
+#ifdef USE_BAKED_FONT
+#include "BakedFontData.h"
+static_assert(BakedFont::kPixelSize == LogDisplay::FONT_SIZE,
+              "BakedFontData.h is stale: it is regenerated by make");
+#endif
 
 Renderer::Renderer(SDL_Renderer* renderer, TTF_Font* font)
     : renderer_(renderer), font_(font) {
+#ifdef USE_BAKED_FONT
+    StartupTrace::Scope trace("glyph atlas upload");
+    createGlyphAtlas();
+#endif
+}
+
+Renderer::~Renderer() {
+    if (glyph_atlas_) SDL_DestroyTexture(glyph_atlas_);
+}
+
+bool Renderer::createGlyphAtlas() {
+#ifdef USE_BAKED_FONT
+    // White glyphs on transparent; colour comes from SDL_SetTextureColorMod
+    const BitmapFont::Face& face = BakedFont::kFace;
+    std::vector<uint32_t> pixels(static_cast<size_t>(face.atlas_width) * face.height);
+    for (int y = 0; y < face.height; ++y) {
+        for (int x = 0; x < face.atlas_width; ++x) {
+            pixels[static_cast<size_t>(y) * face.atlas_width + x] =
+                BitmapFont::pixel(face, x, y) ? 0xFFFFFFFFu : 0x00FFFFFFu;
+        }
+    }
+
+    glyph_atlas_ = SDL_CreateTexture(renderer_, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC,
+                                     face.atlas_width, face.height);
+    if (!glyph_atlas_) return false;
+    if (SDL_UpdateTexture(glyph_atlas_, nullptr, pixels.data(), face.atlas_width * 4) != 0) {
+        SDL_DestroyTexture(glyph_atlas_);
+        glyph_atlas_ = nullptr;
+        return false;
+    }
+    SDL_SetTextureBlendMode(glyph_atlas_, SDL_BLENDMODE_BLEND);
+    return true;
+#else
+    return false;
+#endif
 }
 
 void Renderer::render(const std::vector<std::string>& ipAddrs,
                       const std::vector<std::string>& users,
-                      const std::vector<std::string>& logLines) {
+                      const std::vector<std::string>& statusLines,
+                      const std::vector<std::string>& logLines,
+                      SshProbe::Health health,
+                      size_t logScrollback,
+                      const AllocStats::Totals* frameAllocs) {
     clearScreen();
     
     int y = 30;
+    if (frameAllocs) renderAllocOverlay(*frameAllocs);
+    renderHealth(y, health);
     y = renderTitle(y);
     y = renderIPAddresses(y, ipAddrs);
     y = renderUsers(y, users);
-    y = renderLogs(y, logLines);
+    y = renderStatus(y, statusLines);
+    y = renderLogs(y, logLines, logScrollback);
     renderFooter();
 
     SDL_RenderPresent(renderer_);
@@ -28,19 +78,31 @@ void Renderer::clearScreen() {
 }
 
 int Renderer::renderTitle(int y) const {
-    renderText(renderer_, font_, "Dropbear SSH Server", 
+    renderText("Dropbear SSH Server", 
                Display::WIDTH / 2, y, Color::White(), true);
     return y + 40;
 }
 
+void Renderer::renderHealth(int y, SshProbe::Health health) const {
+    Color color = Color::Gray();
+    switch (health) {
+        case SshProbe::Health::Healthy:  color = Color::LightGreen(); break;
+        case SshProbe::Health::Degraded: color = Color::Yellow(); break;
+        case SshProbe::Health::Down:     color = Color::LightRed(); break;
+        default: break;
+    }
+    renderText("SSH: ", SshProbe::healthName(health),
+               Display::WIDTH - 220, y, color, false);
+}
+
 int Renderer::renderIPAddresses(int y, const std::vector<std::string>& ipAddrs) const {
     if (ipAddrs.empty()) {
-        renderText(renderer_, font_, "IP: (resolving...)", 
+        renderText("IP: (resolving...)", 
                   50, y, Color::Gray(), false);
         y += 24;
     } else {
         for (const auto& ip : ipAddrs) {
-            renderText(renderer_, font_, "IP: " + ip, 
+            renderText("IP: ", ip.c_str(),
                       50, y, Color::LightGreen(), false);
             y += 24;
         }
@@ -50,11 +112,25 @@ int Renderer::renderIPAddresses(int y, const std::vector<std::string>& ipAddrs)
 
 int Renderer::renderUsers(int y, const std::vector<std::string>& users) const {
     if (!users.empty()) {
-        renderText(renderer_, font_, "System Users:", 50, y, Color::LightBlue(), false);
+        renderText("System Users:", 50, y, Color::LightBlue(), false);
         y += 24;
         
         for (const auto& user : users) {
-            renderText(renderer_, font_, "  " + user, 50, y, Color::Yellow(), false);
+            renderText("  ", user.c_str(), 50, y, Color::Yellow(), false);
+            y += 20;
+        }
+        y += 8;
+    }
+    return y;
+}
+
+int Renderer::renderStatus(int y, const std::vector<std::string>& statusLines) const {
+    if (!statusLines.empty()) {
+        renderText("Server:", 50, y, Color::LightBlue(), false);
+        y += 24;
+
+        for (const auto& line : statusLines) {
+            renderText("  ", line.c_str(), 50, y, Color::Gray(), false);
             y += 20;
         }
         y += 8;
@@ -62,15 +138,22 @@ int Renderer::renderUsers(int y, const std::vector<std::string>& users) const {
     return y;
 }
 
-int Renderer::renderLogs(int y, const std::vector<std::string>& logLines) const {
-    renderText(renderer_, font_, "Logs:", 50, y, Color::LightBlue(), false);
+int Renderer::renderLogs(int y, const std::vector<std::string>& logLines,
+                         size_t scrollback) const {
+    if (scrollback == 0) {
+        renderText("Logs:", 50, y, Color::LightBlue(), false);
+    } else {
+        char header[96];
+        snprintf(header, sizeof(header), "Logs: %zu lines back (RIGHT for live)", scrollback);
+        renderText(header, 50, y, Color::Yellow(), false);
+    }
     y += 28;
 
     const int max_visible = (Display::HEIGHT - y - 50) / LogDisplay::LINE_HEIGHT;
     const int start_idx = std::max(0, static_cast<int>(logLines.size()) - max_visible);
 
     for (int i = start_idx; i < static_cast<int>(logLines.size()); ++i) {
-        renderText(renderer_, font_, logLines[i], 50, y, Color::White(), false);
+        renderText(logLines[i].c_str(), 50, y, Color::White(), false);
         y += LogDisplay::LINE_HEIGHT;
     }
     
@@ -78,20 +161,61 @@ int Renderer::renderLogs(int y, const std::vector<std::string>& logLines) const
 }
 
 void Renderer::renderFooter() const {
-    renderText(renderer_, font_, "Press START + SELECT to exit",
+    renderText("Y: restart server  D-pad/L1/R1: scroll logs  SELECT + X: profile  START + SELECT: exit",
                Display::WIDTH / 2, Display::HEIGHT - 40,
                Color::Gray(), true);
 }
 
-void Renderer::renderText(SDL_Renderer* renderer, TTF_Font* font,
-                          const std::string& text, int x, int y,
-                          const Color& color, bool centered) {
-    if (!font) return;
+void Renderer::renderAllocOverlay(const AllocStats::Totals& allocs) const {
+    // Formatted into a stack buffer so the overlay doesn't count itself
+    const AllocStats::Counts total = allocs.total();
+    char buf[160];
+    int n = snprintf(buf, sizeof(buf), "alloc/frame %llu (%llu B):",
+                     static_cast<unsigned long long>(total.allocs),
+                     static_cast<unsigned long long>(total.bytes));
+    for (int i = 0; i < AllocStats::SUBSYSTEM_COUNT && n > 0 && n < static_cast<int>(sizeof(buf)); ++i) {
+        n += snprintf(buf + n, sizeof(buf) - n, " %s %llu",
+                      AllocStats::name(static_cast<AllocStats::Subsystem>(i)),
+                      static_cast<unsigned long long>(allocs.by[i].allocs));
+    }
+    renderText(buf, 10, 4, total.allocs ? Color::Yellow() : Color::Gray(), false);
+}
+
+void Renderer::renderText(const char* text, int x, int y,
+                          const Color& color, bool centered) const {
+    renderText("", text, x, y, color, centered);
+}
+
+// prefix + text without building a temporary string
+void Renderer::renderText(const char* prefix, const char* text, int x, int y,
+                          const Color& color, bool centered) const {
+#ifdef USE_BAKED_FONT
+    // One rect copy per glyph from the atlas; no per-string surface/texture
+    if (!glyph_atlas_) return;
+    const BitmapFont::Face& face = BakedFont::kFace;
+    if (centered) x -= (BitmapFont::textWidth(face, prefix) + BitmapFont::textWidth(face, text)) / 2;
+
+    SDL_SetTextureColorMod(glyph_atlas_, color.r, color.g, color.b);
+    for (const char* part : {prefix, text}) {
+        for (const char* p = part; *p && x < Display::WIDTH; ++p) {
+            const BitmapFont::Glyph& g = BitmapFont::glyph(face, *p);
+            if (g.width > 0) {
+                SDL_Rect src = {g.atlas_x, 0, g.width, face.height};
+                SDL_Rect dst = {x + g.bearing_x, y, g.width, face.height};
+                SDL_RenderCopy(renderer_, glyph_atlas_, &src, &dst);
+            }
+            x += g.advance;
+        }
+    }
+#else
+    if (!font_) return;
 
-    SDL_Surface* surface = TTF_RenderText_Solid(font, text.c_str(), color.toSDLColor());
+    // Reused buffer: after the first frames concatenation stops allocating
+    scratch_.assign(prefix).append(text);
+    SDL_Surface* surface = TTF_RenderText_Solid(font_, scratch_.c_str(), color.toSDLColor());
     if (!surface) return;
 
-    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer_, surface);
     if (!texture) {
         SDL_FreeSurface(surface);
         return;
@@ -100,7 +224,8 @@ void Renderer::renderText(SDL_Renderer* renderer, TTF_Font* font,
     SDL_Rect destRect = {x, y, surface->w, surface->h};
     if (centered) destRect.x = x - surface->w / 2;
 
-    SDL_RenderCopy(renderer, texture, nullptr, &destRect);
+    SDL_RenderCopy(renderer_, texture, nullptr, &destRect);
     SDL_DestroyTexture(texture);
     SDL_FreeSurface(surface);
+#endif
 }
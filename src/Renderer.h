@@ -1,6 +1,8 @@
 #pragma once
 
+#include "AllocStats.h"
 #include "Color.h"
+#include "SshProbe.h"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
 #include <string>
@@ -8,24 +10,42 @@
 
 class Renderer {
 public:
+    // font is only used by BAKED_FONT=0 builds; baked builds pass nullptr and
+    // draw from a glyph atlas texture built from the compiled-in font
     Renderer(SDL_Renderer* renderer, TTF_Font* font);
+    ~Renderer();
+
+    // Delete copy operations
+    Renderer(const Renderer&) = delete;
+    Renderer& operator=(const Renderer&) = delete;
     
     void render(const std::vector<std::string>& ipAddrs,
                 const std::vector<std::string>& users,
-                const std::vector<std::string>& logLines);
+                const std::vector<std::string>& statusLines,
+                const std::vector<std::string>& logLines,
+                SshProbe::Health health,
+                size_t logScrollback = 0,
+                const AllocStats::Totals* frameAllocs = nullptr);
 
 private:
     void clearScreen();
     int renderTitle(int y) const;
+    void renderHealth(int y, SshProbe::Health health) const;
     int renderIPAddresses(int y, const std::vector<std::string>& ipAddrs) const;
     int renderUsers(int y, const std::vector<std::string>& users) const;
-    int renderLogs(int y, const std::vector<std::string>& logLines) const;
+    int renderStatus(int y, const std::vector<std::string>& statusLines) const;
+    int renderLogs(int y, const std::vector<std::string>& logLines, size_t scrollback) const;
     void renderFooter() const;
+    void renderAllocOverlay(const AllocStats::Totals& allocs) const;
     
-    static void renderText(SDL_Renderer* renderer, TTF_Font* font,
-                          const std::string& text, int x, int y,
-                          const Color& color, bool centered);
+    void renderText(const char* text, int x, int y,
+                    const Color& color, bool centered) const;
+    void renderText(const char* prefix, const char* text, int x, int y,
+                    const Color& color, bool centered) const;
+    bool createGlyphAtlas();
 
     SDL_Renderer* renderer_;
     TTF_Font* font_;
+    SDL_Texture* glyph_atlas_ = nullptr;
+    mutable std::string scratch_;         // TTF path: prefix + text
 };
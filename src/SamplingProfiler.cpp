@@ -0,0 +1,474 @@
+#include "SamplingProfiler.h"
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <signal.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <cxxabi.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// Largest step between frame records the walk accepts; anything further is
+// taken for a register that isn't a frame pointer
+constexpr uintptr_t MAX_FRAME_BYTES = 256 * 1024;
+
+struct Sample {
+    pid_t tid;
+    int depth;
+    void* frames[Profiler::MAX_DEPTH];   // leaf first
+};
+
+std::vector<Sample> g_buffer;
+Sample* g_samples = nullptr;
+size_t g_capacity = 0;
+std::atomic<size_t> g_next{0};
+std::atomic<uint64_t> g_dropped{0};
+std::atomic<bool> g_armed{false};
+std::atomic<int> g_in_handler{0};
+volatile sig_atomic_t g_toggle_requested = 0;
+
+bool g_running = false;
+std::chrono::steady_clock::time_point g_started;
+uint64_t g_elapsed_us = 0;
+std::unordered_map<pid_t, std::string> g_thread_names;   // captured by stop()
+
+std::thread g_child_thread;
+std::mutex g_child_mutex;
+std::condition_variable g_child_cv;
+bool g_child_stop = false;
+std::map<std::string, uint64_t> g_child_stacks;
+uint64_t g_child_samples = 0;
+
+// The interrupted pc, then the return address of each frame record up the
+// frame-pointer chain (both ABIs store {previous fp, return address} where fp
+// points). Plain loads only: backtrace() and the unwinder behind it are not
+// async-signal-safe, since they take the loader's lock. Each record must sit
+// above the last one within MAX_FRAME_BYTES, which ends the walk at the
+// outermost frame (fp 0) and where code built without frame pointers (libc)
+// left something else in the register; that code's own caller is skipped.
+int walkFrames(void* context, void** out, int max) {
+#if defined(__aarch64__) || defined(__x86_64__)
+    const ucontext_t* uc = static_cast<const ucontext_t*>(context);
+#if defined(__aarch64__)
+    const uintptr_t pc = uc->uc_mcontext.pc;
+    const uintptr_t sp = uc->uc_mcontext.sp;
+    uintptr_t fp = uc->uc_mcontext.regs[29];
+#else
+    const uintptr_t pc = static_cast<uintptr_t>(uc->uc_mcontext.gregs[REG_RIP]);
+    const uintptr_t sp = static_cast<uintptr_t>(uc->uc_mcontext.gregs[REG_RSP]);
+    uintptr_t fp = static_cast<uintptr_t>(uc->uc_mcontext.gregs[REG_RBP]);
+#endif
+    int n = 0;
+    if (max > 0) out[n++] = reinterpret_cast<void*>(pc);
+    uintptr_t floor = sp;
+    while (n < max && fp >= floor && fp - floor < MAX_FRAME_BYTES && fp % sizeof(uintptr_t) == 0) {
+        const uintptr_t* record = reinterpret_cast<const uintptr_t*>(fp);
+        if (record[1] == 0) break;
+        out[n++] = reinterpret_cast<void*>(record[1]);
+        floor = fp + 2 * sizeof(uintptr_t);
+        fp = record[0];
+    }
+    return n;
+#else
+    (void)context;
+    (void)out;
+    (void)max;
+    return 0;
+#endif
+}
+
+void onProfSignal(int, siginfo_t*, void* context) {
+    g_in_handler.fetch_add(1, std::memory_order_acquire);
+    if (g_armed.load(std::memory_order_relaxed)) {
+        const int savedErrno = errno;
+        const size_t slot = g_next.fetch_add(1, std::memory_order_relaxed);
+        if (slot < g_capacity) {
+            Sample& s = g_samples[slot];
+            s.tid = static_cast<pid_t>(syscall(SYS_gettid));
+            s.depth = walkFrames(context, s.frames, Profiler::MAX_DEPTH);
+        } else {
+            g_dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        errno = savedErrno;
+    }
+    g_in_handler.fetch_sub(1, std::memory_order_release);
+}
+
+void onToggleSignal(int) {
+    g_toggle_requested = 1;
+}
+
+bool readSmallFile(const std::string& path, std::string& out) {
+    FILE* f = fopen(path.c_str(), "r");
+    if (!f) return false;
+    char buf[4096];
+    out.clear();
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+    fclose(f);
+    return true;
+}
+
+// "pid (comm) state ppid ..."; comm may contain spaces and parentheses
+bool readStat(pid_t pid, std::string& comm, char& state, pid_t& ppid) {
+    std::string stat;
+    if (!readSmallFile("/proc/" + std::to_string(pid) + "/stat", stat)) return false;
+    const size_t open = stat.find('(');
+    const size_t close = stat.rfind(')');
+    if (open == std::string::npos || close == std::string::npos || close < open) return false;
+    comm = stat.substr(open + 1, close - open - 1);
+    int parent = 0;
+    if (sscanf(stat.c_str() + close + 1, " %c %d", &state, &parent) != 2) return false;
+    ppid = parent;
+    return true;
+}
+
+// Processes named comm, plus everything below them
+std::vector<pid_t> findProcessTree(const std::string& comm) {
+    struct Proc {
+        pid_t pid;
+        pid_t ppid;
+        bool match;
+    };
+    std::vector<Proc> procs;
+    DIR* dir = opendir("/proc");
+    if (!dir) return {};
+    const pid_t self = getpid();
+    while (struct dirent* e = readdir(dir)) {
+        char* end = nullptr;
+        const long pid = strtol(e->d_name, &end, 10);
+        if (pid <= 0 || *end != '\0' || pid == self) continue;
+        std::string name;
+        char state;
+        pid_t ppid;
+        if (readStat(static_cast<pid_t>(pid), name, state, ppid)) {
+            procs.push_back({static_cast<pid_t>(pid), ppid, name == comm});
+        }
+    }
+    closedir(dir);
+
+    std::vector<pid_t> tree;
+    for (const auto& p : procs) {
+        if (p.match) tree.push_back(p.pid);
+    }
+    for (size_t i = 0; i < tree.size(); ++i) {
+        for (const auto& p : procs) {
+            if (p.ppid == tree[i] && std::find(tree.begin(), tree.end(), p.pid) == tree.end()) {
+                tree.push_back(p.pid);
+            }
+        }
+    }
+    return tree;
+}
+
+const char* stateName(char state) {
+    switch (state) {
+        case 'R': return "[running]";
+        case 'S': return "[sleeping]";
+        case 'D': return "[disk wait]";
+        case 'T': case 't': return "[stopped]";
+        case 'Z': return "[zombie]";
+        default: return "[other]";
+    }
+}
+
+// comm;[state];kernel frames outermost first, or "" if the process is gone
+std::string sampleProcess(pid_t pid) {
+    std::string comm;
+    char state;
+    pid_t ppid;
+    if (!readStat(pid, comm, state, ppid)) return "";
+    std::string stack = comm + ";" + stateName(state);
+    if (state == 'R') return stack;
+
+    // "[<0>] do_select+0x2a4/0x5a0" per line, innermost first
+    const std::string base = "/proc/" + std::to_string(pid);
+    std::string text;
+    std::vector<std::string> frames;
+    if (readSmallFile(base + "/stack", text)) {
+        size_t pos = 0;
+        while (pos < text.size()) {
+            size_t eol = text.find('\n', pos);
+            if (eol == std::string::npos) eol = text.size();
+            const std::string line = text.substr(pos, eol - pos);
+            pos = eol + 1;
+            const size_t name = line.find("] ");
+            if (name == std::string::npos) continue;
+            frames.push_back(line.substr(name + 2, line.find('+', name) - name - 2));
+        }
+    }
+    if (frames.empty() && readSmallFile(base + "/wchan", text) && !text.empty() && text != "0") {
+        frames.push_back(text);
+    }
+    for (auto it = frames.rbegin(); it != frames.rend(); ++it) stack += ";" + *it;
+    return stack;
+}
+
+void childLoop(std::string comm, int hz) {
+    pthread_setname_np(pthread_self(), "profiler");
+    const auto period = std::chrono::microseconds(1000000 / hz);
+    const auto rescanEvery = std::chrono::milliseconds(Profiler::CHILD_RESCAN_MS);
+    auto rescanAt = std::chrono::steady_clock::now();
+    std::vector<pid_t> pids;
+
+    std::unique_lock<std::mutex> lock(g_child_mutex);
+    while (!g_child_stop) {
+        const auto now = std::chrono::steady_clock::now();
+        lock.unlock();
+        if (now >= rescanAt) {
+            pids = findProcessTree(comm);
+            rescanAt = now + rescanEvery;
+        }
+        std::vector<std::string> stacks;
+        for (pid_t pid : pids) {
+            std::string stack = sampleProcess(pid);
+            if (!stack.empty()) stacks.push_back(std::move(stack));
+        }
+        lock.lock();
+        for (const auto& stack : stacks) {
+            g_child_stacks[stack]++;
+            g_child_samples++;
+        }
+        g_child_cv.wait_until(lock, now + period, [] { return g_child_stop; });
+    }
+}
+
+// "ns::Class::method(int) const" -> "ns::Class::method"
+std::string stripParameters(const std::string& name) {
+    if (name.empty() || name.find(')') == std::string::npos) return name;
+    size_t close = name.rfind(')');
+    int depth = 0;
+    for (size_t i = close + 1; i-- > 0;) {
+        if (name[i] == ')') depth++;
+        else if (name[i] == '(' && --depth == 0) return name.substr(0, i);
+    }
+    return name;
+}
+
+std::string symbolize(void* addr, bool returnAddress) {
+    // A return address points past the call; step back into the caller
+    const uintptr_t a = reinterpret_cast<uintptr_t>(addr) - (returnAddress ? 1 : 0);
+    Dl_info info;
+    if (dladdr(reinterpret_cast<void*>(a), &info) == 0) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "0x%zx", static_cast<size_t>(a));
+        return buf;
+    }
+    if (info.dli_sname) {
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+        std::string name = (status == 0 && demangled) ? stripParameters(demangled) : info.dli_sname;
+        free(demangled);
+        return name;
+    }
+    // Not exported (static, or no -rdynamic): module+offset, for addr2line
+    const char* module = info.dli_fname ? strrchr(info.dli_fname, '/') : nullptr;
+    module = module ? module + 1 : (info.dli_fname ? info.dli_fname : "?");
+    char buf[64];
+    snprintf(buf, sizeof(buf), "+0x%zx",
+             static_cast<size_t>(a - reinterpret_cast<uintptr_t>(info.dli_fbase)));
+    return module + std::string(buf);
+}
+
+std::string threadName(pid_t tid) {
+    std::string name;
+    if (readSmallFile("/proc/self/task/" + std::to_string(tid) + "/comm", name)) {
+        while (!name.empty() && name.back() == '\n') name.pop_back();
+    }
+    if (name.empty()) name = "thread-" + std::to_string(tid);
+    return name;
+}
+
+} // namespace
+
+bool SamplingProfiler::start(const Settings& settings, std::string& error) {
+    if (g_running) {
+        error = "already running";
+        return false;
+    }
+    if (settings.hz <= 0 || settings.hz > Profiler::MAX_HZ || settings.max_samples == 0) {
+        error = "invalid rate or buffer size";
+        return false;
+    }
+
+    // Everything the handler touches exists before the timer is armed
+    g_buffer.assign(settings.max_samples, Sample());
+    g_samples = g_buffer.data();
+    g_capacity = g_buffer.size();
+    g_next.store(0);
+    g_dropped.store(0);
+    g_thread_names.clear();
+    g_child_stacks.clear();
+    g_child_samples = 0;
+
+    struct sigaction sa{};
+    sa.sa_sigaction = &onProfSignal;
+    sa.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGPROF, &sa, nullptr) == -1) {
+        error = std::string("sigaction(SIGPROF) failed: ") + strerror(errno);
+        return false;
+    }
+    g_armed.store(true);
+
+    struct itimerval timer{};
+    timer.it_interval.tv_usec = 1000000 / settings.hz;
+    timer.it_value = timer.it_interval;
+    if (setitimer(ITIMER_PROF, &timer, nullptr) == -1) {
+        error = std::string("setitimer failed: ") + strerror(errno);
+        g_armed.store(false);
+        signal(SIGPROF, SIG_IGN);
+        return false;
+    }
+
+    if (settings.children) {
+        g_child_stop = false;
+        g_child_thread = std::thread(childLoop, settings.child_comm, settings.hz);
+    }
+    g_started = std::chrono::steady_clock::now();
+    g_running = true;
+    return true;
+}
+
+void SamplingProfiler::stop() {
+    if (!g_running) return;
+
+    struct itimerval off{};
+    setitimer(ITIMER_PROF, &off, nullptr);
+    g_armed.store(false);
+    // A SIGPROF already queued must not hit the default action (terminate)
+    signal(SIGPROF, SIG_IGN);
+    while (g_in_handler.load(std::memory_order_acquire) != 0) std::this_thread::yield();
+
+    if (g_child_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(g_child_mutex);
+            g_child_stop = true;
+        }
+        g_child_cv.notify_all();
+        g_child_thread.join();
+    }
+
+    g_elapsed_us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - g_started).count());
+    // Names now, while the sampled threads most likely still exist
+    const size_t kept = std::min(g_next.load(), g_capacity);
+    for (size_t i = 0; i < kept; ++i) {
+        const pid_t tid = g_samples[i].tid;
+        if (g_thread_names.find(tid) == g_thread_names.end()) g_thread_names[tid] = threadName(tid);
+    }
+    g_running = false;
+}
+
+bool SamplingProfiler::running() {
+    return g_running;
+}
+
+SamplingProfiler::Stats SamplingProfiler::stats() {
+    Stats s;
+    s.samples = std::min(g_next.load(), g_capacity);
+    s.dropped = g_dropped.load();
+    {
+        std::lock_guard<std::mutex> lock(g_child_mutex);
+        s.child_samples = g_child_samples;
+    }
+    s.elapsed_us = g_running
+        ? static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now() - g_started).count())
+        : g_elapsed_us;
+    return s;
+}
+
+bool SamplingProfiler::writeFolded(const std::string& path, std::string& error) {
+    if (g_running) {
+        error = "profiler still running";
+        return false;
+    }
+
+    std::map<std::string, uint64_t> folded = g_child_stacks;
+    std::unordered_map<void*, std::string> leafNames, callerNames;
+    const size_t kept = std::min(g_next.load(), g_capacity);
+    std::string stack;
+    for (size_t i = 0; i < kept; ++i) {
+        const Sample& s = g_samples[i];
+        stack = g_thread_names[s.tid];
+        if (s.depth <= 0) stack += ";[unknown]";
+        for (int f = s.depth - 1; f >= 0; --f) {
+            auto& cache = f == 0 ? leafNames : callerNames;
+            auto it = cache.find(s.frames[f]);
+            if (it == cache.end()) {
+                it = cache.emplace(s.frames[f], symbolize(s.frames[f], f != 0)).first;
+            }
+            stack += ';';
+            stack += it->second;
+        }
+        folded[stack]++;
+    }
+
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) {
+        error = "cannot open " + path + ": " + strerror(errno);
+        return false;
+    }
+    for (const auto& entry : folded) {
+        fprintf(f, "%s %llu\n", entry.first.c_str(), static_cast<unsigned long long>(entry.second));
+    }
+    if (fclose(f) != 0) {
+        error = "write " + path + " failed: " + strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+std::string SamplingProfiler::toggle(const Settings& settings, const std::string& path) {
+    std::string error;
+    if (!running()) {
+        if (settings.hz == 0) return "Profiler disabled (profile_hz = 0)";
+        if (!start(settings, error)) return "Profiler failed to start: " + error;
+        return "Profiling at " + std::to_string(settings.hz) + " Hz" +
+               (settings.children ? " (with " + settings.child_comm + " sessions)" : std::string());
+    }
+
+    stop();
+    const Stats s = stats();
+    if (!writeFolded(path, error)) return "Profile not written: " + error;
+    char buf[160];
+    snprintf(buf, sizeof(buf), "Profile: %llu samples (%llu dropped), %llu session samples over %.1f s -> ",
+             static_cast<unsigned long long>(s.samples), static_cast<unsigned long long>(s.dropped),
+             static_cast<unsigned long long>(s.child_samples), s.elapsed_us / 1e6);
+    return buf + path;
+}
+
+bool SamplingProfiler::installToggleSignal(int sig, std::string& error) {
+    struct sigaction sa{};
+    sa.sa_handler = &onToggleSignal;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(sig, &sa, nullptr) == -1) {
+        error = std::string("sigaction failed: ") + strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+bool SamplingProfiler::consumeToggleRequest() {
+    if (!g_toggle_requested) return false;
+    g_toggle_requested = 0;
+    return true;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Constants.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// In-process sampling profiler, for when perf can't be attached on the device.
+//
+// ITIMER_PROF raises SIGPROF after every 1/hz seconds of CPU used by the
+// process, on the thread that was running. The handler stores that thread's
+// stack in a buffer allocated by start(). Whatever it interrupted may hold any
+// lock, so it only calls async-signal-safe code: no locks, no allocation, and
+// no backtrace() (the unwinder takes the loader's lock). It walks the frame
+// pointer chain by hand instead, so the app is built with
+// -fno-omit-frame-pointer. Samples that don't fit are counted as dropped.
+//
+// With children set, a helper thread also samples the processes named
+// child_comm (dropbear) and their descendants, such as shells and
+// sftp-server. It reads /proc at the same rate: process name, scheduler state,
+// and the kernel stack when readable (root), else wchan. These samples are
+// wall-clock, so they show where sessions wait, not user-space frames.
+//
+// After stop(), writeFolded() symbolizes the samples with dladdr(). It writes
+// one "thread;outer;...;leaf count" line per distinct stack, the input format
+// of flamegraph.pl and speedscope.
+class SamplingProfiler {
+public:
+    struct Settings {
+        int hz = Profiler::DEFAULT_HZ;
+        size_t max_samples = Profiler::MAX_SAMPLES;
+        bool children = true;
+        std::string child_comm = "dropbear";
+    };
+
+    struct Stats {
+        uint64_t samples = 0;           // UI process stacks kept
+        uint64_t dropped = 0;           // buffer was full
+        uint64_t child_samples = 0;
+        uint64_t elapsed_us = 0;
+    };
+
+    static bool start(const Settings& settings, std::string& error);
+    static void stop();
+    static bool running();
+    // Counts for the current run, or the last one once stopped
+    static Stats stats();
+
+    // Folded stacks of the last run; fails while running
+    static bool writeFolded(const std::string& path, std::string& error);
+
+    // Starts (settings.hz 0 = disabled) or stops and writes path; returns a
+    // line for the log
+    static std::string toggle(const Settings& settings, const std::string& path);
+
+    // The handler only sets a flag, read by consumeToggleRequest() from the
+    // main loop
+    static bool installToggleSignal(int sig, std::string& error);
+    static bool consumeToggleRequest();
+};
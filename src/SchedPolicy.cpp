@@ -0,0 +1,138 @@
+#include "SchedPolicy.h"
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
+
+namespace {
+
+// linux/ioprio.h isn't shipped by every toolchain
+constexpr int IOPRIO_WHO_PROCESS = 1;
+constexpr int IOPRIO_CLASS_SHIFT = 13;
+constexpr int IOPRIO_CLASS_RT = 1;
+constexpr int IOPRIO_CLASS_BE = 2;
+constexpr int IOPRIO_CLASS_IDLE = 3;
+
+bool parseNumber(const std::string& s, long& out) {
+    if (s.empty()) return false;
+    char* end = nullptr;
+    errno = 0;
+    out = std::strtol(s.c_str(), &end, 10);
+    return errno == 0 && *end == '\0';
+}
+
+} // namespace
+
+bool SchedPolicy::parseCpuList(const std::string& list, cpu_set_t& out, std::string& error) {
+    CPU_ZERO(&out);
+    bool any = false;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t comma = list.find(',', start);
+        if (comma == std::string::npos) comma = list.size();
+        std::string item = list.substr(start, comma - start);
+        size_t b = item.find_first_not_of(" \t");
+        size_t e = item.find_last_not_of(" \t");
+        item = (b == std::string::npos) ? "" : item.substr(b, e - b + 1);
+        start = comma + 1;
+        if (item.empty()) continue;
+
+        long lo = 0, hi = 0;
+        size_t dash = item.find('-');
+        bool ok = dash == std::string::npos
+            ? parseNumber(item, lo) && (hi = lo, true)
+            : parseNumber(item.substr(0, dash), lo) && parseNumber(item.substr(dash + 1), hi);
+        if (!ok || lo < 0 || hi < lo || hi >= CPU_SETSIZE) {
+            error = "bad CPU list '" + list + "'";
+            return false;
+        }
+        for (long cpu = lo; cpu <= hi; ++cpu) CPU_SET(static_cast<int>(cpu), &out);
+        any = true;
+    }
+    if (!any) {
+        error = "empty CPU list";
+        return false;
+    }
+    return true;
+}
+
+bool SchedPolicy::parseIoPriority(const std::string& text, int& out, std::string& error) {
+    out = 0;
+    if (text.empty()) return true;
+
+    const size_t colon = text.find(':');
+    const std::string cls = text.substr(0, colon);
+    long level = 4;   // the kernel's default best-effort level
+    if (colon != std::string::npos && (!parseNumber(text.substr(colon + 1), level) ||
+                                       level < 0 || level > 7)) {
+        error = "bad I/O priority level in '" + text + "' (0-7)";
+        return false;
+    }
+
+    if (cls == "idle" && colon == std::string::npos) {
+        out = IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT;
+    } else if (cls == "best-effort") {
+        out = (IOPRIO_CLASS_BE << IOPRIO_CLASS_SHIFT) | static_cast<int>(level);
+    } else if (cls == "realtime") {
+        out = (IOPRIO_CLASS_RT << IOPRIO_CLASS_SHIFT) | static_cast<int>(level);
+    } else {
+        error = "bad I/O priority '" + text + "' (idle, best-effort[:N], realtime[:N])";
+        return false;
+    }
+    return true;
+}
+
+bool SchedPolicy::configure(const Settings& settings, std::string& error) {
+    *this = SchedPolicy();
+
+    if (settings.nice < -20 || settings.nice > 19) {
+        error = "nice " + std::to_string(settings.nice) + " outside -20..19";
+        return false;
+    }
+    cpu_set_t cpus;
+    if (!settings.cpus.empty() && !parseCpuList(settings.cpus, cpus, error)) return false;
+    int ioprio = 0;
+    if (!parseIoPriority(settings.ioprio, ioprio, error)) return false;
+
+    set_nice_ = settings.nice != 0 || settings.nice_set;
+    nice_ = settings.nice;
+    set_cpus_ = !settings.cpus.empty();
+    if (set_cpus_) cpus_ = cpus;
+    ioprio_ = ioprio;
+    settings_ = settings;
+    return true;
+}
+
+const char* SchedPolicy::apply(pid_t tid) const {
+    const char* failed = nullptr;
+    int savedErrno = 0;
+    if (tid == 0) tid = static_cast<pid_t>(syscall(SYS_gettid));
+
+    if (set_nice_ && setpriority(PRIO_PROCESS, static_cast<id_t>(tid), nice_) == -1) {
+        failed = "nice";
+        savedErrno = errno;
+    }
+    if (set_cpus_ && sched_setaffinity(tid, sizeof(cpus_), &cpus_) == -1 && !failed) {
+        failed = "affinity";
+        savedErrno = errno;
+    }
+    if (ioprio_ != 0 && syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, tid, ioprio_) == -1 && !failed) {
+        failed = "ioprio";
+        savedErrno = errno;
+    }
+    if (failed) errno = savedErrno;
+    return failed;
+}
+
+std::string SchedPolicy::describe() const {
+    std::string out;
+    auto add = [&out](const std::string& part) {
+        if (!out.empty()) out += ", ";
+        out += part;
+    };
+    if (set_nice_) add("nice " + std::to_string(nice_));
+    if (set_cpus_) add("cpus " + settings_.cpus);
+    if (ioprio_ != 0) add("io " + settings_.ioprio);
+    return out.empty() ? "default" : out;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <sched.h>
+#include <string>
+#include <sys/types.h>
+
+// CPU and I/O scheduling knobs for one thread: nice level, CPU affinity and
+// I/O priority. configure() parses the dropbear.conf strings up front so that
+// apply() is nothing but raw syscalls and can run between fork() and exec().
+// A forked process inherits all three, so applying the policy in the dropbear
+// child also covers every session dropbear forks later.
+class SchedPolicy {
+public:
+    struct Settings {
+        int nice = 0;             // -20..19, 0 = leave alone unless nice_set
+        bool nice_set = false;    // apply nice even when 0, to undo an earlier value
+        std::string cpus;         // "0-1,3" style list, empty = leave alone
+        std::string ioprio;       // "idle", "best-effort[:0-7]", "realtime[:0-7]", empty = leave alone
+    };
+
+    // Validates settings; on failure error names the offending value and the
+    // policy is left empty
+    bool configure(const Settings& settings, std::string& error);
+
+    bool empty() const { return !set_nice_ && !set_cpus_ && ioprio_ == 0; }
+
+    // Applies to tid (0 = calling thread; nice and affinity are per-thread on
+    // Linux). Returns nullptr on success, otherwise the step that failed
+    // ("nice", "affinity", "ioprio") with errno set. Later steps still run.
+    const char* apply(pid_t tid = 0) const;
+
+    // What configure() accepted; defaults after a failed configure()
+    const Settings& settings() const { return settings_; }
+
+    // e.g. "nice 10, cpus 2-3, io idle"; "default" when empty
+    std::string describe() const;
+
+    static bool parseCpuList(const std::string& list, cpu_set_t& out, std::string& error);
+    // Encoded ioprio_set() value; 0 for an empty string
+    static bool parseIoPriority(const std::string& text, int& out, std::string& error);
+
+private:
+    bool set_nice_ = false;
+    int nice_ = 0;
+    bool set_cpus_ = false;
+    cpu_set_t cpus_{};
+    int ioprio_ = 0;
+    Settings settings_;
+};
@@ -0,0 +1,525 @@
+#include "SpawnHelper.h"
+#include "StartupTrace.h"
+#include <sys/prctl.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+enum MessageType : uint32_t { SPAWN = 1, SPAWNED = 2, EXITED = 3 };
+
+enum SpawnFlags : uint32_t {
+    FLAG_STDIO = 1,
+    FLAG_STDERR = 2,
+    FLAG_LOG_PIPE = 4,
+    FLAG_AWAIT_STDIO = 8,
+};
+
+// Followed by path, args, cpus and ioprio, each NUL-terminated. The stdio
+// and stderr fds ride along in that order, as far as flagged.
+struct SpawnHeader {
+    uint32_t type;
+    uint32_t flags;
+    int32_t nice;
+    uint32_t argc;
+};
+
+struct Reply {
+    uint32_t type;
+    int32_t pid;
+    int32_t value;      // SPAWNED: errno, 0 on success; EXITED: wait status
+};
+
+constexpr size_t MAX_MESSAGE = 64 * 1024;
+constexpr int MAX_FDS = 2;
+// Exit reports kept for pids nobody has waited for yet; the oldest go first
+constexpr size_t MAX_UNCLAIMED_EXITS = 256;
+
+bool sendMessage(int sock, const void* buf, size_t len, const int* fds, int nfds) {
+    iovec iov = {const_cast<void*>(buf), len};
+    char control[CMSG_SPACE(sizeof(int) * MAX_FDS)] = {};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (nfds > 0) {
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * nfds);
+        cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * nfds);
+        memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * nfds);
+    }
+    ssize_t n;
+    do {
+        n = sendmsg(sock, &msg, MSG_NOSIGNAL);
+    } while (n < 0 && errno == EINTR);
+    return n == static_cast<ssize_t>(len);
+}
+
+// One message; attached fds arrive CLOEXEC. Returns the length, 0 on EOF,
+// -1 on error (EAGAIN under MSG_DONTWAIT).
+ssize_t receiveMessage(int sock, void* buf, size_t len, int* fds, int& nfds, int flags) {
+    iovec iov = {buf, len};
+    char control[CMSG_SPACE(sizeof(int) * MAX_FDS)];
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    ssize_t n;
+    do {
+        n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC | flags);
+    } while (n < 0 && errno == EINTR);
+    nfds = 0;
+    if (n < 0) return n;
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) continue;
+        const size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (size_t i = 0; i < count; ++i) {
+            int fd;
+            memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+            if (nfds < MAX_FDS) fds[nfds++] = fd;
+            else close(fd);
+        }
+    }
+    return n;
+}
+
+void closeFrom(int first) {
+#ifdef SYS_close_range
+    if (syscall(SYS_close_range, first, ~0U, 0) == 0) return;
+#endif
+    const long max = std::min(sysconf(_SC_OPEN_MAX), 65536L);
+    for (long fd = first; fd < max; ++fd) close(static_cast<int>(fd));
+}
+
+// Runs in the forked child: only syscalls from here on, since the caller may
+// have other threads holding the allocator lock
+[[noreturn]] void execChild(const char* path, char* const argv[], const SchedPolicy& sched,
+                            int stdioFd, int stderrFd, int logFd, int awaitFd) {
+    // Both are inherited across exec; the helper blocks SIGCHLD and ignores
+    // terminal signals, and without a helper the caller may have blocked
+    // SIGTERM / SIGINT / SIGHUP (headless daemon)
+    sigset_t none;
+    sigemptyset(&none);
+    sigprocmask(SIG_SETMASK, &none, nullptr);
+    for (int sig : {SIGTERM, SIGINT, SIGHUP, SIGUSR2, SIGPIPE}) signal(sig, SIG_DFL);
+
+    if (logFd >= 0) {
+        dup2(logFd, STDOUT_FILENO);
+        dup2(logFd, STDERR_FILENO);
+    }
+    if (stderrFd >= 0) dup2(stderrFd, STDERR_FILENO);
+
+    if (awaitFd >= 0) {
+        // Page the binary in while nobody is waiting, and don't hold the
+        // parent's descriptors (listening sockets) while parked
+        const int bin = open(path, O_RDONLY | O_CLOEXEC);
+        if (bin >= 0) {
+            posix_fadvise(bin, 0, 0, POSIX_FADV_WILLNEED);
+            close(bin);
+        }
+        if (awaitFd != 3) {
+            dup2(awaitFd, 3);
+            awaitFd = 3;
+        }
+        closeFrom(4);
+
+        char byte;
+        int fds[MAX_FDS];
+        int nfds = 0;
+        if (receiveMessage(awaitFd, &byte, 1, fds, nfds, 0) <= 0 || nfds == 0) _exit(0);   // parent closed its end
+        close(awaitFd);
+        stdioFd = fds[0];
+    }
+    if (stdioFd >= 0) {
+        dup2(stdioFd, STDIN_FILENO);
+        dup2(stdioFd, STDOUT_FILENO);
+        if (stdioFd > STDERR_FILENO) close(stdioFd);
+    }
+
+    // Scheduling is inherited across exec and by every session dropbear forks;
+    // a failure (e.g. negative nice without CAP_SYS_NICE) is logged, not fatal
+    if (const char* step = sched.apply()) {
+        dprintf(STDERR_FILENO, "%s scheduling: %s failed: %s\n", argv[0], step, strerror(errno));
+    }
+
+    execv(path, argv);
+    dprintf(STDERR_FILENO, "exec %s failed: %s\n", path, strerror(errno));
+    _exit(127);
+}
+
+// Forks and execs request in the calling process; returns 0 or errno
+int forkChild(const SpawnHelper::Request& request, pid_t& pid, int& fd) {
+    // Everything that allocates happens before fork()
+    SchedPolicy sched;
+    std::string ignored;
+    sched.configure(request.sched, ignored);
+    std::vector<char*> argv;
+    for (const auto& arg : request.args) argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    int pipefd[2] = {-1, -1};
+    int sv[2] = {-1, -1};
+    if (request.log_pipe && pipe2(pipefd, O_CLOEXEC) == -1) return errno;
+    if (request.await_stdio && socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) == -1) {
+        const int err = errno;
+        if (pipefd[0] >= 0) {
+            close(pipefd[0]);
+            close(pipefd[1]);
+        }
+        return err;
+    }
+
+    pid = fork();
+    if (pid == 0) {
+        execChild(request.path.c_str(), argv.data(), sched, request.stdio_fd, request.stderr_fd,
+                  pipefd[1], sv[1]);
+    }
+    const int err = pid < 0 ? errno : 0;
+    if (pipefd[1] >= 0) close(pipefd[1]);
+    if (sv[1] >= 0) close(sv[1]);
+    fd = pipefd[0] >= 0 ? pipefd[0] : sv[0];
+    if (pid < 0 && fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+    return err;
+}
+
+bool decodeRequest(const char* data, size_t len, const int* fds, int nfds, SpawnHelper::Request& out) {
+    if (len < sizeof(SpawnHeader)) return false;
+    SpawnHeader h;
+    memcpy(&h, data, sizeof(h));
+    if (h.type != SPAWN) return false;
+
+    std::vector<std::string> strings;
+    const char* p = data + sizeof(h);
+    const char* end = data + len;
+    while (p < end) {
+        const char* nul = static_cast<const char*>(memchr(p, '\0', static_cast<size_t>(end - p)));
+        if (!nul) return false;
+        strings.emplace_back(p, nul);
+        p = nul + 1;
+    }
+    if (strings.size() != h.argc + 3) return false;
+
+    int next = 0;
+    out.stdio_fd = (h.flags & FLAG_STDIO) && next < nfds ? fds[next++] : -1;
+    out.stderr_fd = (h.flags & FLAG_STDERR) && next < nfds ? fds[next++] : -1;
+    out.log_pipe = (h.flags & FLAG_LOG_PIPE) != 0;
+    out.await_stdio = (h.flags & FLAG_AWAIT_STDIO) != 0;
+    out.path = strings[0];
+    out.args.assign(strings.begin() + 1, strings.end() - 2);
+    out.sched.nice = h.nice;
+    out.sched.cpus = strings[strings.size() - 2];
+    out.sched.ioprio = strings.back();
+    return true;
+}
+
+} // namespace
+
+SpawnHelper::SpawnHelper()
+    : metric_spawns_(Metrics::global().counter(
+          "dropbear_app_spawns_total", "dropbear and dropbearkey processes started")),
+      metric_spawn_us_(Metrics::global().gauge(
+          "dropbear_app_spawn_microseconds", "Spawn request to pid known, last spawn")) {
+}
+
+SpawnHelper::~SpawnHelper() {
+    stop();
+}
+
+SpawnHelper& SpawnHelper::global() {
+    static SpawnHelper instance;
+    return instance;
+}
+
+bool SpawnHelper::start(std::string& error) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (sock_ >= 0) return true;
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) == -1) {
+        error = std::string("socketpair: ") + strerror(errno);
+        return false;
+    }
+    const pid_t pid = fork();
+    if (pid < 0) {
+        error = std::string("fork failed: ") + strerror(errno);
+        close(sv[0]);
+        close(sv[1]);
+        return false;
+    }
+    if (pid == 0) {
+        close(sv[0]);
+        serve(sv[1]);
+    }
+    close(sv[1]);
+    sock_ = sv[0];
+    helper_pid_ = pid;
+    return true;
+}
+
+void SpawnHelper::stop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (sock_ < 0) return;
+    // EOF tells the helper to exit; what it started keeps running. It also
+    // wakes a reader blocked in receive(), which must let go of the fd first.
+    shutdown(sock_, SHUT_RDWR);
+    while (reading_) received_.wait(lock);
+    if (sock_ < 0) return;   // the reader saw EOF and cleaned up
+    close(sock_);
+    sock_ = -1;
+    while (waitpid(helper_pid_, nullptr, 0) < 0 && errno == EINTR) {}
+    helper_pid_ = -1;
+}
+
+void SpawnHelper::lost(std::unique_lock<std::mutex>& lock) {
+    if (sock_ < 0) return;
+    shutdown(sock_, SHUT_RDWR);
+    while (reading_) received_.wait(lock);
+    if (sock_ < 0) return;
+    close(sock_);
+    sock_ = -1;
+    if (helper_pid_ > 0) {
+        kill(helper_pid_, SIGKILL);
+        while (waitpid(helper_pid_, nullptr, 0) < 0 && errno == EINTR) {}
+        helper_pid_ = -1;
+    }
+}
+
+bool SpawnHelper::spawn(const Request& request, pid_t& pid, int& fd, std::string& error) {
+    // Replies come back in request order, so one request at a time
+    std::lock_guard<std::mutex> spawnLock(spawn_mutex_);
+    std::unique_lock<std::mutex> lock(mutex_);
+    const uint64_t startUs = StartupTrace::nowMicros();
+    fd = -1;
+    const bool ok = sock_ >= 0 ? spawnRemote(lock, request, pid, fd, error)
+                               : spawnLocal(request, pid, fd, error);
+    if (ok) {
+        const uint64_t us = StartupTrace::nowMicros() - startUs;
+        latency_.record(us);
+        metric_spawns_.inc();
+        metric_spawn_us_.set(static_cast<int64_t>(us));
+    }
+    return ok;
+}
+
+bool SpawnHelper::spawnLocal(const Request& request, pid_t& pid, int& fd, std::string& error) {
+    const int err = forkChild(request, pid, fd);
+    if (err != 0) {
+        error = std::string("fork failed: ") + strerror(err);
+        return false;
+    }
+    return true;
+}
+
+bool SpawnHelper::spawnRemote(std::unique_lock<std::mutex>& lock, const Request& request,
+                              pid_t& pid, int& fd, std::string& error) {
+    SpawnHeader h = {SPAWN, 0, request.sched.nice, static_cast<uint32_t>(request.args.size())};
+    int fds[MAX_FDS];
+    int nfds = 0;
+    if (request.stdio_fd >= 0) {
+        h.flags |= FLAG_STDIO;
+        fds[nfds++] = request.stdio_fd;
+    }
+    if (request.stderr_fd >= 0) {
+        h.flags |= FLAG_STDERR;
+        fds[nfds++] = request.stderr_fd;
+    }
+    if (request.log_pipe) h.flags |= FLAG_LOG_PIPE;
+    if (request.await_stdio) h.flags |= FLAG_AWAIT_STDIO;
+
+    std::string msg(reinterpret_cast<const char*>(&h), sizeof(h));
+    auto add = [&msg](const std::string& s) {
+        msg += s;
+        msg += '\0';
+    };
+    add(request.path);
+    for (const auto& arg : request.args) add(arg);
+    add(request.sched.cpus);
+    add(request.sched.ioprio);
+    if (msg.size() > MAX_MESSAGE) {
+        error = "argument list too long";
+        return false;
+    }
+
+    have_reply_ = false;
+    if (!sendMessage(sock_, msg.data(), msg.size(), fds, nfds)) {
+        lost(lock);
+        return spawnLocal(request, pid, fd, error);
+    }
+    while (!have_reply_) {
+        if (receive(lock, true) < 0) return spawnLocal(request, pid, fd, error);
+    }
+
+    if (reply_errno_ != 0) {
+        error = std::string("fork failed: ") + strerror(reply_errno_);
+        if (received_fd_ >= 0) close(received_fd_);
+        received_fd_ = -1;
+        return false;
+    }
+    pid = reply_pid_;
+    fd = received_fd_;
+    received_fd_ = -1;
+    remote_pids_.insert(pid);
+    return true;
+}
+
+int SpawnHelper::receive(std::unique_lock<std::mutex>& lock, bool block) {
+    if (sock_ < 0) return -1;
+    Reply r;
+    int fds[MAX_FDS];
+    int nfds = 0;
+    ssize_t n;
+    if (block) {
+        // One thread blocks in recv() without the lock; the others sleep until
+        // it has handed over a message, then look again
+        if (reading_) {
+            received_.wait(lock);
+            return 1;
+        }
+        reading_ = true;
+        const int sock = sock_;
+        lock.unlock();
+        n = receiveMessage(sock, &r, sizeof(r), fds, nfds, 0);
+        const int err = errno;
+        lock.lock();
+        reading_ = false;
+        received_.notify_all();
+        errno = err;
+    } else {
+        // A blocked reader would miss a message taken here, and hands over
+        // everything it receives anyway
+        if (reading_) return 0;
+        n = receiveMessage(sock_, &r, sizeof(r), fds, nfds, MSG_DONTWAIT);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+    }
+    if (n <= 0) {
+        lost(lock);
+        return -1;
+    }
+    if (n != static_cast<ssize_t>(sizeof(r))) {
+        for (int i = 0; i < nfds; ++i) close(fds[i]);
+        return 1;
+    }
+    if (r.type == EXITED) {
+        if (exited_.size() >= MAX_UNCLAIMED_EXITS) {
+            auto oldest = std::min_element(exited_.begin(), exited_.end(),
+                [](const std::pair<const pid_t, Exit>& a, const std::pair<const pid_t, Exit>& b) {
+                    return a.second.seq < b.second.seq;
+                });
+            // A late wait() on it gets waitpid()'s ECHILD
+            remote_pids_.erase(oldest->first);
+            exited_.erase(oldest);
+        }
+        exited_[r.pid] = Exit{r.value, ++exit_seq_};
+    } else if (r.type == SPAWNED) {
+        have_reply_ = true;
+        reply_pid_ = r.pid;
+        reply_errno_ = r.value;
+        received_fd_ = nfds > 0 ? fds[0] : -1;
+    }
+    received_.notify_all();
+    return 1;
+}
+
+pid_t SpawnHelper::wait(pid_t pid, int* status, int flags) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!remote_pids_.count(pid)) {
+        lock.unlock();
+        pid_t r;
+        do {
+            r = waitpid(pid, status, flags);
+        } while (r < 0 && errno == EINTR);
+        return r;
+    }
+
+    for (;;) {
+        auto it = exited_.find(pid);
+        if (it != exited_.end()) {
+            if (status) *status = it->second.status;
+            exited_.erase(it);
+            remote_pids_.erase(pid);
+            return pid;
+        }
+        if (sock_ < 0) {
+            // The helper died and its exit reports with it; init reaps now
+            if (kill(pid, 0) == -1 && errno == ESRCH) {
+                if (status) *status = 0;
+                remote_pids_.erase(pid);
+                return pid;
+            }
+            if (flags & WNOHANG) return 0;
+            lock.unlock();
+            usleep(10000);
+            lock.lock();
+            continue;
+        }
+        if (receive(lock, (flags & WNOHANG) == 0) == 0) return 0;
+    }
+}
+
+bool SpawnHelper::sendFd(int sock, int fd) {
+    const char byte = 0;
+    return sendMessage(sock, &byte, 1, &fd, 1);
+}
+
+[[noreturn]] void SpawnHelper::serve(int sock) {
+    prctl(PR_SET_NAME, "spawn-helper", 0, 0, 0);
+    // Terminal signals are for the app; the helper goes when its socket closes
+    signal(SIGHUP, SIG_IGN);
+    signal(SIGINT, SIG_IGN);
+
+    sigset_t chld;
+    sigemptyset(&chld);
+    sigaddset(&chld, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &chld, nullptr);
+    const int sigfd = signalfd(-1, &chld, SFD_CLOEXEC | SFD_NONBLOCK);
+
+    std::vector<char> buf(MAX_MESSAGE);
+    for (;;) {
+        struct pollfd pfds[2] = {{sock, POLLIN, 0}, {sigfd, POLLIN, 0}};
+        if (poll(pfds, 2, sigfd >= 0 ? -1 : 100) < 0 && errno != EINTR) break;
+
+        if (pfds[1].revents & POLLIN) {
+            signalfd_siginfo info;
+            while (read(sigfd, &info, sizeof(info)) > 0) {}
+        }
+        int status;
+        pid_t pid;
+        while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+            const Reply r = {EXITED, pid, status};
+            sendMessage(sock, &r, sizeof(r), nullptr, 0);
+        }
+
+        if (!(pfds[0].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+        int fds[MAX_FDS];
+        int nfds = 0;
+        const ssize_t n = receiveMessage(sock, buf.data(), buf.size(), fds, nfds, 0);
+        if (n <= 0) break;   // the app is gone
+
+        Request request;
+        Reply r = {SPAWNED, -1, EINVAL};
+        int fd = -1;
+        if (decodeRequest(buf.data(), static_cast<size_t>(n), fds, nfds, request)) {
+            r.value = forkChild(request, pid, fd);
+            r.pid = pid;
+        }
+        sendMessage(sock, &r, sizeof(r), &fd, fd >= 0 ? 1 : 0);
+        if (fd >= 0) close(fd);
+        for (int i = 0; i < nfds; ++i) close(fds[i]);
+    }
+    _exit(0);
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "LatencyHistogram.h"
+#include "Metrics.h"
+#include "SchedPolicy.h"
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Starts dropbear and dropbearkey from a small process forked at the top of
+// main(), before SDL, the GL context and the font exist. fork() copies the
+// caller's page tables, so forking the running app gets slower as it grows;
+// forking the helper stays cheap.
+//
+// The app talks to the helper over a SOCK_SEQPACKET socketpair. A spawn
+// request carries the argv, the scheduling settings and any stdio fds
+// (SCM_RIGHTS). The reply carries the pid and, when asked for, the read end of
+// a new log pipe or our end of a socketpair the child waits on. The helper is
+// the parent of everything it starts and reports each exit, so wait() stands
+// in for waitpid() on those pids.
+//
+// Without a helper (not started, or it died) spawn() forks the caller
+// directly, with the same semantics.
+class SpawnHelper {
+public:
+    struct Request {
+        std::string path;
+        std::vector<std::string> args;        // full argv
+        SchedPolicy::Settings sched;          // applied in the child before exec
+        int stdio_fd = -1;                    // becomes stdin and stdout (a connection)
+        int stderr_fd = -1;                   // becomes stderr
+        bool log_pipe = false;                // stdout and stderr to a new pipe; read end returned
+        bool await_stdio = false;             // child receives stdio_fd over a socketpair before exec
+    };
+
+    SpawnHelper();
+    ~SpawnHelper();
+
+    SpawnHelper(const SpawnHelper&) = delete;
+    SpawnHelper& operator=(const SpawnHelper&) = delete;
+
+    // The one main() starts and everything else spawns through
+    static SpawnHelper& global();
+
+    // Forks the helper. Call while the process is small and single-threaded;
+    // the helper never returns from here.
+    bool start(std::string& error);
+    void stop();
+    bool running() const { return sock_ >= 0; }
+
+    // fd is the pipe read end (log_pipe) or the socketpair end to send the
+    // connection to with sendFd() (await_stdio), else -1. Both are CLOEXEC.
+    bool spawn(const Request& request, pid_t& pid, int& fd, std::string& error);
+
+    // waitpid() for spawned pids; flags is 0 or WNOHANG. Safe from any
+    // thread: a blocking wait doesn't hold up spawns or other waits.
+    pid_t wait(pid_t pid, int* status, int flags);
+
+    // Request to pid returned, over the last spawns
+    const LatencyHistogram& latency() const { return latency_; }
+
+    static bool sendFd(int sock, int fd);
+
+private:
+    bool spawnRemote(std::unique_lock<std::mutex>& lock, const Request& request,
+                     pid_t& pid, int& fd, std::string& error);
+    bool spawnLocal(const Request& request, pid_t& pid, int& fd, std::string& error);
+    // 1 = handled a message (or another thread did), 0 = none pending,
+    // -1 = helper lost. Called with lock held; a blocking call drops it
+    // while it waits.
+    int receive(std::unique_lock<std::mutex>& lock, bool block);
+    void lost(std::unique_lock<std::mutex>& lock);
+    [[noreturn]] static void serve(int sock);
+
+    int sock_ = -1;
+    pid_t helper_pid_ = -1;
+    struct Exit {
+        int status;
+        uint64_t seq;                                   // arrival order
+    };
+
+    std::mutex spawn_mutex_;                            // one request in flight
+    std::mutex mutex_;                                  // everything below
+    std::condition_variable received_;                  // a message came in, or the reader stepped down
+    bool reading_ = false;                              // a thread is blocked in recv() on sock_
+    std::unordered_set<pid_t> remote_pids_;             // started by the helper, not yet waited for
+    std::unordered_map<pid_t, Exit> exited_;            // reported exits not yet waited for (capped)
+    uint64_t exit_seq_ = 0;
+    int received_fd_ = -1;                              // fd that came with the last reply
+    bool have_reply_ = false;
+    pid_t reply_pid_ = -1;
+    int reply_errno_ = 0;
+    LatencyHistogram latency_;
+    Metrics::Metric& metric_spawns_;
+    Metrics::Metric& metric_spawn_us_;
+};
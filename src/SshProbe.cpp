@@ -0,0 +1,216 @@
+#include "SshProbe.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+constexpr size_t SshProbe::HISTORY;
+
+namespace {
+
+const size_t kMaxBannerBytes = 255;   // RFC 4253 limit for the identification line
+
+uint64_t clockMicros(clockid_t clock) {
+    struct timespec ts{};
+    clock_gettime(clock, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000 + static_cast<uint64_t>(ts.tv_nsec) / 1000;
+}
+
+} // namespace
+
+SshProbe::~SshProbe() {
+    if (fd_ >= 0) close(fd_);
+}
+
+void SshProbe::configure(const Settings& settings) {
+    settings_ = settings;
+}
+
+void SshProbe::reset(uint64_t nowUs) {
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+    bad_streak_ = 0;
+    next_probe_us_ = nowUs + static_cast<uint64_t>(settings_.interval_secs) * 1000000;
+}
+
+bool SshProbe::begin(uint64_t nowUs) {
+    banner_.clear();
+    started_us_ = nowUs;
+    started_mono_us_ = clockMicros(CLOCK_MONOTONIC);
+    started_realtime_us_ = clockMicros(CLOCK_REALTIME);
+
+    fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) {
+        last_error_ = std::string("socket: ") + strerror(errno);
+        return false;
+    }
+    int on = 1;
+    setsockopt(fd_, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+
+    struct sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(settings_.port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == -1 &&
+        errno != EINPROGRESS) {
+        last_error_ = std::string("connect: ") + strerror(errno);
+        return false;
+    }
+
+    // Remember our source port so the matching dropbear child can be recognised
+    struct sockaddr_in local{};
+    socklen_t len = sizeof(local);
+    if (getsockname(fd_, reinterpret_cast<struct sockaddr*>(&local), &len) == 0) {
+        recent_ports_[recent_port_head_] = ntohs(local.sin_port);
+        recent_port_head_ = (recent_port_head_ + 1) % recent_ports_.size();
+    }
+    return true;
+}
+
+ssize_t SshProbe::readBanner(uint64_t& rxRealtimeUs) {
+    char buf[256];
+    char control[CMSG_SPACE(sizeof(struct timespec))];
+    struct iovec iov = {buf, sizeof(buf)};
+    struct msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t n = recvmsg(fd_, &msg, 0);
+    if (n <= 0) return n;
+
+    for (struct cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+        if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS) {
+            struct timespec ts;
+            memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+            rxRealtimeUs = static_cast<uint64_t>(ts.tv_sec) * 1000000 +
+                           static_cast<uint64_t>(ts.tv_nsec) / 1000;
+        }
+    }
+    banner_.append(buf, static_cast<size_t>(n));
+    return n;
+}
+
+SshProbe::Result SshProbe::poll(uint64_t nowUs) {
+    if (!enabled()) return Result::None;
+
+    if (fd_ < 0) {
+        if (nowUs < next_probe_us_) return Result::None;
+        next_probe_us_ = nowUs + static_cast<uint64_t>(settings_.interval_secs) * 1000000;
+        if (!begin(nowUs)) return finish(nowUs, false, 0, last_error_);
+    }
+
+    // Drain whatever has arrived; ENOTCONN/EAGAIN just mean "not yet"
+    for (;;) {
+        uint64_t rxRealtimeUs = 0;
+        const ssize_t n = readBanner(rxRealtimeUs);
+        if (n < 0) {
+            const int err = errno;
+            if (err == EAGAIN || err == EWOULDBLOCK || err == ENOTCONN || err == EINTR) break;
+            return finish(nowUs, false, 0, strerror(err));
+        }
+        if (n == 0) return finish(nowUs, false, 0, "closed before banner");
+
+        size_t eol = banner_.find('\n');
+        if (eol != std::string::npos) {
+            // Servers may send other lines before the identification string
+            size_t start = 0;
+            while (eol != std::string::npos) {
+                if (banner_.compare(start, 4, "SSH-") == 0) {
+                    // Prefer the kernel's arrival stamp; reading late (e.g. once
+                    // per frame) must not inflate the measurement
+                    uint64_t latency = clockMicros(CLOCK_MONOTONIC) - started_mono_us_;
+                    if (rxRealtimeUs > started_realtime_us_) {
+                        latency = std::min(latency, rxRealtimeUs - started_realtime_us_);
+                    }
+                    return finish(nowUs, true, latency, "");
+                }
+                start = eol + 1;
+                eol = banner_.find('\n', start);
+            }
+        }
+        if (banner_.size() > kMaxBannerBytes * 4) {
+            return finish(nowUs, false, 0, "no SSH identification line");
+        }
+    }
+
+    if (nowUs - started_us_ >= static_cast<uint64_t>(settings_.timeout_ms) * 1000) {
+        return finish(nowUs, false, nowUs - started_us_, "no banner after " +
+                      std::to_string(settings_.timeout_ms) + " ms");
+    }
+    return Result::None;
+}
+
+SshProbe::Result SshProbe::finish(uint64_t nowUs, bool ok, uint64_t latencyUs,
+                                  const std::string& error) {
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+
+    Sample& s = history_[history_head_];
+    s.at_us = nowUs;
+    s.latency_us = latencyUs;
+    s.ok = ok;
+    history_head_ = (history_head_ + 1) % HISTORY;
+    if (history_count_ < HISTORY) history_count_++;
+
+    const bool spike = ok && latencyUs > static_cast<uint64_t>(settings_.spike_ms) * 1000;
+    bad_streak_ = (!ok || spike) ? bad_streak_ + 1 : 0;
+    last_error_ = ok ? "" : error;
+    return ok ? Result::Ok : Result::Failed;
+}
+
+bool SshProbe::needsRestart() const {
+    return enabled() && settings_.failures_to_restart > 0 &&
+           bad_streak_ >= settings_.failures_to_restart;
+}
+
+SshProbe::Health SshProbe::health() const {
+    if (!enabled() || history_count_ == 0) return Health::Unknown;
+    if (needsRestart()) return Health::Down;
+    return bad_streak_ > 0 ? Health::Degraded : Health::Healthy;
+}
+
+uint64_t SshProbe::nextWakeUs() const {
+    if (!enabled()) return UINT64_MAX;
+    if (fd_ >= 0) return started_us_ + static_cast<uint64_t>(settings_.timeout_ms) * 1000;
+    return next_probe_us_;
+}
+
+bool SshProbe::isProbePort(int port) const {
+    if (port <= 0) return false;
+    return std::find(recent_ports_.begin(), recent_ports_.end(), port) != recent_ports_.end();
+}
+
+const SshProbe::Sample& SshProbe::lastSample() const {
+    return history_[(history_head_ + HISTORY - 1) % HISTORY];
+}
+
+uint64_t SshProbe::percentileLatency(double p) const {
+    std::vector<uint64_t> ok;
+    for (size_t i = 0; i < history_count_; ++i) {
+        if (history_[i].ok) ok.push_back(history_[i].latency_us);
+    }
+    if (ok.empty()) return 0;
+    std::sort(ok.begin(), ok.end());
+    size_t idx = static_cast<size_t>(p * (ok.size() - 1) + 0.5);
+    return ok[std::min(idx, ok.size() - 1)];
+}
+
+const char* SshProbe::healthName(Health h) {
+    switch (h) {
+        case Health::Healthy:  return "healthy";
+        case Health::Degraded: return "degraded";
+        case Health::Down:     return "down";
+        default:               return "unknown";
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+
+// Checks that the dropbear listener actually answers: connects to
+// 127.0.0.1:port, reads the "SSH-2.0-..." identification banner and records
+// the time to banner. Non-blocking and driven by poll(), so it never stalls
+// the render loop; the banner's arrival time comes from the socket's kernel
+// receive timestamp, so the measurement doesn't depend on how often poll()
+// runs. Each probe costs one short-lived dropbear child.
+class SshProbe {
+public:
+    enum class Health { Unknown, Healthy, Degraded, Down };
+    enum class Result { None, Ok, Failed };
+
+    struct Settings {
+        int port = 22;
+        int interval_secs = 5;           // 0 disables probing
+        int failures_to_restart = 3;     // consecutive failures/spikes
+        int timeout_ms = 2000;
+        int spike_ms = 1000;
+    };
+
+    struct Sample {
+        uint64_t at_us = 0;
+        uint64_t latency_us = 0;
+        bool ok = false;
+    };
+
+    static constexpr size_t HISTORY = 32;
+
+    SshProbe() = default;
+    ~SshProbe();
+
+    // Delete copy operations
+    SshProbe(const SshProbe&) = delete;
+    SshProbe& operator=(const SshProbe&) = delete;
+
+    void configure(const Settings& settings);
+
+    // Forget streaks and wait a full interval before the next probe, e.g.
+    // right after dropbear (re)started
+    void reset(uint64_t nowUs);
+
+    // Starts a due probe or advances the one in flight; returns Ok/Failed when
+    // a probe finishes
+    Result poll(uint64_t nowUs);
+
+    bool enabled() const { return settings_.interval_secs > 0; }
+    bool needsRestart() const;
+    Health health() const;
+
+    // For callers that sleep in poll(): socket of the probe in flight (-1 if
+    // none) and when poll() next has work to do
+    int fd() const { return fd_; }
+    uint64_t nextWakeUs() const;
+
+    // Whether a dropbear "Child connection from 127.0.0.1:<port>" came from us
+    bool isProbePort(int port) const;
+
+    const Sample& lastSample() const;
+    const std::string& lastError() const { return last_error_; }
+    uint64_t percentileLatency(double p) const;   // over successful samples in history
+
+    static const char* healthName(Health h);
+
+private:
+    bool begin(uint64_t nowUs);
+    Result finish(uint64_t nowUs, bool ok, uint64_t latencyUs, const std::string& error);
+    ssize_t readBanner(uint64_t& rxRealtimeUs);   // recvmsg() result
+
+    Settings settings_;
+    int fd_ = -1;
+    uint64_t started_us_ = 0;           // caller's clock, for scheduling/timeouts
+    uint64_t started_mono_us_ = 0;      // CLOCK_MONOTONIC, for latency
+    uint64_t started_realtime_us_ = 0;  // CLOCK_REALTIME, matches kernel rx stamps
+    uint64_t next_probe_us_ = 0;
+    std::string banner_;
+    std::string last_error_;
+
+    std::array<Sample, HISTORY> history_{};
+    size_t history_head_ = 0;           // next slot to write
+    size_t history_count_ = 0;
+    int bad_streak_ = 0;                // consecutive failures or spikes
+
+    std::array<int, 4> recent_ports_{};
+    size_t recent_port_head_ = 0;
+};
@@ -0,0 +1,180 @@
+#include "StartupTrace.h"
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <vector>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#ifndef APP_BUILD_ID
+#define APP_BUILD_ID "unknown"
+#endif
+
+namespace {
+
+struct Event {
+    std::string name;
+    char phase;          // 'X' complete, 'i' instant
+    uint64_t ts_us;
+    uint64_t dur_us;
+    long tid;
+};
+
+struct TraceState {
+    std::mutex mutex;
+    std::vector<Event> events;
+};
+
+TraceState& state() {
+    static TraceState s;
+    return s;
+}
+
+uint64_t clockMicros(clockid_t clock) {
+    struct timespec ts{};
+    clock_gettime(clock, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+long currentTid() {
+    return static_cast<long>(syscall(SYS_gettid));
+}
+
+// Process start on the monotonic clock. The kernel records start time in
+// clock ticks since boot (/proc/self/stat field 22), i.e. on CLOCK_BOOTTIME.
+uint64_t processLaunchMicros() {
+    std::ifstream stat("/proc/self/stat");
+    std::string content;
+    if (!std::getline(stat, content)) return 0;
+
+    // Skip past "pid (comm)"; comm may contain spaces
+    size_t close = content.rfind(')');
+    if (close == std::string::npos) return 0;
+
+    std::istringstream fields(content.substr(close + 2));
+    std::string field;
+    unsigned long long startTicks = 0;
+    for (int i = 3; i <= 22 && fields >> field; ++i) {
+        if (i == 22) startTicks = std::stoull(field);
+    }
+
+    const long hz = sysconf(_SC_CLK_TCK);
+    if (startTicks == 0 || hz <= 0) return 0;
+
+    const uint64_t startBoot = startTicks * 1000000ULL / hz;
+    const uint64_t nowBoot = clockMicros(CLOCK_BOOTTIME);
+    const uint64_t nowMono = clockMicros(CLOCK_MONOTONIC);
+    const uint64_t sinceLaunch = nowBoot > startBoot ? nowBoot - startBoot : 0;
+    return nowMono > sinceLaunch ? nowMono - sinceLaunch : 0;
+}
+
+uint64_t launchMicros() {
+    static const uint64_t launch = processLaunchMicros();
+    return launch;
+}
+
+std::string escapeJson(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (static_cast<unsigned char>(c) < 0x20) continue;
+        out += c;
+    }
+    return out;
+}
+
+} // namespace
+
+StartupTrace::Scope::Scope(const char* name)
+    : name_(name), start_us_(StartupTrace::nowMicros()) {
+}
+
+StartupTrace::Scope::~Scope() {
+    StartupTrace::complete(name_, start_us_, StartupTrace::nowMicros());
+}
+
+uint64_t StartupTrace::nowMicros() {
+    return clockMicros(CLOCK_MONOTONIC);
+}
+
+uint64_t StartupTrace::sinceLaunchMicros() {
+    const uint64_t launch = launchMicros();
+    const uint64_t now = nowMicros();
+    return launch != 0 && now > launch ? now - launch : 0;
+}
+
+void StartupTrace::complete(const std::string& name, uint64_t startUs, uint64_t endUs) {
+    TraceState& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.events.push_back({name, 'X', startUs, endUs > startUs ? endUs - startUs : 0, currentTid()});
+}
+
+void StartupTrace::instant(const std::string& name) {
+    TraceState& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.events.push_back({name, 'i', nowMicros(), 0, currentTid()});
+}
+
+bool StartupTrace::has(const std::string& name) {
+    TraceState& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    for (const auto& e : s.events) {
+        if (e.name == name) return true;
+    }
+    return false;
+}
+
+std::string StartupTrace::toJson() {
+    TraceState& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+
+    uint64_t origin = launchMicros();
+    for (const auto& e : s.events) {
+        if (origin == 0 || e.ts_us < origin) origin = e.ts_us;
+    }
+
+    const long pid = static_cast<long>(getpid());
+    std::ostringstream out;
+    out << "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"build\":\""
+        << escapeJson(APP_BUILD_ID) << "\"},\"traceEvents\":[";
+
+    bool first = true;
+    auto emit = [&](const std::string& name, char phase, uint64_t ts, uint64_t dur, long tid) {
+        out << (first ? "" : ",") << "\n{\"name\":\"" << escapeJson(name)
+            << "\",\"ph\":\"" << phase << "\",\"ts\":" << ts
+            << ",\"pid\":" << pid << ",\"tid\":" << tid;
+        if (phase == 'X') out << ",\"dur\":" << dur;
+        if (phase == 'i') out << ",\"s\":\"g\"";
+        out << "}";
+        first = false;
+    };
+
+    if (launchMicros() != 0 && !s.events.empty()) {
+        emit("process launch", 'i', 0, 0, pid);
+    }
+    for (const auto& e : s.events) {
+        emit(e.name, e.phase, e.ts_us - origin, e.dur_us, e.tid);
+    }
+    out << "\n]}\n";
+    return out.str();
+}
+
+bool StartupTrace::writeFile(const std::string& path) {
+    const std::string json = toJson();
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream file(tmp, std::ios::trunc);
+        if (!file.is_open()) return false;
+        file << json;
+        if (!file.good()) return false;
+    }
+    return rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+void StartupTrace::reset() {
+    TraceState& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.events.clear();
+}
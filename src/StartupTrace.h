@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Records startup phases with monotonic timestamps and writes them as a
+// Chrome trace (chrome://tracing, Perfetto) so launch-to-SSH-ready time can
+// be compared across builds. All timestamps are reported relative to process
+// launch as recorded by the kernel.
+class StartupTrace {
+public:
+    // Records a complete ("X") event spanning the lifetime of the scope
+    class Scope {
+    public:
+        explicit Scope(const char* name);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* name_;
+        uint64_t start_us_;
+    };
+
+    static uint64_t nowMicros();
+    // Time since the kernel started this process; 0 if unknown
+    static uint64_t sinceLaunchMicros();
+
+    static void complete(const std::string& name, uint64_t startUs, uint64_t endUs);
+    static void instant(const std::string& name);
+    static bool has(const std::string& name);
+
+    static std::string toJson();
+    static bool writeFile(const std::string& path);
+
+    // Drops all recorded events (used by tests)
+    static void reset();
+};
@@ -0,0 +1,655 @@
+#include "SyncProtocol.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+namespace {
+
+constexpr uint32_t MAGIC = 0x4E595344;        // "DSYN"
+constexpr uint32_t VERSION = 1;
+constexpr size_t FLUSH_BYTES = 256 * 1024;
+constexpr size_t LITERAL_CHUNK = 256 * 1024;
+constexpr uint32_t MAX_MESSAGE = 64 * 1024 * 1024;
+constexpr uint32_t MIN_READ_SIZE = 64 * 1024;
+constexpr uint32_t MAX_READ_SIZE = 4 * 1024 * 1024;   // per buffer; the server holds two per thread
+
+enum ResultCode : uint8_t { RESULT_FAILED, RESULT_UPDATED, RESULT_SAME };
+
+enum MessageType : uint8_t {
+    HELLO = 1,
+    FILE_ENTRY,
+    LIST_END,
+    SIG,
+    SIG_END,
+    DELTA_BEGIN,
+    COPY,
+    LITERAL,
+    DELTA_END,
+    DONE,
+    SAME,       // content already identical: only the mtime is updated
+    RESULT,
+    STATS,
+    FAILURE,    // fatal error text; the sender stops after it
+};
+
+class Writer {
+public:
+    void u8(uint8_t v) { s_.push_back(static_cast<char>(v)); }
+    void u32(uint32_t v) {
+        for (int i = 0; i < 4; ++i) s_.push_back(static_cast<char>(v >> (8 * i)));
+    }
+    void u64(uint64_t v) {
+        for (int i = 0; i < 8; ++i) s_.push_back(static_cast<char>(v >> (8 * i)));
+    }
+    void str(const std::string& v) {
+        u32(static_cast<uint32_t>(v.size()));
+        s_ += v;
+    }
+    const std::string& data() const { return s_; }
+
+private:
+    std::string s_;
+};
+
+class Reader {
+public:
+    explicit Reader(const std::string& s) : s_(s) {}
+
+    uint8_t u8() { return need(1) ? static_cast<uint8_t>(s_[pos_++]) : 0; }
+    uint32_t u32() {
+        uint32_t v = 0;
+        if (need(4)) {
+            for (int i = 0; i < 4; ++i) v |= static_cast<uint32_t>(static_cast<uint8_t>(s_[pos_++])) << (8 * i);
+        }
+        return v;
+    }
+    uint64_t u64() {
+        uint64_t v = 0;
+        if (need(8)) {
+            for (int i = 0; i < 8; ++i) v |= static_cast<uint64_t>(static_cast<uint8_t>(s_[pos_++])) << (8 * i);
+        }
+        return v;
+    }
+    std::string str() {
+        const uint32_t n = u32();
+        if (!need(n)) return std::string();
+        std::string v = s_.substr(pos_, n);
+        pos_ += n;
+        return v;
+    }
+    bool ok() const { return ok_; }
+
+private:
+    bool need(size_t n) {
+        if (ok_ && s_.size() - pos_ >= n) return true;
+        ok_ = false;
+        return false;
+    }
+
+    const std::string& s_;
+    size_t pos_ = 0;
+    bool ok_ = true;
+};
+
+// Framed messages over a pair of fds, with large buffered writes
+class Channel {
+public:
+    Channel(int inFd, int outFd) : in_fd_(inFd), out_fd_(outFd) {}
+
+    bool send(uint8_t type, const char* payload, size_t len) {
+        Writer h;
+        h.u8(type);
+        h.u32(static_cast<uint32_t>(len));
+        out_ += h.data();
+        out_.append(payload, len);
+        return out_.size() < FLUSH_BYTES || flush();
+    }
+    bool send(uint8_t type, const std::string& payload) { return send(type, payload.data(), payload.size()); }
+    bool send(uint8_t type) { return send(type, nullptr, 0); }
+
+    bool flush() {
+        const char* p = out_.data();
+        size_t left = out_.size();
+        while (left > 0) {
+            ssize_t n = write(out_fd_, p, left);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                error_ = std::string("write: ") + strerror(errno);
+                return false;
+            }
+            p += n;
+            left -= static_cast<size_t>(n);
+            sent_ += static_cast<uint64_t>(n);
+        }
+        out_.clear();
+        return true;
+    }
+
+    bool recv(uint8_t& type, std::string& payload) {
+        char header[5];
+        if (!readExact(header, sizeof(header))) return false;
+        type = static_cast<uint8_t>(header[0]);
+        uint32_t len = 0;
+        for (int i = 0; i < 4; ++i) len |= static_cast<uint32_t>(static_cast<uint8_t>(header[1 + i])) << (8 * i);
+        if (len > MAX_MESSAGE) {
+            error_ = "oversized message";
+            return false;
+        }
+        payload.resize(len);
+        return len == 0 || readExact(&payload[0], len);
+    }
+
+    uint64_t sent() const { return sent_; }
+    uint64_t received() const { return received_; }
+    const std::string& error() const { return error_; }
+
+private:
+    bool readExact(char* dst, size_t len) {
+        while (len > 0) {
+            if (in_pos_ == in_.size()) {
+                in_.resize(FLUSH_BYTES);
+                ssize_t n = read(in_fd_, &in_[0], in_.size());
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) {
+                    error_ = n == 0 ? "connection closed" : std::string("read: ") + strerror(errno);
+                    in_.clear();
+                    in_pos_ = 0;
+                    return false;
+                }
+                in_.resize(static_cast<size_t>(n));
+                in_pos_ = 0;
+                received_ += static_cast<uint64_t>(n);
+            }
+            const size_t take = std::min(len, in_.size() - in_pos_);
+            std::memcpy(dst, in_.data() + in_pos_, take);
+            in_pos_ += take;
+            dst += take;
+            len -= take;
+        }
+        return true;
+    }
+
+    int in_fd_;
+    int out_fd_;
+    std::string out_;
+    std::string in_;
+    size_t in_pos_ = 0;
+    uint64_t sent_ = 0;
+    uint64_t received_ = 0;
+    std::string error_;
+};
+
+// Turns DeltaSync::diff output into DELTA_BEGIN + COPY / LITERAL messages.
+// A delta that is one run over every old block of an equal-sized file is
+// held back: the copies are identical and need no rewrite.
+class ChannelSink : public DeltaSync::Sink {
+public:
+    ChannelSink(Channel& ch, uint32_t index, const DeltaSync::Signature& sig, uint64_t newSize)
+        : ch_(ch), index_(index), sig_(sig), new_size_(newSize) {}
+
+    bool copyBlocks(uint64_t first, uint64_t count) override {
+        matched_ += std::min(sig_.file_size, (first + count) * sig_.block_size) - first * sig_.block_size;
+        if (!begun_ && first == 0 && count == sig_.blocks.size() && new_size_ == sig_.file_size) {
+            held_ = true;
+            return true;
+        }
+        Writer w;
+        w.u64(first);
+        w.u64(count);
+        return begin() && ch_.send(COPY, w.data());
+    }
+
+    bool literal(const char* data, size_t len) override {
+        literal_ += len;
+        if (!begin()) return false;
+        for (size_t off = 0; off < len; off += LITERAL_CHUNK) {
+            if (!ch_.send(LITERAL, data + off, std::min(LITERAL_CHUNK, len - off))) return false;
+        }
+        return true;
+    }
+
+    // Sends DELTA_BEGIN (and a held-back copy) once
+    bool begin() {
+        if (begun_) return true;
+        begun_ = true;
+        Writer w;
+        w.u32(index_);
+        if (!ch_.send(DELTA_BEGIN, w.data())) return false;
+        if (!held_) return true;
+        held_ = false;
+        Writer c;
+        c.u64(0);
+        c.u64(sig_.blocks.size());
+        return ch_.send(COPY, c.data());
+    }
+
+    // Nothing needs rewriting: all blocks matched in place, or both are empty
+    bool identical() const {
+        return !begun_ && sig_.exists && new_size_ == sig_.file_size && (held_ || new_size_ == 0);
+    }
+
+    uint64_t matched() const { return matched_; }
+    uint64_t literalBytes() const { return literal_; }
+
+private:
+    Channel& ch_;
+    uint32_t index_;
+    const DeltaSync::Signature& sig_;
+    uint64_t new_size_;
+    bool begun_ = false;
+    bool held_ = false;
+    uint64_t matched_ = 0;
+    uint64_t literal_ = 0;
+};
+
+struct Entry {
+    std::string path;
+    uint64_t size;
+    int64_t mtime;
+};
+
+bool mkdirs(const std::string& root, const std::string& relDir) {
+    std::string dir = root;
+    size_t start = 0;
+    while (start < relDir.size()) {
+        size_t slash = relDir.find('/', start);
+        if (slash == std::string::npos) slash = relDir.size();
+        dir += "/" + relDir.substr(start, slash - start);
+        if (mkdir(dir.c_str(), 0755) == -1 && errno != EEXIST) return false;
+        start = slash + 1;
+    }
+    return true;
+}
+
+void walk(const std::string& root, const std::string& rel, std::vector<Entry>& out) {
+    const std::string dirPath = rel.empty() ? root : root + "/" + rel;
+    DIR* dir = opendir(dirPath.c_str());
+    if (!dir) return;
+    while (struct dirent* de = readdir(dir)) {
+        const std::string name = de->d_name;
+        if (name == "." || name == "..") continue;
+        const std::string relPath = rel.empty() ? name : rel + "/" + name;
+        struct stat st;
+        if (lstat((root + "/" + relPath).c_str(), &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) {
+            walk(root, relPath, out);
+        } else if (S_ISREG(st.st_mode)) {
+            out.push_back({relPath, static_cast<uint64_t>(st.st_size), static_cast<int64_t>(st.st_mtime)});
+        }
+    }
+    closedir(dir);
+}
+
+// One file being rebuilt on the server
+struct Rebuild {
+    size_t index = 0;
+    int old_fd = -1;
+    int tmp_fd = -1;
+    std::string tmp_path;
+    std::string error;
+    std::unique_ptr<DeltaSync::Patcher> patcher;
+};
+
+void abandon(Rebuild& r) {
+    r.patcher.reset();
+    if (r.old_fd >= 0) close(r.old_fd);
+    if (r.tmp_fd >= 0) close(r.tmp_fd);
+    if (!r.tmp_path.empty()) unlink(r.tmp_path.c_str());
+    r.old_fd = r.tmp_fd = -1;
+    r.tmp_path.clear();
+}
+
+} // namespace
+
+bool SyncProtocol::safeRelativePath(const std::string& path) {
+    if (path.empty() || path[0] == '/') return false;
+    size_t start = 0;
+    while (start <= path.size()) {
+        size_t slash = path.find('/', start);
+        if (slash == std::string::npos) slash = path.size();
+        const std::string part = path.substr(start, slash - start);
+        if (part.empty() || part == "." || part == "..") return false;
+        start = slash + 1;
+    }
+    return path.find('\0') == std::string::npos;
+}
+
+bool SyncProtocol::serve(int inFd, int outFd, const std::string& destDir, std::string& error) {
+    Channel ch(inFd, outFd);
+    auto fail = [&](const std::string& why) {
+        error = why;
+        ch.send(FAILURE, why);
+        ch.flush();
+        return false;
+    };
+
+    uint8_t type;
+    std::string payload;
+    if (!ch.recv(type, payload) || type != HELLO) return fail("expected HELLO");
+    Reader hello(payload);
+    if (hello.u32() != MAGIC || hello.u32() != VERSION) return fail("protocol version mismatch");
+    const bool checksum = hello.u8() != 0;
+    DeltaSync::SignOptions signOptions;
+    // Both come from the client; signing allocates threads * 2 * read_size
+    // and starts that many threads, so keep them to what this device has
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    signOptions.threads = std::min(hello.u32(), cores);
+    signOptions.read_size = std::min(std::max(MIN_READ_SIZE, hello.u32()), MAX_READ_SIZE);
+    if (!hello.ok()) return fail("malformed HELLO");
+
+    std::vector<Entry> entries;
+    for (;;) {
+        if (!ch.recv(type, payload)) return fail(ch.error());
+        if (type == LIST_END) break;
+        if (type != FILE_ENTRY) return fail("expected FILE");
+        Reader r(payload);
+        Entry e;
+        e.path = r.str();
+        e.size = r.u64();
+        e.mtime = static_cast<int64_t>(r.u64());
+        if (!r.ok()) return fail("malformed FILE");
+        entries.push_back(e);
+    }
+
+    // Quick check by size and mtime, then sign everything that differs
+    std::vector<std::string> results(entries.size());   // "" = no result yet
+    std::vector<bool> expected(entries.size(), false);
+    std::vector<size_t> toSign;
+    std::vector<std::string> signPaths;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const Entry& e = entries[i];
+        if (!safeRelativePath(e.path)) {
+            results[i] = "Funsafe path";
+            continue;
+        }
+        struct stat st;
+        const std::string full = destDir + "/" + e.path;
+        const bool exists = stat(full.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+        if (exists && !checksum && static_cast<uint64_t>(st.st_size) == e.size &&
+            std::llabs(static_cast<long long>(st.st_mtime - e.mtime)) <= MTIME_WINDOW_SECS) {
+            continue;
+        }
+        expected[i] = true;
+        toSign.push_back(i);
+        signPaths.push_back(full);
+    }
+
+    std::vector<DeltaSync::Signature> sigs;
+    DeltaSync::SignStats signStats;
+    std::string signError;
+    if (!DeltaSync::sign(signPaths, sigs, signOptions, &signStats, signError)) return fail(signError);
+
+    for (size_t k = 0; k < toSign.size(); ++k) {
+        const DeltaSync::Signature& sig = sigs[k];
+        Writer w;
+        w.u32(static_cast<uint32_t>(toSign[k]));
+        w.u8(sig.exists ? 1 : 0);
+        w.u32(sig.block_size);
+        w.u64(sig.file_size);
+        w.u32(static_cast<uint32_t>(sig.blocks.size()));
+        for (const auto& b : sig.blocks) {
+            w.u32(b.weak);
+            w.u64(b.strong);
+        }
+        if (!ch.send(SIG, w.data())) return fail(ch.error());
+    }
+    if (!ch.send(SIG_END) || !ch.flush()) return fail(ch.error());
+    std::vector<DeltaSync::Signature> sigByIndex(entries.size());
+    for (size_t k = 0; k < toSign.size(); ++k) sigByIndex[toSign[k]] = std::move(sigs[k]);
+
+    Rebuild cur;
+    bool inFile = false;
+    for (;;) {
+        if (!ch.recv(type, payload)) {
+            if (inFile) abandon(cur);
+            return fail(ch.error());
+        }
+        if (type == DONE) break;
+
+        if (type == SAME) {
+            Reader r(payload);
+            const uint32_t index = r.u32();
+            const int64_t mtime = static_cast<int64_t>(r.u64());
+            if (!r.ok() || inFile || index >= entries.size() || !expected[index]) {
+                return fail("unexpected SAME");
+            }
+            expected[index] = false;
+            struct timespec times[2];
+            times[0].tv_sec = times[1].tv_sec = static_cast<time_t>(mtime);
+            times[0].tv_nsec = times[1].tv_nsec = 0;
+            utimensat(AT_FDCWD, (destDir + "/" + entries[index].path).c_str(), times, 0);
+            results[index] = "=";
+        } else if (type == DELTA_BEGIN) {
+            Reader r(payload);
+            const uint32_t index = r.u32();
+            if (!r.ok() || inFile || index >= entries.size() || !expected[index]) {
+                return fail("unexpected DELTA_BEGIN");
+            }
+            expected[index] = false;
+            inFile = true;
+            cur = Rebuild();
+            cur.index = index;
+            const std::string& rel = entries[index].path;
+            const size_t slash = rel.find_last_of('/');
+            const std::string full = destDir + "/" + rel;
+            if (slash != std::string::npos && !mkdirs(destDir, rel.substr(0, slash))) {
+                cur.error = std::string("mkdir: ") + strerror(errno);
+                continue;
+            }
+            const DeltaSync::Signature& sig = sigByIndex[index];
+            if (sig.exists) cur.old_fd = open(full.c_str(), O_RDONLY | O_CLOEXEC);
+            const size_t base = full.find_last_of('/') + 1;
+            cur.tmp_path = full.substr(0, base) + "." + full.substr(base) + ".dsync-XXXXXX";
+            cur.tmp_fd = mkstemp(&cur.tmp_path[0]);
+            if (cur.tmp_fd < 0) {
+                cur.error = std::string("create: ") + strerror(errno);
+                cur.tmp_path.clear();
+                continue;
+            }
+            cur.patcher.reset(new DeltaSync::Patcher(cur.old_fd, sig.block_size, sig.file_size, cur.tmp_fd));
+        } else if (type == COPY || type == LITERAL) {
+            if (!inFile) return fail("data outside a file");
+            if (!cur.error.empty() || !cur.patcher) continue;   // drain the rest of a failed file
+            bool ok;
+            if (type == COPY) {
+                Reader r(payload);
+                const uint64_t first = r.u64();
+                const uint64_t count = r.u64();
+                ok = r.ok() && cur.patcher->copyBlocks(first, count);
+            } else {
+                ok = cur.patcher->literal(payload.data(), payload.size());
+            }
+            if (!ok) cur.error = cur.patcher->error().empty() ? "malformed delta" : cur.patcher->error();
+        } else if (type == DELTA_END) {
+            Reader r(payload);
+            const uint32_t index = r.u32();
+            const uint64_t digest = r.u64();
+            const int64_t mtime = static_cast<int64_t>(r.u64());
+            if (!r.ok() || !inFile || index != cur.index) return fail("unexpected DELTA_END");
+            inFile = false;
+
+            uint64_t got = 0;
+            if (cur.error.empty() && cur.patcher && !cur.patcher->finish(got)) cur.error = cur.patcher->error();
+            if (cur.error.empty() && got != digest) cur.error = "checksum mismatch after rebuild";
+            if (cur.error.empty()) {
+                struct stat oldSt;
+                const std::string full = destDir + "/" + entries[index].path;
+                const mode_t mode = stat(full.c_str(), &oldSt) == 0 ? (oldSt.st_mode & 07777) : 0644;
+                fchmod(cur.tmp_fd, mode);   // may fail on FAT; harmless
+                struct timespec times[2];
+                times[0].tv_sec = times[1].tv_sec = static_cast<time_t>(mtime);
+                times[0].tv_nsec = times[1].tv_nsec = 0;
+                futimens(cur.tmp_fd, times);
+                if (rename(cur.tmp_path.c_str(), full.c_str()) == -1) {
+                    cur.error = std::string("rename: ") + strerror(errno);
+                } else {
+                    cur.tmp_path.clear();
+                }
+            }
+            results[index] = cur.error.empty() ? "O" : "F" + cur.error;
+            abandon(cur);
+        } else {
+            if (inFile) abandon(cur);
+            return fail("unexpected message");
+        }
+    }
+    if (inFile) abandon(cur);
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (results[i].empty()) continue;
+        Writer w;
+        w.u32(static_cast<uint32_t>(i));
+        w.u8(results[i][0] == 'F' ? RESULT_FAILED : results[i][0] == '=' ? RESULT_SAME : RESULT_UPDATED);
+        w.str(results[i].substr(1));
+        if (!ch.send(RESULT, w.data())) return false;
+    }
+    Writer s;
+    s.u64(signStats.bytes);
+    s.u64(signStats.elapsed_us);
+    s.u32(signStats.threads);
+    return ch.send(STATS, s.data()) && ch.flush();
+}
+
+bool SyncProtocol::push(int inFd, int outFd, const std::string& srcDir, const Options& options,
+                        Stats& stats, std::string& error) {
+    Channel ch(inFd, outFd);
+    std::vector<Entry> entries;
+    walk(srcDir, "", entries);
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry& a, const Entry& b) { return a.path < b.path; });
+    stats.files = entries.size();
+    for (const auto& e : entries) stats.source_bytes += e.size;
+
+    auto finish = [&](bool ok, const std::string& why) {
+        stats.wire_sent = ch.sent();
+        stats.wire_received = ch.received();
+        if (!ok) error = why;
+        return ok;
+    };
+
+    Writer hello;
+    hello.u32(MAGIC);
+    hello.u32(VERSION);
+    hello.u8(options.checksum ? 1 : 0);
+    hello.u32(options.sign.threads);
+    hello.u32(static_cast<uint32_t>(options.sign.read_size));
+    ch.send(HELLO, hello.data());
+    for (const auto& e : entries) {
+        Writer w;
+        w.str(e.path);
+        w.u64(e.size);
+        w.u64(static_cast<uint64_t>(e.mtime));
+        if (!ch.send(FILE_ENTRY, w.data())) return finish(false, ch.error());
+    }
+    if (!ch.send(LIST_END) || !ch.flush()) return finish(false, ch.error());
+
+    uint8_t type;
+    std::string payload;
+    std::vector<std::pair<uint32_t, DeltaSync::Signature>> sigs;
+    for (;;) {
+        if (!ch.recv(type, payload)) return finish(false, ch.error());
+        if (type == SIG_END) break;
+        if (type == FAILURE) return finish(false, "server: " + payload);
+        if (type != SIG) return finish(false, "expected SIG");
+        Reader r(payload);
+        DeltaSync::Signature sig;
+        const uint32_t index = r.u32();
+        sig.exists = r.u8() != 0;
+        sig.block_size = r.u32();
+        sig.file_size = r.u64();
+        const uint32_t count = r.u32();
+        if (!r.ok() || index >= entries.size() || count > payload.size() / 12) {
+            return finish(false, "malformed SIG");
+        }
+        sig.blocks.resize(count);
+        for (auto& b : sig.blocks) {
+            b.weak = r.u32();
+            b.strong = r.u64();
+        }
+        if (!r.ok()) return finish(false, "malformed SIG");
+        sigs.emplace_back(index, std::move(sig));
+    }
+
+    // 0 = up to date, 1 = sent, 2 = updated, 3 = failed
+    std::vector<uint8_t> state(entries.size(), 0);
+    for (const auto& s : sigs) {
+        const Entry& e = entries[s.first];
+        const std::string path = srcDir + "/" + e.path;
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            stats.errors.push_back(e.path + ": " + strerror(errno));
+            state[s.first] = 3;
+            if (fd >= 0) close(fd);
+            continue;
+        }
+        const size_t len = static_cast<size_t>(st.st_size);
+        const char* data = "";
+        void* map = MAP_FAILED;
+        if (len > 0) {
+            map = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map == MAP_FAILED) {
+                stats.errors.push_back(e.path + ": mmap: " + strerror(errno));
+                state[s.first] = 3;
+                close(fd);
+                continue;
+            }
+            madvise(map, len, MADV_SEQUENTIAL);
+            data = static_cast<const char*>(map);
+        }
+
+        ChannelSink sink(ch, s.first, s.second, len);
+        bool sent = DeltaSync::diff(s.second, data, len, sink);
+        Writer end;
+        end.u32(s.first);
+        if (sent && sink.identical()) {
+            end.u64(static_cast<uint64_t>(st.st_mtime));
+            sent = ch.send(SAME, end.data());
+        } else if (sent) {
+            end.u64(DeltaSync::strongHash(data, len));
+            end.u64(static_cast<uint64_t>(st.st_mtime));
+            sent = sink.begin() && ch.send(DELTA_END, end.data());
+        }
+        if (map != MAP_FAILED) munmap(map, len);
+        close(fd);
+        if (!sent) return finish(false, ch.error());
+        stats.literal_bytes += sink.literalBytes();
+        stats.matched_bytes += sink.matched();
+        state[s.first] = 1;
+    }
+    if (!ch.send(DONE) || !ch.flush()) return finish(false, ch.error());
+
+    for (;;) {
+        if (!ch.recv(type, payload)) return finish(false, ch.error());
+        if (type == FAILURE) return finish(false, "server: " + payload);
+        Reader r(payload);
+        if (type == STATS) {
+            stats.server_hashed_bytes = r.u64();
+            stats.server_sign_us = r.u64();
+            stats.server_threads = r.u32();
+            break;
+        }
+        if (type != RESULT) return finish(false, "expected RESULT");
+        const uint32_t index = r.u32();
+        const uint8_t code = r.u8();
+        const std::string message = r.str();
+        if (!r.ok() || index >= entries.size()) return finish(false, "malformed RESULT");
+        state[index] = code == RESULT_SAME ? 0 : code == RESULT_UPDATED ? 2 : 3;
+        if (code == RESULT_FAILED) stats.errors.push_back(entries[index].path + ": " + message);
+    }
+
+    for (uint8_t s : state) {
+        if (s == 0) stats.up_to_date++;
+        else if (s == 2) stats.updated++;
+        else stats.failed++;
+    }
+    return finish(true, "");
+}
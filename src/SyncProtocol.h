@@ -0,0 +1,65 @@
+#pragma once
+
+#include "DeltaSync.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Wire protocol of tools/delta_sync: a client pushes a directory tree to a
+// server over a pair of byte streams, normally the stdin/stdout of
+// `ssh device delta-sync --server DEST`.
+//
+//   client                                  server (device)
+//   HELLO, FILE x N, LIST_END       ->
+//                                   <-      SIG for each file that differs
+//                                           (size/mtime, or always with
+//                                           checksum), SIG_END
+//   DELTA_BEGIN, COPY/LITERAL...,
+//   DELTA_END(digest, mtime) per SIG ->     rebuilt beside the old copy,
+//                                           verified, renamed over it
+//   (or SAME(mtime) when every block
+//   matched in place)               ->      only the mtime is updated
+//   DONE                            ->
+//                                   <-      RESULT per file, STATS
+//
+// Messages are [type u8][length u32 LE][payload]. Each side sends its whole
+// phase before reading the next one, so neither can block on a full pipe
+// while the other is also writing. Files are only added or replaced, never
+// deleted.
+class SyncProtocol {
+public:
+    struct Options {
+        bool checksum = false;           // compare signatures even when size/mtime match
+        DeltaSync::SignOptions sign;     // forwarded to the server
+    };
+
+    struct Stats {
+        uint64_t files = 0;
+        uint64_t up_to_date = 0;
+        uint64_t updated = 0;
+        uint64_t failed = 0;
+        uint64_t source_bytes = 0;       // size of the whole local tree
+        uint64_t literal_bytes = 0;      // file data sent as-is
+        uint64_t matched_bytes = 0;      // reused from the device's copies
+        uint64_t wire_sent = 0;          // protocol bytes, before SSH framing
+        uint64_t wire_received = 0;
+        uint64_t server_hashed_bytes = 0;
+        uint64_t server_sign_us = 0;
+        unsigned server_threads = 0;
+        std::vector<std::string> errors;
+    };
+
+    // Device side: serves one client reading inFd and writing outFd, with
+    // paths relative to destDir. Returns when the client is done.
+    static bool serve(int inFd, int outFd, const std::string& destDir, std::string& error);
+
+    // Host side: pushes every regular file under srcDir
+    static bool push(int inFd, int outFd, const std::string& srcDir, const Options& options,
+                     Stats& stats, std::string& error);
+
+    // Relative, non-empty, no "." / ".." components, no leading '/'
+    static bool safeRelativePath(const std::string& path);
+
+    // Seconds; FAT/exFAT SD cards store mtimes at 2 s resolution
+    static constexpr int64_t MTIME_WINDOW_SECS = 2;
+};
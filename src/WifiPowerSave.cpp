@@ -0,0 +1,327 @@
+#include "WifiPowerSave.h"
+#include "Constants.h"
+#include "SpawnHelper.h"
+#include <linux/genetlink.h>
+#include <linux/netlink.h>
+#include <linux/nl80211.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <net/if.h>
+#include <signal.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <deque>
+
+namespace {
+
+const long long COMMAND_POLL_MS = 10;
+const size_t MAX_COMMAND_OUTPUT = 256;   // kept for the error message
+
+// One generic netlink request/response over a fresh socket. Attributes are
+// appended in order; the reply's top-level attributes are handed to onAttr.
+class GenlRequest {
+public:
+    GenlRequest(uint16_t family, uint8_t cmd, uint16_t flags) {
+        buf_.resize(NLMSG_HDRLEN + GENL_HDRLEN);
+        nlmsghdr* nlh = header();
+        nlh->nlmsg_type = family;
+        nlh->nlmsg_flags = NLM_F_REQUEST | flags;
+        nlh->nlmsg_seq = 1;
+        genlmsghdr* genl = reinterpret_cast<genlmsghdr*>(buf_.data() + NLMSG_HDRLEN);
+        genl->cmd = cmd;
+        genl->version = 1;
+    }
+
+    void put(uint16_t type, const void* data, size_t len) {
+        const size_t at = buf_.size();
+        buf_.resize(at + NLA_ALIGN(NLA_HDRLEN + len));
+        nlattr* nla = reinterpret_cast<nlattr*>(buf_.data() + at);
+        nla->nla_type = type;
+        nla->nla_len = static_cast<uint16_t>(NLA_HDRLEN + len);
+        memcpy(buf_.data() + at + NLA_HDRLEN, data, len);
+    }
+    void putU32(uint16_t type, uint32_t v) { put(type, &v, sizeof(v)); }
+
+    // Sends and reads until the reply (or ack) arrives. Kernel errors come
+    // back as negative errno in an NLMSG_ERROR message.
+    template <typename Fn>
+    bool exchange(Fn onAttr, std::string& error) {
+        header()->nlmsg_len = static_cast<uint32_t>(buf_.size());
+        const int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_GENERIC);
+        if (fd < 0) {
+            error = std::string("netlink socket: ") + strerror(errno);
+            return false;
+        }
+        sockaddr_nl kernel{};
+        kernel.nl_family = AF_NETLINK;
+        bool ok = sendto(fd, buf_.data(), buf_.size(), 0,
+                         reinterpret_cast<sockaddr*>(&kernel), sizeof(kernel)) >= 0;
+        if (!ok) error = std::string("netlink send: ") + strerror(errno);
+
+        bool done = !ok;
+        char reply[8192];
+        while (!done) {
+            const ssize_t n = recv(fd, reply, sizeof(reply), 0);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                error = std::string("netlink recv: ") + strerror(errno);
+                ok = false;
+                break;
+            }
+            int len = static_cast<int>(n);
+            for (nlmsghdr* nlh = reinterpret_cast<nlmsghdr*>(reply); NLMSG_OK(nlh, len);
+                 nlh = NLMSG_NEXT(nlh, len)) {
+                if (nlh->nlmsg_type == NLMSG_ERROR) {
+                    const nlmsgerr* err = static_cast<const nlmsgerr*>(NLMSG_DATA(nlh));
+                    if (err->error != 0) {
+                        error = strerror(-err->error);
+                        ok = false;
+                    }
+                    done = true;
+                    break;
+                }
+                if (nlh->nlmsg_type == NLMSG_DONE) {
+                    done = true;
+                    break;
+                }
+                const char* payload = static_cast<const char*>(NLMSG_DATA(nlh)) + GENL_HDRLEN;
+                int remaining = static_cast<int>(nlh->nlmsg_len) - NLMSG_HDRLEN - GENL_HDRLEN;
+                while (remaining >= NLA_HDRLEN) {
+                    const nlattr* nla = reinterpret_cast<const nlattr*>(payload);
+                    if (nla->nla_len < NLA_HDRLEN || nla->nla_len > remaining) break;
+                    onAttr(nla->nla_type & NLA_TYPE_MASK, payload + NLA_HDRLEN, nla->nla_len - NLA_HDRLEN);
+                    const int step = NLA_ALIGN(nla->nla_len);
+                    payload += step;
+                    remaining -= step;
+                }
+                // Non-dump requests without NLM_F_ACK end with their one reply
+                if (!(header()->nlmsg_flags & NLM_F_ACK)) done = true;
+            }
+        }
+        close(fd);
+        return ok;
+    }
+
+private:
+    nlmsghdr* header() { return reinterpret_cast<nlmsghdr*>(buf_.data()); }
+    std::vector<char> buf_;
+};
+
+class Nl80211PowerSave : public WifiPowerSave {
+public:
+    const char* name() const override { return "nl80211"; }
+
+    bool get(const std::string& iface, bool& enabled, std::string& error) override {
+        uint32_t ifindex;
+        if (!resolve(iface, ifindex, error)) return false;
+        GenlRequest req(family_, NL80211_CMD_GET_POWER_SAVE, 0);
+        req.putU32(NL80211_ATTR_IFINDEX, ifindex);
+        bool found = false;
+        const bool ok = req.exchange([&](uint16_t type, const char* data, size_t len) {
+            if (type == NL80211_ATTR_PS_STATE && len >= sizeof(uint32_t)) {
+                uint32_t state;
+                memcpy(&state, data, sizeof(state));
+                enabled = state == NL80211_PS_ENABLED;
+                found = true;
+            }
+        }, error);
+        if (ok && !found) error = "no power save state in reply";
+        return ok && found;
+    }
+
+    bool set(const std::string& iface, bool enabled, std::string& error) override {
+        uint32_t ifindex;
+        if (!resolve(iface, ifindex, error)) return false;
+        GenlRequest req(family_, NL80211_CMD_SET_POWER_SAVE, NLM_F_ACK);
+        req.putU32(NL80211_ATTR_IFINDEX, ifindex);
+        req.putU32(NL80211_ATTR_PS_STATE, enabled ? NL80211_PS_ENABLED : NL80211_PS_DISABLED);
+        return req.exchange([](uint16_t, const char*, size_t) {}, error);
+    }
+
+private:
+    bool resolve(const std::string& iface, uint32_t& ifindex, std::string& error) {
+        ifindex = if_nametoindex(iface.c_str());
+        if (ifindex == 0) {
+            error = iface + ": " + strerror(errno);
+            return false;
+        }
+        if (family_ != 0) return true;
+
+        // The nl80211 family id is assigned at runtime
+        GenlRequest req(GENL_ID_CTRL, CTRL_CMD_GETFAMILY, 0);
+        req.put(CTRL_ATTR_FAMILY_NAME, NL80211_GENL_NAME, sizeof(NL80211_GENL_NAME));
+        const bool ok = req.exchange([this](uint16_t type, const char* data, size_t len) {
+            if (type == CTRL_ATTR_FAMILY_ID && len >= sizeof(uint16_t)) memcpy(&family_, data, sizeof(family_));
+        }, error);
+        if (!ok) error = "nl80211 unavailable: " + error;
+        else if (family_ == 0) error = "nl80211 family not found";
+        return ok && family_ != 0;
+    }
+
+    uint16_t family_ = 0;
+};
+
+class CommandPowerSave : public WifiPowerSave {
+public:
+    explicit CommandPowerSave(const std::string& setTemplate) : template_(setTemplate) {}
+
+    // Queued switches still run, so power save is restored on exit
+    ~CommandPowerSave() override {
+        Completion done;
+        while (!jobs_.empty()) {
+            if (!poll(done)) usleep(COMMAND_POLL_MS * 1000);
+        }
+    }
+
+    const char* name() const override { return "command"; }
+    bool async() const override { return true; }
+
+    bool get(const std::string&, bool&, std::string& error) override {
+        error = "state can't be read through a command";
+        return false;
+    }
+
+    // Through the spawn helper (clean signal mask and dispositions), one
+    // command at a time. set() only starts it: this runs on the loop reacting
+    // to sessions, and a template slow on the driver must not stall it.
+    bool set(const std::string& iface, bool enabled, std::string& error) override {
+        Job job;
+        job.iface = iface;
+        job.enabled = enabled;
+        for (size_t i = 0; i < template_.size(); ++i) {
+            if (template_[i] == '%' && i + 1 < template_.size()) {
+                const char c = template_[i + 1];
+                if (c == 'i') { job.cmd += iface; ++i; continue; }
+                if (c == 's') { job.cmd += enabled ? "on" : "off"; ++i; continue; }
+            }
+            job.cmd += template_[i];
+        }
+        if (jobs_.empty() && !start(job, error)) return false;
+        jobs_.push_back(std::move(job));
+        return true;
+    }
+
+    bool poll(Completion& done) override {
+        if (jobs_.empty()) return false;
+        Job& job = jobs_.front();
+        std::string error;
+        if (job.pid < 0 && !start(job, error)) return complete(done, false, error);
+
+        drain(job);
+        int status = 0;
+        const pid_t reaped = SpawnHelper::global().wait(job.pid, &status, WNOHANG);
+        if (reaped == 0 || (reaped < 0 && errno == EINTR)) {
+            if (std::chrono::steady_clock::now() < job.deadline) return false;
+            // sh -c execs a lone command, so this is usually the tool itself
+            kill(job.pid, SIGKILL);
+            SpawnHelper::global().wait(job.pid, nullptr, 0);
+            return complete(done, false, "'" + job.cmd + "' timed out after " +
+                                         std::to_string(Network::POWER_SAVE_COMMAND_TIMEOUT_MS) +
+                                         " ms and was killed");
+        }
+        if (reaped < 0) return complete(done, false, std::string("waitpid failed: ") + strerror(errno));
+
+        drain(job);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            error = "'" + job.cmd + "' exited with status " +
+                    std::to_string(WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status));
+            std::string& output = job.output;
+            while (!output.empty() && (output.back() == '\n' || output.back() == ' ')) output.pop_back();
+            if (!output.empty()) error += ": " + output.substr(0, MAX_COMMAND_OUTPUT);
+            return complete(done, false, error);
+        }
+        return complete(done, true, "");
+    }
+
+private:
+    struct Job {
+        std::string iface;
+        bool enabled = false;
+        std::string cmd;
+        pid_t pid = -1;
+        int fd = -1;                      // output, non-blocking; -1 at EOF
+        std::string output;               // kept for the error message
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    static bool start(Job& job, std::string& error) {
+        SpawnHelper::Request request;
+        request.path = "/bin/sh";
+        request.args = {"sh", "-c", job.cmd};
+        request.log_pipe = true;
+        if (!SpawnHelper::global().spawn(request, job.pid, job.fd, error)) {
+            job.pid = -1;
+            return false;
+        }
+        if (job.fd >= 0) fcntl(job.fd, F_SETFL, fcntl(job.fd, F_GETFL) | O_NONBLOCK);
+        job.deadline = std::chrono::steady_clock::now() +
+                       std::chrono::milliseconds(Network::POWER_SAVE_COMMAND_TIMEOUT_MS);
+        return true;
+    }
+
+    static void drain(Job& job) {
+        char buf[256];
+        while (job.fd >= 0) {
+            const ssize_t n = read(job.fd, buf, sizeof(buf));
+            if (n > 0) {
+                if (job.output.size() < MAX_COMMAND_OUTPUT) job.output.append(buf, static_cast<size_t>(n));
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && errno == EAGAIN) break;
+            close(job.fd);
+            job.fd = -1;
+        }
+    }
+
+    // Hands the front job's outcome to done and drops it; the next one
+    // starts on the following poll()
+    bool complete(Completion& done, bool ok, const std::string& error) {
+        Job& job = jobs_.front();
+        if (job.fd >= 0) close(job.fd);
+        done.iface = job.iface;
+        done.enabled = job.enabled;
+        done.ok = ok;
+        done.error = error;
+        jobs_.pop_front();
+        return true;
+    }
+
+    std::string template_;
+    std::deque<Job> jobs_;
+};
+
+bool isDirectory(const std::string& path) {
+    struct stat st{};
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+} // namespace
+
+std::vector<std::string> WifiPowerSave::interfaces() {
+    std::vector<std::string> names;
+    DIR* dir = opendir("/sys/class/net");
+    if (!dir) return names;
+    while (dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] == '.') continue;
+        const std::string base = std::string("/sys/class/net/") + entry->d_name;
+        if (isDirectory(base + "/wireless") || isDirectory(base + "/phy80211")) names.push_back(entry->d_name);
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+std::unique_ptr<WifiPowerSave> WifiPowerSave::nl80211() {
+    return std::unique_ptr<WifiPowerSave>(new Nl80211PowerSave());
+}
+
+std::unique_ptr<WifiPowerSave> WifiPowerSave::command(const std::string& setTemplate) {
+    return std::unique_ptr<WifiPowerSave>(new CommandPowerSave(setTemplate));
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// Reads and switches 802.11 power save on a wireless interface. NetworkManager
+// drives it; tests substitute a fake.
+//
+// nl80211() talks generic netlink to the kernel directly (what
+// `iw dev wlan0 set power_save off` does) and needs CAP_NET_ADMIN to switch.
+// command() runs a shell template instead, for drivers that only expose a
+// vendor tool: %i becomes the interface and %s "on" or "off". A command
+// backend can't read the current state, so get() fails and callers assume
+// power save was on. Its set() only starts the command (async()); poll()
+// reports the outcome once it exits or is killed at the deadline.
+class WifiPowerSave {
+public:
+    struct Completion {
+        std::string iface;
+        bool enabled = false;             // the state set() asked for
+        bool ok = false;
+        std::string error;
+    };
+
+    virtual ~WifiPowerSave() = default;
+
+    virtual const char* name() const = 0;
+    virtual bool get(const std::string& iface, bool& enabled, std::string& error) = 0;
+    // Done on return, or started when async()
+    virtual bool set(const std::string& iface, bool enabled, std::string& error) = 0;
+    virtual bool async() const { return false; }
+    // Takes the next finished switch of an async backend; never blocks
+    virtual bool poll(Completion&) { return false; }
+
+    // Interfaces with a /sys/class/net/<if>/wireless or phy80211 entry
+    virtual std::vector<std::string> interfaces();
+
+    static std::unique_ptr<WifiPowerSave> nl80211();
+    static std::unique_ptr<WifiPowerSave> command(const std::string& setTemplate);
+};
@@ -1,8 +1,38 @@
 // src/main.cpp
 #include "Application.h"
+#include "HeadlessDaemon.h"
+#include "SpawnHelper.h"
+#include <cstring>
 #include <iostream>
 
+namespace {
+
+bool hasFlag(int argc, char* argv[], const char* flag) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], flag) == 0) return true;
+    }
+    return false;
+}
+
+} // namespace
+
 int main(int argc, char* argv[]) {
+    // Forked while the process is still small and single-threaded; every
+    // dropbear and dropbearkey launch goes through it
+    std::string spawnError;
+    if (!SpawnHelper::global().start(spawnError)) {
+        std::cerr << "Spawn helper unavailable, forking directly: " << spawnError << std::endl;
+    }
+
+    if (hasFlag(argc, argv, "--headless")) {
+        HeadlessDaemon daemon;
+        if (!daemon.initialize()) {
+            std::cerr << "Failed to initialize headless daemon" << std::endl;
+            return 1;
+        }
+        return daemon.run();
+    }
+
     Application app;
     
     if (!app.initialize()) {
@@ -0,0 +1,39 @@
+#include "bench_framework.h"
+#include "../src/AuthGuard.h"
+#include <vector>
+
+namespace {
+
+std::vector<std::string> attackerAddresses(size_t count) {
+    std::vector<std::string> ips;
+    for (size_t i = 0; i < count; ++i) {
+        ips.push_back("10." + std::to_string((i >> 16) & 255) + "." +
+                      std::to_string((i >> 8) & 255) + "." + std::to_string(i & 255));
+    }
+    return ips;
+}
+
+} // namespace
+
+void registerAuthGuardBenchmarks(BenchRunner& runner) {
+    // Cost per logged failure must not grow with the number of attackers
+    runner.addBenchmark("AuthGuard::recordFailure 10k distinct IPs", []() {
+        static const std::vector<std::string> ips = attackerAddresses(10000);
+        static AuthGuard guard;
+        static size_t i = 0;
+        static uint32_t now = 0;
+
+        guard.recordFailure(ips[i], now);
+        if (++i == ips.size()) { i = 0; ++now; }
+    });
+
+    runner.addBenchmark("AuthGuard::isBlocked 10k distinct IPs", []() {
+        static const std::vector<std::string> ips = attackerAddresses(10000);
+        static AuthGuard guard;
+        static size_t i = 0;
+
+        bool blocked = guard.isBlocked(ips[i], 0);
+        benchDoNotOptimize(blocked);
+        if (++i == ips.size()) i = 0;
+    });
+}
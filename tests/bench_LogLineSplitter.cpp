@@ -0,0 +1,50 @@
+#include "bench_framework.h"
+#include "../src/LogLineSplitter.h"
+
+namespace {
+
+// A realistic mix of dropbear -E output, fed in read()-sized chunks
+std::string sampleLog() {
+    const char* lines[] = {
+        "[1234] Jan 01 12:00:00 Child connection from 192.168.1.2:51234\n",
+        "[1234] Jan 01 12:00:01 Password auth succeeded for 'root' from 192.168.1.2:51234\n",
+        "[1240] Jan 01 12:00:02 Bad password attempt for 'admin' from 203.0.113.9:5555\n",
+        "[1234] Jan 01 12:10:00 Exit (root) from <192.168.1.2:51234>: Disconnect received\n",
+    };
+    std::string out;
+    while (out.size() < 64 * 1024) {
+        for (const char* l : lines) out += l;
+    }
+    return out;
+}
+
+} // namespace
+
+void registerLogLineSplitterBenchmarks(BenchRunner& runner) {
+    // DropbearManager::pumpLogs reads up to 1 KiB at a time
+    runner.addBenchmark("LogLineSplitter::feed 1 KiB chunk", []() {
+        static const std::string log = sampleLog();
+        static size_t offset = 0;
+        static LogLineSplitter splitter;
+        static size_t lines = 0;
+        static const LogLineSplitter::LineCallback count =
+            [](const std::string&) { ++lines; };
+
+        if (offset + 1024 > log.size()) offset = 0;
+        splitter.feed(log.data() + offset, 1024, count);
+        offset += 1024;
+        benchDoNotOptimize(lines);
+    });
+
+    runner.addBenchmark("LogLineSplitter::feed single line", []() {
+        static LogLineSplitter splitter;
+        static const std::string line =
+            "[1234] Jan 01 12:00:00 Child connection from 192.168.1.2:51234\n";
+        static size_t lines = 0;
+        static const LogLineSplitter::LineCallback count =
+            [](const std::string&) { ++lines; };
+
+        splitter.feed(line.data(), line.size(), count);
+        benchDoNotOptimize(lines);
+    });
+}
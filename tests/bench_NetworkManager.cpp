@@ -0,0 +1,17 @@
+#include "bench_framework.h"
+#include "../src/NetworkManager.h"
+
+void registerNetworkManagerBenchmarks(BenchRunner& runner) {
+    // Runs every IP_REFRESH_PERIOD_MS on the UI thread
+    runner.addBenchmark("NetworkManager::getIPv4Addresses", []() {
+        NetworkManager manager;
+        auto addrs = manager.getIPv4Addresses();
+        benchDoNotOptimize(addrs);
+    });
+
+    runner.addBenchmark("NetworkManager::getSystemUsers", []() {
+        NetworkManager manager;
+        auto users = manager.getSystemUsers();
+        benchDoNotOptimize(users);
+    });
+}
@@ -0,0 +1,19 @@
+#include "bench_framework.h"
+#include "../src/PathHelper.h"
+
+void registerPathHelperBenchmarks(BenchRunner& runner) {
+    runner.addBenchmark("PathHelper::appBaseDir", []() {
+        std::string dir = PathHelper::appBaseDir();
+        benchDoNotOptimize(dir);
+    });
+
+    runner.addBenchmark("PathHelper::bundledDropbearPath", []() {
+        std::string path = PathHelper::bundledDropbearPath();
+        benchDoNotOptimize(path);
+    });
+
+    runner.addBenchmark("PathHelper::hostKeyPath", []() {
+        std::string path = PathHelper::hostKeyPath();
+        benchDoNotOptimize(path);
+    });
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Provided by bench_alloc.cpp, which replaces global operator new/delete
+uint64_t benchAllocationCount();
+
+// Keeps the optimizer from discarding a benchmarked result
+template <typename T>
+inline void benchDoNotOptimize(const T& value) {
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+// Micro-benchmark runner, sibling of TestRunner: each body is one operation,
+// repeated with warmup and an auto-calibrated iteration count.
+class BenchRunner {
+public:
+    using BenchFunc = std::function<void()>;
+
+    struct Result {
+        std::string name;
+        double ns_per_op;
+        double allocs_per_op;
+        uint64_t iterations;
+    };
+
+    void addBenchmark(const std::string& name, BenchFunc func) {
+        benches_.push_back({name, func});
+    }
+
+    // Arguments: [--filter TEXT] [--baseline FILE] [--update-baseline] [--threshold PCT]
+    int run(int argc, char* argv[]) {
+        std::string filter, baselinePath;
+        bool updateBaseline = false;
+        double thresholdPct = 20.0;
+
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--filter" && i + 1 < argc) filter = argv[++i];
+            else if (arg == "--baseline" && i + 1 < argc) baselinePath = argv[++i];
+            else if (arg == "--threshold" && i + 1 < argc) thresholdPct = std::stod(argv[++i]);
+            else if (arg == "--update-baseline") updateBaseline = true;
+        }
+
+        std::map<std::string, Result> baseline;
+        if (!baselinePath.empty() && !updateBaseline) baseline = loadBaseline(baselinePath);
+
+        std::vector<Result> results;
+        int regressions = 0;
+
+        std::printf("%-52s %12s %10s %10s  %s\n", "benchmark", "ns/op", "allocs/op", "iters", "vs baseline");
+        for (const auto& bench : benches_) {
+            if (!filter.empty() && bench.name.find(filter) == std::string::npos) continue;
+
+            Result r = measure(bench);
+            results.push_back(r);
+
+            std::string verdict = "-";
+            auto it = baseline.find(r.name);
+            if (it != baseline.end()) {
+                const Result& base = it->second;
+                double deltaPct = base.ns_per_op > 0
+                    ? (r.ns_per_op - base.ns_per_op) * 100.0 / base.ns_per_op : 0.0;
+                bool slower = deltaPct > thresholdPct;
+                bool moreAllocs = r.allocs_per_op > base.allocs_per_op + 0.5;
+                char buf[64];
+                std::snprintf(buf, sizeof(buf), "%+.1f%%", deltaPct);
+                verdict = buf;
+                if (slower || moreAllocs) {
+                    verdict += moreAllocs ? " REGRESSION (allocs)" : " REGRESSION";
+                    regressions++;
+                }
+            }
+
+            std::printf("%-52s %12.1f %10.2f %10llu  %s\n", r.name.c_str(), r.ns_per_op,
+                        r.allocs_per_op, static_cast<unsigned long long>(r.iterations),
+                        verdict.c_str());
+        }
+
+        if (updateBaseline && !baselinePath.empty()) {
+            saveBaseline(baselinePath, results);
+            std::cout << "\nBaseline written to " << baselinePath << std::endl;
+            return 0;
+        }
+
+        if (!baselinePath.empty() && baseline.empty()) {
+            std::cout << "\nNo baseline at " << baselinePath
+                      << " (create one with --update-baseline)" << std::endl;
+        }
+
+        std::cout << "\n========================================\n";
+        std::cout << "Benchmarks run: " << results.size() << std::endl;
+        std::cout << "Regressions (>" << thresholdPct << "%): " << regressions << std::endl;
+        std::cout << "========================================\n";
+        return regressions == 0 ? 0 : 1;
+    }
+
+private:
+    struct Bench {
+        std::string name;
+        BenchFunc func;
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr double kWarmupNs = 20e6;     // 20 ms
+    static constexpr double kSampleNs = 50e6;     // 50 ms per sample
+    static constexpr int kSamples = 5;
+
+    static double runBatch(const BenchFunc& func, uint64_t iterations) {
+        auto start = Clock::now();
+        for (uint64_t i = 0; i < iterations; ++i) func();
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    }
+
+    static Result measure(const Bench& bench) {
+        // Warmup doubles as calibration: grow the batch until it takes long enough
+        uint64_t iterations = 1;
+        double elapsed = runBatch(bench.func, iterations);
+        while (elapsed < kWarmupNs && iterations < (1ULL << 40)) {
+            iterations *= 2;
+            elapsed = runBatch(bench.func, iterations);
+        }
+        const double estimate = elapsed / iterations;
+        iterations = std::max<uint64_t>(1, static_cast<uint64_t>(kSampleNs / std::max(estimate, 1.0)));
+
+        std::vector<double> samples;
+        const uint64_t allocsBefore = benchAllocationCount();
+        for (int s = 0; s < kSamples; ++s) {
+            samples.push_back(runBatch(bench.func, iterations) / iterations);
+        }
+        const uint64_t allocs = benchAllocationCount() - allocsBefore;
+
+        std::sort(samples.begin(), samples.end());
+        return {bench.name, samples[samples.size() / 2],
+                static_cast<double>(allocs) / (iterations * kSamples), iterations};
+    }
+
+    static std::map<std::string, Result> loadBaseline(const std::string& path) {
+        std::map<std::string, Result> out;
+        std::ifstream in(path);
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            std::istringstream fields(line);
+            Result r{};
+            std::string ns, allocs;
+            if (std::getline(fields, r.name, '\t') && std::getline(fields, ns, '\t') &&
+                std::getline(fields, allocs, '\t')) {
+                r.ns_per_op = std::stod(ns);
+                r.allocs_per_op = std::stod(allocs);
+                out[r.name] = r;
+            }
+        }
+        return out;
+    }
+
+    static void saveBaseline(const std::string& path, const std::vector<Result>& results) {
+        std::ofstream out(path, std::ios::trunc);
+        out << "# name\tns_per_op\tallocs_per_op (regenerate with: make bench-baseline)\n";
+        for (const auto& r : results) {
+            out << r.name << '\t' << r.ns_per_op << '\t' << r.allocs_per_op << '\n';
+        }
+    }
+
+    std::vector<Bench> benches_;
+};
@@ -0,0 +1,19 @@
+#include "bench_framework.h"
+
+// External benchmark declarations
+void registerPathHelperBenchmarks(BenchRunner& runner);
+void registerNetworkManagerBenchmarks(BenchRunner& runner);
+void registerLogLineSplitterBenchmarks(BenchRunner& runner);
+void registerAuthGuardBenchmarks(BenchRunner& runner);
+
+int main(int argc, char* argv[]) {
+    BenchRunner runner;
+
+    // Register all benchmark suites
+    registerPathHelperBenchmarks(runner);
+    registerNetworkManagerBenchmarks(runner);
+    registerLogLineSplitterBenchmarks(runner);
+    registerAuthGuardBenchmarks(runner);
+
+    return runner.run(argc, argv);
+}
@@ -0,0 +1,115 @@
+#include "test_framework.h"
+#include "../src/AllocStats.h"
+#include "../src/Constants.h"
+#include "../src/DropbearManager.h"
+#include "../src/LogHistory.h"
+#include "../src/LogLineSplitter.h"
+#include "../src/Metrics.h"
+#include "../src/NetworkManager.h"
+#include "../src/SshProbe.h"
+#include <unistd.h>
+#include <cstring>
+#include <memory>
+#include <string>
+
+// The test binary always links AllocStats.cpp with -DALLOC_STATS (see the
+// Makefile), so operator new is counted here just as in an instrumented app.
+void registerAllocStatsTests(TestRunner& runner) {
+    // Test allocations are charged to the innermost scope, which then restores
+    runner.addTest("AllocStats charges allocations to the current scope", []() {
+        ASSERT_TRUE(AllocStats::enabled());
+        const AllocStats::Totals before = AllocStats::snapshot();
+        {
+            AllocStats::Scope events(AllocStats::Events);
+            std::unique_ptr<int> a(new int(1));
+            {
+                AllocStats::Scope render(AllocStats::Render);
+                std::unique_ptr<char[]> b(new char[100]);
+            }
+            std::unique_ptr<int> c(new int(2));
+        }
+        const AllocStats::Totals d = AllocStats::delta(before, AllocStats::snapshot());
+        ASSERT_EQ(2u, d.by[AllocStats::Events].allocs);
+        ASSERT_EQ(2 * sizeof(int), d.by[AllocStats::Events].bytes);
+        ASSERT_EQ(1u, d.by[AllocStats::Render].allocs);
+        ASSERT_EQ(100u, d.by[AllocStats::Render].bytes);
+        ASSERT_EQ(0u, d.by[AllocStats::Network].allocs);
+        ASSERT_EQ(3u, d.total().allocs);
+    });
+
+    // Test subsystem names used as metric labels
+    runner.addTest("AllocStats names subsystems", []() {
+        ASSERT_STR_EQ(std::string("events"), AllocStats::name(AllocStats::Events));
+        ASSERT_STR_EQ(std::string("dropbear"), AllocStats::name(AllocStats::Dropbear));
+        ASSERT_STR_EQ(std::string("other"), AllocStats::name(AllocStats::Other));
+    });
+
+    // Test a warmed-up splitter emits same-sized lines without allocating
+    runner.addTest("LogLineSplitter steady state does not allocate", []() {
+        LogLineSplitter splitter;
+        size_t seen = 0;
+        const LogLineSplitter::LineCallback onLine = [&](const std::string& l) { seen += l.size(); };
+        const char* chunk = "[1234] Jan 01 00:00:00 Child connection from 192.168.1.20:51234\n";
+        const size_t len = std::strlen(chunk);
+        for (int i = 0; i < 4; ++i) splitter.feed(chunk, len, onLine);
+
+        const AllocStats::Totals before = AllocStats::snapshot();
+        for (int i = 0; i < 1000; ++i) splitter.feed(chunk, len, onLine);
+        const AllocStats::Totals d = AllocStats::delta(before, AllocStats::snapshot());
+        ASSERT_EQ(0u, d.total().allocs);
+        ASSERT_EQ(1004 * (len - 1), seen);
+    });
+
+    // Test an idle frame (Application::run with no input, no log output and
+    // no IP refresh due) does not allocate: log pump and health check on an
+    // attached pipe, power save session check, log view refresh and the frame
+    // counters. The periodic status refresh (refreshIPAddrs, sampleRtt,
+    // refreshStatus) builds its lines as strings and is excluded; it runs
+    // once per Network::IP_REFRESH_PERIOD_MS, not per frame.
+    runner.addTest("Idle frame does not allocate", []() {
+        DropbearManager dropbear([](const std::string&) {});
+        int logPipe[2];
+        ASSERT_TRUE(pipe(logPipe) == 0);
+        dropbear.attachLogSource(logPipe[0]);
+
+        NetworkManager network(WifiPowerSave::command("true"));
+        NetworkManager::PowerSaveSettings powerSave;
+        powerSave.manage = true;
+        powerSave.interface = "wlan0";
+        network.configurePowerSave(powerSave, 0);
+
+        LogHistory history;
+        for (int i = 0; i < 500; ++i) history.append("[1234] Jan 01 00:00:00 line " + std::to_string(i));
+        std::vector<std::string> view(LogDisplay::VIEW_LINES);
+        const auto refreshView = [&]() {
+            const uint64_t top = history.end() - view.size();
+            for (uint64_t i = top; i < history.end(); ++i) history.line(i, view[static_cast<size_t>(i - top)]);
+        };
+
+        SshProbe probe;
+        SshProbe::Settings settings;
+        settings.interval_secs = 5;
+        probe.configure(settings);
+        probe.reset(1000000);
+        Metrics::Metric& frames = Metrics::global().counter("alloc_test_frames_total", "test");
+        Metrics::Metric& last = Metrics::global().gauge("alloc_test_last_frame", "test");
+
+        const auto frame = [&](uint64_t n) {
+            dropbear.pumpLogs();
+            dropbear.checkHealth();
+            ASSERT_TRUE(network.updateSessions(dropbear.activeSessions(), n).empty());
+            refreshView();
+            ASSERT_TRUE(probe.poll(1000000 + n * 1000) == SshProbe::Result::None);
+            ASSERT_TRUE(probe.health() == SshProbe::Health::Unknown);
+            frames.inc();
+            last.set(static_cast<int64_t>(n));
+        };
+        for (uint64_t n = 0; n < 4; ++n) frame(n);   // first copies size the view's buffers
+
+        const AllocStats::Totals before = AllocStats::snapshot();
+        for (uint64_t n = 4; n < 1000; ++n) frame(n);
+        const AllocStats::Totals d = AllocStats::delta(before, AllocStats::snapshot());
+        ASSERT_EQ(0u, d.total().allocs);
+        close(logPipe[1]);
+    });
+}
@@ -0,0 +1,88 @@
+#include "test_framework.h"
+#include "../src/AuthGuard.h"
+
+namespace {
+
+AuthGuard::Settings settings(int maxFailures, int halfLife, int blockSecs) {
+    AuthGuard::Settings s;
+    s.max_failures = maxFailures;
+    s.decay_half_life_secs = halfLife;
+    s.block_secs = blockSecs;
+    return s;
+}
+
+} // namespace
+
+void registerAuthGuardTests(TestRunner& runner) {
+    // Test threshold blocking
+    runner.addTest("AuthGuard blocks after max failures", []() {
+        AuthGuard guard(settings(3, 300, 600));
+        ASSERT_FALSE(guard.recordFailure("10.0.0.1", 100));
+        ASSERT_FALSE(guard.recordFailure("10.0.0.1", 101));
+        ASSERT_FALSE(guard.isBlocked("10.0.0.1", 101));
+        ASSERT_TRUE(guard.recordFailure("10.0.0.1", 102));
+        ASSERT_TRUE(guard.isBlocked("10.0.0.1", 102));
+        ASSERT_FALSE(guard.isBlocked("10.0.0.2", 102));
+    });
+
+    // Test block expiry
+    runner.addTest("AuthGuard block expires after block time", []() {
+        AuthGuard guard(settings(1, 300, 60));
+        ASSERT_TRUE(guard.recordFailure("10.0.0.1", 1000));
+        ASSERT_TRUE(guard.isBlocked("10.0.0.1", 1059));
+        ASSERT_FALSE(guard.isBlocked("10.0.0.1", 1060));
+    });
+
+    // Test decay
+    runner.addTest("AuthGuard failures decay over time", []() {
+        AuthGuard guard(settings(3, 60, 600));
+        guard.recordFailure("10.0.0.1", 0);
+        guard.recordFailure("10.0.0.1", 1);
+        // Two half-lives later the score is ~0.5, so one more failure stays below 3
+        ASSERT_FALSE(guard.recordFailure("10.0.0.1", 121));
+        ASSERT_FALSE(guard.isBlocked("10.0.0.1", 121));
+    });
+
+    // Test allowlist and denylist
+    runner.addTest("AuthGuard honours allowlist and denylist", []() {
+        AuthGuard::Settings s = settings(1, 300, 600);
+        s.allowlist = "192.168.1.0/24, 10.9.9.9";
+        s.denylist = "203.0.113.0/24";
+        AuthGuard guard(s);
+
+        ASSERT_FALSE(guard.recordFailure("192.168.1.50", 10));
+        ASSERT_FALSE(guard.isBlocked("192.168.1.50", 10));
+        ASSERT_TRUE(guard.isAllowlisted("10.9.9.9"));
+        ASSERT_FALSE(guard.isAllowlisted("10.9.9.8"));
+        ASSERT_TRUE(guard.isBlocked("203.0.113.77", 10));
+        ASSERT_FALSE(guard.isBlocked("203.0.114.77", 10));
+    });
+
+    // Test disabled guard
+    runner.addTest("AuthGuard with max_failures 0 never blocks", []() {
+        AuthGuard guard(settings(0, 300, 600));
+        for (int i = 0; i < 50; ++i) ASSERT_FALSE(guard.recordFailure("10.0.0.1", i));
+        ASSERT_FALSE(guard.isBlocked("10.0.0.1", 50));
+    });
+
+    // Test the table stays bounded and keeps blocks under churn
+    runner.addTest("AuthGuard survives more attackers than capacity", []() {
+        AuthGuard guard(settings(2, 300, 600));
+        guard.recordFailure("198.51.100.1", 0);
+        guard.recordFailure("198.51.100.1", 0);
+        ASSERT_TRUE(guard.isBlocked("198.51.100.1", 0));
+
+        // One failure each from many distinct addresses
+        for (int i = 0; i < 20000; ++i) {
+            std::string ip = "10." + std::to_string((i >> 16) & 255) + "." +
+                             std::to_string((i >> 8) & 255) + "." + std::to_string(i & 255);
+            guard.recordFailure(ip, 1);
+        }
+
+        // Single-failure entries are recycled before blocked ones
+        ASSERT_TRUE(guard.isBlocked("198.51.100.1", 1));
+        AuthGuard::Stats stats = guard.stats(1);
+        ASSERT_TRUE(stats.tracked <= AuthGuard::CAPACITY);
+        ASSERT_EQ(1u, stats.blocked);
+    });
+}
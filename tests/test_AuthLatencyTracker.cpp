@@ -0,0 +1,70 @@
+#include "test_framework.h"
+#include "../src/AuthLatencyTracker.h"
+
+void registerAuthLatencyTrackerTests(TestRunner& runner) {
+    // Test connection -> auth -> exit correlation by pid
+    runner.addTest("AuthLatencyTracker correlates events by pid", []() {
+        AuthLatencyTracker t;
+        t.onConnection(100, "10.0.0.1", 1000000);
+        t.onConnection(200, "10.0.0.2", 1100000);
+        t.onAuthSuccess(200, 1400000);   // 300 ms
+        t.onAuthSuccess(100, 1800000);   // 800 ms
+        t.onSessionExit(100, 11800000);  // 10 s session
+
+        ASSERT_EQ(2u, t.timeToAuth().count());
+        ASSERT_EQ(800000u, t.timeToAuth().maxMicros());
+        ASSERT_EQ(1u, t.sessionLength().count());
+        ASSERT_EQ(1u, t.pendingCount());
+    });
+
+    // Test unmatched and duplicate events are ignored
+    runner.addTest("AuthLatencyTracker ignores unknown pids and repeats", []() {
+        AuthLatencyTracker t;
+        t.onAuthSuccess(42, 1000);
+        t.onSessionExit(42, 2000);
+        t.onConnection(7, "10.0.0.1", 0);
+        t.onAuthSuccess(7, 5000);
+        t.onAuthSuccess(7, 9000);
+        ASSERT_EQ(1u, t.timeToAuth().count());
+    });
+
+    // Test pre-auth exits leave no latency sample
+    runner.addTest("AuthLatencyTracker::forget drops pending connection", []() {
+        AuthLatencyTracker t;
+        t.onConnection(7, "10.0.0.1", 0);
+        t.forget(7);
+        t.onAuthSuccess(7, 5000);
+        ASSERT_EQ(0u, t.timeToAuth().count());
+        ASSERT_EQ(0u, t.pendingCount());
+    });
+
+    // Test per-client summaries, most recent first
+    runner.addTest("AuthLatencyTracker keeps per-client histograms", []() {
+        AuthLatencyTracker t;
+        int pid = 1;
+        for (int i = 0; i < 3; ++i, ++pid) {
+            t.onConnection(pid, "10.0.0.1", 0);
+            t.onAuthSuccess(pid, 100000);
+        }
+        t.onConnection(pid, "10.0.0.2", 200000);
+        t.onAuthSuccess(pid, 2200000);
+
+        auto clients = t.clientSummaries(5);
+        ASSERT_EQ(2u, clients.size());
+        ASSERT_STR_EQ("10.0.0.2", clients[0].client_ip);
+        ASSERT_EQ(1u, clients[0].count);
+        ASSERT_EQ(3u, clients[1].count);
+        ASSERT_TRUE(clients[1].p99_us <= 100000);
+    });
+
+    // Test bounded state under connection floods
+    runner.addTest("AuthLatencyTracker bounds pending connections", []() {
+        AuthLatencyTracker t;
+        for (int pid = 1; pid <= 5000; ++pid) t.onConnection(pid, "203.0.113.9", pid);
+        ASSERT_EQ(AuthLatencyTracker::MAX_PENDING, t.pendingCount());
+
+        // Newest connections survive eviction
+        t.onAuthSuccess(5000, 6000);
+        ASSERT_EQ(1u, t.timeToAuth().count());
+    });
+}
@@ -0,0 +1,52 @@
+#include "test_framework.h"
+#include "../src/BitmapFont.h"
+
+namespace {
+
+// Three glyphs ('>', '?', '@') in a 16x2 strip: '?' lights its first and
+// last column on row 0, '@' its last column on row 1
+const uint8_t kBits[] = {
+    0x00, 0x90,
+    0x00, 0x02,
+};
+
+const BitmapFont::Glyph kGlyphs[] = {
+    {0, 0, 0, 3},    // '>' blank
+    {8, 4, 0, 5},    // '?'
+    {12, 3, -1, 4},  // '@'
+};
+
+const BitmapFont::Face kFace = {'>', 3, 2, 2, 16, kGlyphs, kBits};
+
+} // namespace
+
+void registerBitmapFontTests(TestRunner& runner) {
+    // Test glyph lookup and the '?' fallback outside the baked range
+    runner.addTest("BitmapFont maps characters to glyphs", []() {
+        ASSERT_EQ(3, BitmapFont::glyph(kFace, '>').advance);
+        ASSERT_EQ(4, BitmapFont::glyph(kFace, '@').advance);
+        ASSERT_EQ(5, BitmapFont::glyph(kFace, 'A').advance);
+        ASSERT_EQ(5, BitmapFont::glyph(kFace, '\xe9').advance);
+        ASSERT_EQ(5, BitmapFont::glyph(kFace, '\n').advance);
+    });
+
+    // Test MSB-first bit addressing and bounds
+    runner.addTest("BitmapFont reads atlas pixels", []() {
+        ASSERT_TRUE(BitmapFont::pixel(kFace, 8, 0));
+        ASSERT_FALSE(BitmapFont::pixel(kFace, 9, 0));
+        ASSERT_TRUE(BitmapFont::pixel(kFace, 11, 0));
+        ASSERT_TRUE(BitmapFont::pixel(kFace, 14, 1));
+        ASSERT_FALSE(BitmapFont::pixel(kFace, 14, 0));
+        ASSERT_FALSE(BitmapFont::pixel(kFace, -1, 0));
+        ASSERT_FALSE(BitmapFont::pixel(kFace, 16, 0));
+        ASSERT_FALSE(BitmapFont::pixel(kFace, 8, 2));
+        ASSERT_EQ(2u, BitmapFont::rowBytes(kFace));
+    });
+
+    // Test text width sums advances, including fallback glyphs
+    runner.addTest("BitmapFont measures text by advance", []() {
+        ASSERT_EQ(0, BitmapFont::textWidth(kFace, ""));
+        ASSERT_EQ(3 + 5 + 4, BitmapFont::textWidth(kFace, ">?@"));
+        ASSERT_EQ(5 + 5, BitmapFont::textWidth(kFace, "xy"));
+    });
+}
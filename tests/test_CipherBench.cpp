@@ -0,0 +1,106 @@
+#include "test_framework.h"
+#include "../src/CipherBench.h"
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string tempPath(const std::string& name) {
+    return "/tmp/dropbear_app_test_" + std::to_string(getpid()) + "_" + name;
+}
+
+// Stands in for the bundled cipher-bench helper
+std::string writeHelper(const std::string& name, const std::string& body) {
+    const std::string path = tempPath(name);
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) return path;
+    fputs(("#!/bin/sh\n" + body).c_str(), f);
+    fclose(f);
+    chmod(path.c_str(), 0755);
+    return path;
+}
+
+CipherBench::Report sampleReport() {
+    CipherBench::Report report;
+    report.cpu = CipherBench::cpuSignature();
+    report.ciphers = {{"aes128-ctr", 40}, {"aes256-ctr", 30}, {"chacha20-poly1305@openssh.com", 35}};
+    report.macs = {{"hmac-sha1", 60}, {"hmac-sha2-256", 120}};
+    return report;
+}
+
+} // namespace
+
+void registerCipherBenchTests(TestRunner& runner) {
+    // Test non-AEAD ciphers are charged the best MAC before ranking
+    runner.addTest("CipherBench ranks ciphers with their MAC cost", []() {
+        const CipherBench::Report report = sampleReport();
+        const std::vector<CipherBench::Measurement> ciphers = CipherBench::rankCiphers(report);
+        ASSERT_EQ(3u, ciphers.size());
+        // aes128 40 MiB/s with a 120 MiB/s MAC is 30, below chacha20-poly1305's 35
+        ASSERT_STR_EQ(std::string("chacha20-poly1305@openssh.com"), ciphers[0].name);
+        ASSERT_STR_EQ(std::string("aes128-ctr"), ciphers[1].name);
+        ASSERT_TRUE(ciphers[1].mib_per_sec > 29.9 && ciphers[1].mib_per_sec < 30.1);
+        ASSERT_STR_EQ(std::string("-c chacha20-poly1305@openssh.com,aes128-ctr,aes256-ctr -m hmac-sha2-256,hmac-sha1"),
+                      CipherBench::clientOptions(report));
+        const std::vector<std::string> lines = CipherBench::describe(report);
+        ASSERT_EQ(3u, lines.size());
+        ASSERT_TRUE(lines[0].compare(0, 40, "Fastest cipher: chacha20-poly1305 (35 Mi") == 0);
+    });
+
+    // Test the cache round-trips and is ignored when the CPU differs
+    runner.addTest("CipherBench cache is keyed by CPU", []() {
+        const std::string path = tempPath("cipher_bench.txt");
+        CipherBench::Report report = sampleReport();
+        std::string error;
+        ASSERT_TRUE(CipherBench::save(report, path, error));
+        CipherBench::Report loaded;
+        ASSERT_TRUE(CipherBench::load(path, loaded));
+        ASSERT_STR_EQ(report.cpu, loaded.cpu);
+        ASSERT_EQ(3u, loaded.ciphers.size());
+        ASSERT_STR_EQ(std::string("hmac-sha2-256"), loaded.macs[1].name);
+        ASSERT_TRUE(loaded.macs[1].mib_per_sec == 120);
+
+        report.cpu = "other-cpu hwcap=0x0 hwcap2=0x0";
+        ASSERT_TRUE(CipherBench::save(report, path, error));
+        ASSERT_FALSE(CipherBench::load(path, loaded));
+        unlink(path.c_str());
+        ASSERT_FALSE(CipherBench::load(path, loaded));
+    });
+
+    // Test the helper's lines become a report for this CPU
+    runner.addTest("CipherBench run parses the helper's output", []() {
+        const std::string helper = writeHelper("cipher_bench_ok",
+            "[ \"$1\" = 5 ] || exit 2\n"
+            "echo 'cipher aes128-ctr 40.00'\n"
+            "echo 'cipher chacha20-poly1305@openssh.com 35.50'\n"
+            "echo 'mac hmac-sha1 60.00'\n");
+        CipherBench::Report report;
+        std::string error;
+        ASSERT_TRUE(CipherBench::run(helper, 5, report, error));
+        ASSERT_EQ(2u, report.ciphers.size());
+        ASSERT_EQ(1u, report.macs.size());
+        ASSERT_STR_EQ(std::string("chacha20-poly1305@openssh.com"), report.ciphers[1].name);
+        ASSERT_TRUE(report.ciphers[1].mib_per_sec == 35.5);
+        ASSERT_STR_EQ(CipherBench::cpuSignature(), report.cpu);
+        unlink(helper.c_str());
+    });
+
+    // Test a failing, silent or missing helper is an error, not an empty report
+    runner.addTest("CipherBench run reports helper failures", []() {
+        const std::string failing = writeHelper("cipher_bench_fail", "echo 'cipher aes128-ctr 40.00'\nexit 3\n");
+        const std::string silent = writeHelper("cipher_bench_silent", "echo 'cipher aes128-ctr 40.00'\n");
+        CipherBench::Report report;
+        std::string error;
+        ASSERT_FALSE(CipherBench::run(failing, 5, report, error));
+        ASSERT_TRUE(error.find("status 3") != std::string::npos);
+        ASSERT_FALSE(CipherBench::run(silent, 5, report, error));
+        ASSERT_TRUE(error.find("no MACs") != std::string::npos);
+        ASSERT_FALSE(CipherBench::run(tempPath("cipher_bench_missing"), 5, report, error));
+        ASSERT_TRUE(report.ciphers.empty());
+        unlink(failing.c_str());
+        unlink(silent.c_str());
+    });
+}
@@ -0,0 +1,270 @@
+#include "test_framework.h"
+#include "../src/DeltaSync.h"
+#include "../src/SyncProtocol.h"
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+
+namespace {
+
+std::string tempDir(const std::string& name) {
+    return "/tmp/dropbear_app_test_" + std::to_string(getpid()) + "_" + name;
+}
+
+std::string randomBytes(size_t n, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::string s(n, '\0');
+    for (auto& c : s) c = static_cast<char>(rng());
+    return s;
+}
+
+void writeFile(const std::string& path, const std::string& data) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return;
+    fwrite(data.data(), 1, data.size(), f);
+    fclose(f);
+}
+
+std::string readFile(const std::string& path) {
+    std::string out;
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return out;
+    char buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+    fclose(f);
+    return out;
+}
+
+void removeTree(const std::string& path) {
+    std::string cmd = "rm -rf '" + path + "'";
+    if (system(cmd.c_str()) != 0) {}
+}
+
+// Collects a delta in memory and replays it against the old buffer
+class MemorySink : public DeltaSync::Sink {
+public:
+    MemorySink(const std::string& old, uint32_t blockSize) : old_(old), bs_(blockSize) {}
+    bool copyBlocks(uint64_t first, uint64_t count) override {
+        const size_t from = static_cast<size_t>(first * bs_);
+        out += old_.substr(from, static_cast<size_t>(count * bs_));
+        copied += count;
+        return true;
+    }
+    bool literal(const char* data, size_t len) override {
+        out.append(data, len);
+        literalBytes += len;
+        return true;
+    }
+    std::string out;
+    uint64_t copied = 0;
+    size_t literalBytes = 0;
+
+private:
+    const std::string& old_;
+    uint32_t bs_;
+};
+
+bool runPush(const std::string& src, const std::string& dst, bool checksum,
+             SyncProtocol::Stats& stats, unsigned threads = 3, size_t readSize = 64 * 1024) {
+    int toServer[2], toClient[2];
+    if (pipe(toServer) != 0 || pipe(toClient) != 0) return false;
+    bool served = false;
+    std::thread server([&]() {
+        std::string error;
+        served = SyncProtocol::serve(toServer[0], toClient[1], dst, error);
+        close(toClient[1]);
+    });
+    SyncProtocol::Options options;
+    options.checksum = checksum;
+    options.sign.threads = threads;
+    options.sign.read_size = readSize;
+    std::string error;
+    const bool pushed = SyncProtocol::push(toClient[0], toServer[1], src, options, stats, error);
+    close(toServer[1]);
+    server.join();
+    close(toServer[0]);
+    close(toClient[0]);
+    return pushed && served;
+}
+
+} // namespace
+
+void registerDeltaSyncTests(TestRunner& runner) {
+    // Test the rolling update matches a full recomputation at every offset
+    runner.addTest("DeltaSync rolling checksum matches recomputation", []() {
+        const std::string data = randomBytes(5000, 1);
+        const size_t window = 700;
+        uint32_t weak = DeltaSync::weakChecksum(data.data(), window);
+        for (size_t pos = 0; pos + window < data.size(); ++pos) {
+            weak = DeltaSync::rollWeak(weak, static_cast<unsigned char>(data[pos]),
+                                       static_cast<unsigned char>(data[pos + window]), window);
+            ASSERT_EQ(DeltaSync::weakChecksum(data.data() + pos + 1, window), weak);
+        }
+    });
+
+    // Test the streaming hash doesn't depend on how input is chunked
+    runner.addTest("DeltaSync hasher is chunking independent", []() {
+        const std::string data = randomBytes(1001, 2);
+        DeltaSync::Hasher h;
+        for (size_t off = 0; off < data.size(); off += 7) {
+            h.update(data.data() + off, std::min<size_t>(7, data.size() - off));
+        }
+        ASSERT_TRUE(h.digest() == DeltaSync::strongHash(data.data(), data.size()));
+        ASSERT_FALSE(DeltaSync::strongHash(data.data(), 1000) == DeltaSync::strongHash(data.data(), 1001));
+        ASSERT_FALSE(DeltaSync::strongHash("", 0) == DeltaSync::strongHash("\0", 1));
+    });
+
+    // Test block size grows with the file and stays within bounds
+    runner.addTest("DeltaSync picks block sizes", []() {
+        ASSERT_EQ(DeltaSync::MIN_BLOCK, DeltaSync::blockSizeFor(0));
+        ASSERT_EQ(DeltaSync::MIN_BLOCK, DeltaSync::blockSizeFor(1000));
+        ASSERT_EQ(32u * 1024, DeltaSync::blockSizeFor(1024ull * 1024 * 1024));
+        ASSERT_EQ(DeltaSync::MAX_BLOCK, DeltaSync::blockSizeFor(1ull << 40));
+    });
+
+    // Test a delta reproduces edits: insertion, overwrite, deletion, new tail
+    runner.addTest("DeltaSync diff reproduces an edited file", []() {
+        const std::string old = randomBytes(200000, 3);
+        std::string now = old;
+        now.insert(1000, "inserted bytes shift everything after them");
+        now.replace(90000, 500, randomBytes(500, 4));
+        now.erase(150000, 3000);
+        now += "appended tail";
+
+        const DeltaSync::Signature sig = DeltaSync::signBuffer(old.data(), old.size(), 2048);
+        MemorySink sink(old, sig.block_size);
+        ASSERT_TRUE(DeltaSync::diff(sig, now.data(), now.size(), sink));
+        ASSERT_TRUE(sink.out == now);
+        ASSERT_TRUE(sink.literalBytes < 10000);
+    });
+
+    // Test unchanged data becomes block references only, short last block included
+    runner.addTest("DeltaSync diff of identical data sends no literals", []() {
+        const std::string old = randomBytes(10000, 5);
+        const DeltaSync::Signature sig = DeltaSync::signBuffer(old.data(), old.size(), 2048);
+        MemorySink sink(old, sig.block_size);
+        ASSERT_TRUE(DeltaSync::diff(sig, old.data(), old.size(), sink));
+        ASSERT_TRUE(sink.out == old);
+        ASSERT_EQ(0u, sink.literalBytes);
+    });
+
+    // Test parallel file signatures equal the single-threaded ones
+    runner.addTest("DeltaSync signs files in parallel", []() {
+        const std::string dir = tempDir("sign");
+        removeTree(dir);
+        mkdir(dir.c_str(), 0755);
+        std::vector<std::string> paths;
+        std::vector<std::string> contents;
+        for (int i = 0; i < 5; ++i) {
+            contents.push_back(randomBytes(static_cast<size_t>(50000 * i + 123), 10 + i));
+            paths.push_back(dir + "/f" + std::to_string(i));
+            writeFile(paths.back(), contents.back());
+        }
+        paths.push_back(dir + "/missing");
+
+        DeltaSync::SignOptions options;
+        options.threads = 4;
+        options.read_size = 16 * 1024;   // several chunks per file
+        std::vector<DeltaSync::Signature> sigs;
+        DeltaSync::SignStats stats;
+        std::string error;
+        ASSERT_TRUE(DeltaSync::sign(paths, sigs, options, &stats, error));
+        ASSERT_EQ(6u, sigs.size());
+        ASSERT_FALSE(sigs[5].exists);
+        ASSERT_EQ(4u, stats.threads);
+        for (int i = 0; i < 5; ++i) {
+            const DeltaSync::Signature ref = DeltaSync::signBuffer(
+                contents[i].data(), contents[i].size(), DeltaSync::blockSizeFor(contents[i].size()));
+            ASSERT_TRUE(sigs[i].exists);
+            ASSERT_EQ(ref.file_size, sigs[i].file_size);
+            ASSERT_EQ(ref.blocks.size(), sigs[i].blocks.size());
+            for (size_t b = 0; b < ref.blocks.size(); ++b) {
+                ASSERT_EQ(ref.blocks[b].weak, sigs[i].blocks[b].weak);
+                ASSERT_TRUE(ref.blocks[b].strong == sigs[i].blocks[b].strong);
+            }
+        }
+        removeTree(dir);
+    });
+
+    // Test a push creates the tree, a re-push is a no-op, an edit sends only the change
+    runner.addTest("SyncProtocol pushes only changed regions", []() {
+        const std::string src = tempDir("sync_src");
+        const std::string dst = tempDir("sync_dst");
+        removeTree(src);
+        removeTree(dst);
+        mkdir(src.c_str(), 0755);
+        mkdir((src + "/saves").c_str(), 0755);
+        mkdir(dst.c_str(), 0755);
+        const std::string rom = randomBytes(1024 * 1024, 20);
+        writeFile(src + "/game.rom", rom);
+        writeFile(src + "/saves/game.sav", randomBytes(8192, 21));
+        writeFile(src + "/empty", "");
+
+        SyncProtocol::Stats first;
+        ASSERT_TRUE(runPush(src, dst, false, first));
+        ASSERT_EQ(3u, first.updated);
+        ASSERT_EQ(0u, first.failed);
+        ASSERT_TRUE(readFile(dst + "/game.rom") == rom);
+        ASSERT_TRUE(readFile(dst + "/saves/game.sav") == readFile(src + "/saves/game.sav"));
+
+        SyncProtocol::Stats again;
+        ASSERT_TRUE(runPush(src, dst, false, again));
+        ASSERT_EQ(3u, again.up_to_date);
+        ASSERT_TRUE(again.wire_sent < 1024);
+
+        std::string edited = rom;
+        edited.replace(500000, 100, randomBytes(100, 22));
+        writeFile(src + "/game.rom", edited);
+        SyncProtocol::Stats delta;
+        ASSERT_TRUE(runPush(src, dst, true, delta));
+        ASSERT_EQ(1u, delta.updated);
+        ASSERT_EQ(2u, delta.up_to_date);
+        ASSERT_TRUE(readFile(dst + "/game.rom") == edited);
+        ASSERT_TRUE(delta.literal_bytes < 2 * DeltaSync::blockSizeFor(rom.size()));
+        ASSERT_TRUE(delta.wire_sent < rom.size() / 20);
+        ASSERT_TRUE(delta.server_hashed_bytes >= rom.size());
+
+        removeTree(src);
+        removeTree(dst);
+    });
+
+    // Test the server caps the client's signing threads and buffer size
+    runner.addTest("SyncProtocol limits client-requested signing resources", []() {
+        const std::string src = tempDir("sync_cap_src");
+        const std::string dst = tempDir("sync_cap_dst");
+        removeTree(src);
+        removeTree(dst);
+        mkdir(src.c_str(), 0755);
+        mkdir(dst.c_str(), 0755);
+        writeFile(src + "/game.sav", randomBytes(8192, 30));
+        writeFile(dst + "/game.sav", randomBytes(8192, 31));
+
+        // Unbounded, this would be 100000 threads with 2 GiB of buffers each
+        SyncProtocol::Stats stats;
+        ASSERT_TRUE(runPush(src, dst, true, stats, 100000, 1u << 30));
+        ASSERT_EQ(1u, stats.updated);
+        ASSERT_TRUE(stats.server_threads >= 1);
+        ASSERT_TRUE(stats.server_threads <= std::max(1u, std::thread::hardware_concurrency()));
+
+        removeTree(src);
+        removeTree(dst);
+    });
+
+    // Test paths that could escape the destination are rejected
+    runner.addTest("SyncProtocol rejects unsafe paths", []() {
+        ASSERT_TRUE(SyncProtocol::safeRelativePath("a/b.sav"));
+        ASSERT_FALSE(SyncProtocol::safeRelativePath("/etc/passwd"));
+        ASSERT_FALSE(SyncProtocol::safeRelativePath("../x"));
+        ASSERT_FALSE(SyncProtocol::safeRelativePath("a/../../x"));
+        ASSERT_FALSE(SyncProtocol::safeRelativePath("a//b"));
+        ASSERT_FALSE(SyncProtocol::safeRelativePath(""));
+        ASSERT_FALSE(SyncProtocol::safeRelativePath("a/"));
+    });
+}
@@ -0,0 +1,180 @@
+#include "test_framework.h"
+#include "../src/DropbearConfig.h"
+#include <algorithm>
+#include <sstream>
+
+namespace {
+
+DropbearConfig parseString(const std::string& text, std::vector<std::string>& warnings) {
+    std::istringstream in(text);
+    return DropbearConfig::parse(in, warnings);
+}
+
+bool hasArgPair(const std::vector<std::string>& args, const std::string& flag,
+                const std::string& value) {
+    auto it = std::find(args.begin(), args.end(), flag);
+    return it != args.end() && (it + 1) != args.end() && *(it + 1) == value;
+}
+
+} // namespace
+
+void registerDropbearConfigTests(TestRunner& runner) {
+    // Test defaults match the historical fixed launch arguments
+    runner.addTest("DropbearConfig defaults produce base arguments", []() {
+        DropbearConfig cfg;
+        auto args = cfg.toArgs("/tmp/key");
+        ASSERT_STR_EQ("dropbear", args[0]);
+        ASSERT_TRUE(std::find(args.begin(), args.end(), "-E") != args.end());
+        ASSERT_TRUE(std::find(args.begin(), args.end(), "-F") != args.end());
+        ASSERT_TRUE(hasArgPair(args, "-r", "/tmp/key"));
+        ASSERT_TRUE(hasArgPair(args, "-p", "22"));
+        ASSERT_TRUE(std::find(args.begin(), args.end(), "-W") == args.end());
+        ASSERT_TRUE(std::find(args.begin(), args.end(), "-s") == args.end());
+    });
+
+    // Test parsing of all supported keys
+    runner.addTest("DropbearConfig parses tuning keys", []() {
+        std::vector<std::string> warnings;
+        DropbearConfig cfg = parseString(
+            "# comment line\n"
+            "port = 2222\n"
+            "receive_window = 1048576   # 1 MiB\n"
+            "keepalive=30\n"
+            "idle_timeout = 600\n"
+            "max_auth_tries = 3\n"
+            "password_auth = no\n"
+            "root_login = false\n", warnings);
+
+        ASSERT_EQ(0u, warnings.size());
+        ASSERT_EQ(2222, cfg.port);
+        ASSERT_EQ(1048576, cfg.receive_window);
+        ASSERT_EQ(30, cfg.keepalive_secs);
+        ASSERT_EQ(600, cfg.idle_timeout_secs);
+        ASSERT_EQ(3, cfg.max_auth_tries);
+        ASSERT_FALSE(cfg.password_auth);
+        ASSERT_FALSE(cfg.root_login);
+    });
+
+    // Test conversion to dropbear flags
+    runner.addTest("DropbearConfig::toArgs maps settings to flags", []() {
+        DropbearConfig cfg;
+        cfg.receive_window = 524288;
+        cfg.keepalive_secs = 15;
+        cfg.max_auth_tries = 4;
+        cfg.password_auth = false;
+        auto args = cfg.toArgs("/tmp/key");
+
+        ASSERT_TRUE(hasArgPair(args, "-W", "524288"));
+        ASSERT_TRUE(hasArgPair(args, "-K", "15"));
+        ASSERT_TRUE(hasArgPair(args, "-T", "4"));
+        ASSERT_TRUE(std::find(args.begin(), args.end(), "-s") != args.end());
+        ASSERT_TRUE(std::find(args.begin(), args.end(), "-w") == args.end());
+        ASSERT_TRUE(std::find(args.begin(), args.end(), "-i") == args.end());
+
+        cfg.inetd = true;
+        args = cfg.toArgs("/tmp/key");
+        ASSERT_TRUE(std::find(args.begin(), args.end(), "-i") != args.end());
+    });
+
+    // Test invalid values keep defaults and warn
+    runner.addTest("DropbearConfig rejects out-of-range values", []() {
+        std::vector<std::string> warnings;
+        DropbearConfig cfg = parseString(
+            "port = 70000\n"
+            "receive_window = lots\n"
+            "password_auth = maybe\n", warnings);
+
+        ASSERT_EQ(3u, warnings.size());
+        ASSERT_EQ(22, cfg.port);
+        ASSERT_EQ(0, cfg.receive_window);
+        ASSERT_TRUE(cfg.password_auth);
+    });
+
+    // Test an explicit ui_nice = 0 is told apart from a missing key
+    runner.addTest("DropbearConfig records whether ui_nice was given", []() {
+        std::vector<std::string> warnings;
+        DropbearConfig cfg = parseString("port = 2222\n", warnings);
+        ASSERT_FALSE(cfg.ui_nice_set);
+
+        cfg = parseString("ui_nice = 0\n", warnings);
+        ASSERT_TRUE(cfg.ui_nice_set);
+        ASSERT_EQ(0, cfg.ui_nice);
+
+        cfg = parseString("ui_nice = 40\n", warnings);
+        ASSERT_FALSE(cfg.ui_nice_set);
+        ASSERT_EQ(1u, warnings.size());
+    });
+
+    // Test unknown keys and malformed lines
+    runner.addTest("DropbearConfig warns on unknown keys and missing '='", []() {
+        std::vector<std::string> warnings;
+        parseString("bogus = 1\njust some words\n\n", warnings);
+        ASSERT_EQ(2u, warnings.size());
+        ASSERT_TRUE(warnings[0].find("bogus") != std::string::npos);
+        ASSERT_TRUE(warnings[1].find("line 2") != std::string::npos);
+    });
+
+    // Test missing file falls back to defaults
+    runner.addTest("DropbearConfig::loadFile missing file uses defaults", []() {
+        std::vector<std::string> warnings;
+        DropbearConfig cfg = DropbearConfig::loadFile("/nonexistent/dropbear.conf", warnings);
+        ASSERT_EQ(0u, warnings.size());
+        ASSERT_EQ(22, cfg.port);
+    });
+
+    // Test summary lines for the UI
+    runner.addTest("DropbearConfig::describe reports active settings", []() {
+        DropbearConfig cfg;
+        cfg.receive_window = 65536;
+        auto lines = cfg.describe();
+        ASSERT_FALSE(lines.empty());
+        ASSERT_TRUE(lines[0].find("65536") != std::string::npos);
+    });
+
+    // Test brute-force guard and probe keys
+    runner.addTest("DropbearConfig parses app-enforced keys", []() {
+        std::vector<std::string> warnings;
+        DropbearConfig cfg = parseString(
+            "bruteforce_max_failures = 3\n"
+            "bruteforce_half_life = 120\n"
+            "bruteforce_block_time = 3600\n"
+            "allowlist = 192.168.1.0/24, 10.0.0.5\n"
+            "probe_interval = 0\n"
+            "log_history_kb = 0\n"
+            "log_block_kb = 64\n"
+            "log_pipe_kb = 512\n"
+            "log_buffer_kb = 64\n"
+            "log_overflow = drop-newest\n"
+            "profile_hz = 0\n"
+            "profile_children = no\n"
+            "wifi_powersave_off = no\n"
+            "wifi_interface = wlan1\n"
+            "wifi_powersave_cmd = iw dev %i set power_save %s\n"
+            "inetd = yes\n"
+            "inetd_spare = no\n", warnings);
+        ASSERT_EQ(0u, warnings.size());
+        ASSERT_EQ(3, cfg.bruteforce_max_failures);
+        ASSERT_EQ(120, cfg.bruteforce_half_life_secs);
+        ASSERT_EQ(3600, cfg.bruteforce_block_secs);
+        ASSERT_STR_EQ("192.168.1.0/24, 10.0.0.5", cfg.allowlist);
+        ASSERT_EQ(0, cfg.probe_interval_secs);
+        ASSERT_EQ(3, cfg.probe_failures);
+        ASSERT_EQ(0, cfg.log_history_kb);
+        ASSERT_EQ(64, cfg.log_block_kb);
+        ASSERT_EQ(512, cfg.log_pipe_kb);
+        ASSERT_EQ(64, cfg.log_buffer_kb);
+        ASSERT_STR_EQ("drop-newest", cfg.log_overflow);
+        ASSERT_EQ(0, cfg.profile_hz);
+        ASSERT_FALSE(cfg.profile_children);
+        ASSERT_FALSE(cfg.wifi_powersave_off);
+        ASSERT_STR_EQ("wlan1", cfg.wifi_interface);
+        ASSERT_STR_EQ("iw dev %i set power_save %s", cfg.wifi_powersave_cmd);
+        ASSERT_TRUE(cfg.inetd);
+        ASSERT_FALSE(cfg.inetd_spare);
+
+        // Guard settings never leak into dropbear's argv
+        for (const auto& arg : cfg.toArgs("/key")) {
+            ASSERT_TRUE(arg.find("192.168") == std::string::npos);
+        }
+    });
+}
@@ -0,0 +1,77 @@
+#include "test_framework.h"
+#include "../src/DropbearLogParser.h"
+
+void registerDropbearLogParserTests(TestRunner& runner) {
+    using Type = DropbearLogEvent::Type;
+
+    // Test new connection lines
+    runner.addTest("DropbearLogParser parses child connection", []() {
+        auto ev = DropbearLogParser::parse(
+            "[1234] Jan 01 12:00:00 Child connection from 192.168.1.2:51234");
+        ASSERT_TRUE(ev.type == Type::ChildConnection);
+        ASSERT_EQ(1234, ev.pid);
+        ASSERT_STR_EQ("192.168.1.2", ev.client_ip);
+        ASSERT_EQ(51234, ev.client_port);
+    });
+
+    // Test password and pubkey successes
+    runner.addTest("DropbearLogParser parses auth success", []() {
+        auto ev = DropbearLogParser::parse(
+            "[77] Mar 15 08:01:02 Password auth succeeded for 'root' from 10.0.0.5:40000");
+        ASSERT_TRUE(ev.type == Type::AuthSuccess);
+        ASSERT_STR_EQ("root", ev.user);
+        ASSERT_STR_EQ("10.0.0.5", ev.client_ip);
+
+        auto pk = DropbearLogParser::parse(
+            "[78] Mar 15 08:01:02 Pubkey auth succeeded for 'root' with ssh-rsa key "
+            "SHA256:abc from 10.0.0.6:40001");
+        ASSERT_TRUE(pk.type == Type::AuthSuccess);
+        ASSERT_STR_EQ("10.0.0.6", pk.client_ip);
+    });
+
+    // Test failure lines
+    runner.addTest("DropbearLogParser parses auth failures", []() {
+        auto bad = DropbearLogParser::parse(
+            "[90] Mar 15 08:01:02 Bad password attempt for 'admin' from 203.0.113.9:5555");
+        ASSERT_TRUE(bad.type == Type::AuthFailure);
+        ASSERT_STR_EQ("admin", bad.user);
+        ASSERT_STR_EQ("203.0.113.9", bad.client_ip);
+
+        auto nouser = DropbearLogParser::parse(
+            "[91] Mar 15 08:01:02 Login attempt for nonexistent user from 203.0.113.9:5556");
+        ASSERT_TRUE(nouser.type == Type::AuthFailure);
+        ASSERT_STR_EQ("203.0.113.9", nouser.client_ip);
+    });
+
+    // Test exit lines
+    runner.addTest("DropbearLogParser parses session exits", []() {
+        auto ex = DropbearLogParser::parse(
+            "[1234] Jan 01 12:10:00 Exit (root) from <192.168.1.2:51234>: Disconnect received");
+        ASSERT_TRUE(ex.type == Type::SessionExit);
+        ASSERT_STR_EQ("root", ex.user);
+        ASSERT_STR_EQ("192.168.1.2", ex.client_ip);
+
+        auto pre = DropbearLogParser::parse(
+            "[1235] Jan 01 12:10:00 Exit before auth from <192.168.1.3:1>: Exited normally");
+        ASSERT_TRUE(pre.type == Type::PreAuthExit);
+        ASSERT_STR_EQ("192.168.1.3", pre.client_ip);
+    });
+
+    // Test unrelated and malformed lines
+    runner.addTest("DropbearLogParser ignores other lines", []() {
+        auto ev = DropbearLogParser::parse("[1] Jan 01 12:00:00 Not backgrounding");
+        ASSERT_TRUE(ev.type == Type::Other);
+        ASSERT_EQ(1, ev.pid);
+
+        ASSERT_TRUE(DropbearLogParser::parse("").type == Type::Other);
+        ASSERT_TRUE(DropbearLogParser::parse("[123 broken").type == Type::Other);
+        ASSERT_TRUE(DropbearLogParser::parse("getifaddrs failed").type == Type::Other);
+    });
+
+    // Test address helper
+    runner.addTest("DropbearLogParser::hostFromAddress strips port and brackets", []() {
+        ASSERT_STR_EQ("1.2.3.4", DropbearLogParser::hostFromAddress("1.2.3.4:22"));
+        ASSERT_STR_EQ("1.2.3.4", DropbearLogParser::hostFromAddress("<1.2.3.4:22>"));
+        ASSERT_STR_EQ("host", DropbearLogParser::hostFromAddress("host"));
+    });
+}
@@ -0,0 +1,140 @@
+#include "test_framework.h"
+#include "../src/DropbearManager.h"
+#include "../src/PathHelper.h"
+#include <sys/stat.h>
+#include <signal.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace {
+
+void writeFile(const std::string& path, const std::string& data, mode_t mode) {
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) return;
+    fputs(data.c_str(), f);
+    fclose(f);
+    chmod(path.c_str(), mode);
+}
+
+// An app directory whose dropbear is a stub: the first listener starts one
+// session in its own session (setsid, as dropbear does per connection) that
+// logs a line every 20 ms on the listener's stderr until it is killed, plus
+// a failed login from 192.0.2.7 once <dir>/fail exists
+std::string writeStubAppDir() {
+    const std::string dir = "/tmp/dropbear_app_test_" + std::to_string(getpid()) + "_app/";
+    mkdir(dir.c_str(), 0700);
+    writeFile(dir + "dropbear",
+              "#!/bin/sh\n"
+              "dir=$(dirname \"$0\")\n"
+              "if mkdir \"$dir/started\" 2>/dev/null; then\n"
+              "    setsid sh -c 'echo $$ > \"$1/session.tmp\"; mv \"$1/session.tmp\" \"$1/session.pid\";\n"
+              "                  while :; do echo \"[$$] session tick\" >&2;\n"
+              "                      [ -e \"$1/fail\" ] && echo \"[$$] Jan 01 00:00:00 Bad password attempt for root from 192.0.2.7:5555\" >&2;\n"
+              "                      sleep 0.02; done' sh \"$dir\" &\n"
+              "fi\n"
+              "echo \"[$$] listener up\" >&2\n"
+              "exec sleep 1000\n", 0755);
+    writeFile(dir + "dropbear_rsa_host_key", "stub", 0600);
+    writeFile(dir + "dropbear.conf", "probe_interval = 0\nbruteforce_max_failures = 1\n", 0644);
+    return dir;
+}
+
+// Pumps like the frame loop until done() or timeoutMs
+bool pumpUntil(DropbearManager& manager, const std::function<bool()>& done, int timeoutMs) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (std::chrono::steady_clock::now() < deadline) {
+        manager.pumpLogs();
+        if (done()) return true;
+        usleep(5000);
+    }
+    return false;
+}
+
+// Running and not a zombie: the session is reparented away from us
+bool running(pid_t pid) {
+    char path[32];
+    snprintf(path, sizeof(path), "/proc/%d/stat", static_cast<int>(pid));
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+    char state = 0;
+    const bool read = fscanf(f, "%*d (%*[^)]) %c", &state) == 1;
+    fclose(f);
+    return read && state != 'Z';
+}
+
+bool readPid(const std::string& path, pid_t& pid) {
+    FILE* f = fopen(path.c_str(), "r");
+    if (!f) return false;
+    const bool ok = fscanf(f, "%d", &pid) == 1;
+    fclose(f);
+    return ok;
+}
+
+bool contains(const std::vector<std::string>& lines, const std::string& text) {
+    for (const auto& line : lines) {
+        if (line.find(text) != std::string::npos) return true;
+    }
+    return false;
+}
+
+} // namespace
+
+void registerDropbearManagerTests(TestRunner& runner) {
+    // Test a listener-only restart leaves sessions running, keeps reading
+    // their output from the retired pipe, and drops that pipe at EOF
+    runner.addTest("DropbearManager::restartListener keeps sessions and drains their pipe", []() {
+        const std::string dir = writeStubAppDir();
+        PathHelper::setBaseDir(dir);
+        std::vector<std::string> lines;
+        pid_t session = -1;
+        {
+            DropbearManager manager([&](const std::string& line) { lines.push_back(line); });
+            ASSERT_TRUE(manager.start());
+            ASSERT_TRUE(pumpUntil(manager, [&]() { return contains(lines, "session tick"); }, 5000));
+            ASSERT_TRUE(readPid(dir + "session.pid", session));
+
+            ASSERT_TRUE(manager.restartListener());
+            ASSERT_EQ(1u, manager.drainingFds().size());
+            ASSERT_EQ(0, kill(session, 0));
+
+            // Only the old session logs ticks, and only into the old pipe
+            lines.clear();
+            ASSERT_TRUE(pumpUntil(manager, [&]() { return contains(lines, "session tick"); }, 5000));
+            ASSERT_TRUE(contains(lines, "listener up"));
+            ASSERT_EQ(0, kill(session, 0));
+            ASSERT_EQ(1u, manager.drainingFds().size());
+
+            kill(session, SIGKILL);
+            ASSERT_TRUE(pumpUntil(manager, [&]() { return manager.drainingFds().empty(); }, 5000));
+        }
+        PathHelper::setBaseDir("");
+        if (system(("rm -rf '" + dir + "'").c_str()) != 0) {}
+    });
+
+    // Test the brute-force guard can still cut off a session that was started
+    // by a listener since retired: it has been reparented by then
+    runner.addTest("DropbearManager drops sessions of a retired listener", []() {
+        const std::string dir = writeStubAppDir();
+        PathHelper::setBaseDir(dir);
+        std::vector<std::string> lines;
+        pid_t session = -1;
+        {
+            DropbearManager manager([&](const std::string& line) { lines.push_back(line); });
+            ASSERT_TRUE(manager.start());
+            ASSERT_TRUE(pumpUntil(manager, [&]() { return readPid(dir + "session.pid", session); }, 5000));
+            ASSERT_TRUE(manager.restartListener());
+            ASSERT_TRUE(running(session));
+
+            writeFile(dir + "fail", "", 0644);
+            ASSERT_TRUE(pumpUntil(manager, [&]() { return !running(session); }, 5000));
+            ASSERT_TRUE(contains(lines, "Blocking 192.0.2.7"));
+        }
+        PathHelper::setBaseDir("");
+        if (system(("rm -rf '" + dir + "'").c_str()) != 0) {}
+    });
+}
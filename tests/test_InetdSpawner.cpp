@@ -0,0 +1,184 @@
+#include "test_framework.h"
+#include "../src/InetdSpawner.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+
+namespace {
+
+// Stands in for `dropbear -i`: greets on the connection, logs on stderr
+std::string writeFakeDropbear() {
+    const std::string path = "/tmp/dropbear_app_test_" + std::to_string(getpid()) + "_fake_dropbear";
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) return "";
+    fputs("#!/bin/sh\n"
+          "echo \"SSH-2.0-fake $1\"\n"
+          "echo \"[$$] Child connection\" >&2\n", f);
+    fclose(f);
+    chmod(path.c_str(), 0755);
+    return path;
+}
+
+int connectTo(int port) {
+    const int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Accepts until one connection has been taken, the way pumpLogs() would
+std::vector<InetdSpawner::Spawned> acceptOne(InetdSpawner& spawner, bool allow, size_t& refused) {
+    std::vector<InetdSpawner::Spawned> spawned;
+    std::string error;
+    for (int attempt = 0; attempt < 100 && spawned.empty() && refused == 0; ++attempt) {
+        std::vector<struct pollfd> pfds;
+        for (int fd : spawner.fds()) pfds.push_back({fd, POLLIN, 0});
+        poll(pfds.data(), pfds.size(), 20);
+        spawned = spawner.acceptPending([allow](const std::string&) { return allow; }, refused, error);
+    }
+    return spawned;
+}
+
+std::string readAll(int fd) {
+    std::string out;
+    char buf[256];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) out.append(buf, static_cast<size_t>(n));
+    return out;
+}
+
+InetdSpawner::Settings fakeSettings(const std::string& path, int logFd, bool spare) {
+    InetdSpawner::Settings s;
+    s.port = 0;
+    s.path = path;
+    s.args = {path, "-i"};
+    s.log_fd = logFd;
+    s.warm_spare = spare;
+    return s;
+}
+
+} // namespace
+
+void registerInetdSpawnerTests(TestRunner& runner) {
+    // Test a connection goes to the pre-forked spare and a new spare follows
+    runner.addTest("InetdSpawner hands connections to the warm spare", []() {
+        const std::string fake = writeFakeDropbear();
+        ASSERT_FALSE(fake.empty());
+        int logPipe[2];
+        ASSERT_TRUE(pipe(logPipe) == 0);
+
+        InetdSpawner spawner;
+        std::string error;
+        ASSERT_TRUE(spawner.open(fakeSettings(fake, logPipe[1], true), error));
+        ASSERT_TRUE(spawner.port() > 0);
+        const pid_t spare = spawner.sparePid();
+        ASSERT_TRUE(spare > 0);
+
+        const int client = connectTo(spawner.port());
+        ASSERT_TRUE(client >= 0);
+        size_t refused = 0;
+        const auto spawned = acceptOne(spawner, true, refused);
+        ASSERT_EQ(1u, spawned.size());
+        ASSERT_EQ(0u, refused);
+        ASSERT_TRUE(spawned[0].from_spare);
+        ASSERT_EQ(spare, spawned[0].pid);
+        ASSERT_STR_EQ("127.0.0.1", spawned[0].client_ip);
+        ASSERT_TRUE(spawner.sparePid() > 0);
+        ASSERT_TRUE(spawner.sparePid() != spare);
+
+        ASSERT_STR_EQ("SSH-2.0-fake -i\n", readAll(client));
+        int status = 0;
+        ASSERT_EQ(spawned[0].pid, SpawnHelper::global().wait(spawned[0].pid, &status, 0));
+        ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+        spawner.close();
+        close(logPipe[1]);
+        const std::string log = readAll(logPipe[0]);
+        ASSERT_TRUE(log.find("[" + std::to_string(spare) + "] Child connection") != std::string::npos);
+        close(logPipe[0]);
+        close(client);
+        unlink(fake.c_str());
+    });
+
+    // Test without a spare each connection forks and execs on the spot
+    runner.addTest("InetdSpawner forks per connection without a spare", []() {
+        const std::string fake = writeFakeDropbear();
+        InetdSpawner spawner;
+        std::string error;
+        ASSERT_TRUE(spawner.open(fakeSettings(fake, -1, false), error));
+        ASSERT_EQ(-1, spawner.sparePid());
+
+        for (int i = 0; i < 2; ++i) {
+            const int client = connectTo(spawner.port());
+            ASSERT_TRUE(client >= 0);
+            size_t refused = 0;
+            const auto spawned = acceptOne(spawner, true, refused);
+            ASSERT_EQ(1u, spawned.size());
+            ASSERT_FALSE(spawned[0].from_spare);
+            ASSERT_STR_EQ("SSH-2.0-fake -i\n", readAll(client));
+            SpawnHelper::global().wait(spawned[0].pid, nullptr, 0);
+            close(client);
+        }
+        ASSERT_EQ(-1, spawner.sparePid());
+        unlink(fake.c_str());
+    });
+
+    // Test denied clients are closed without a process being started
+    runner.addTest("InetdSpawner refuses denied clients before spawning", []() {
+        const std::string fake = writeFakeDropbear();
+        InetdSpawner spawner;
+        std::string error;
+        ASSERT_TRUE(spawner.open(fakeSettings(fake, -1, true), error));
+        const pid_t spare = spawner.sparePid();
+
+        const int client = connectTo(spawner.port());
+        ASSERT_TRUE(client >= 0);
+        size_t refused = 0;
+        const auto spawned = acceptOne(spawner, false, refused);
+        ASSERT_EQ(0u, spawned.size());
+        ASSERT_EQ(1u, refused);
+        ASSERT_STR_EQ("", readAll(client));
+        ASSERT_EQ(spare, spawner.sparePid());
+        close(client);
+        unlink(fake.c_str());
+    });
+
+    // Test close() frees the port and ends the spare
+    runner.addTest("InetdSpawner releases the port on close", []() {
+        const std::string fake = writeFakeDropbear();
+        InetdSpawner spawner;
+        std::string error;
+        ASSERT_TRUE(spawner.open(fakeSettings(fake, -1, true), error));
+        const int port = spawner.port();
+        const pid_t spare = spawner.sparePid();
+        ASSERT_TRUE(spawner.isOpen());
+
+        spawner.close();
+        ASSERT_FALSE(spawner.isOpen());
+        ASSERT_EQ(-1, spawner.sparePid());
+        ASSERT_EQ(-1, kill(spare, 0));
+        ASSERT_EQ(-1, connectTo(port));
+
+        // A busy port is reported, not silently ignored
+        InetdSpawner first, second;
+        ASSERT_TRUE(first.open(fakeSettings(fake, -1, false), error));
+        InetdSpawner::Settings clash = fakeSettings(fake, -1, false);
+        clash.port = first.port();
+        ASSERT_FALSE(second.open(clash, error));
+        ASSERT_TRUE(error.find("listen on port") != std::string::npos);
+        unlink(fake.c_str());
+    });
+}
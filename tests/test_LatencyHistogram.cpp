@@ -0,0 +1,40 @@
+#include "test_framework.h"
+#include "../src/LatencyHistogram.h"
+
+void registerLatencyHistogramTests(TestRunner& runner) {
+    // Test empty histogram
+    runner.addTest("LatencyHistogram empty reports zeros", []() {
+        LatencyHistogram h;
+        ASSERT_EQ(0u, h.count());
+        ASSERT_EQ(0u, h.percentile(0.5));
+        ASSERT_EQ(0u, h.meanMicros());
+    });
+
+    // Test percentiles stay within one bucket (~19%) of the true value
+    runner.addTest("LatencyHistogram percentiles are bucket-accurate", []() {
+        LatencyHistogram h;
+        for (int i = 1; i <= 100; ++i) h.record(static_cast<uint64_t>(i) * 10000);   // 10 ms .. 1 s
+
+        uint64_t p50 = h.percentile(0.50);
+        uint64_t p99 = h.percentile(0.99);
+        ASSERT_TRUE(p50 >= 500000 && p50 <= 500000 * 119 / 100);
+        ASSERT_TRUE(p99 >= 990000 && p99 <= 1000000);   // capped at max sample
+        ASSERT_EQ(1000000u, h.maxMicros());
+        ASSERT_EQ(100u, h.count());
+    });
+
+    // Test extremes land in the first and overflow buckets
+    runner.addTest("LatencyHistogram handles sub-ms and huge samples", []() {
+        LatencyHistogram h;
+        h.record(10);
+        h.record(3600ULL * 1000000);
+        ASSERT_EQ(1000u, h.percentile(0.5));
+        ASSERT_EQ(3600ULL * 1000000, h.percentile(1.0));
+    });
+
+    // Test formatting
+    runner.addTest("LatencyHistogram::formatMicros picks ms or s", []() {
+        ASSERT_STR_EQ("120 ms", LatencyHistogram::formatMicros(120000));
+        ASSERT_STR_EQ("1.5 s", LatencyHistogram::formatMicros(1500000));
+    });
+}
@@ -0,0 +1,74 @@
+#include "test_framework.h"
+#include "../src/LogFile.h"
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+std::string tempLogPath(const char* name) {
+    return "/tmp/dropbear_app_test_" + std::to_string(getpid()) + "_" + name;
+}
+
+std::string readAll(const std::string& path) {
+    std::ifstream in(path);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+} // namespace
+
+void registerLogFileTests(TestRunner& runner) {
+    // Test lines are timestamped and appended across reopen
+    runner.addTest("LogFile appends timestamped lines across reopen", []() {
+        const std::string path = tempLogPath("append.log");
+        unlink(path.c_str());
+        {
+            LogFile log(path, 0);
+            ASSERT_TRUE(log.open());
+            log.write("first");
+        }
+        {
+            LogFile log(path, 0);
+            ASSERT_TRUE(log.open());
+            ASSERT_TRUE(log.size() > 0);
+            log.write("second");
+        }
+        std::string content = readAll(path);
+        ASSERT_TRUE(content.find(" first\n") != std::string::npos);
+        ASSERT_TRUE(content.find(" second\n") != std::string::npos);
+        ASSERT_TRUE(content.find("first") < content.find("second"));
+        ASSERT_TRUE(content[4] == '-');   // YYYY-MM-DD prefix
+        unlink(path.c_str());
+    });
+
+    // Test size-based rotation
+    runner.addTest("LogFile rotates to .1 past max size", []() {
+        const std::string path = tempLogPath("rotate.log");
+        const std::string rotated = path + ".1";
+        unlink(path.c_str());
+        unlink(rotated.c_str());
+
+        LogFile log(path, 200);
+        ASSERT_TRUE(log.open());
+        for (int i = 0; i < 20; ++i) log.write("line " + std::to_string(i));
+
+        ASSERT_TRUE(log.size() <= 200);
+        std::string current = readAll(path);
+        std::string old = readAll(rotated);
+        ASSERT_FALSE(old.empty());
+        ASSERT_TRUE(current.find("line 19") != std::string::npos);
+        ASSERT_TRUE(current.find("line 0\n") == std::string::npos);
+        unlink(path.c_str());
+        unlink(rotated.c_str());
+    });
+
+    // Test writes to an unopened log are ignored
+    runner.addTest("LogFile write without open is a no-op", []() {
+        LogFile log("/nonexistent-dir/app.log", 0);
+        ASSERT_FALSE(log.open());
+        ASSERT_FALSE(log.isOpen());
+        log.write("dropped");
+        ASSERT_EQ(0u, log.size());
+    });
+}
@@ -0,0 +1,178 @@
+#include "test_framework.h"
+#include "../src/LogHistory.h"
+#include "../src/Lz4Block.h"
+#include <random>
+#include <string>
+
+namespace {
+
+std::string logLine(uint64_t i) {
+    return "[" + std::to_string(20000 + i % 50) + "] Oct 18 12:00:00 Child connection from 192.168.1." +
+           std::to_string(i % 200) + ":" + std::to_string(40000 + i) + " #" + std::to_string(i);
+}
+
+bool roundTrips(const std::string& raw) {
+    std::string packed;
+    Lz4Block::compress(raw.data(), raw.size(), packed);
+    if (packed.size() > Lz4Block::bound(raw.size())) return false;
+    std::string out(raw.size(), '\0');
+    return Lz4Block::decompress(packed.data(), packed.size(), &out[0], out.size()) && out == raw;
+}
+
+} // namespace
+
+void registerLogHistoryTests(TestRunner& runner) {
+    // Test codec round trips on empty, tiny, repetitive and random input
+    runner.addTest("Lz4Block round trips", []() {
+        ASSERT_TRUE(roundTrips(""));
+        ASSERT_TRUE(roundTrips("a"));
+        ASSERT_TRUE(roundTrips("abcdefghijklm"));
+        ASSERT_TRUE(roundTrips(std::string(100000, 'x')));
+
+        std::string text;
+        for (uint64_t i = 0; i < 500; ++i) text += logLine(i) + "\n";
+        ASSERT_TRUE(roundTrips(text));
+
+        std::mt19937 rng(7);
+        std::string noise(70000, '\0');
+        for (auto& c : noise) c = static_cast<char>(rng());
+        ASSERT_TRUE(roundTrips(noise));
+    });
+
+    // Test repetitive log text shrinks and corrupt input is rejected
+    runner.addTest("Lz4Block compresses logs and rejects bad input", []() {
+        std::string text;
+        for (uint64_t i = 0; i < 500; ++i) text += logLine(i) + "\n";
+        std::string packed;
+        Lz4Block::compress(text.data(), text.size(), packed);
+        ASSERT_TRUE(packed.size() * 3 < text.size());
+
+        std::string out(text.size(), '\0');
+        ASSERT_FALSE(Lz4Block::decompress(packed.data(), packed.size() / 2, &out[0], out.size()));
+        ASSERT_FALSE(Lz4Block::decompress(packed.data(), packed.size(), &out[0], out.size() - 1));
+        const char badOffset[] = {0x10, 'a', 0x05, 0x00, 0x00};   // offset 5 after 1 byte
+        ASSERT_FALSE(Lz4Block::decompress(badOffset, sizeof(badOffset), &out[0], 10));
+    });
+
+    // Test every retained line reads back across hot ring, open block and cold blocks
+    runner.addTest("LogHistory reads back lines from every tier", []() {
+        LogHistory::Settings s;
+        s.hot_lines = 50;
+        s.block_bytes = 2048;
+        LogHistory history(s);
+        for (uint64_t i = 0; i < 3000; ++i) history.append(logLine(i));
+
+        ASSERT_EQ(0u, history.begin());
+        ASSERT_EQ(3000u, history.end());
+        const LogHistory::Stats st = history.stats();
+        ASSERT_TRUE(st.blocks > 10);
+        ASSERT_TRUE(st.ratio() > 2.0);
+
+        std::string out;
+        for (uint64_t i = 0; i < 3000; i += 7) {
+            ASSERT_TRUE(history.line(i, out));
+            ASSERT_TRUE(out == logLine(i));
+        }
+        ASSERT_TRUE(history.line(2999, out));
+        ASSERT_TRUE(out == logLine(2999));
+        ASSERT_FALSE(history.line(3000, out));
+        ASSERT_TRUE(history.stats().decodes >= st.blocks);
+    });
+
+    // Test sequential reads decode each block once
+    runner.addTest("LogHistory caches the decoded block", []() {
+        LogHistory::Settings s;
+        s.hot_lines = 10;
+        s.block_bytes = 4096;
+        LogHistory history(s);
+        for (uint64_t i = 0; i < 1000; ++i) history.append(logLine(i));
+
+        std::string out;
+        for (uint64_t i = 0; i < 20; ++i) ASSERT_TRUE(history.line(i, out));
+        ASSERT_EQ(1u, history.stats().decodes);
+    });
+
+    // Test the cold budget drops the oldest blocks and begin() follows
+    runner.addTest("LogHistory evicts oldest blocks over budget", []() {
+        LogHistory::Settings s;
+        s.hot_lines = 20;
+        s.block_bytes = 1024;
+        s.cold_budget_bytes = 4096;
+        LogHistory history(s);
+        for (uint64_t i = 0; i < 20000; ++i) history.append(logLine(i));
+
+        const LogHistory::Stats st = history.stats();
+        ASSERT_TRUE(st.compressed_bytes <= 4096);
+        ASSERT_TRUE(st.evicted_lines > 0);
+        ASSERT_EQ(20000u - st.evicted_lines, history.size());
+
+        std::string out;
+        ASSERT_FALSE(history.line(history.begin() - 1, out));
+        ASSERT_TRUE(history.line(history.begin(), out));
+        ASSERT_TRUE(out == logLine(history.begin()));
+    });
+
+    // Test a zero budget keeps only the hot ring and the open block
+    runner.addTest("LogHistory with zero budget keeps no cold blocks", []() {
+        LogHistory::Settings s;
+        s.hot_lines = 5;
+        s.block_bytes = 512;
+        s.cold_budget_bytes = 0;
+        LogHistory history(s);
+        for (uint64_t i = 0; i < 1000; ++i) history.append(logLine(i));
+
+        ASSERT_EQ(0u, history.stats().blocks);
+        std::string out;
+        ASSERT_TRUE(history.line(history.begin(), out));
+        ASSERT_TRUE(out == logLine(history.begin()));
+        ASSERT_TRUE(history.size() >= 5);
+    });
+
+    // Test search in both directions across tiers
+    runner.addTest("LogHistory finds lines backward and forward", []() {
+        LogHistory::Settings s;
+        s.hot_lines = 30;
+        s.block_bytes = 1024;
+        LogHistory history(s);
+        for (uint64_t i = 0; i < 2000; ++i) history.append(logLine(i));
+
+        ASSERT_EQ(1234u, history.find("#1234", history.end(), true));
+        ASSERT_EQ(1234u, history.find("#1234", 0, false));
+        ASSERT_EQ(1990u, history.find("#1990", 1500, false));
+        ASSERT_EQ(history.end(), history.find("#1990", 1500, true));
+        ASSERT_EQ(history.end(), history.find("no such text", history.end(), true));
+        ASSERT_EQ(5u, history.find("#5", 5, true));
+    });
+
+    // Test shrinking the ring moves lines to cold storage without losing any
+    runner.addTest("LogHistory reconfigure keeps lines", []() {
+        LogHistory::Settings s;
+        s.hot_lines = 400;
+        s.block_bytes = 1024;
+        LogHistory history(s);
+        for (uint64_t i = 0; i < 300; ++i) history.append(logLine(i));
+
+        s.hot_lines = 10;
+        history.configure(s);
+        ASSERT_EQ(0u, history.begin());
+        for (uint64_t i = 300; i < 320; ++i) history.append(logLine(i));
+        std::string out;
+        for (uint64_t i = 0; i < 320; ++i) {
+            ASSERT_TRUE(history.line(i, out));
+            ASSERT_TRUE(out == logLine(i));
+        }
+    });
+
+    // Test newlines inside a line don't split it in cold storage
+    runner.addTest("LogHistory flattens embedded newlines", []() {
+        LogHistory::Settings s;
+        s.hot_lines = 1;
+        LogHistory history(s);
+        history.append("two\nparts");
+        history.append("next");
+        std::string out;
+        ASSERT_TRUE(history.line(0, out));
+        ASSERT_STR_EQ(std::string("two parts"), out);
+        ASSERT_EQ(2u, history.size());
+    });
+}
@@ -0,0 +1,55 @@
+#include "test_framework.h"
+#include "../src/LogLineSplitter.h"
+#include <vector>
+
+void registerLogLineSplitterTests(TestRunner& runner) {
+    // Test complete lines are emitted
+    runner.addTest("LogLineSplitter emits complete lines", []() {
+        LogLineSplitter splitter;
+        std::vector<std::string> lines;
+        auto collect = [&](const std::string& l) { lines.push_back(l); };
+
+        const std::string data = "first\nsecond\r\n";
+        splitter.feed(data.data(), data.size(), collect);
+        ASSERT_EQ(2u, lines.size());
+        ASSERT_STR_EQ("first", lines[0]);
+        ASSERT_STR_EQ("second", lines[1]);
+        ASSERT_EQ(0u, splitter.pendingBytes());
+    });
+
+    // Test lines split across chunks are reassembled
+    runner.addTest("LogLineSplitter joins lines across chunks", []() {
+        LogLineSplitter splitter;
+        std::vector<std::string> lines;
+        auto collect = [&](const std::string& l) { lines.push_back(l); };
+
+        splitter.feed("Child conn", 10, collect);
+        ASSERT_EQ(0u, lines.size());
+        ASSERT_EQ(10u, splitter.pendingBytes());
+        splitter.feed("ection\npart", 11, collect);
+        ASSERT_EQ(1u, lines.size());
+        ASSERT_STR_EQ("Child connection", lines[0]);
+        ASSERT_EQ(4u, splitter.pendingBytes());
+    });
+
+    // Test empty lines are dropped
+    runner.addTest("LogLineSplitter skips empty lines", []() {
+        LogLineSplitter splitter;
+        int count = 0;
+        splitter.feed("\n\r\n\n", 4, [&](const std::string&) { count++; });
+        ASSERT_EQ(0, count);
+    });
+
+    // Test flush emits the tail
+    runner.addTest("LogLineSplitter::flush emits partial tail", []() {
+        LogLineSplitter splitter;
+        std::vector<std::string> lines;
+        auto collect = [&](const std::string& l) { lines.push_back(l); };
+
+        splitter.feed("done\nno newline\r", 16, collect);
+        splitter.flush(collect);
+        ASSERT_EQ(2u, lines.size());
+        ASSERT_STR_EQ("no newline", lines[1]);
+        ASSERT_EQ(0u, splitter.pendingBytes());
+    });
+}
@@ -0,0 +1,85 @@
+#include "test_framework.h"
+#include "../src/LogRecording.h"
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+std::string tempRecordingPath(const char* name) {
+    return "/tmp/dropbear_app_test_" + std::to_string(getpid()) + "_" + name;
+}
+
+} // namespace
+
+void registerLogRecordingTests(TestRunner& runner) {
+    // Test chunks round-trip byte for byte, including newlines and NULs
+    runner.addTest("LogRecording round-trips raw chunks", []() {
+        const std::string path = tempRecordingPath("roundtrip.rec");
+        unlink(path.c_str());
+        {
+            LogRecording rec;
+            ASSERT_TRUE(rec.open(path));
+            rec.append("[1] Jan  1 00:00:00 hello\n[1] Ja", 32, 1000);
+            const char binary[] = {'x', '\0', 'y', '\n'};
+            rec.append(binary, sizeof(binary), 1500);
+        }
+
+        std::vector<LogRecording::Chunk> chunks;
+        std::string error;
+        ASSERT_TRUE(LogRecording::load(path, chunks, error));
+        ASSERT_EQ(2u, chunks.size());
+        ASSERT_STR_EQ("[1] Jan  1 00:00:00 hello\n[1] Ja", chunks[0].data);
+        ASSERT_TRUE(chunks[1].data == std::string("x\0y\n", 4));
+        ASSERT_EQ(0u, chunks[0].offset_us);
+        ASSERT_EQ(500u, chunks[1].offset_us);
+        unlink(path.c_str());
+    });
+
+    // Test reopening appends instead of truncating
+    runner.addTest("LogRecording appends across reopen", []() {
+        const std::string path = tempRecordingPath("append.rec");
+        unlink(path.c_str());
+        {
+            LogRecording rec;
+            ASSERT_TRUE(rec.open(path));
+            rec.append("a\n", 2, 10);
+        }
+        {
+            LogRecording rec;
+            ASSERT_TRUE(rec.open(path));
+            rec.append("b\n", 2, 20);
+        }
+
+        std::vector<LogRecording::Chunk> chunks;
+        std::string error;
+        ASSERT_TRUE(LogRecording::load(path, chunks, error));
+        ASSERT_EQ(2u, chunks.size());
+        ASSERT_STR_EQ("b\n", chunks[1].data);
+        unlink(path.c_str());
+    });
+
+    // Test corrupt and foreign files are rejected
+    runner.addTest("LogRecording::load rejects corrupt files", []() {
+        const std::string path = tempRecordingPath("corrupt.rec");
+        std::vector<LogRecording::Chunk> chunks;
+        std::string error;
+
+        {
+            std::ofstream out(path);
+            out << "plain text log\n";
+        }
+        ASSERT_FALSE(LogRecording::load(path, chunks, error));
+        ASSERT_TRUE(error.find("header") != std::string::npos);
+
+        {
+            std::ofstream out(path);
+            out << "# dropbear-app log recording v1\n100 50\nshort\n";
+        }
+        ASSERT_FALSE(LogRecording::load(path, chunks, error));
+        ASSERT_TRUE(error.find("corrupt") != std::string::npos);
+
+        ASSERT_FALSE(LogRecording::load("/nonexistent/file.rec", chunks, error));
+        unlink(path.c_str());
+    });
+}
@@ -0,0 +1,255 @@
+#include "test_framework.h"
+#include "../src/LogRelay.h"
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstdio>
+#include <thread>
+
+namespace {
+
+// "line 00042 ...\n", LINE_BYTES long
+const size_t LINE_BYTES = 32;
+
+std::string numberedLine(int i) {
+    char buf[LINE_BYTES + 1];
+    snprintf(buf, sizeof(buf), "line %05d %20s\n", i, "");
+    return std::string(buf, LINE_BYTES);
+}
+
+// Reads the relay's output until EOF
+std::vector<std::string> readLines(int fd) {
+    std::string all;
+    char buf[4096];
+    for (;;) {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, 5000) <= 0) break;
+        const ssize_t n = read(fd, buf, sizeof(buf));
+        if (n <= 0) break;
+        all.append(buf, static_cast<size_t>(n));
+    }
+    std::vector<std::string> lines;
+    size_t start = 0, nl;
+    while ((nl = all.find('\n', start)) != std::string::npos) {
+        lines.push_back(all.substr(start, nl - start));
+        start = nl + 1;
+    }
+    return lines;
+}
+
+int lineNumber(const std::string& line) {
+    int n = -1;
+    return sscanf(line.c_str(), "line %d", &n) == 1 ? n : -1;
+}
+
+uint64_t reportedDrops(const std::string& line) {
+    unsigned long long n = 0;
+    return sscanf(line.c_str(), "log relay: %llu lines", &n) == 1 ? n : 0;
+}
+
+// Writes lines 0..count-1 into fd with blocking writes, like dropbear's
+// stderr; false if that took longer than limitMs
+bool writeLines(int fd, int count, int limitMs) {
+    std::atomic<bool> done{false};
+    std::thread writer([&]() {
+        for (int i = 0; i < count; ++i) {
+            const std::string line = numberedLine(i);
+            if (write(fd, line.data(), line.size()) != static_cast<ssize_t>(line.size())) break;
+        }
+        done = true;
+    });
+    for (int waited = 0; !done && waited < limitMs; ++waited) usleep(1000);
+    const bool finished = done;
+    if (!finished) close(fd);   // unblocks the writer with EPIPE / EBADF
+    writer.join();
+    return finished;
+}
+
+// Relay with a small buffer and a one-page consumer pipe, so a few hundred
+// lines are enough to overflow
+LogRelay::Settings smallBuffer(LogRelay::Overflow overflow) {
+    LogRelay::Settings s;
+    s.buffer_bytes = 4096;
+    s.overflow = overflow;
+    return s;
+}
+
+} // namespace
+
+void registerLogRelayTests(TestRunner& runner) {
+    // Test lines arrive intact and in order, then EOF, when the reader keeps up
+    runner.addTest("LogRelay forwards lines and EOF", []() {
+        int src[2];
+        ASSERT_TRUE(pipe(src) == 0);
+        LogRelay relay;
+        int out = -1;
+        std::string error;
+        ASSERT_TRUE(relay.start(src[0], LogRelay::Settings(), out, error));
+
+        std::vector<std::string> lines;
+        std::thread reader([&]() { lines = readLines(out); });
+        ASSERT_TRUE(writeLines(src[1], 5000, 5000));
+        close(src[1]);
+        reader.join();
+        close(out);
+        ASSERT_EQ(5000u, lines.size());
+        for (size_t i = 0; i < lines.size(); ++i) {
+            ASSERT_EQ(static_cast<int>(i), lineNumber(lines[i]));
+        }
+
+        const LogRelay::Stats stats = relay.stats();
+        ASSERT_EQ(5000u, stats.relayed_lines);
+        ASSERT_EQ(0u, stats.dropped_lines);
+    });
+
+    // Test drop-oldest keeps the writer moving and the most recent lines, and
+    // reports the gap where it happened
+    runner.addTest("LogRelay drops the oldest lines while the reader is frozen", []() {
+        int src[2];
+        ASSERT_TRUE(pipe(src) == 0);
+        LogRelay relay;
+        int out = -1;
+        std::string error;
+        ASSERT_TRUE(relay.start(src[0], smallBuffer(LogRelay::Overflow::DropOldest), out, error));
+        LogRelay::setPipeCapacity(out, 4096);
+
+        const int total = 20000;   // 640 KB against a 64 KiB source pipe
+        ASSERT_TRUE(writeLines(src[1], total, 10000));
+        close(src[1]);
+
+        const std::vector<std::string> lines = readLines(out);
+        close(out);
+        const LogRelay::Stats stats = relay.stats();
+        ASSERT_TRUE(stats.dropped_lines > 0);
+        ASSERT_EQ(stats.dropped_bytes, stats.dropped_lines * LINE_BYTES);
+        ASSERT_TRUE(stats.peak_buffered_bytes <= 4096);
+
+        uint64_t reported = 0;
+        size_t delivered = 0;
+        int previous = -1;
+        for (const auto& line : lines) {
+            if (reportedDrops(line) > 0) {
+                reported += reportedDrops(line);
+                continue;
+            }
+            ASSERT_TRUE(lineNumber(line) > previous);
+            previous = lineNumber(line);
+            ++delivered;
+        }
+        ASSERT_EQ(total - 1, previous);   // the newest line made it
+        ASSERT_EQ(stats.dropped_lines, reported);
+        ASSERT_EQ(static_cast<uint64_t>(total), delivered + reported);
+    });
+
+    // Test drop-newest keeps the lines from before the stall and reports the
+    // rest after them
+    runner.addTest("LogRelay drops the newest lines while the reader is frozen", []() {
+        int src[2];
+        ASSERT_TRUE(pipe(src) == 0);
+        LogRelay relay;
+        int out = -1;
+        std::string error;
+        ASSERT_TRUE(relay.start(src[0], smallBuffer(LogRelay::Overflow::DropNewest), out, error));
+        LogRelay::setPipeCapacity(out, 4096);
+
+        const int total = 20000;
+        ASSERT_TRUE(writeLines(src[1], total, 10000));
+        close(src[1]);
+
+        const std::vector<std::string> lines = readLines(out);
+        close(out);
+        // Everything up to the first report is the unbroken start of the stream
+        size_t first = 0;
+        while (first < lines.size() && lineNumber(lines[first]) == static_cast<int>(first)) ++first;
+        ASSERT_TRUE(first >= 4096 / LINE_BYTES);
+        ASSERT_TRUE(first < lines.size() && reportedDrops(lines[first]) > 0);
+
+        uint64_t reported = 0;
+        size_t delivered = 0;
+        for (const auto& line : lines) {
+            if (reportedDrops(line) > 0) reported += reportedDrops(line);
+            else ++delivered;
+        }
+        ASSERT_EQ(relay.stats().dropped_lines, reported);
+        ASSERT_EQ(static_cast<uint64_t>(total), delivered + reported);
+    });
+
+    // Test a server that logs every transfer keeps serving while nobody reads
+    // its log: without the relay it would block once 64 KiB were logged
+    runner.addTest("LogRelay keeps a logging server serving while the reader is frozen", []() {
+        int src[2];
+        ASSERT_TRUE(pipe(src) == 0);
+        LogRelay relay;
+        int out = -1;
+        std::string error;
+        ASSERT_TRUE(relay.start(src[0], smallBuffer(LogRelay::Overflow::DropOldest), out, error));
+        LogRelay::setPipeCapacity(out, 4096);
+
+        int sv[2];
+        ASSERT_TRUE(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+        const pid_t server = fork();
+        if (server == 0) {
+            // Echoes each 1 KiB chunk after logging eight lines about it
+            close(sv[0]);
+            char chunk[1024];
+            const std::string line(127, 'x');
+            for (;;) {
+                size_t got = 0;
+                while (got < sizeof(chunk)) {
+                    const ssize_t n = read(sv[1], chunk + got, sizeof(chunk) - got);
+                    if (n <= 0) _exit(0);
+                    got += static_cast<size_t>(n);
+                }
+                for (int i = 0; i < 8; ++i) dprintf(src[1], "%s\n", line.c_str());
+                if (write(sv[1], chunk, sizeof(chunk)) != static_cast<ssize_t>(sizeof(chunk))) _exit(1);
+            }
+        }
+        close(sv[1]);
+        close(src[1]);
+
+        // 2 MiB each way, 2 MiB of log that nobody reads
+        const int transfers = 2048;
+        char chunk[1024] = {};
+        int served = 0;
+        for (; served < transfers; ++served) {
+            if (write(sv[0], chunk, sizeof(chunk)) != static_cast<ssize_t>(sizeof(chunk))) break;
+            size_t got = 0;
+            while (got < sizeof(chunk)) {
+                struct pollfd pfd = {sv[0], POLLIN, 0};
+                if (poll(&pfd, 1, 5000) <= 0) break;
+                const ssize_t n = read(sv[0], chunk + got, sizeof(chunk) - got);
+                if (n <= 0) break;
+                got += static_cast<size_t>(n);
+            }
+            if (got < sizeof(chunk)) break;
+        }
+        close(sv[0]);
+        kill(server, SIGKILL);
+        waitpid(server, nullptr, 0);
+
+        ASSERT_EQ(transfers, served);
+        ASSERT_TRUE(relay.stats().dropped_lines > 0);
+        close(out);
+    });
+
+    // Test capacity is raised, clamped rather than refused, and policies parse
+    runner.addTest("LogRelay::setPipeCapacity raises the pipe size", []() {
+        int fds[2];
+        ASSERT_TRUE(pipe(fds) == 0);
+        ASSERT_TRUE(LogRelay::setPipeCapacity(fds[0], 256 * 1024) >= 256 * 1024);
+        ASSERT_TRUE(LogRelay::setPipeCapacity(fds[1], 0) >= 256 * 1024);   // 0 leaves it alone
+        ASSERT_TRUE(LogRelay::setPipeCapacity(fds[0], 1 << 30) > 0);
+        close(fds[0]);
+        close(fds[1]);
+        ASSERT_EQ(-1, LogRelay::setPipeCapacity(fds[0], 4096));
+
+        LogRelay::Overflow policy = LogRelay::Overflow::DropOldest;
+        ASSERT_TRUE(LogRelay::parseOverflow("drop-newest", policy));
+        ASSERT_TRUE(policy == LogRelay::Overflow::DropNewest);
+        ASSERT_FALSE(LogRelay::parseOverflow("block", policy));
+        ASSERT_STR_EQ(std::string("drop-oldest"), LogRelay::overflowName(LogRelay::Overflow::DropOldest));
+    });
+}
@@ -0,0 +1,104 @@
+#include "test_framework.h"
+#include "../src/Metrics.h"
+#include "../src/MetricsExporter.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+std::string readSocket(const std::string& path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == -1) {
+        close(fd);
+        return "";
+    }
+    std::string out;
+    char buf[512];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) out.append(buf, n);
+    close(fd);
+    return out;
+}
+
+} // namespace
+
+void registerMetricsTests(TestRunner& runner) {
+    // Test counters accumulate
+    runner.addTest("Metrics counter increments", []() {
+        Metrics metrics;
+        auto& c = metrics.counter("test_total", "A test counter");
+        c.inc();
+        c.inc(4);
+        ASSERT_EQ(5, c.value());
+    });
+
+    // Test registration is idempotent
+    runner.addTest("Metrics returns same metric for same name and labels", []() {
+        Metrics metrics;
+        auto& a = metrics.gauge("test_gauge", "help", "interface=\"wlan0\"");
+        auto& b = metrics.gauge("test_gauge", "help", "interface=\"wlan0\"");
+        auto& c = metrics.gauge("test_gauge", "help", "interface=\"eth0\"");
+        ASSERT_TRUE(&a == &b);
+        ASSERT_FALSE(&a == &c);
+    });
+
+    // Test gauges
+    runner.addTest("Metrics gauge set and dec", []() {
+        Metrics metrics;
+        auto& g = metrics.gauge("test_active", "help");
+        g.set(3);
+        g.dec();
+        ASSERT_EQ(2, g.value());
+    });
+
+    // Test exposition format
+    runner.addTest("Metrics renders Prometheus text format", []() {
+        Metrics metrics;
+        metrics.counter("b_total", "B things").inc(2);
+        metrics.gauge("a_bytes", "A bytes", "interface=\"wlan0\"").set(10);
+        metrics.gauge("a_bytes", "A bytes", "interface=\"eth0\"").set(20);
+
+        std::string text = metrics.renderPrometheus();
+        ASSERT_TRUE(text.find("# TYPE b_total counter\nb_total 2\n") != std::string::npos);
+        ASSERT_TRUE(text.find("a_bytes{interface=\"wlan0\"} 10\n") != std::string::npos);
+        ASSERT_TRUE(text.find("a_bytes{interface=\"eth0\"} 20\n") != std::string::npos);
+
+        // HELP/TYPE once per family, families sorted
+        size_t first = text.find("# HELP a_bytes");
+        ASSERT_TRUE(first != std::string::npos);
+        ASSERT_TRUE(text.find("# HELP a_bytes", first + 1) == std::string::npos);
+        ASSERT_TRUE(first < text.find("# HELP b_total"));
+    });
+
+    // Test exporter writes file and answers on the socket
+    runner.addTest("MetricsExporter publishes file and socket", []() {
+        Metrics metrics;
+        metrics.counter("exported_total", "help").inc(7);
+
+        const std::string tag = std::to_string(getpid());
+        const std::string file = "/tmp/test_metrics_" + tag + ".prom";
+        const std::string sock = "/tmp/test_metrics_" + tag + ".sock";
+        {
+            MetricsExporter exporter(metrics, file, sock, 50);
+            ASSERT_TRUE(exporter.start());
+
+            std::string viaSocket = readSocket(sock);
+            ASSERT_TRUE(viaSocket.find("exported_total 7") != std::string::npos);
+        }
+
+        std::ifstream in(file);
+        std::stringstream content;
+        content << in.rdbuf();
+        ASSERT_TRUE(content.str().find("exported_total 7") != std::string::npos);
+        ASSERT_TRUE(access(sock.c_str(), F_OK) != 0);   // socket removed on stop
+        std::remove(file.c_str());
+    });
+}
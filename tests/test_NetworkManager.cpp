@@ -1,6 +1,72 @@
 #include "test_framework.h"
+#include "../src/Constants.h"
 #include "../src/NetworkManager.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
 #include <algorithm>
+#include <chrono>
+#include <memory>
+
+namespace {
+
+// Shared with the test after NetworkManager takes ownership of the backend
+struct FakeRadio {
+    bool power_save = true;
+    bool fail_set = false;
+    int sets = 0;
+};
+
+class FakePowerSave : public WifiPowerSave {
+public:
+    explicit FakePowerSave(std::shared_ptr<FakeRadio> radio) : radio_(std::move(radio)) {}
+    const char* name() const override { return "fake"; }
+    bool get(const std::string&, bool& enabled, std::string&) override {
+        enabled = radio_->power_save;
+        return true;
+    }
+    bool set(const std::string&, bool enabled, std::string& error) override {
+        ++radio_->sets;
+        if (radio_->fail_set) {
+            error = "Operation not permitted";
+            return false;
+        }
+        radio_->power_save = enabled;
+        return true;
+    }
+    std::vector<std::string> interfaces() override { return {"wlan0"}; }
+
+private:
+    std::shared_ptr<FakeRadio> radio_;
+};
+
+// Polls an async backend until its queued switch finishes
+WifiPowerSave::Completion finish(WifiPowerSave& backend) {
+    WifiPowerSave::Completion done;
+    while (!backend.poll(done)) usleep(5000);
+    return done;
+}
+
+// Calls updateSessions until it reports something, for up to 5 s
+std::string awaitLine(NetworkManager& manager, int64_t active, uint64_t nowMs) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    std::string line;
+    while (line.empty() && std::chrono::steady_clock::now() < deadline) {
+        usleep(5000);
+        line = manager.updateSessions(active, nowMs);
+    }
+    return line;
+}
+
+NetworkManager::PowerSaveSettings managedSettings() {
+    NetworkManager::PowerSaveSettings settings;
+    settings.manage = true;
+    settings.restore_delay_ms = 5000;
+    return settings;
+}
+
+} // namespace
 
 void registerNetworkManagerTests(TestRunner& runner) {
     // Test NetworkManager instantiation
@@ -71,4 +137,180 @@ void registerNetworkManagerTests(TestRunner& runner) {
             }
         }
     });
+
+    // Test power save goes off with the first session and back on after the delay
+    runner.addTest("NetworkManager disables power save while sessions are active", []() {
+        auto radio = std::make_shared<FakeRadio>();
+        NetworkManager manager(std::unique_ptr<WifiPowerSave>(new FakePowerSave(radio)));
+        ASSERT_STR_EQ(std::string(""), manager.configurePowerSave(managedSettings(), 10000));
+        ASSERT_STR_EQ(std::string(""), manager.updateSessions(0, 10000));
+
+        ASSERT_STR_EQ(std::string("WiFi power save off on wlan0 (1 session)"), manager.updateSessions(1, 10000));
+        ASSERT_FALSE(radio->power_save);
+        ASSERT_STR_EQ(std::string(""), manager.updateSessions(2, 11000));
+        ASSERT_STR_EQ(std::string(""), manager.updateSessions(0, 12000));
+        ASSERT_STR_EQ(std::string(""), manager.updateSessions(0, 16999));
+        ASSERT_FALSE(radio->power_save);
+        ASSERT_STR_EQ(std::string("WiFi power save restored on wlan0"), manager.updateSessions(0, 17000));
+        ASSERT_TRUE(radio->power_save);
+        ASSERT_EQ(2, radio->sets);
+    });
+
+    // Test a session returning within the delay keeps power save off
+    runner.addTest("NetworkManager bridges short idle gaps", []() {
+        auto radio = std::make_shared<FakeRadio>();
+        NetworkManager manager(std::unique_ptr<WifiPowerSave>(new FakePowerSave(radio)));
+        manager.configurePowerSave(managedSettings(), 0);
+        manager.updateSessions(1, 1000);
+        manager.updateSessions(0, 2000);
+        ASSERT_STR_EQ(std::string(""), manager.updateSessions(1, 4000));
+        ASSERT_STR_EQ(std::string(""), manager.updateSessions(0, 8000));
+        ASSERT_FALSE(radio->power_save);
+        ASSERT_EQ(1, radio->sets);
+    });
+
+    // Test interfaces that already had power save off are left alone
+    runner.addTest("NetworkManager only restores what it switched", []() {
+        auto radio = std::make_shared<FakeRadio>();
+        radio->power_save = false;
+        NetworkManager manager(std::unique_ptr<WifiPowerSave>(new FakePowerSave(radio)));
+        manager.configurePowerSave(managedSettings(), 0);
+        ASSERT_STR_EQ(std::string(""), manager.updateSessions(1, 1000));
+        ASSERT_STR_EQ(std::string(""), manager.updateSessions(0, 10000));
+        ASSERT_FALSE(radio->power_save);
+        ASSERT_EQ(0, radio->sets);
+    });
+
+    // Test a failing backend is reported once per busy period, not every frame
+    runner.addTest("NetworkManager reports power save failures once", []() {
+        auto radio = std::make_shared<FakeRadio>();
+        radio->fail_set = true;
+        NetworkManager manager(std::unique_ptr<WifiPowerSave>(new FakePowerSave(radio)));
+        manager.configurePowerSave(managedSettings(), 0);
+        ASSERT_STR_EQ(std::string("Cannot disable WiFi power save (fake): wlan0: Operation not permitted"),
+                      manager.updateSessions(1, 1000));
+        ASSERT_STR_EQ(std::string(""), manager.updateSessions(1, 1016));
+        ASSERT_EQ(1, radio->sets);
+        ASSERT_STR_EQ(std::string(""), manager.updateSessions(0, 10000));
+        ASSERT_EQ(1, radio->sets);
+    });
+
+    // Test turning management off, or destroying the manager, restores power save
+    runner.addTest("NetworkManager restores power save when unmanaged or destroyed", []() {
+        auto radio = std::make_shared<FakeRadio>();
+        {
+            NetworkManager manager(std::unique_ptr<WifiPowerSave>(new FakePowerSave(radio)));
+            manager.configurePowerSave(managedSettings(), 0);
+            manager.updateSessions(1, 1000);
+            ASSERT_FALSE(radio->power_save);
+            NetworkManager::PowerSaveSettings off = managedSettings();
+            off.manage = false;
+            ASSERT_STR_EQ(std::string("WiFi power save restored on wlan0"), manager.configurePowerSave(off, 2000));
+            ASSERT_TRUE(radio->power_save);
+            ASSERT_STR_EQ(std::string(""), manager.updateSessions(1, 3000));
+            ASSERT_TRUE(radio->power_save);
+
+            manager.configurePowerSave(managedSettings(), 4000);
+            manager.updateSessions(1, 4000);
+            ASSERT_FALSE(radio->power_save);
+        }
+        ASSERT_TRUE(radio->power_save);
+    });
+
+    // Test RTTs are read from the kernel for connections on a port
+    runner.addTest("NetworkManager::tcpRtts reads connection RTTs", []() {
+        const int listener = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        ASSERT_EQ(0, bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)));
+        socklen_t len = sizeof(addr);
+        getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &len);
+        listen(listener, 1);
+        const int client = socket(AF_INET, SOCK_STREAM, 0);
+        ASSERT_EQ(0, connect(client, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)));
+        const int server = accept(listener, nullptr, nullptr);
+        char byte = 'x';
+        for (int i = 0; i < 4; ++i) {
+            ASSERT_EQ(1, static_cast<int>(write(server, &byte, 1)));
+            ASSERT_EQ(1, static_cast<int>(read(client, &byte, 1)));
+        }
+
+        const int port = ntohs(addr.sin_port);
+        std::vector<uint32_t> rtts;
+        std::string error;
+        ASSERT_TRUE(NetworkManager::tcpRtts(port, true, rtts, error));
+        ASSERT_EQ(1u, rtts.size());   // the server side; the client's local port differs
+        ASSERT_TRUE(rtts[0] > 0);
+        rtts.clear();
+        ASSERT_TRUE(NetworkManager::tcpRtts(port, false, rtts, error));
+        ASSERT_EQ(0u, rtts.size());
+        close(client);
+        close(server);
+        close(listener);
+    });
+
+    // Test the command backend substitutes the template, reports failures with
+    // the command's output, and kills a command that hangs, all without set()
+    // waiting for the command
+    runner.addTest("WifiPowerSave command backend runs with a deadline", []() {
+        std::string error;
+        std::unique_ptr<WifiPowerSave> ok = WifiPowerSave::command("test %i = wlan0 && test %s = off");
+        ASSERT_TRUE(ok->async());
+        ASSERT_TRUE(ok->set("wlan0", false, error));
+        WifiPowerSave::Completion done = finish(*ok);
+        ASSERT_TRUE(done.ok);
+        ASSERT_FALSE(done.enabled);
+        ASSERT_STR_EQ(std::string("wlan0"), done.iface);
+        ASSERT_FALSE(ok->poll(done));
+
+        std::unique_ptr<WifiPowerSave> failing = WifiPowerSave::command("echo no such device >&2; exit 3");
+        ASSERT_TRUE(failing->set("wlan0", true, error));
+        done = finish(*failing);
+        ASSERT_FALSE(done.ok);
+        ASSERT_TRUE(done.enabled);
+        ASSERT_TRUE(done.error.find("status 3: no such device") != std::string::npos);
+
+        std::unique_ptr<WifiPowerSave> hung = WifiPowerSave::command("exec sleep 30");
+        const auto start = std::chrono::steady_clock::now();
+        ASSERT_TRUE(hung->set("wlan0", true, error));
+        ASSERT_TRUE(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(500));
+        done = finish(*hung);
+        const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        ASSERT_TRUE(ms >= Network::POWER_SAVE_COMMAND_TIMEOUT_MS);
+        ASSERT_TRUE(ms < Network::POWER_SAVE_COMMAND_TIMEOUT_MS + 2000);
+        ASSERT_TRUE(done.error.find("timed out") != std::string::npos);
+    });
+
+    // Test command switches are logged when they finish, and a failed switch
+    // off is not restored
+    runner.addTest("NetworkManager reports command backend switches once they finish", []() {
+        NetworkManager::PowerSaveSettings settings = managedSettings();
+        settings.interface = "wlan0";
+        {
+            NetworkManager manager(WifiPowerSave::command("sleep 0.2"));
+            manager.configurePowerSave(settings, 0);
+            const auto start = std::chrono::steady_clock::now();
+            ASSERT_STR_EQ(std::string(""), manager.updateSessions(1, 1000));
+            ASSERT_TRUE(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(150));
+            ASSERT_TRUE(manager.powerSaveSwitching());
+            ASSERT_STR_EQ(std::string("WiFi power save off on wlan0"), awaitLine(manager, 1, 1100));
+            ASSERT_FALSE(manager.powerSaveSwitching());
+
+            ASSERT_STR_EQ(std::string(""), manager.updateSessions(0, 2000));
+            ASSERT_STR_EQ(std::string(""), manager.updateSessions(0, 7000));
+            ASSERT_STR_EQ(std::string("WiFi power save restored on wlan0"), awaitLine(manager, 0, 7100));
+        }
+        {
+            NetworkManager manager(WifiPowerSave::command("exit 1"));
+            manager.configurePowerSave(settings, 0);
+            ASSERT_STR_EQ(std::string(""), manager.updateSessions(1, 1000));
+            ASSERT_STR_EQ(std::string("Cannot disable WiFi power save (command): wlan0: 'exit 1' exited with status 1"),
+                          awaitLine(manager, 1, 1100));
+            ASSERT_STR_EQ(std::string(""), manager.updateSessions(0, 2000));
+            ASSERT_STR_EQ(std::string(""), manager.updateSessions(0, 7000));
+            ASSERT_FALSE(manager.powerSaveSwitching());
+        }
+    });
 }
@@ -1,5 +1,7 @@
 #include "test_framework.h"
 #include "../src/PathHelper.h"
+#include <sys/stat.h>
+#include <unistd.h>
 
 void registerPathHelperTests(TestRunner& runner) {
     // Test appBaseDir returns non-empty path
@@ -28,6 +30,13 @@ void registerPathHelperTests(TestRunner& runner) {
         ASSERT_TRUE(path.find("dropbearkey") != std::string::npos);
     });
     
+    // Test bundledSftpServerPath
+    runner.addTest("PathHelper::bundledSftpServerPath returns valid path", []() {
+        std::string path = PathHelper::bundledSftpServerPath();
+        ASSERT_TRUE(path.find(PathHelper::appBaseDir()) == 0);
+        ASSERT_TRUE(path.find("sftp-server") != std::string::npos);
+    });
+    
     // Test hostKeyPath
     runner.addTest("PathHelper::hostKeyPath returns valid path", []() {
         std::string path = PathHelper::hostKeyPath();
@@ -35,6 +44,13 @@ void registerPathHelperTests(TestRunner& runner) {
         ASSERT_TRUE(path.find("dropbear_rsa_host_key") != std::string::npos);
     });
     
+    // Test dropbearConfigPath
+    runner.addTest("PathHelper::dropbearConfigPath returns valid path", []() {
+        std::string path = PathHelper::dropbearConfigPath();
+        ASSERT_TRUE(path.find(PathHelper::appBaseDir()) == 0);
+        ASSERT_TRUE(path.find("dropbear.conf") != std::string::npos);
+    });
+    
     // Test paths are consistent
     runner.addTest("PathHelper paths use same base directory", []() {
         std::string baseDir = PathHelper::appBaseDir();
@@ -57,4 +73,37 @@ void registerPathHelperTests(TestRunner& runner) {
         ASSERT_TRUE(keygenPath.find("//") == std::string::npos);
         ASSERT_TRUE(hostKeyPath.find("//") == std::string::npos);
     });
+
+    // Test the link directory must be ours, a real directory, and not shared
+    runner.addTest("PathHelper::ensurePrivateDir rejects unsafe directories", []() {
+        const std::string base = "/tmp/dropbear_app_test_" + std::to_string(getpid());
+        const std::string dir = base + "_links";
+        const std::string alias = base + "_alias";
+        rmdir(dir.c_str());
+        unlink(alias.c_str());
+        std::string error;
+
+        ASSERT_TRUE(PathHelper::ensurePrivateDir(dir, error));   // created
+        ASSERT_TRUE(PathHelper::ensurePrivateDir(dir, error));   // reused
+
+        chmod(dir.c_str(), 0777);
+        ASSERT_FALSE(PathHelper::ensurePrivateDir(dir, error));
+        ASSERT_TRUE(error.find("writable by others") != std::string::npos);
+        chmod(dir.c_str(), 0755);
+
+        ASSERT_EQ(0, symlink(dir.c_str(), alias.c_str()));
+        ASSERT_FALSE(PathHelper::ensurePrivateDir(alias, error));
+        ASSERT_TRUE(error.find("not a directory") != std::string::npos);
+
+        // Planted by another user (only root can hand a directory over)
+        if (geteuid() == 0) {
+            ASSERT_EQ(0, chown(dir.c_str(), 65534, 65534));
+            ASSERT_FALSE(PathHelper::ensurePrivateDir(dir, error));
+            ASSERT_TRUE(error.find("owned by uid 65534") != std::string::npos);
+        }
+        ASSERT_FALSE(PathHelper::ensurePrivateDir("/tmp", error));
+
+        unlink(alias.c_str());
+        rmdir(dir.c_str());
+    });
 }
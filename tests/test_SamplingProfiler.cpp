@@ -0,0 +1,166 @@
+#include "test_framework.h"
+#include "../src/AllocStats.h"
+#include "../src/SamplingProfiler.h"
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string tempPath(const std::string& name) {
+    return "/tmp/dropbear_app_test_" + std::to_string(getpid()) + "_" + name;
+}
+
+// Spins on the CPU without touching the heap
+uint64_t burnCpu(int ms) {
+    volatile uint64_t x = 1;
+    const auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+    while (std::chrono::steady_clock::now() < until) {
+        for (int i = 0; i < 10000; ++i) x = x * 6364136223846793005ull + 1442695040888963407ull;
+    }
+    return x;
+}
+
+std::vector<std::string> readLines(const std::string& path) {
+    std::vector<std::string> lines;
+    FILE* f = fopen(path.c_str(), "r");
+    if (!f) return lines;
+    char buf[8192];
+    while (fgets(buf, sizeof(buf), f)) {
+        std::string line(buf);
+        if (!line.empty() && line.back() == '\n') line.pop_back();
+        lines.push_back(line);
+    }
+    fclose(f);
+    return lines;
+}
+
+} // namespace
+
+void registerSamplingProfilerTests(TestRunner& runner) {
+    // Test a busy thread is sampled, without heap use, into valid folded stacks
+    runner.addTest("SamplingProfiler samples a busy thread without allocating", []() {
+        SamplingProfiler::Settings settings;
+        settings.hz = 1000;
+        settings.children = false;
+        std::string error;
+        ASSERT_TRUE(SamplingProfiler::start(settings, error));
+        ASSERT_TRUE(SamplingProfiler::running());
+        const AllocStats::Totals before = AllocStats::snapshot();
+        burnCpu(300);
+        const AllocStats::Totals during = AllocStats::delta(before, AllocStats::snapshot());
+        SamplingProfiler::stop();
+        ASSERT_FALSE(SamplingProfiler::running());
+        ASSERT_EQ(0u, during.total().allocs);
+
+        const SamplingProfiler::Stats stats = SamplingProfiler::stats();
+        ASSERT_TRUE(stats.samples >= 10);
+        ASSERT_EQ(0u, stats.dropped);
+
+        const std::string path = tempPath("profile.folded");
+        ASSERT_TRUE(SamplingProfiler::writeFolded(path, error));
+        uint64_t total = 0;
+        bool sawThread = false;
+        size_t deepest = 0;
+        for (const auto& line : readLines(path)) {
+            const size_t space = line.rfind(' ');
+            ASSERT_TRUE(space != std::string::npos && space > 0);
+            total += std::strtoull(line.c_str() + space + 1, nullptr, 10);
+            if (line.compare(0, 12, "test_runner;") == 0) sawThread = true;
+            deepest = std::max<size_t>(deepest, std::count(line.begin(), line.end(), ';'));
+        }
+        ASSERT_EQ(stats.samples, total);
+        ASSERT_TRUE(sawThread);
+        // The frame-pointer walk got past the leaf: burnCpu, the test, the runner
+        ASSERT_TRUE(deepest >= 4);
+        unlink(path.c_str());
+    });
+
+    // Test samples beyond the preallocated buffer are counted, not stored
+    runner.addTest("SamplingProfiler drops samples past its buffer", []() {
+        SamplingProfiler::Settings settings;
+        settings.hz = 1000;
+        settings.max_samples = 4;
+        settings.children = false;
+        std::string error;
+        ASSERT_TRUE(SamplingProfiler::start(settings, error));
+        burnCpu(200);
+        SamplingProfiler::stop();
+        const SamplingProfiler::Stats stats = SamplingProfiler::stats();
+        ASSERT_EQ(4u, stats.samples);
+        ASSERT_TRUE(stats.dropped > 0);
+    });
+
+    // Test a named child process tree is sampled through /proc
+    runner.addTest("SamplingProfiler samples child processes by name", []() {
+        const pid_t child = fork();
+        if (child == 0) {
+            prctl(PR_SET_NAME, "dbprof_child", 0, 0, 0);
+            for (;;) pause();
+        }
+        ASSERT_TRUE(child > 0);
+        usleep(20000);   // let the child rename itself
+
+        SamplingProfiler::Settings settings;
+        settings.hz = 200;
+        settings.child_comm = "dbprof_child";
+        std::string error;
+        const bool started = SamplingProfiler::start(settings, error);
+        usleep(100000);
+        SamplingProfiler::stop();
+        kill(child, SIGKILL);
+        waitpid(child, nullptr, 0);
+        ASSERT_TRUE(started);
+        ASSERT_TRUE(SamplingProfiler::stats().child_samples >= 5);
+
+        const std::string path = tempPath("children.folded");
+        ASSERT_TRUE(SamplingProfiler::writeFolded(path, error));
+        const std::string prefix = "dbprof_child;[sleeping]";
+        bool sawChild = false;
+        for (const auto& line : readLines(path)) {
+            if (line.compare(0, prefix.size(), prefix) == 0) sawChild = true;
+        }
+        ASSERT_TRUE(sawChild);
+        unlink(path.c_str());
+    });
+
+    // Test toggle starts and stops, and a running profiler can't be restarted or written
+    runner.addTest("SamplingProfiler toggles and guards its state", []() {
+        SamplingProfiler::Settings settings;
+        settings.children = false;
+        const std::string path = tempPath("toggle.folded");
+
+        settings.hz = 0;
+        ASSERT_STR_EQ(std::string("Profiler disabled (profile_hz = 0)"), SamplingProfiler::toggle(settings, path));
+        ASSERT_FALSE(SamplingProfiler::running());
+
+        settings.hz = 99;
+        ASSERT_STR_EQ(std::string("Profiling at 99 Hz"), SamplingProfiler::toggle(settings, path));
+        std::string error;
+        ASSERT_FALSE(SamplingProfiler::start(settings, error));
+        ASSERT_FALSE(SamplingProfiler::writeFolded(path, error));
+        const std::string done = SamplingProfiler::toggle(settings, path);
+        ASSERT_FALSE(SamplingProfiler::running());
+        ASSERT_TRUE(done.compare(0, 9, "Profile: ") == 0);
+        ASSERT_TRUE(access(path.c_str(), F_OK) == 0);
+        unlink(path.c_str());
+    });
+
+    // Test the toggle signal only raises a flag, consumed once
+    runner.addTest("SamplingProfiler toggle signal sets a flag", []() {
+        std::string error;
+        ASSERT_TRUE(SamplingProfiler::installToggleSignal(SIGUSR2, error));
+        ASSERT_FALSE(SamplingProfiler::consumeToggleRequest());
+        raise(SIGUSR2);
+        ASSERT_TRUE(SamplingProfiler::consumeToggleRequest());
+        ASSERT_FALSE(SamplingProfiler::consumeToggleRequest());
+        signal(SIGUSR2, SIG_DFL);
+    });
+}
@@ -0,0 +1,104 @@
+#include "test_framework.h"
+#include "../src/SchedPolicy.h"
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <thread>
+
+void registerSchedPolicyTests(TestRunner& runner) {
+    // Test CPU lists with single CPUs, ranges and whitespace
+    runner.addTest("SchedPolicy parses CPU lists", []() {
+        cpu_set_t set;
+        std::string error;
+        ASSERT_TRUE(SchedPolicy::parseCpuList("0, 2-4", set, error));
+        ASSERT_EQ(4, CPU_COUNT(&set));
+        ASSERT_TRUE(CPU_ISSET(0, &set));
+        ASSERT_FALSE(CPU_ISSET(1, &set));
+        ASSERT_TRUE(CPU_ISSET(4, &set));
+
+        ASSERT_FALSE(SchedPolicy::parseCpuList("3-1", set, error));
+        ASSERT_FALSE(SchedPolicy::parseCpuList("a", set, error));
+        ASSERT_FALSE(SchedPolicy::parseCpuList(" , ", set, error));
+        ASSERT_FALSE(SchedPolicy::parseCpuList("-1", set, error));
+    });
+
+    // Test I/O priority classes encode like ioprio(1)
+    runner.addTest("SchedPolicy parses I/O priorities", []() {
+        int v = -1;
+        std::string error;
+        ASSERT_TRUE(SchedPolicy::parseIoPriority("", v, error));
+        ASSERT_EQ(0, v);
+        ASSERT_TRUE(SchedPolicy::parseIoPriority("idle", v, error));
+        ASSERT_EQ(3 << 13, v);
+        ASSERT_TRUE(SchedPolicy::parseIoPriority("best-effort:7", v, error));
+        ASSERT_EQ((2 << 13) | 7, v);
+        ASSERT_TRUE(SchedPolicy::parseIoPriority("realtime", v, error));
+        ASSERT_EQ((1 << 13) | 4, v);
+
+        ASSERT_FALSE(SchedPolicy::parseIoPriority("best-effort:8", v, error));
+        ASSERT_FALSE(SchedPolicy::parseIoPriority("idle:2", v, error));
+        ASSERT_FALSE(SchedPolicy::parseIoPriority("fast", v, error));
+    });
+
+    // Test invalid settings leave an empty policy behind
+    runner.addTest("SchedPolicy rejects invalid settings", []() {
+        SchedPolicy policy;
+        SchedPolicy::Settings s;
+        std::string error;
+        ASSERT_TRUE(policy.configure(s, error));
+        ASSERT_TRUE(policy.empty());
+        ASSERT_STR_EQ("default", policy.describe());
+
+        s.nice = 5;
+        s.cpus = "0-1";
+        s.ioprio = "idle";
+        ASSERT_TRUE(policy.configure(s, error));
+        ASSERT_FALSE(policy.empty());
+        ASSERT_STR_EQ("nice 5, cpus 0-1, io idle", policy.describe());
+
+        s.nice = 0;
+        s.cpus.clear();
+        s.ioprio.clear();
+        s.nice_set = true;
+        ASSERT_TRUE(policy.configure(s, error));
+        ASSERT_FALSE(policy.empty());
+        ASSERT_STR_EQ("nice 0", policy.describe());
+
+        s.nice = 20;
+        ASSERT_FALSE(policy.configure(s, error));
+        ASSERT_TRUE(policy.empty());
+        ASSERT_TRUE(error.find("nice") != std::string::npos);
+    });
+
+    // Test nice and affinity land on the calling thread only
+    runner.addTest("SchedPolicy applies to the calling thread", []() {
+        cpu_set_t allowed;
+        ASSERT_TRUE(sched_getaffinity(0, sizeof(allowed), &allowed) == 0);
+        int firstCpu = 0;
+        while (!CPU_ISSET(firstCpu, &allowed)) ++firstCpu;
+
+        SchedPolicy policy;
+        SchedPolicy::Settings s;
+        s.nice = 19;   // raising nice needs no privileges
+        s.cpus = std::to_string(firstCpu);
+        std::string error;
+        ASSERT_TRUE(policy.configure(s, error));
+
+        const int mainNice = getpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)));
+        const char* failed = "not run";
+        int threadNice = 0;
+        cpu_set_t threadCpus;
+        std::thread worker([&]() {
+            failed = policy.apply();
+            threadNice = getpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)));
+            sched_getaffinity(0, sizeof(threadCpus), &threadCpus);
+        });
+        worker.join();
+
+        ASSERT_TRUE(failed == nullptr);
+        ASSERT_EQ(19, threadNice);
+        ASSERT_EQ(1, CPU_COUNT(&threadCpus));
+        ASSERT_TRUE(CPU_ISSET(firstCpu, &threadCpus));
+        ASSERT_EQ(mainNice, getpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid))));
+    });
+}
@@ -0,0 +1,208 @@
+#include "test_framework.h"
+#include "../src/SpawnHelper.h"
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace {
+
+SpawnHelper::Request shell(const std::string& script) {
+    SpawnHelper::Request r;
+    r.path = "/bin/sh";
+    r.args = {"sh", "-c", script};
+    return r;
+}
+
+std::string readAll(int fd) {
+    std::string out;
+    char buf[256];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) out.append(buf, static_cast<size_t>(n));
+    return out;
+}
+
+} // namespace
+
+void registerSpawnHelperTests(TestRunner& runner) {
+    // Test the helper is the parent, passes the log pipe back and reports the exit
+    runner.addTest("SpawnHelper starts processes from the helper", []() {
+        SpawnHelper helper;
+        std::string error;
+        ASSERT_TRUE(helper.start(error));
+        ASSERT_TRUE(helper.running());
+
+        SpawnHelper::Request r = shell("echo out; echo err >&2; cut -d' ' -f19 /proc/self/stat; exit 3");
+        r.log_pipe = true;
+        r.sched.nice = 5;
+        pid_t pid = -1;
+        int fd = -1;
+        ASSERT_TRUE(helper.spawn(r, pid, fd, error));
+        ASSERT_TRUE(pid > 0);
+        ASSERT_TRUE(fd >= 0);
+        ASSERT_STR_EQ("out\nerr\n5\n", readAll(fd));
+        close(fd);
+
+        ASSERT_EQ(-1, waitpid(pid, nullptr, WNOHANG));   // not our child
+        ASSERT_EQ(ECHILD, errno);
+        int status = 0;
+        ASSERT_EQ(pid, helper.wait(pid, &status, 0));
+        ASSERT_TRUE(WIFEXITED(status));
+        ASSERT_EQ(3, WEXITSTATUS(status));
+        ASSERT_EQ(1u, helper.latency().count());
+        helper.stop();
+        ASSERT_FALSE(helper.running());
+    });
+
+    // Test a parked child takes its connection over the returned socketpair,
+    // with and without the helper
+    runner.addTest("SpawnHelper hands a connection to a waiting child", []() {
+        for (int useHelper = 0; useHelper < 2; ++useHelper) {
+            SpawnHelper helper;
+            std::string error;
+            if (useHelper) ASSERT_TRUE(helper.start(error));
+
+            int log[2];
+            ASSERT_TRUE(pipe(log) == 0);
+            SpawnHelper::Request r = shell("read line; echo \"got $line\"; echo logged >&2");
+            r.await_stdio = true;
+            r.stderr_fd = log[1];
+            pid_t pid = -1;
+            int fd = -1;
+            ASSERT_TRUE(helper.spawn(r, pid, fd, error));
+            close(log[1]);
+
+            int conn[2];
+            ASSERT_TRUE(socketpair(AF_UNIX, SOCK_STREAM, 0, conn) == 0);
+            ASSERT_TRUE(SpawnHelper::sendFd(fd, conn[1]));
+            close(conn[1]);
+            close(fd);
+            ASSERT_TRUE(write(conn[0], "hello\n", 6) == 6);
+            ASSERT_STR_EQ("got hello\n", readAll(conn[0]));
+            ASSERT_STR_EQ("logged\n", readAll(log[0]));
+            close(conn[0]);
+            close(log[0]);
+
+            int status = -1;
+            ASSERT_EQ(pid, helper.wait(pid, &status, 0));
+            ASSERT_EQ(0, status);
+        }
+    });
+
+    // Test WNOHANG returns at once while the child runs
+    runner.addTest("SpawnHelper::wait polls without blocking", []() {
+        SpawnHelper helper;
+        std::string error;
+        ASSERT_TRUE(helper.start(error));
+        pid_t pid = -1;
+        int fd = -1;
+        ASSERT_TRUE(helper.spawn(shell("exec sleep 5"), pid, fd, error));   // no orphaned sleep
+        ASSERT_EQ(-1, fd);
+        ASSERT_EQ(0, helper.wait(pid, nullptr, WNOHANG));
+
+        ASSERT_EQ(0, kill(pid, SIGKILL));
+        int status = 0;
+        ASSERT_EQ(pid, helper.wait(pid, &status, 0));
+        ASSERT_TRUE(WIFSIGNALED(status));
+        ASSERT_EQ(SIGKILL, WTERMSIG(status));
+    });
+
+    // Test a thread blocked in wait() doesn't hold up spawns and waits from
+    // another thread
+    runner.addTest("SpawnHelper::wait blocks without holding up other callers", []() {
+        SpawnHelper helper;
+        std::string error;
+        ASSERT_TRUE(helper.start(error));
+        pid_t slow = -1;
+        int fd = -1;
+        ASSERT_TRUE(helper.spawn(shell("exec sleep 0.5"), slow, fd, error));
+        int slowStatus = -1;
+        std::thread waiter([&]() { helper.wait(slow, &slowStatus, 0); });
+        usleep(50000);
+
+        const auto start = std::chrono::steady_clock::now();
+        pid_t quick = -1;
+        ASSERT_TRUE(helper.spawn(shell("exit 7"), quick, fd, error));
+        int status = 0;
+        ASSERT_EQ(quick, helper.wait(quick, &status, 0));
+        ASSERT_EQ(7, WEXITSTATUS(status));
+        ASSERT_EQ(0, helper.wait(slow, nullptr, WNOHANG));
+        ASSERT_TRUE(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(300));
+        waiter.join();
+        ASSERT_EQ(0, slowStatus);
+    });
+
+    // Test exits nobody waits for are dropped oldest first past a cap
+    runner.addTest("SpawnHelper bounds unclaimed exit reports", []() {
+        SpawnHelper helper;
+        std::string error;
+        ASSERT_TRUE(helper.start(error));
+        std::vector<pid_t> pids;
+        for (int i = 0; i < 300; ++i) {
+            pid_t pid = -1;
+            int fd = -1;
+            ASSERT_TRUE(helper.spawn(shell("exit 0"), pid, fd, error));
+            pids.push_back(pid);
+        }
+        usleep(100000);
+        ASSERT_EQ(pids.back(), helper.wait(pids.back(), nullptr, 0));
+        ASSERT_EQ(pids[pids.size() - 2], helper.wait(pids[pids.size() - 2], nullptr, 0));
+        ASSERT_EQ(-1, helper.wait(pids.front(), nullptr, WNOHANG));
+        ASSERT_EQ(ECHILD, errno);
+    });
+
+    // Test a caller's blocked signals (the headless daemon blocks SIGTERM,
+    // SIGINT and SIGHUP outside ppoll) don't reach the child
+    runner.addTest("SpawnHelper children start with no signals blocked", []() {
+        sigset_t blocked;
+        sigemptyset(&blocked);
+        sigaddset(&blocked, SIGTERM);
+        sigaddset(&blocked, SIGHUP);
+        sigprocmask(SIG_BLOCK, &blocked, nullptr);
+        signal(SIGPIPE, SIG_IGN);
+
+        SpawnHelper helper;   // not started: forks this process directly
+        SpawnHelper::Request r = shell("grep -E '^Sig(Blk|Ign)' /proc/self/status");
+        r.log_pipe = true;
+        pid_t pid = -1;
+        int fd = -1;
+        std::string error;
+        ASSERT_TRUE(helper.spawn(r, pid, fd, error));
+        const std::string out = readAll(fd);
+        close(fd);
+        helper.wait(pid, nullptr, 0);
+        unsigned long long blk = ~0ULL, ign = ~0ULL;
+        ASSERT_EQ(2, sscanf(out.c_str(), "SigBlk: %llx SigIgn: %llx", &blk, &ign));
+        // Bit n-1 is signal n; other ignores may come from whoever ran the tests
+        const unsigned long long ours = (1ULL << (SIGTERM - 1)) | (1ULL << (SIGHUP - 1)) |
+                                        (1ULL << (SIGPIPE - 1));
+        ASSERT_EQ(0ULL, blk);
+        ASSERT_EQ(0ULL, ign & ours);
+    });
+
+    // Test spawning falls back to a direct fork once the helper is stopped
+    runner.addTest("SpawnHelper forks directly without a helper", []() {
+        SpawnHelper helper;
+        std::string error;
+        ASSERT_TRUE(helper.start(error));
+        helper.stop();
+
+        pid_t pid = -1;
+        int fd = -1;
+        ASSERT_TRUE(helper.spawn(shell("exit 7"), pid, fd, error));
+        int status = 0;
+        ASSERT_EQ(pid, helper.wait(pid, &status, 0));
+        ASSERT_EQ(7, WEXITSTATUS(status));
+
+        SpawnHelper::Request missing = shell("");
+        missing.path = "/nonexistent/dropbear";
+        ASSERT_TRUE(helper.spawn(missing, pid, fd, error));
+        ASSERT_EQ(pid, helper.wait(pid, &status, 0));
+        ASSERT_EQ(127, WEXITSTATUS(status));
+    });
+}
@@ -0,0 +1,174 @@
+#include "test_framework.h"
+#include "../src/SshProbe.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstring>
+#include <ctime>
+#include <thread>
+
+namespace {
+
+uint64_t monotonicMicros() {
+    struct timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000 + static_cast<uint64_t>(ts.tv_nsec) / 1000;
+}
+
+// Loopback listener on an ephemeral port; optionally answers with a banner
+struct FakeServer {
+    int fd = -1;
+    int port = 0;
+    std::atomic<int> peer_port{0};
+    std::thread thread;
+
+    explicit FakeServer(const char* banner) {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+        listen(fd, 4);
+        socklen_t len = sizeof(addr);
+        getsockname(fd, reinterpret_cast<struct sockaddr*>(&addr), &len);
+        port = ntohs(addr.sin_port);
+
+        thread = std::thread([this, banner]() {
+            struct sockaddr_in peer{};
+            socklen_t plen = sizeof(peer);
+            int c = accept(fd, reinterpret_cast<struct sockaddr*>(&peer), &plen);
+            if (c < 0) return;
+            peer_port = ntohs(peer.sin_port);
+            if (banner) {
+                ssize_t ignored = write(c, banner, strlen(banner));
+                (void)ignored;
+            }
+            // Hold the connection until the probe hangs up
+            char buf[16];
+            while (read(c, buf, sizeof(buf)) > 0) {}
+            close(c);
+        });
+    }
+
+    ~FakeServer() {
+        shutdown(fd, SHUT_RDWR);
+        close(fd);
+        if (thread.joinable()) thread.join();
+    }
+};
+
+SshProbe::Settings probeSettings(int port) {
+    SshProbe::Settings s;
+    s.port = port;
+    s.interval_secs = 1;
+    s.failures_to_restart = 2;
+    s.timeout_ms = 200;
+    s.spike_ms = 1000;
+    return s;
+}
+
+// Drives one probe to completion. The probe's clock runs ahead of the real
+// monotonic clock by skew, which grows by one interval per call so every call
+// starts a fresh probe without sleeping
+SshProbe::Result runProbe(SshProbe& probe, uint64_t& skew) {
+    skew += 1000000;
+    SshProbe::Result r = probe.poll(monotonicMicros() + skew);
+    while (r == SshProbe::Result::None) {
+        if (probe.fd() >= 0) {
+            struct pollfd pfd = {probe.fd(), POLLIN, 0};
+            ::poll(&pfd, 1, 20);
+        }
+        r = probe.poll(monotonicMicros() + skew);
+    }
+    return r;
+}
+
+} // namespace
+
+void registerSshProbeTests(TestRunner& runner) {
+    // Test successful probe reads the banner
+    runner.addTest("SshProbe succeeds on SSH banner", []() {
+        FakeServer server("SSH-2.0-dropbear_test\r\n");
+        SshProbe probe;
+        probe.configure(probeSettings(server.port));
+        uint64_t clock = 0;
+        probe.reset(monotonicMicros());
+
+        ASSERT_TRUE(runProbe(probe, clock) == SshProbe::Result::Ok);
+        ASSERT_TRUE(probe.health() == SshProbe::Health::Healthy);
+        ASSERT_TRUE(probe.lastSample().ok);
+        ASSERT_TRUE(probe.lastSample().latency_us < 200000);
+        ASSERT_TRUE(probe.fd() < 0);
+
+        // The server saw our source port, which is how dropbear's log lines are matched
+        for (int i = 0; i < 100 && server.peer_port == 0; ++i) usleep(1000);
+        ASSERT_TRUE(probe.isProbePort(server.peer_port));
+        ASSERT_FALSE(probe.isProbePort(1));
+    });
+
+    // Test refused connections and restart threshold
+    runner.addTest("SshProbe reports down after consecutive failures", []() {
+        int port;
+        {
+            FakeServer closed(nullptr);
+            port = closed.port;
+        }
+        SshProbe probe;
+        probe.configure(probeSettings(port));
+        uint64_t clock = 0;
+        probe.reset(monotonicMicros());
+
+        ASSERT_TRUE(runProbe(probe, clock) == SshProbe::Result::Failed);
+        ASSERT_TRUE(probe.health() == SshProbe::Health::Degraded);
+        ASSERT_FALSE(probe.needsRestart());
+        ASSERT_TRUE(runProbe(probe, clock) == SshProbe::Result::Failed);
+        ASSERT_TRUE(probe.needsRestart());
+        ASSERT_TRUE(probe.health() == SshProbe::Health::Down);
+        ASSERT_FALSE(probe.lastError().empty());
+
+        // A restart resets the streak
+        probe.reset(monotonicMicros());
+        ASSERT_FALSE(probe.needsRestart());
+    });
+
+    // Test a wedged listener that accepts but never speaks
+    runner.addTest("SshProbe times out without banner", []() {
+        FakeServer silent("");
+        SshProbe probe;
+        probe.configure(probeSettings(silent.port));
+        uint64_t clock = 0;
+        probe.reset(monotonicMicros());
+
+        ASSERT_TRUE(runProbe(probe, clock) == SshProbe::Result::Failed);
+        ASSERT_TRUE(probe.lastError().find("no banner") != std::string::npos);
+    });
+
+    // Test slow banners count toward a restart
+    runner.addTest("SshProbe treats latency spikes as degraded", []() {
+        FakeServer server("SSH-2.0-dropbear_test\r\n");
+        SshProbe::Settings s = probeSettings(server.port);
+        s.spike_ms = 0;
+        SshProbe probe;
+        probe.configure(s);
+        uint64_t clock = 0;
+        probe.reset(monotonicMicros());
+
+        ASSERT_TRUE(runProbe(probe, clock) == SshProbe::Result::Ok);
+        ASSERT_TRUE(probe.health() == SshProbe::Health::Degraded);
+    });
+
+    // Test disabled probe never connects
+    runner.addTest("SshProbe with interval 0 is disabled", []() {
+        SshProbe::Settings s = probeSettings(22);
+        s.interval_secs = 0;
+        SshProbe probe;
+        probe.configure(s);
+        probe.reset(0);
+        ASSERT_TRUE(probe.poll(1000000000ULL) == SshProbe::Result::None);
+        ASSERT_TRUE(probe.fd() < 0);
+        ASSERT_TRUE(probe.health() == SshProbe::Health::Unknown);
+    });
+}
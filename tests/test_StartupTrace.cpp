@@ -0,0 +1,83 @@
+#include "test_framework.h"
+#include "../src/StartupTrace.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+void registerStartupTraceTests(TestRunner& runner) {
+    // Test monotonic clock
+    runner.addTest("StartupTrace::nowMicros is monotonic", []() {
+        uint64_t a = StartupTrace::nowMicros();
+        uint64_t b = StartupTrace::nowMicros();
+        ASSERT_TRUE(a > 0);
+        ASSERT_TRUE(b >= a);
+    });
+
+    // Test time since launch grows and covers at least this test's runtime
+    runner.addTest("StartupTrace::sinceLaunchMicros counts from process start", []() {
+        uint64_t a = StartupTrace::sinceLaunchMicros();
+        usleep(2000);
+        uint64_t b = StartupTrace::sinceLaunchMicros();
+        ASSERT_TRUE(a > 0);
+        ASSERT_TRUE(b >= a + 2000);
+    });
+
+    // Test scope records a complete event
+    runner.addTest("StartupTrace::Scope records complete event", []() {
+        StartupTrace::reset();
+        {
+            StartupTrace::Scope scope("test phase");
+            usleep(1000);
+        }
+        ASSERT_TRUE(StartupTrace::has("test phase"));
+        std::string json = StartupTrace::toJson();
+        ASSERT_TRUE(json.find("\"name\":\"test phase\",\"ph\":\"X\"") != std::string::npos);
+        ASSERT_TRUE(json.find("\"dur\":") != std::string::npos);
+    });
+
+    // Test instant events
+    runner.addTest("StartupTrace::instant records global instant event", []() {
+        StartupTrace::reset();
+        ASSERT_FALSE(StartupTrace::has("ready"));
+        StartupTrace::instant("ready");
+        ASSERT_TRUE(StartupTrace::has("ready"));
+        std::string json = StartupTrace::toJson();
+        ASSERT_TRUE(json.find("\"ph\":\"i\"") != std::string::npos);
+        ASSERT_TRUE(json.find("\"s\":\"g\"") != std::string::npos);
+    });
+
+    // Test JSON shape expected by chrome://tracing
+    runner.addTest("StartupTrace::toJson produces trace event container", []() {
+        StartupTrace::reset();
+        StartupTrace::complete("quoted \"name\"", 100, 250);
+        std::string json = StartupTrace::toJson();
+        ASSERT_TRUE(json.find("{\"displayTimeUnit\":\"ms\"") == 0);
+        ASSERT_TRUE(json.find("\"traceEvents\":[") != std::string::npos);
+        ASSERT_TRUE(json.find("quoted \\\"name\\\"") != std::string::npos);
+        ASSERT_TRUE(json.find("\"dur\":150") != std::string::npos);
+        ASSERT_TRUE(json.find("]}") != std::string::npos);
+    });
+
+    // Test reset clears events
+    runner.addTest("StartupTrace::reset clears events", []() {
+        StartupTrace::instant("something");
+        StartupTrace::reset();
+        ASSERT_FALSE(StartupTrace::has("something"));
+    });
+
+    // Test file output
+    runner.addTest("StartupTrace::writeFile writes JSON atomically", []() {
+        StartupTrace::reset();
+        StartupTrace::instant("written");
+        const std::string path = "/tmp/test_startup_trace_" + std::to_string(getpid()) + ".json";
+        ASSERT_TRUE(StartupTrace::writeFile(path));
+
+        std::ifstream in(path);
+        std::stringstream content;
+        content << in.rdbuf();
+        ASSERT_TRUE(content.str().find("written") != std::string::npos);
+        std::remove(path.c_str());
+        StartupTrace::reset();
+    });
+}
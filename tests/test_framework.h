@@ -1,52 +1,538 @@
 #pragma once
 
 #include "test_helpers.h"
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
 #include <iostream>
-#include <vector>
+#include <map>
+#include <sstream>
 #include <string>
-#include <functional>
+#include <thread>
+#include <vector>
 
 // Test framework
+//
+// By default every test runs in its own forked process, up to --jobs at a
+// time (default: core count). Isolation makes tests independent of each
+// other's global state, lets a hung test be killed at its timeout (with its
+// process group, so the processes it started go too), and turns a crash into
+// a failure instead of taking the whole run down.
+//
+// Arguments: [--jobs N] [--timeout SECS] [--filter TEXT] [--no-fork]
+//            [--junit FILE] [--json FILE] [--compare FILE] [--slowest N]
 class TestRunner {
 public:
     using TestFunc = std::function<void()>;
-    
-    void addTest(const std::string& name, TestFunc func) {
-        tests_.push_back({name, func});
+
+    static constexpr double kDefaultTimeoutSecs = 30.0;
+
+    // timeoutSecs <= 0 uses the run-wide --timeout
+    void addTest(const std::string& name, TestFunc func, double timeoutSecs = 0) {
+        tests_.push_back({name, func, timeoutSecs});
     }
-    
+
     int run() {
-        std::cout << "Running " << tests_.size() << " tests...\n\n";
-        
-        int passed = 0;
-        int failed = 0;
-        
-        for (const auto& test : tests_) {
-            try {
-                std::cout << "[ RUN  ] " << test.name << std::endl;
-                test.func();
-                std::cout << "[ PASS ] " << test.name << std::endl;
-                passed++;
-            } catch (const std::exception& e) {
-                std::cout << "[ FAIL ] " << test.name << std::endl;
-                std::cout << "         " << e.what() << std::endl;
-                failed++;
+        char prog[] = "test_runner";
+        char* argv[] = {prog, nullptr};
+        return run(1, argv);
+    }
+
+    int run(int argc, char* argv[]) {
+        Options opt;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--jobs" && i + 1 < argc) opt.jobs = std::max(1, std::atoi(argv[++i]));
+            else if (arg == "--timeout" && i + 1 < argc) opt.timeout_secs = std::atof(argv[++i]);
+            else if (arg == "--filter" && i + 1 < argc) opt.filter = argv[++i];
+            else if (arg == "--junit" && i + 1 < argc) opt.junit_path = argv[++i];
+            else if (arg == "--json" && i + 1 < argc) opt.json_path = argv[++i];
+            else if (arg == "--compare" && i + 1 < argc) opt.compare_path = argv[++i];
+            else if (arg == "--slowest" && i + 1 < argc) opt.slowest = std::atoi(argv[++i]);
+            else if (arg == "--no-fork") opt.fork = false;
+            else {
+                std::cerr << "unknown argument: " << arg << std::endl;
+                return 2;
+            }
+        }
+
+        std::vector<size_t> selected;
+        for (size_t i = 0; i < tests_.size(); ++i) {
+            if (opt.filter.empty() || tests_[i].name.find(opt.filter) != std::string::npos) {
+                selected.push_back(i);
             }
         }
-        
+
+        std::cout << "Running " << selected.size() << " tests";
+        if (opt.fork) std::cout << " (" << opt.jobs << (opt.jobs == 1 ? " job)" : " jobs)");
+        std::cout << "...\n\n" << std::flush;
+
+        const auto wallStart = Clock::now();
+        std::vector<Result> results = opt.fork ? runForked(selected, opt) : runInProcess(selected);
+        const double wallMs = msSince(wallStart);
+
+        int passed = 0;
+        int failed = 0;
+        for (const auto& r : results) (r.passed ? passed : failed)++;
+
+        reportSlowest(results, opt);
+        if (!opt.junit_path.empty()) writeJUnit(opt.junit_path, results, wallMs);
+        if (!opt.json_path.empty()) writeJson(opt.json_path, results, wallMs);
+
         std::cout << "\n========================================\n";
-        std::cout << "Tests passed: " << passed << "/" << tests_.size() << std::endl;
-        std::cout << "Tests failed: " << failed << "/" << tests_.size() << std::endl;
+        std::cout << "Tests passed: " << passed << "/" << results.size() << std::endl;
+        std::cout << "Tests failed: " << failed << "/" << results.size() << std::endl;
+        std::cout << "Wall time: " << formatMs(wallMs) << std::endl;
         std::cout << "========================================\n";
-        
+
         return failed == 0 ? 0 : 1;
     }
-    
+
 private:
+    using Clock = std::chrono::steady_clock;
+
     struct Test {
         std::string name;
         TestFunc func;
+        double timeout_secs;
+    };
+
+    struct Options {
+        int jobs = std::max(1u, std::thread::hardware_concurrency());
+        double timeout_secs = kDefaultTimeoutSecs;
+        bool fork = true;
+        int slowest = 5;
+        std::string filter;
+        std::string junit_path;
+        std::string json_path;
+        std::string compare_path;
+    };
+
+    struct Result {
+        size_t index;
+        std::string name;
+        bool passed = false;
+        bool timed_out = false;
+        double ms = 0;
+        std::string message;   // failure reason
+        std::string output;    // captured stdout/stderr (forked mode)
     };
-    
+
+    struct Child {
+        pid_t pid;
+        size_t index;
+        int out_fd;            // test's stdout/stderr
+        int msg_fd;            // failure message
+        Clock::time_point start;
+        Clock::time_point deadline;
+        std::string out;
+        std::string msg;
+    };
+
+    static double msSince(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    static std::string formatMs(double ms) {
+        char buf[32];
+        if (ms < 1000) std::snprintf(buf, sizeof(buf), "%.1f ms", ms);
+        else std::snprintf(buf, sizeof(buf), "%.2f s", ms / 1000);
+        return buf;
+    }
+
+    static void printResult(const Result& r) {
+        std::cout << (r.passed ? "[ PASS ] " : r.timed_out ? "[ TIME ] " : "[ FAIL ] ")
+                  << r.name << " (" << formatMs(r.ms) << ")" << std::endl;
+        if (!r.passed) {
+            std::cout << "         " << r.message << std::endl;
+            if (!r.output.empty()) {
+                std::istringstream lines(r.output);
+                std::string line;
+                while (std::getline(lines, line)) std::cout << "         | " << line << "\n";
+            }
+        }
+    }
+
+    std::vector<Result> runInProcess(const std::vector<size_t>& selected) {
+        std::vector<Result> results;
+        for (size_t idx : selected) {
+            const Test& test = tests_[idx];
+            Result r;
+            r.index = idx;
+            r.name = test.name;
+            std::cout << "[ RUN  ] " << test.name << std::endl;
+            const auto start = Clock::now();
+            try {
+                test.func();
+                r.passed = true;
+            } catch (const std::exception& e) {
+                r.message = e.what();
+            }
+            r.ms = msSince(start);
+            printResult(r);
+            results.push_back(r);
+        }
+        return results;
+    }
+
+    bool spawn(size_t idx, const Options& opt, Child& child) {
+        int out[2], msg[2];
+        if (pipe(out) == -1) return false;
+        if (pipe(msg) == -1) {
+            close(out[0]);
+            close(out[1]);
+            return false;
+        }
+        std::cout.flush();
+        std::fflush(nullptr);
+
+        const Test& test = tests_[idx];
+        child.start = Clock::now();
+        pid_t pid = fork();
+        if (pid == -1) {
+            for (int fd : {out[0], out[1], msg[0], msg[1]}) close(fd);
+            return false;
+        }
+
+        if (pid == 0) {
+            // Own process group, so a timeout also takes down what the test started
+            setpgid(0, 0);
+            signal(SIGCHLD, SIG_DFL);
+            close(out[0]);
+            close(chld_pipe_[0]);
+            close(chld_pipe_[1]);
+            close(msg[0]);
+            dup2(out[1], STDOUT_FILENO);
+            dup2(out[1], STDERR_FILENO);
+            close(out[1]);
+
+            int code = 0;
+            std::string what;
+            try {
+                test.func();
+            } catch (const std::exception& e) {
+                what = e.what();
+                code = 1;
+            } catch (...) {
+                what = "unknown exception";
+                code = 1;
+            }
+            std::cout.flush();
+            std::fflush(nullptr);
+            if (!what.empty()) {
+                ssize_t ignored = write(msg[1], what.data(), what.size());
+                (void)ignored;
+            }
+            _exit(code);   // skip the parent's atexit handlers and static destructors
+        }
+
+        setpgid(pid, pid);   // also here: the child may not have run yet at a timeout
+        close(out[1]);
+        close(msg[1]);
+        const double timeout = test.timeout_secs > 0 ? test.timeout_secs : opt.timeout_secs;
+        child.pid = pid;
+        child.index = idx;
+        child.out_fd = out[0];
+        child.msg_fd = msg[0];
+        child.deadline = child.start + std::chrono::microseconds(static_cast<int64_t>(timeout * 1e6));
+        return true;
+    }
+
+    static void drain(int& fd, std::string& into) {
+        if (fd < 0) return;
+        char buf[4096];
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n > 0) {
+            into.append(buf, static_cast<size_t>(n));
+        } else if (n == 0 || (errno != EINTR && errno != EAGAIN)) {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    // Reads what is buffered now, without waiting for EOF
+    static void drainAvailable(int fd, std::string& into) {
+        if (fd < 0) return;
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        char buf[4096];
+        for (;;) {
+            const ssize_t n = read(fd, buf, sizeof(buf));
+            if (n > 0) into.append(buf, static_cast<size_t>(n));
+            else if (n == -1 && errno == EINTR) continue;
+            else break;
+        }
+    }
+
+    static Result finishChild(Child& c, const std::string& name, int status, bool timedOut) {
+        Result r;
+        r.index = c.index;
+        r.name = name;
+        r.ms = msSince(c.start);
+        r.output = c.out;
+        r.timed_out = timedOut;
+        if (timedOut) {
+            r.message = "timed out after " + formatMs(r.ms);
+        } else if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+            r.passed = true;
+        } else if (WIFSIGNALED(status)) {
+            r.message = std::string("killed by signal ") + std::to_string(WTERMSIG(status)) +
+                        " (" + strsignal(WTERMSIG(status)) + ")";
+        } else {
+            r.message = c.msg.empty() ? "exit status " + std::to_string(WEXITSTATUS(status)) : c.msg;
+        }
+        for (int fd : {c.out_fd, c.msg_fd}) {
+            if (fd >= 0) close(fd);
+        }
+        return r;
+    }
+
+    static int& chldWriteFd() {
+        static int fd = -1;
+        return fd;
+    }
+
+    static void onSigchld(int) {
+        const int saved = errno;
+        char c = 0;
+        ssize_t ignored = write(chldWriteFd(), &c, 1);
+        (void)ignored;
+        errno = saved;
+    }
+
+    // Single-threaded scheduler over a pool of forked children: forking from
+    // one thread keeps the children free of locks held by sibling threads.
+    // SIGCHLD lands on a self-pipe so an exit wakes poll() immediately.
+    std::vector<Result> runForked(const std::vector<size_t>& selected, const Options& opt) {
+        std::vector<Result> results;
+        std::vector<Child> running;
+        size_t next = 0;
+
+        if (pipe(chld_pipe_) == -1) return runInProcess(selected);
+        for (int fd : chld_pipe_) fcntl(fd, F_SETFL, O_NONBLOCK);
+        chldWriteFd() = chld_pipe_[1];
+        struct sigaction sa{}, oldSa{};
+        sa.sa_handler = onSigchld;
+        sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGCHLD, &sa, &oldSa);
+
+        while (next < selected.size() || !running.empty()) {
+            while (static_cast<int>(running.size()) < opt.jobs && next < selected.size()) {
+                Child c;
+                const size_t idx = selected[next++];
+                if (spawn(idx, opt, c)) {
+                    running.push_back(c);
+                } else {
+                    Result r;
+                    r.index = idx;
+                    r.name = tests_[idx].name;
+                    r.message = std::string("fork failed: ") + strerror(errno);
+                    printResult(r);
+                    results.push_back(r);
+                }
+            }
+
+            std::vector<struct pollfd> pfds;
+            for (const auto& c : running) {
+                pfds.push_back({c.out_fd, POLLIN, 0});
+                pfds.push_back({c.msg_fd, POLLIN, 0});
+            }
+            int waitMs = -1;
+            const auto now = Clock::now();
+            for (const auto& c : running) {
+                const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(c.deadline - now).count();
+                const int ms = static_cast<int>(std::max<long long>(0, left) + 1);
+                if (waitMs < 0 || ms < waitMs) waitMs = ms;
+            }
+            pfds.push_back({chld_pipe_[0], POLLIN, 0});
+            ::poll(pfds.data(), pfds.size(), waitMs);
+            if (pfds.back().revents) {
+                char buf[64];
+                while (read(chld_pipe_[0], buf, sizeof(buf)) > 0) {}
+            }
+
+            for (size_t i = 0; i < running.size(); ) {
+                Child& c = running[i];
+                if (pfds[2 * i].revents) drain(c.out_fd, c.out);
+                if (pfds[2 * i + 1].revents) drain(c.msg_fd, c.msg);
+
+                int status = 0;
+                bool done = false;
+                bool timedOut = false;
+                if (waitpid(c.pid, &status, WNOHANG) == c.pid) {
+                    // Pick up anything written right before exit. One pass:
+                    // a grandchild still holding the pipe must not keep us here
+                    drainAvailable(c.out_fd, c.out);
+                    drainAvailable(c.msg_fd, c.msg);
+                    done = true;
+                } else if (Clock::now() >= c.deadline) {
+                    kill(-c.pid, SIGKILL);
+                    waitpid(c.pid, &status, 0);
+                    done = true;
+                    timedOut = true;
+                }
+
+                if (done) {
+                    Result r = finishChild(c, tests_[c.index].name, status, timedOut);
+                    printResult(r);
+                    results.push_back(r);
+                    running.erase(running.begin() + static_cast<long>(i));
+                    pfds.erase(pfds.begin() + static_cast<long>(2 * i), pfds.begin() + static_cast<long>(2 * i + 2));
+                } else {
+                    ++i;
+                }
+            }
+        }
+
+        sigaction(SIGCHLD, &oldSa, nullptr);
+        chldWriteFd() = -1;
+        close(chld_pipe_[0]);
+        close(chld_pipe_[1]);
+
+        std::sort(results.begin(), results.end(),
+                  [](const Result& a, const Result& b) { return a.index < b.index; });
+        return results;
+    }
+
+    void reportSlowest(const std::vector<Result>& results, const Options& opt) const {
+        std::map<std::string, double> previous;
+        if (!opt.compare_path.empty()) previous = loadJsonDurations(opt.compare_path);
+
+        if (opt.slowest > 0 && !results.empty()) {
+            std::vector<const Result*> byTime;
+            for (const auto& r : results) byTime.push_back(&r);
+            std::sort(byTime.begin(), byTime.end(),
+                      [](const Result* a, const Result* b) { return a->ms > b->ms; });
+
+            std::cout << "\nSlowest tests:\n";
+            for (int i = 0; i < opt.slowest && i < static_cast<int>(byTime.size()); ++i) {
+                const Result& r = *byTime[i];
+                std::printf("  %10s  %s", formatMs(r.ms).c_str(), r.name.c_str());
+                auto it = previous.find(r.name);
+                if (it != previous.end()) std::printf("  (was %s)", formatMs(it->second).c_str());
+                std::printf("\n");
+            }
+            std::fflush(stdout);
+        }
+
+        // Drift: clearly slower than the compared run, ignoring sub-10 ms noise
+        if (!previous.empty()) {
+            std::vector<std::string> drifted;
+            for (const auto& r : results) {
+                auto it = previous.find(r.name);
+                if (it != previous.end() && r.ms > it->second * 1.5 && r.ms - it->second > 10.0) {
+                    drifted.push_back("  " + r.name + ": " + formatMs(it->second) + " -> " + formatMs(r.ms));
+                }
+            }
+            std::cout << "\nSlower than " << opt.compare_path << ": "
+                      << (drifted.empty() ? "none" : std::to_string(drifted.size())) << "\n";
+            for (const auto& line : drifted) std::cout << line << "\n";
+        }
+    }
+
+    static std::string escapeXml(const std::string& s) {
+        std::string out;
+        for (char c : s) {
+            switch (c) {
+                case '&':  out += "&amp;"; break;
+                case '<':  out += "&lt;"; break;
+                case '>':  out += "&gt;"; break;
+                case '"':  out += "&quot;"; break;
+                case '\'': out += "&apos;"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20 && c != '\n' && c != '\t') out += ' ';
+                    else out += c;
+            }
+        }
+        return out;
+    }
+
+    static std::string escapeJson(const std::string& s) {
+        std::string out;
+        for (char c : s) {
+            if (c == '"' || c == '\\') { out += '\\'; out += c; }
+            else if (c == '\n') out += "\\n";
+            else if (static_cast<unsigned char>(c) < 0x20) out += ' ';
+            else out += c;
+        }
+        return out;
+    }
+
+    // "PathHelper::appBaseDir ..." and "PathHelper paths ..." both -> "PathHelper"
+    static std::string suiteOf(const std::string& name) {
+        size_t end = name.find_first_of(": ");
+        return name.substr(0, end);
+    }
+
+    static void writeJUnit(const std::string& path, const std::vector<Result>& results, double wallMs) {
+        std::ofstream out(path, std::ios::trunc);
+        int failures = 0;
+        for (const auto& r : results) if (!r.passed) failures++;
+
+        out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+        out << "<testsuite name=\"dropbear-app\" tests=\"" << results.size() << "\" failures=\""
+            << failures << "\" errors=\"0\" time=\"" << wallMs / 1000 << "\">\n";
+        for (const auto& r : results) {
+            out << "  <testcase classname=\"" << escapeXml(suiteOf(r.name)) << "\" name=\""
+                << escapeXml(r.name) << "\" time=\"" << r.ms / 1000 << "\"";
+            if (r.passed) {
+                out << "/>\n";
+                continue;
+            }
+            out << ">\n    <failure message=\"" << escapeXml(r.message) << "\"/>\n";
+            if (!r.output.empty()) {
+                out << "    <system-out>" << escapeXml(r.output) << "</system-out>\n";
+            }
+            out << "  </testcase>\n";
+        }
+        out << "</testsuite>\n";
+    }
+
+    // One test object per line so loadJsonDurations() can read it back without
+    // a JSON library
+    static void writeJson(const std::string& path, const std::vector<Result>& results, double wallMs) {
+        std::ofstream out(path, std::ios::trunc);
+        out << "{\"wall_ms\":" << wallMs << ",\"tests\":[\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const Result& r = results[i];
+            out << "{\"name\":\"" << escapeJson(r.name) << "\",\"status\":\""
+                << (r.passed ? "passed" : r.timed_out ? "timeout" : "failed")
+                << "\",\"duration_ms\":" << r.ms << ",\"message\":\"" << escapeJson(r.message) << "\"}"
+                << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "]}\n";
+    }
+
+    static std::map<std::string, double> loadJsonDurations(const std::string& path) {
+        std::map<std::string, double> out;
+        std::ifstream in(path);
+        std::string line;
+        const std::string nameKey = "{\"name\":\"";
+        const std::string durKey = "\"duration_ms\":";
+        while (std::getline(in, line)) {
+            if (line.compare(0, nameKey.size(), nameKey) != 0) continue;
+            std::string name;
+            size_t i = nameKey.size();
+            for (; i < line.size() && line[i] != '"'; ++i) {
+                if (line[i] == '\\' && i + 1 < line.size()) ++i;
+                name += line[i];
+            }
+            size_t dur = line.find(durKey, i);
+            if (dur != std::string::npos) out[name] = std::atof(line.c_str() + dur + durKey.size());
+        }
+        return out;
+    }
+
     std::vector<Test> tests_;
+    int chld_pipe_[2] = {-1, -1};
 };
@@ -4,14 +4,58 @@
 void registerPathHelperTests(TestRunner& runner);
 void registerNetworkManagerTests(TestRunner& runner);
 void registerColorTests(TestRunner& runner);
+void registerDropbearConfigTests(TestRunner& runner);
+void registerStartupTraceTests(TestRunner& runner);
+void registerDropbearLogParserTests(TestRunner& runner);
+void registerMetricsTests(TestRunner& runner);
+void registerLogLineSplitterTests(TestRunner& runner);
+void registerAuthGuardTests(TestRunner& runner);
+void registerLogFileTests(TestRunner& runner);
+void registerLogRecordingTests(TestRunner& runner);
+void registerLatencyHistogramTests(TestRunner& runner);
+void registerAuthLatencyTrackerTests(TestRunner& runner);
+void registerSshProbeTests(TestRunner& runner);
+void registerSchedPolicyTests(TestRunner& runner);
+void registerBitmapFontTests(TestRunner& runner);
+void registerAllocStatsTests(TestRunner& runner);
+void registerLogHistoryTests(TestRunner& runner);
+void registerDeltaSyncTests(TestRunner& runner);
+void registerSamplingProfilerTests(TestRunner& runner);
+void registerCipherBenchTests(TestRunner& runner);
+void registerInetdSpawnerTests(TestRunner& runner);
+void registerSpawnHelperTests(TestRunner& runner);
+void registerLogRelayTests(TestRunner& runner);
+void registerDropbearManagerTests(TestRunner& runner);
 
-int main() {
+int main(int argc, char* argv[]) {
     TestRunner runner;
     
     // Register all test suites
     registerPathHelperTests(runner);
     registerNetworkManagerTests(runner);
     registerColorTests(runner);
+    registerDropbearConfigTests(runner);
+    registerStartupTraceTests(runner);
+    registerDropbearLogParserTests(runner);
+    registerMetricsTests(runner);
+    registerLogLineSplitterTests(runner);
+    registerAuthGuardTests(runner);
+    registerLogFileTests(runner);
+    registerLogRecordingTests(runner);
+    registerLatencyHistogramTests(runner);
+    registerAuthLatencyTrackerTests(runner);
+    registerSshProbeTests(runner);
+    registerSchedPolicyTests(runner);
+    registerBitmapFontTests(runner);
+    registerAllocStatsTests(runner);
+    registerLogHistoryTests(runner);
+    registerDeltaSyncTests(runner);
+    registerSamplingProfilerTests(runner);
+    registerCipherBenchTests(runner);
+    registerInetdSpawnerTests(runner);
+    registerSpawnHelperTests(runner);
+    registerLogRelayTests(runner);
+    registerDropbearManagerTests(runner);
     
-    return runner.run();
+    return runner.run(argc, argv);
 }
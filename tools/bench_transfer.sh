@@ -0,0 +1,73 @@
+#!/bin/sh
+# Compare legacy scp against SFTP uploads to the device.
+#
+# Usage: tools/bench_transfer.sh <user@host> [small_file_count] [large_file_mb]
+#
+# Runs on the host machine. Uses one shared SSH connection (ControlMaster) so
+# authentication is paid once and the numbers reflect transfer cost only.
+# Set up key auth or expect one password prompt.
+
+set -e
+
+TARGET="$1"
+SMALL_COUNT="${2:-500}"
+LARGE_MB="${3:-256}"
+REMOTE_DIR="/tmp/dropbear-bench"
+
+# Large requests and many in flight: the whole point of SFTP over scp
+SFTP_BUFFER=261120
+SFTP_REQUESTS=64
+
+if [ -z "$TARGET" ]; then
+    echo "Usage: $0 <user@host> [small_file_count] [large_file_mb]"
+    exit 1
+fi
+
+WORK=$(mktemp -d)
+CTL="$WORK/ctl"
+SSH_OPTS="-o ControlMaster=auto -o ControlPath=$CTL -o ControlPersist=60"
+trap 'ssh $SSH_OPTS -O exit "$TARGET" 2>/dev/null; rm -rf "$WORK"' EXIT
+
+echo "Preparing $SMALL_COUNT small files and one ${LARGE_MB} MiB file..."
+mkdir -p "$WORK/small"
+i=0
+while [ "$i" -lt "$SMALL_COUNT" ]; do
+    head -c 4096 /dev/urandom > "$WORK/small/f$i"
+    i=$((i + 1))
+done
+head -c $((LARGE_MB * 1024 * 1024)) /dev/urandom > "$WORK/large.bin"
+
+ssh $SSH_OPTS "$TARGET" "rm -rf $REMOTE_DIR && mkdir -p $REMOTE_DIR"
+
+now() { date +%s.%N; }
+
+# run <label> <bytes> <command...>
+run() {
+    label="$1"; bytes="$2"; shift 2
+    ssh $SSH_OPTS "$TARGET" "rm -rf $REMOTE_DIR/* 2>/dev/null; true"
+    t0=$(now)
+    "$@" > /dev/null
+    t1=$(now)
+    awk -v l="$label" -v b="$bytes" -v a="$t0" -v z="$t1" \
+        'BEGIN { s = z - a; printf "%-28s %8.2f s %8.2f MiB/s\n", l, s, b / s / 1048576 }'
+}
+
+SMALL_BYTES=$((SMALL_COUNT * 4096))
+LARGE_BYTES=$((LARGE_MB * 1024 * 1024))
+
+printf 'put -r %s/small %s/\n' "$WORK" "$REMOTE_DIR" > "$WORK/small.batch"
+printf 'put %s/large.bin %s/\n' "$WORK" "$REMOTE_DIR" > "$WORK/large.batch"
+
+echo
+run "scp (legacy) small files" "$SMALL_BYTES" \
+    scp -O -q -r -o ControlPath="$CTL" "$WORK/small" "$TARGET:$REMOTE_DIR/"
+run "sftp small files" "$SMALL_BYTES" \
+    sftp -q -o ControlPath="$CTL" -B "$SFTP_BUFFER" -R "$SFTP_REQUESTS" \
+         -b "$WORK/small.batch" "$TARGET"
+run "scp (legacy) large file" "$LARGE_BYTES" \
+    scp -O -q -o ControlPath="$CTL" "$WORK/large.bin" "$TARGET:$REMOTE_DIR/"
+run "sftp large file" "$LARGE_BYTES" \
+    sftp -q -o ControlPath="$CTL" -B "$SFTP_BUFFER" -R "$SFTP_REQUESTS" \
+         -b "$WORK/large.batch" "$TARGET"
+
+ssh $SSH_OPTS "$TARGET" "rm -rf $REMOTE_DIR"
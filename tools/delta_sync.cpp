@@ -0,0 +1,390 @@
+// Pushes a directory tree to the device, sending only the parts of each file
+// that changed (see DeltaSync.h and SyncProtocol.h). The device side is the
+// same binary, bundled with the app and linked to DELTA_SYNC_LINK_PATH while
+// the server runs.
+//
+//   delta_sync push SRC [USER@]HOST:DEST [--ssh CMD] [--remote PATH] [--checksum]
+//                   [--threads N] [--read-kb N]
+//   delta_sync --server DEST
+//   delta_sync local SRC DEST [--checksum] [--threads N] [--read-kb N]
+//   delta_sync bench [--files N] [--size-mb N] [--change PCT] [--link-mbps N]
+//
+// push runs `ssh HOST PATH --server DEST` and speaks the protocol over its
+// stdin/stdout, so it works with any SSH client and the existing host key.
+// Files are added or replaced, never deleted. bench builds a synthetic ROM and
+// save tree, syncs it once, rewrites a few percent of it and syncs again,
+// reporting bytes on the wire and wall time against a full copy.
+// Built on the host with `make delta-sync`; the device copy by `make`.
+#include "../src/Constants.h"
+#include "../src/SyncProtocol.h"
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+int usage() {
+    fprintf(stderr,
+            "usage: delta_sync push SRC [USER@]HOST:DEST [--ssh CMD] [--remote PATH] [--checksum]\n"
+            "                       [--threads N] [--read-kb N]\n"
+            "       delta_sync --server DEST\n"
+            "       delta_sync local SRC DEST [--checksum] [--threads N] [--read-kb N]\n"
+            "       delta_sync bench [--files N] [--size-mb N] [--change PCT] [--link-mbps N]\n");
+    return 2;
+}
+
+uint64_t nowMicros() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000ull + static_cast<uint64_t>(ts.tv_nsec) / 1000;
+}
+
+bool makeDirs(const std::string& path) {
+    for (size_t pos = 1; pos <= path.size(); ++pos) {
+        if (pos != path.size() && path[pos] != '/') continue;
+        const std::string prefix = path.substr(0, pos);
+        if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) return false;
+    }
+    return true;
+}
+
+void printStats(const SyncProtocol::Stats& s, uint64_t elapsedUs) {
+    printf("files: %llu (%llu up to date, %llu updated, %llu failed)\n",
+           static_cast<unsigned long long>(s.files), static_cast<unsigned long long>(s.up_to_date),
+           static_cast<unsigned long long>(s.updated), static_cast<unsigned long long>(s.failed));
+    printf("data: %.1f MiB in tree, %.1f MiB literal, %.1f MiB matched on device\n",
+           s.source_bytes / 1048576.0, s.literal_bytes / 1048576.0, s.matched_bytes / 1048576.0);
+    printf("wire: %.1f KiB sent, %.1f KiB received (%.2f%% of the tree)\n",
+           s.wire_sent / 1024.0, s.wire_received / 1024.0,
+           s.source_bytes ? 100.0 * (s.wire_sent + s.wire_received) / s.source_bytes : 0.0);
+    printf("device hashing: %.1f MiB in %.1f ms on %u threads\n",
+           s.server_hashed_bytes / 1048576.0, s.server_sign_us / 1000.0, s.server_threads);
+    printf("wall: %.1f ms\n", elapsedUs / 1000.0);
+    for (const auto& e : s.errors) fprintf(stderr, "error: %s\n", e.c_str());
+}
+
+bool parseSignOption(int argc, char* argv[], int& i, SyncProtocol::Options& options) {
+    const std::string arg = argv[i];
+    if (arg == "--checksum") {
+        options.checksum = true;
+    } else if (arg == "--threads" && i + 1 < argc) {
+        options.sign.threads = static_cast<unsigned>(std::max(0, std::atoi(argv[++i])));
+    } else if (arg == "--read-kb" && i + 1 < argc) {
+        options.sign.read_size = static_cast<size_t>(std::max(4, std::atoi(argv[++i]))) * 1024;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+int serve(const std::string& dest) {
+    if (!makeDirs(dest)) {
+        fprintf(stderr, "delta_sync: cannot create %s: %s\n", dest.c_str(), strerror(errno));
+        return 1;
+    }
+    std::string error;
+    if (!SyncProtocol::serve(STDIN_FILENO, STDOUT_FILENO, dest, error)) {
+        fprintf(stderr, "delta_sync: %s\n", error.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+// Pushes over a server running in a child process: argv[0] of `command`
+// is exec'd with stdin/stdout wired to the protocol pipes
+bool pushToChild(const std::vector<std::string>& command, const std::string& src,
+                 const SyncProtocol::Options& options, SyncProtocol::Stats& stats,
+                 std::string& error) {
+    int toChild[2], fromChild[2];
+    if (pipe(toChild) != 0) {
+        error = std::string("pipe: ") + strerror(errno);
+        return false;
+    }
+    if (pipe(fromChild) != 0) {
+        error = std::string("pipe: ") + strerror(errno);
+        close(toChild[0]);
+        close(toChild[1]);
+        return false;
+    }
+    const pid_t pid = fork();
+    if (pid < 0) {
+        error = std::string("fork: ") + strerror(errno);
+        for (int fd : {toChild[0], toChild[1], fromChild[0], fromChild[1]}) close(fd);
+        return false;
+    }
+    if (pid == 0) {
+        dup2(toChild[0], STDIN_FILENO);
+        dup2(fromChild[1], STDOUT_FILENO);
+        close(toChild[0]);
+        close(toChild[1]);
+        close(fromChild[0]);
+        close(fromChild[1]);
+        std::vector<char*> args;
+        for (const auto& a : command) args.push_back(const_cast<char*>(a.c_str()));
+        args.push_back(nullptr);
+        execvp(args[0], args.data());
+        fprintf(stderr, "delta_sync: exec %s: %s\n", args[0], strerror(errno));
+        _exit(127);
+    }
+    close(toChild[0]);
+    close(fromChild[1]);
+    const bool ok = SyncProtocol::push(fromChild[0], toChild[1], src, options, stats, error);
+    close(toChild[1]);
+    close(fromChild[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (ok && !(WIFEXITED(status) && WEXITSTATUS(status) == 0)) {
+        error = "server exited with status " + std::to_string(WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+        return false;
+    }
+    return ok;
+}
+
+std::string selfPath() {
+    char buf[4096];
+    const ssize_t n = readlink("/proc/self/exe", buf, sizeof(buf) - 1);
+    if (n <= 0) return "delta_sync";
+    return std::string(buf, static_cast<size_t>(n));
+}
+
+int push(int argc, char* argv[]) {
+    if (argc < 4) return usage();
+    const std::string src = argv[2];
+    const std::string target = argv[3];
+    const size_t colon = target.find(':');
+    if (colon == std::string::npos || colon == 0 || colon + 1 == target.size()) return usage();
+
+    std::string ssh = "ssh";
+    std::string remote = Dropbear::DELTA_SYNC_LINK_PATH;
+    SyncProtocol::Options options;
+    for (int i = 4; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (parseSignOption(argc, argv, i, options)) continue;
+        if (arg == "--ssh" && i + 1 < argc) {
+            ssh = argv[++i];
+        } else if (arg == "--remote" && i + 1 < argc) {
+            remote = argv[++i];
+        } else {
+            return usage();
+        }
+    }
+
+    // The remote command is a single shell string; quote DEST for it
+    std::string dest = target.substr(colon + 1);
+    std::string quoted = "'";
+    for (char c : dest) quoted += (c == '\'') ? std::string("'\\''") : std::string(1, c);
+    quoted += "'";
+    std::vector<std::string> command;
+    const char* sep = " \t";
+    for (size_t pos = 0; pos < ssh.size(); ) {
+        const size_t start = ssh.find_first_not_of(sep, pos);
+        if (start == std::string::npos) break;
+        const size_t end = ssh.find_first_of(sep, start);
+        command.push_back(ssh.substr(start, end == std::string::npos ? std::string::npos : end - start));
+        pos = end == std::string::npos ? ssh.size() : end;
+    }
+    command.push_back(target.substr(0, colon));
+    command.push_back(remote + " --server " + quoted);
+
+    SyncProtocol::Stats stats;
+    std::string error;
+    const uint64_t start = nowMicros();
+    const bool ok = pushToChild(command, src, options, stats, error);
+    printStats(stats, nowMicros() - start);
+    if (!ok) fprintf(stderr, "delta_sync: %s\n", error.c_str());
+    return ok && stats.failed == 0 ? 0 : 1;
+}
+
+int local(int argc, char* argv[]) {
+    if (argc < 4) return usage();
+    SyncProtocol::Options options;
+    for (int i = 4; i < argc; ++i) {
+        if (!parseSignOption(argc, argv, i, options)) return usage();
+    }
+    SyncProtocol::Stats stats;
+    std::string error;
+    const uint64_t start = nowMicros();
+    const bool ok = pushToChild({selfPath(), "--server", argv[3]}, argv[2], options, stats, error);
+    printStats(stats, nowMicros() - start);
+    if (!ok) fprintf(stderr, "delta_sync: %s\n", error.c_str());
+    return ok && stats.failed == 0 ? 0 : 1;
+}
+
+bool writeFile(const std::string& path, const std::string& data) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    const bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    return fclose(f) == 0 && ok;
+}
+
+bool readFile(const std::string& path, std::string& out) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    out.clear();
+    char buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+    fclose(f);
+    return true;
+}
+
+struct BenchRun {
+    const char* label;
+    SyncProtocol::Stats stats;
+    uint64_t wall_us = 0;
+};
+
+int bench(int argc, char* argv[]) {
+    int files = 40;
+    int sizeMb = 256;
+    double changePct = 2.0;
+    double linkMbps = 20.0;   // typical handheld WiFi throughput under SSH
+    for (int i = 2; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--files" && i + 1 < argc) {
+            files = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--size-mb" && i + 1 < argc) {
+            sizeMb = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--change" && i + 1 < argc) {
+            changePct = std::max(0.0, std::atof(argv[++i]));
+        } else if (arg == "--link-mbps" && i + 1 < argc) {
+            linkMbps = std::max(0.1, std::atof(argv[++i]));
+        } else {
+            return usage();
+        }
+    }
+
+    const std::string root = "/tmp/delta_sync_bench_" + std::to_string(getpid());
+    const std::string src = root + "/src";
+    const std::string dst = root + "/dst";
+    if (!makeDirs(src + "/roms") || !makeDirs(src + "/saves") || !makeDirs(dst)) {
+        fprintf(stderr, "delta_sync: cannot create %s\n", root.c_str());
+        return 1;
+    }
+
+    // Mostly ROM-sized files plus a save per ROM, sizes varied around the mean
+    std::mt19937_64 rng(7);
+    const uint64_t total = static_cast<uint64_t>(sizeMb) * 1024 * 1024;
+    std::vector<std::string> paths;
+    for (int i = 0; i < files; ++i) {
+        const uint64_t size = total / files / 2 + rng() % (total / files + 1);
+        std::string data(static_cast<size_t>(size), '\0');
+        for (size_t off = 0; off + 8 <= data.size(); off += 8) {
+            const uint64_t v = rng();
+            memcpy(&data[off], &v, 8);
+        }
+        paths.push_back(src + "/roms/game" + std::to_string(i) + ".bin");
+        writeFile(paths.back(), data);
+        std::string save(32 * 1024, '\0');
+        for (auto& c : save) c = static_cast<char>(rng());
+        paths.push_back(src + "/saves/game" + std::to_string(i) + ".sav");
+        writeFile(paths.back(), save);
+    }
+
+    std::vector<BenchRun> runs;
+    auto run = [&](const char* label, bool checksum) {
+        SyncProtocol::Options options;
+        options.checksum = checksum;
+        BenchRun r;
+        r.label = label;
+        std::string error;
+        const uint64_t start = nowMicros();
+        if (!pushToChild({selfPath(), "--server", dst}, src, options, r.stats, error)) {
+            fprintf(stderr, "delta_sync: %s: %s\n", label, error.c_str());
+        }
+        r.wall_us = nowMicros() - start;
+        runs.push_back(r);
+    };
+
+    run("initial (full copy)", false);
+    run("unchanged", false);
+
+    // Patch changePct of the bytes in scattered 4 KiB runs, touching every
+    // save and a share of the ROMs; bump mtimes so the quick check sees them
+    uint64_t changed = 0;
+    const uint64_t budget = static_cast<uint64_t>(total * changePct / 100.0);
+    std::string data;
+    for (size_t i = 0; i < paths.size() && changed < budget; ++i) {
+        const bool save = paths[i].find("/saves/") != std::string::npos;
+        if (!save && rng() % 3 != 0) continue;
+        if (!readFile(paths[i], data) || data.empty()) continue;
+        // About a third of the ROMs are touched; spread the budget over them
+        const size_t runs4k = save ? 1 : std::max<size_t>(1, static_cast<size_t>(budget / (4096 * (files / 3 + 1))));
+        for (size_t k = 0; k < runs4k && changed < budget; ++k) {
+            const size_t off = static_cast<size_t>(rng() % data.size());
+            const size_t len = std::min<size_t>(4096, data.size() - off);
+            for (size_t b = 0; b < len; ++b) data[off + b] = static_cast<char>(rng());
+            changed += len;
+        }
+        writeFile(paths[i], data);
+        struct timespec times[2];
+        clock_gettime(CLOCK_REALTIME, &times[0]);
+        times[0].tv_sec += 10;
+        times[1] = times[0];
+        utimensat(AT_FDCWD, paths[i].c_str(), times, 0);
+    }
+    run("after edits", false);
+
+    // Same edit again, but found by --checksum rather than mtimes
+    const std::string& victim = paths[0];
+    if (readFile(victim, data) && !data.empty()) {
+        for (size_t b = 0; b < std::min<size_t>(4096, data.size()); ++b) data[b] = static_cast<char>(rng());
+        writeFile(victim, data);
+        changed += std::min<size_t>(4096, data.size());
+    }
+    run("after edits, --checksum", true);
+
+    const double bytesPerSec = linkMbps * 1000.0 * 1000.0 / 8.0;
+    printf("tree: %d files, %.1f MiB; changed %.1f MiB (%.2f%%)\n", files * 2,
+           runs[0].stats.source_bytes / 1048576.0, changed / 1048576.0,
+           runs[0].stats.source_bytes ? 100.0 * changed / runs[0].stats.source_bytes : 0.0);
+    printf("%-26s %8s %8s %12s %10s %10s %14s\n", "run", "updated", "same", "wire KiB",
+           "of tree", "wall ms", "at link ms");
+    for (const auto& r : runs) {
+        const uint64_t wire = r.stats.wire_sent + r.stats.wire_received;
+        printf("%-26s %8llu %8llu %12.1f %9.2f%% %10.1f %14.1f\n", r.label,
+               static_cast<unsigned long long>(r.stats.updated),
+               static_cast<unsigned long long>(r.stats.up_to_date), wire / 1024.0,
+               r.stats.source_bytes ? 100.0 * wire / r.stats.source_bytes : 0.0,
+               r.wall_us / 1000.0, r.wall_us / 1000.0 + wire / bytesPerSec * 1000.0);
+    }
+    const BenchRun& last = runs.back();
+    printf("device hashing (--checksum): %.1f MiB in %.1f ms on %u threads (%.0f MiB/s)\n",
+           last.stats.server_hashed_bytes / 1048576.0, last.stats.server_sign_us / 1000.0,
+           last.stats.server_threads,
+           last.stats.server_sign_us ? last.stats.server_hashed_bytes / 1.048576 / last.stats.server_sign_us : 0.0);
+    printf("\"at link\" adds wire bytes at %.0f Mbit/s to the local wall time\n", linkMbps);
+
+    std::string cmd = "rm -rf '" + root + "'";
+    if (system(cmd.c_str()) != 0) fprintf(stderr, "delta_sync: could not remove %s\n", root.c_str());
+    for (const auto& r : runs) {
+        if (r.stats.failed != 0 || !r.stats.errors.empty()) return 1;
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    // A dead peer must surface as a write error, not kill the process
+    signal(SIGPIPE, SIG_IGN);
+    if (argc < 2) return usage();
+    const std::string mode = argv[1];
+    if (mode == "--server") return argc == 3 ? serve(argv[2]) : usage();
+    if (mode == "push") return push(argc, argv);
+    if (mode == "local") return local(argc, argv);
+    if (mode == "bench") return bench(argc, argv);
+    return usage();
+}
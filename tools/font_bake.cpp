@@ -0,0 +1,132 @@
+// Build-time glyph rasterizer: renders printable ASCII from a TrueType font
+// into a 1-bit atlas and writes it as a constexpr BitmapFont::Face header,
+// so the app draws text without SDL_ttf, FreeType or the .ttf at runtime.
+//
+//   font_bake FONT.ttf OUT.h [PIXEL_SIZE]     (default LogDisplay::FONT_SIZE)
+//
+// Uses FreeType's mono hinting and rendering, which is what SDL_ttf's
+// TTF_RenderText_Solid uses, so the baked glyphs match the TTF fallback
+// pixel for pixel (minus kerning). Sizes follow SDL_ttf too: the point size
+// is set at 72 dpi and line height is ascent - descent + 1.
+#include "../src/Constants.h"
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int FIRST = 0x20;
+constexpr int LAST = 0x7E;
+
+struct BakedGlyph {
+    int atlas_x;
+    int width;
+    int bearing_x;
+    int advance;
+};
+
+int ceil26_6(long v) { return static_cast<int>((v + 63) >> 6); }
+int floor26_6(long v) { return static_cast<int>(v >> 6); }
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3 || argc > 4) {
+        std::fprintf(stderr, "usage: font_bake FONT.ttf OUT.h [PIXEL_SIZE]\n");
+        return 2;
+    }
+    const char* fontPath = argv[1];
+    const char* outPath = argv[2];
+    const int size = argc == 4 ? std::atoi(argv[3]) : LogDisplay::FONT_SIZE;
+
+    FT_Library lib;
+    FT_Face face;
+    if (FT_Init_FreeType(&lib) != 0 || FT_New_Face(lib, fontPath, 0, &face) != 0) {
+        std::fprintf(stderr, "font_bake: cannot load %s\n", fontPath);
+        return 1;
+    }
+    if (FT_Set_Char_Size(face, 0, size * 64, 0, 0) != 0) {
+        std::fprintf(stderr, "font_bake: cannot set size %d\n", size);
+        return 1;
+    }
+
+    const int ascent = ceil26_6(face->size->metrics.ascender);
+    const int descent = floor26_6(face->size->metrics.descender);
+    const int height = ascent - descent + 1;
+
+    // First pass: cell sizes, to lay out the atlas strip
+    std::vector<BakedGlyph> glyphs;
+    int atlasWidth = 0;
+    for (int c = FIRST; c <= LAST; ++c) {
+        if (FT_Load_Char(face, c, FT_LOAD_RENDER | FT_LOAD_TARGET_MONO) != 0) {
+            std::fprintf(stderr, "font_bake: no glyph for '%c'\n", c);
+            return 1;
+        }
+        const FT_GlyphSlot g = face->glyph;
+        BakedGlyph bg;
+        bg.atlas_x = atlasWidth;
+        bg.width = static_cast<int>(g->bitmap.width);
+        bg.bearing_x = g->bitmap_left;
+        bg.advance = floor26_6(g->advance.x);
+        glyphs.push_back(bg);
+        atlasWidth += bg.width;
+    }
+
+    const int rowBytes = (atlasWidth + 7) / 8;
+    std::vector<unsigned char> bits(static_cast<size_t>(rowBytes) * height, 0);
+    for (int c = FIRST; c <= LAST; ++c) {
+        FT_Load_Char(face, c, FT_LOAD_RENDER | FT_LOAD_TARGET_MONO);
+        const FT_GlyphSlot g = face->glyph;
+        const BakedGlyph& bg = glyphs[c - FIRST];
+        const int top = ascent - g->bitmap_top;
+        for (unsigned row = 0; row < g->bitmap.rows; ++row) {
+            const int y = top + static_cast<int>(row);
+            if (y < 0 || y >= height) continue;   // clipped like SDL_ttf's line box
+            const unsigned char* src = g->bitmap.buffer + row * g->bitmap.pitch;
+            for (int col = 0; col < bg.width; ++col) {
+                if (!((src[col / 8] >> (7 - col % 8)) & 1)) continue;
+                const int x = bg.atlas_x + col;
+                bits[static_cast<size_t>(y) * rowBytes + x / 8] |= static_cast<unsigned char>(0x80 >> (x % 8));
+            }
+        }
+    }
+
+    FILE* out = std::fopen(outPath, "w");
+    if (!out) {
+        std::perror(outPath);
+        return 1;
+    }
+    std::fprintf(out,
+                 "// Generated by tools/font_bake from %s at %d px. Do not edit.\n"
+                 "#pragma once\n\n"
+                 "#include \"src/BitmapFont.h\"\n\n"
+                 "namespace BakedFont {\n\n"
+                 "constexpr int kPixelSize = %d;\n\n"
+                 "constexpr uint8_t kBits[] = {",
+                 fontPath, size, size);
+    for (size_t i = 0; i < bits.size(); ++i) {
+        std::fprintf(out, "%s0x%02x,", i % 16 == 0 ? "\n    " : " ", bits[i]);
+    }
+    std::fprintf(out, "\n};\n\nconstexpr BitmapFont::Glyph kGlyphs[] = {\n");
+    for (int c = FIRST; c <= LAST; ++c) {
+        const BakedGlyph& bg = glyphs[c - FIRST];
+        std::fprintf(out, "    {%d, %d, %d, %d},   // '%s%c'\n", bg.atlas_x, bg.width,
+                     bg.bearing_x, bg.advance, c == '\\' ? "\\" : "", c);
+    }
+    std::fprintf(out,
+                 "};\n\n"
+                 "constexpr BitmapFont::Face kFace = {%d, %d, %d, %d, %d, kGlyphs, kBits};\n\n"
+                 "} // namespace BakedFont\n",
+                 FIRST, LAST - FIRST + 1, height, ascent, atlasWidth);
+    std::fclose(out);
+
+    std::printf("font_bake: %d glyphs, %dx%d atlas, %zu bytes -> %s\n",
+                LAST - FIRST + 1, atlasWidth, height, bits.size(), outPath);
+    FT_Done_Face(face);
+    FT_Done_FreeType(lib);
+    return 0;
+}
@@ -0,0 +1,264 @@
+// Compares the always-on dropbear listener with on-demand (inetd) spawning
+// through InetdSpawner, with and without the warm spare:
+//
+//   - idle: PSS of what stays resident while nobody is connected (the
+//     listener, or the spare; the accepting process is the app itself and
+//     counts for neither)
+//   - first connect: connect() to SSH banner for the first client after idle
+//   - sequential connects: banner latency p50/p99 over --connects clients
+//   - per connection: extra PSS for each of --hold concurrent clients sitting
+//     at the banner
+//
+//   inetd_bench --dropbear PATH --key PATH [--port P] [--connects N] [--hold K]
+//
+// Built on the host with `make inetd-bench`; run it on the device against the
+// real dropbear for numbers that mean anything. Here the spare is forked from
+// this small tool; in the app it is a copy-on-write fork of the app, which
+// shares its pages and so adds little PSS either way.
+#include "../src/InetdSpawner.h"
+#include "../src/LatencyHistogram.h"
+#include "../src/StartupTrace.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+enum class Mode { Listener, Inetd, InetdSpare };
+
+struct Options {
+    std::string dropbear;
+    std::string key;
+    int port = 2299;
+    int connects = 50;
+    int hold = 5;
+};
+
+uint64_t pssKib(pid_t pid) {
+    std::ifstream in("/proc/" + std::to_string(pid) + "/smaps_rollup");
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.compare(0, 4, "Pss:") == 0) return std::strtoull(line.c_str() + 4, nullptr, 10);
+    }
+    return 0;
+}
+
+// Direct and indirect children of root
+std::vector<pid_t> descendants(pid_t root) {
+    std::vector<std::pair<pid_t, pid_t>> all;   // pid, ppid
+    DIR* dir = opendir("/proc");
+    if (!dir) return {};
+    while (dirent* entry = readdir(dir)) {
+        const pid_t pid = std::atoi(entry->d_name);
+        if (pid <= 0) continue;
+        std::ifstream in(std::string("/proc/") + entry->d_name + "/stat");
+        std::string stat;
+        std::getline(in, stat);
+        const size_t paren = stat.rfind(')');
+        if (paren == std::string::npos) continue;
+        int ppid = 0;
+        if (std::sscanf(stat.c_str() + paren + 1, " %*c %d", &ppid) == 1) all.push_back({pid, ppid});
+    }
+    closedir(dir);
+
+    std::vector<pid_t> out;
+    std::vector<pid_t> frontier = {root};
+    while (!frontier.empty()) {
+        const pid_t parent = frontier.back();
+        frontier.pop_back();
+        for (const auto& p : all) {
+            if (p.second != parent) continue;
+            out.push_back(p.first);
+            frontier.push_back(p.first);
+        }
+    }
+    return out;
+}
+
+// The listener counts itself; the inetd supervisor stands in for the app
+uint64_t serverPssKib(Mode mode, pid_t root) {
+    uint64_t total = mode == Mode::Listener ? pssKib(root) : 0;
+    for (pid_t pid : descendants(root)) total += pssKib(pid);
+    return total;
+}
+
+// Connects and waits for the "SSH-" banner; returns the open socket or -1
+int connectForBanner(int port, uint64_t& micros) {
+    const uint64_t start = StartupTrace::nowMicros();
+    const int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1) {
+        close(fd);
+        return -1;
+    }
+    struct pollfd pfd = {fd, POLLIN, 0};
+    char buf[64];
+    if (poll(&pfd, 1, 5000) != 1 || read(fd, buf, sizeof(buf)) < 4 || std::memcmp(buf, "SSH-", 4) != 0) {
+        close(fd);
+        return -1;
+    }
+    micros = StartupTrace::nowMicros() - start;
+    return fd;
+}
+
+pid_t startListener(const Options& opt) {
+    const pid_t pid = fork();
+    if (pid == 0) {
+        const int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDERR_FILENO);
+        const std::string port = std::to_string(opt.port);
+        execl(opt.dropbear.c_str(), "dropbear", "-F", "-E", "-r", opt.key.c_str(), "-p", port.c_str(),
+              static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    return pid;
+}
+
+// Accept loop standing in for the app's pumpLogs(); runs until killed
+pid_t startSupervisor(const Options& opt, bool spare, int readyFd) {
+    const pid_t pid = fork();
+    if (pid != 0) return pid;
+
+    InetdSpawner spawner;
+    InetdSpawner::Settings settings;
+    settings.port = opt.port;
+    settings.path = opt.dropbear;
+    settings.args = {"dropbear", "-i", "-E", "-r", opt.key};
+    settings.log_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    settings.warm_spare = spare;
+    std::string error;
+    const char ok = spawner.open(settings, error) ? 1 : 0;
+    if (!ok) std::fprintf(stderr, "inetd: %s\n", error.c_str());
+    if (write(readyFd, &ok, 1) != 1 || !ok) _exit(1);
+
+    for (;;) {
+        std::vector<struct pollfd> pfds;
+        for (int fd : spawner.fds()) pfds.push_back({fd, POLLIN, 0});
+        poll(pfds.data(), pfds.size(), 100);
+        size_t refused = 0;
+        spawner.acceptPending(nullptr, refused, error);
+        // The spare is reaped by the spawner; everything else ended here
+        while (waitpid(-1, nullptr, WNOHANG) > 0) {}
+    }
+}
+
+int runMode(Mode mode, const Options& opt) {
+    const char* names[] = {"listener", "inetd", "inetd + spare"};
+    pid_t server;
+    if (mode == Mode::Listener) {
+        server = startListener(opt);
+    } else {
+        int ready[2];
+        if (pipe(ready) == -1) return 1;
+        server = startSupervisor(opt, mode == Mode::InetdSpare, ready[1]);
+        char ok = 0;
+        if (read(ready[0], &ok, 1) != 1) ok = 0;
+        close(ready[0]);
+        close(ready[1]);
+        if (!ok) {
+            waitpid(server, nullptr, 0);
+            return 1;
+        }
+    }
+
+    // The listener binds after loading its key; wait until it answers, then
+    // let it go idle
+    uint64_t us = 0;
+    int fd = -1;
+    for (int i = 0; i < 100 && fd < 0; ++i) {
+        fd = connectForBanner(opt.port, us);
+        if (fd < 0) usleep(50000);
+    }
+    if (fd < 0) {
+        std::fprintf(stderr, "%s: no SSH banner on port %d\n", names[static_cast<int>(mode)], opt.port);
+        kill(server, SIGTERM);
+        waitpid(server, nullptr, 0);
+        return 1;
+    }
+    close(fd);
+    usleep(500000);
+
+    const uint64_t idle = serverPssKib(mode, server);
+    uint64_t first = 0;
+    fd = connectForBanner(opt.port, first);
+    if (fd >= 0) close(fd);
+    usleep(200000);
+
+    LatencyHistogram latency;
+    for (int i = 0; i < opt.connects; ++i) {
+        fd = connectForBanner(opt.port, us);
+        if (fd < 0) continue;
+        latency.record(us);
+        close(fd);
+    }
+    usleep(200000);
+
+    const uint64_t before = serverPssKib(mode, server);
+    std::vector<int> held;
+    for (int i = 0; i < opt.hold; ++i) {
+        fd = connectForBanner(opt.port, us);
+        if (fd >= 0) held.push_back(fd);
+    }
+    usleep(200000);
+    const uint64_t during = serverPssKib(mode, server);
+    for (int h : held) close(h);
+    const uint64_t perConn = held.empty() || during < before ? 0 : (during - before) / held.size();
+
+    std::printf("%-16s %9llu %10s %10s %10s %11llu\n", names[static_cast<int>(mode)],
+                static_cast<unsigned long long>(idle), LatencyHistogram::formatMicros(first).c_str(),
+                LatencyHistogram::formatMicros(latency.percentile(0.50)).c_str(),
+                LatencyHistogram::formatMicros(latency.percentile(0.99)).c_str(),
+                static_cast<unsigned long long>(perConn));
+    std::fflush(stdout);
+
+    kill(server, SIGTERM);
+    waitpid(server, nullptr, 0);
+    usleep(200000);   // sessions see their clients go away
+    return 0;
+}
+
+int usage() {
+    std::fprintf(stderr, "usage: inetd_bench --dropbear PATH --key PATH [--port P] [--connects N] [--hold K]\n");
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) return usage();
+        if (arg == "--dropbear") opt.dropbear = argv[++i];
+        else if (arg == "--key") opt.key = argv[++i];
+        else if (arg == "--port") opt.port = std::atoi(argv[++i]);
+        else if (arg == "--connects") opt.connects = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--hold") opt.hold = std::max(1, std::atoi(argv[++i]));
+        else return usage();
+    }
+    if (opt.dropbear.empty() || opt.key.empty()) return usage();
+
+    std::printf("port %d, %d sequential connects, %d held\n\n", opt.port, opt.connects, opt.hold);
+    std::printf("%-16s %9s %10s %10s %10s %11s\n", "mode", "idle KiB", "first", "conn p50", "conn p99",
+                "KiB/conn");
+    int failures = 0;
+    for (Mode mode : {Mode::Listener, Mode::Inetd, Mode::InetdSpare}) failures += runMode(mode, opt) != 0;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,276 @@
+// Replays a dropbear log recording (see LogRecording.h, enabled with
+// record_log in dropbear.conf) through DropbearManager's real ingest path:
+// a pipe read by pumpLogs(), split, parsed, run through the brute-force guard
+// and handed to a sink that mirrors Application::pushLogLine (a LogHistory).
+//
+//   log_replay RECORDING [--speed N|max] [--repeat K] [--history-kb N] [--search TEXT]
+//   log_replay --generate bruteforce|sessions LINES OUT
+//
+// Reports ingest throughput, end-to-end latency (pipe write -> line callback),
+// peak RSS, and the log history's compression ratio, decode cost per block and
+// footprint. --search times a backward search over the whole history.
+// Built on the host with `make log-replay`.
+#include "../src/Constants.h"
+#include "../src/DropbearManager.h"
+#include "../src/LogHistory.h"
+#include "../src/LogLineSplitter.h"
+#include "../src/LogRecording.h"
+#include "../src/Metrics.h"
+#include "../src/StartupTrace.h"
+#include <sys/resource.h>
+#include <poll.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct ExpectedLine {
+    std::string text;
+    size_t chunk;   // global index of the chunk whose write completes the line
+};
+
+int usage() {
+    fprintf(stderr,
+            "usage: log_replay RECORDING [--speed N|max] [--repeat K] [--history-kb N] [--search TEXT]\n"
+            "       log_replay --generate bruteforce|sessions LINES OUT\n");
+    return 2;
+}
+
+void sleepUntil(uint64_t targetUs) {
+    uint64_t now = StartupTrace::nowMicros();
+    if (targetUs > now) usleep(static_cast<useconds_t>(targetUs - now));
+}
+
+uint64_t percentile(std::vector<uint64_t>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t idx = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(idx, sorted.size() - 1)];
+}
+
+// Synthetic traces in dropbear's -E format, split into pipe-sized chunks at
+// arbitrary byte offsets the way read() would return them
+int generate(const std::string& kind, long lines, const std::string& outPath) {
+    if (kind != "bruteforce" && kind != "sessions") return usage();
+
+    std::mt19937 rng(42);
+    std::string stream;
+    int pid = 20000;
+    for (long i = 0; i < lines; ) {
+        ++pid;
+        const std::string prefix = "[" + std::to_string(pid) + "] Oct 18 12:00:00 ";
+        if (kind == "bruteforce") {
+            const std::string from = "203.0.113." + std::to_string(rng() % 32) + ":" +
+                                     std::to_string(40000 + rng() % 20000);
+            stream += prefix + "Child connection from " + from + "\n";
+            stream += prefix + "Bad password attempt for 'root' from " + from + "\n";
+            stream += prefix + "Bad password attempt for 'root' from " + from + "\n";
+            stream += prefix + "Exit before auth from <" + from + ">: Max auth tries reached - user 'root'\n";
+            i += 4;
+        } else {
+            const std::string from = "192.168.1." + std::to_string(2 + rng() % 200) + ":" +
+                                     std::to_string(40000 + rng() % 20000);
+            stream += prefix + "Child connection from " + from + "\n";
+            stream += prefix + "Password auth succeeded for 'root' from " + from + "\n";
+            stream += prefix + "Exit (root) from <" + from + ">: Disconnect received\n";
+            i += 3;
+        }
+    }
+
+    unlink(outPath.c_str());
+    LogRecording out;
+    if (!out.open(outPath)) {
+        fprintf(stderr, "cannot write %s: %s\n", outPath.c_str(), strerror(errno));
+        return 1;
+    }
+    uint64_t ts = 0;
+    for (size_t pos = 0; pos < stream.size(); ) {
+        size_t len = std::min<size_t>(1 + rng() % 1024, stream.size() - pos);
+        out.append(stream.data() + pos, len, ts);
+        ts += 200 + rng() % 1800;
+        pos += len;
+    }
+    printf("Wrote %ld lines (%zu bytes) to %s\n", lines, stream.size(), outPath.c_str());
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc >= 2 && std::strcmp(argv[1], "--generate") == 0) {
+        if (argc != 5) return usage();
+        return generate(argv[2], std::atol(argv[3]), argv[4]);
+    }
+    if (argc < 2) return usage();
+
+    const std::string path = argv[1];
+    double speed = 1.0;   // 0 = as fast as possible
+    int repeat = 1;
+    LogHistory::Settings historySettings;
+    std::string search;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--speed" && i + 1 < argc) {
+            std::string v = argv[++i];
+            speed = v == "max" ? 0.0 : std::atof(v.c_str());
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--history-kb" && i + 1 < argc) {
+            historySettings.cold_budget_bytes = static_cast<size_t>(std::max(0, std::atoi(argv[++i]))) * 1024;
+        } else if (arg == "--search" && i + 1 < argc) {
+            search = argv[++i];
+        } else {
+            return usage();
+        }
+    }
+
+    std::vector<LogRecording::Chunk> chunks;
+    std::string error;
+    if (!LogRecording::load(path, chunks, error)) {
+        fprintf(stderr, "%s: %s\n", path.c_str(), error.c_str());
+        return 1;
+    }
+    if (chunks.empty()) {
+        fprintf(stderr, "%s: no chunks recorded\n", path.c_str());
+        return 1;
+    }
+
+    // Expected line sequence, so each delivered line can be timed against the
+    // write that completed it
+    std::vector<ExpectedLine> expected;
+    size_t totalBytes = 0;
+    {
+        LogLineSplitter splitter;
+        size_t chunkIdx = 0;
+        for (int r = 0; r < repeat; ++r) {
+            for (const auto& c : chunks) {
+                splitter.feed(c.data.data(), c.data.size(), [&](const std::string& line) {
+                    expected.push_back({line, chunkIdx});
+                });
+                totalBytes += c.data.size();
+                ++chunkIdx;
+            }
+        }
+        splitter.flush([&](const std::string& line) {
+            expected.push_back({line, chunkIdx - 1});
+        });
+    }
+    const size_t totalChunks = chunks.size() * repeat;
+    std::unique_ptr<std::atomic<uint64_t>[]> writeUs(new std::atomic<uint64_t>[totalChunks]);
+
+    // Sink mirrors Application::pushLogLine
+    LogHistory history(historySettings);
+    std::vector<uint64_t> latencies;
+    latencies.reserve(expected.size());
+    size_t nextExpected = 0;
+    size_t extraLines = 0;
+
+    DropbearManager manager([&](const std::string& line) {
+        if (nextExpected < expected.size() && line == expected[nextExpected].text) {
+            const uint64_t sent = writeUs[expected[nextExpected].chunk].load(std::memory_order_acquire);
+            latencies.push_back(StartupTrace::nowMicros() - sent);
+            ++nextExpected;
+        } else {
+            ++extraLines;   // generated by the manager itself, e.g. guard blocks
+        }
+        history.append(line);
+    });
+
+    int pipefd[2];
+    if (pipe(pipefd) == -1) {
+        perror("pipe");
+        return 1;
+    }
+    manager.attachLogSource(pipefd[0]);
+
+    const uint64_t recordingUs = chunks.back().offset_us;
+    const uint64_t start = StartupTrace::nowMicros();
+    std::thread writer([&]() {
+        size_t idx = 0;
+        for (int r = 0; r < repeat; ++r) {
+            for (const auto& c : chunks) {
+                if (speed > 0) {
+                    const uint64_t at = static_cast<uint64_t>(r) * recordingUs + c.offset_us;
+                    sleepUntil(start + static_cast<uint64_t>(at / speed));
+                }
+                writeUs[idx].store(StartupTrace::nowMicros(), std::memory_order_release);
+                size_t off = 0;
+                while (off < c.data.size()) {
+                    ssize_t n = write(pipefd[1], c.data.data() + off, c.data.size() - off);
+                    if (n > 0) off += static_cast<size_t>(n);
+                    else if (errno != EINTR) break;
+                }
+                ++idx;
+            }
+        }
+        close(pipefd[1]);
+    });
+
+    while (manager.logFd() >= 0) {
+        struct pollfd pfd = {manager.logFd(), POLLIN, 0};
+        if (poll(&pfd, 1, -1) > 0) manager.pumpLogs();
+    }
+    const uint64_t elapsedUs = std::max<uint64_t>(1, StartupTrace::nowMicros() - start);
+    writer.join();
+
+    struct rusage ru{};
+    getrusage(RUSAGE_SELF, &ru);
+    std::sort(latencies.begin(), latencies.end());
+    const double secs = elapsedUs / 1e6;
+
+    Metrics& m = Metrics::global();
+    printf("recording        %s (%zu chunks x %d)\n", path.c_str(), chunks.size(), repeat);
+    if (speed > 0) printf("speed            %gx\n", speed);
+    else printf("speed            max\n");
+    printf("bytes            %zu\n", totalBytes);
+    printf("lines            %zu / %zu delivered, %zu extra\n",
+           nextExpected, expected.size(), extraLines);
+    printf("elapsed          %.3f s\n", secs);
+    printf("throughput       %.0f lines/s, %.2f MiB/s\n",
+           nextExpected / secs, totalBytes / secs / (1024.0 * 1024.0));
+    printf("latency          p50 %llu us, p99 %llu us, max %llu us\n",
+           static_cast<unsigned long long>(percentile(latencies, 0.50)),
+           static_cast<unsigned long long>(percentile(latencies, 0.99)),
+           static_cast<unsigned long long>(latencies.empty() ? 0 : latencies.back()));
+    printf("peak RSS         %ld KiB\n", ru.ru_maxrss);
+    printf("auth failures    %lld\n", static_cast<long long>(
+        m.counter("dropbear_app_auth_failures_total", "").value()));
+    printf("sessions         %lld\n", static_cast<long long>(
+        m.counter("dropbear_app_sessions_total", "").value()));
+    printf("time to auth     p50 %lld us, p99 %lld us\n",
+           static_cast<long long>(m.gauge("dropbear_app_time_to_auth_p50_microseconds", "").value()),
+           static_cast<long long>(m.gauge("dropbear_app_time_to_auth_p99_microseconds", "").value()));
+
+    // Scrollback from the oldest retained line, then an optional full search
+    std::string scratch;
+    for (uint64_t i = history.begin(); i < history.end(); ++i) history.line(i, scratch);
+    LogHistory::Stats hs = history.stats();
+    printf("history          %llu lines retained, %llu evicted, %llu blocks\n",
+           static_cast<unsigned long long>(hs.lines),
+           static_cast<unsigned long long>(hs.evicted_lines),
+           static_cast<unsigned long long>(hs.blocks));
+    printf("compression      %.2fx (%llu -> %llu bytes), decode %.1f us/block\n",
+           hs.ratio(), static_cast<unsigned long long>(hs.raw_bytes),
+           static_cast<unsigned long long>(hs.compressed_bytes), hs.decodeMicrosPerBlock());
+    printf("footprint        %zu KiB\n", hs.footprint_bytes / 1024);
+    if (!search.empty()) {
+        const uint64_t t0 = StartupTrace::nowMicros();
+        size_t matches = 0;
+        for (uint64_t i = history.find(search, history.end(), true); i != history.end();
+             i = i > history.begin() ? history.find(search, i - 1, true) : history.end()) {
+            ++matches;
+        }
+        printf("search           %zu matches for \"%s\" in %llu us\n", matches, search.c_str(),
+               static_cast<unsigned long long>(StartupTrace::nowMicros() - t0));
+    }
+
+    return nextExpected == expected.size() ? 0 : 1;
+}
@@ -0,0 +1,258 @@
+// Measures how CPU scheduling policies (SchedPolicy, set through the
+// dropbear_* / ui_* keys in dropbear.conf) trade transfer throughput against
+// UI frame times. Each scenario runs in its own process:
+//
+//   - N "transfer" workers, forked with the dropbear policy applied, run
+//     ChaCha20 over a buffer as a stand-in for dropbear's per-packet crypto
+//   - the scenario's main thread, with the UI policy applied, runs a 60 fps
+//     loop that busy-works for --frame-work-ms and then sleeps to the next vsync
+//
+//   sched_bench [--seconds S] [--workers N] [--frame-work-ms M]
+//
+// Reports MiB/s across workers, render time p50/p99 (how much the frame work
+// got stretched) and the share of frames that missed their deadline.
+// Built on the host with `make sched-bench`; run it on the device for numbers
+// that mean anything. Negative nice values need root / CAP_SYS_NICE.
+#include "../src/SchedPolicy.h"
+#include "../src/StartupTrace.h"
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Scenario {
+    std::string name;
+    SchedPolicy::Settings dropbear;
+    SchedPolicy::Settings ui;
+    bool transfers = true;
+};
+
+struct Options {
+    double seconds = 3.0;
+    int workers = 0;          // 0 = one per core
+    double frame_work_ms = 4.0;
+};
+
+constexpr uint64_t FRAME_US = 1000000 / 60;
+
+inline uint32_t rotl(uint32_t v, int n) { return (v << n) | (v >> (32 - n)); }
+
+#define QR(a, b, c, d)                    \
+    a += b; d ^= a; d = rotl(d, 16);      \
+    c += d; b ^= c; b = rotl(b, 12);      \
+    a += b; d ^= a; d = rotl(d, 8);       \
+    c += d; b ^= c; b = rotl(b, 7)
+
+void chachaBlock(uint32_t out[16], const uint32_t in[16]) {
+    uint32_t x[16];
+    std::memcpy(x, in, sizeof(x));
+    for (int i = 0; i < 10; ++i) {
+        QR(x[0], x[4], x[8], x[12]); QR(x[1], x[5], x[9], x[13]);
+        QR(x[2], x[6], x[10], x[14]); QR(x[3], x[7], x[11], x[15]);
+        QR(x[0], x[5], x[10], x[15]); QR(x[1], x[6], x[11], x[12]);
+        QR(x[2], x[7], x[8], x[13]); QR(x[3], x[4], x[9], x[14]);
+    }
+    for (int i = 0; i < 16; ++i) out[i] = x[i] + in[i];
+}
+
+// Encrypts a 16 KiB "packet" over and over until the deadline; returns bytes
+uint64_t transferWorker(uint64_t deadlineUs) {
+    uint32_t state[16] = {0x61707865, 0x3320646e, 0x79622d32, 0x6b206574};
+    std::vector<uint32_t> buf(16 * 1024 / 4, 0x5a5a5a5a);
+    uint64_t bytes = 0;
+    while (StartupTrace::nowMicros() < deadlineUs) {
+        uint32_t ks[16];
+        for (size_t i = 0; i < buf.size(); i += 16) {
+            chachaBlock(ks, state);
+            ++state[12];
+            for (int j = 0; j < 16; ++j) buf[i + j] ^= ks[j];
+        }
+        bytes += buf.size() * 4;
+    }
+    return bytes + (buf[0] & 1);   // keep the work observable
+}
+
+void spinFor(uint64_t us) {
+    const uint64_t end = StartupTrace::nowMicros() + us;
+    volatile uint64_t sink = 0;
+    while (StartupTrace::nowMicros() < end) {
+        for (int i = 0; i < 256; ++i) sink = sink + i;
+    }
+}
+
+double percentileMs(std::vector<uint64_t> v, double p) {
+    if (v.empty()) return 0;
+    std::sort(v.begin(), v.end());
+    size_t idx = static_cast<size_t>(p * (v.size() - 1) + 0.5);
+    return v[std::min(idx, v.size() - 1)] / 1000.0;
+}
+
+void reportPolicyError(const char* who, const char* step) {
+    if (step) std::fprintf(stderr, "  %s policy: %s failed: %s\n", who, step, std::strerror(errno));
+}
+
+// Runs in a forked process so nice/affinity changes don't leak between scenarios
+int runScenario(const Scenario& sc, const Options& opt, int workers) {
+    SchedPolicy dbPolicy, uiPolicy;
+    std::string error;
+    if (!dbPolicy.configure(sc.dropbear, error) || !uiPolicy.configure(sc.ui, error)) {
+        std::fprintf(stderr, "  %s: %s\n", sc.name.c_str(), error.c_str());
+        return 1;
+    }
+
+    const uint64_t start = StartupTrace::nowMicros() + 50000;   // let workers spin up
+    const uint64_t deadline = start + static_cast<uint64_t>(opt.seconds * 1e6);
+
+    std::vector<pid_t> pids;
+    std::vector<int> fds;
+    if (sc.transfers) {
+        for (int i = 0; i < workers; ++i) {
+            int p[2];
+            if (pipe(p) == -1) return 1;
+            pid_t pid = fork();
+            if (pid == 0) {
+                close(p[0]);
+                reportPolicyError("dropbear", dbPolicy.apply());
+                uint64_t bytes = transferWorker(deadline);
+                ssize_t ignored = write(p[1], &bytes, sizeof(bytes));
+                (void)ignored;
+                _exit(0);
+            }
+            close(p[1]);
+            pids.push_back(pid);
+            fds.push_back(p[0]);
+        }
+    }
+
+    reportPolicyError("ui", uiPolicy.apply());
+    while (StartupTrace::nowMicros() < start) usleep(1000);
+
+    std::vector<uint64_t> renderUs;
+    size_t missed = 0;
+    const uint64_t workUs = static_cast<uint64_t>(opt.frame_work_ms * 1000);
+    uint64_t nextFrame = start;
+    while (true) {
+        const uint64_t frameStart = StartupTrace::nowMicros();
+        if (frameStart >= deadline) break;
+        spinFor(workUs);
+        renderUs.push_back(StartupTrace::nowMicros() - frameStart);
+
+        nextFrame += FRAME_US;
+        const uint64_t now = StartupTrace::nowMicros();
+        if (now > nextFrame) {
+            // Missed vsync; resync instead of trying to catch up
+            missed += 1 + (now - nextFrame) / FRAME_US;
+            nextFrame += ((now - nextFrame) / FRAME_US + 1) * FRAME_US;
+        }
+        const uint64_t after = StartupTrace::nowMicros();
+        if (nextFrame > after) usleep(static_cast<useconds_t>(nextFrame - after));
+    }
+
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < pids.size(); ++i) {
+        uint64_t b = 0;
+        if (read(fds[i], &b, sizeof(b)) == sizeof(b)) bytes += b;
+        close(fds[i]);
+        waitpid(pids[i], nullptr, 0);
+    }
+
+    const size_t frames = renderUs.size() + missed;
+    std::printf("%-28s %9.1f %9.2f %9.2f %8.1f%%\n", sc.name.c_str(),
+                bytes / opt.seconds / (1024.0 * 1024.0),
+                percentileMs(renderUs, 0.50), percentileMs(renderUs, 0.99),
+                frames ? 100.0 * missed / frames : 0.0);
+    std::fflush(stdout);
+    return 0;
+}
+
+std::vector<Scenario> scenarios(int cores) {
+    std::vector<Scenario> out;
+    Scenario s;
+
+    s = Scenario();
+    s.name = "idle (no transfers)";
+    s.transfers = false;
+    out.push_back(s);
+
+    s = Scenario();
+    s.name = "default";
+    out.push_back(s);
+
+    s = Scenario();
+    s.name = "dropbear nice 10";
+    s.dropbear.nice = 10;
+    out.push_back(s);
+
+    s = Scenario();
+    s.name = "dropbear nice 19, io idle";
+    s.dropbear.nice = 19;
+    s.dropbear.ioprio = "idle";
+    out.push_back(s);
+
+    if (cores >= 2) {
+        const std::string rest = cores == 2 ? "1" : "1-" + std::to_string(cores - 1);
+        s = Scenario();
+        s.name = "split: ui cpu 0, dropbear " + rest;
+        s.dropbear.cpus = rest;
+        s.ui.cpus = "0";
+        out.push_back(s);
+
+        s.name = "split + dropbear nice 10";
+        s.dropbear.nice = 10;
+        out.push_back(s);
+    }
+
+    s = Scenario();
+    s.name = "ui nice -5";
+    s.ui.nice = -5;
+    out.push_back(s);
+    return out;
+}
+
+int usage() {
+    std::fprintf(stderr, "usage: sched_bench [--seconds S] [--workers N] [--frame-work-ms M]\n");
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) return usage();
+        if (arg == "--seconds") opt.seconds = std::max(0.5, std::atof(argv[++i]));
+        else if (arg == "--workers") opt.workers = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--frame-work-ms") opt.frame_work_ms = std::max(0.0, std::atof(argv[++i]));
+        else return usage();
+    }
+
+    const int cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    const int workers = opt.workers > 0 ? opt.workers : cores;
+    std::printf("%d cores, %d transfer workers, %.1f ms frame work, %.1f s per scenario\n\n",
+                cores, workers, opt.frame_work_ms, opt.seconds);
+    std::printf("%-28s %9s %9s %9s %9s\n", "policy", "MiB/s", "render50", "render99", "missed");
+
+    int failures = 0;
+    for (const auto& sc : scenarios(cores)) {
+        std::fflush(stdout);
+        pid_t pid = fork();
+        if (pid == -1) {
+            std::perror("fork");
+            return 1;
+        }
+        if (pid == 0) _exit(runScenario(sc, opt, workers));
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) failures++;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,95 @@
+// Measures what the spawn helper saves. fork() copies the caller's page
+// tables, so its cost grows with the caller's resident memory; the helper is
+// forked while the process is still small, as main() does, and stays small.
+//
+// After the helper is up, --ballast-mb of memory is touched to stand in for a
+// running app (SDL, GL buffers, font atlas, log history). Then /bin/true (or
+// --exec PATH) is started --runs times each way:
+//
+//   - direct: fork() of this process, then exec
+//   - helper: request over the socketpair, helper forks, pid comes back
+//
+//   spawn_bench [--ballast-mb N] [--runs N] [--exec PATH]
+//
+// Reports the spawn call (request to pid) and spawn to exit, p50/p99 in
+// microseconds (histogram bucket bounds).
+// Built on the host with `make spawn-bench`; run it on the device.
+#include "../src/LatencyHistogram.h"
+#include "../src/SpawnHelper.h"
+#include "../src/StartupTrace.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+    size_t ballast_mb = 64;
+    int runs = 200;
+    std::string exec = "/bin/true";
+};
+
+int measure(const char* name, SpawnHelper& spawner, const Options& opt) {
+    SpawnHelper::Request request;
+    request.path = opt.exec;
+    request.args = {opt.exec};
+
+    LatencyHistogram call, total;
+    for (int i = 0; i < opt.runs; ++i) {
+        const uint64_t start = StartupTrace::nowMicros();
+        pid_t pid;
+        int fd;
+        std::string error;
+        if (!spawner.spawn(request, pid, fd, error)) {
+            std::fprintf(stderr, "%s: %s\n", name, error.c_str());
+            return 1;
+        }
+        call.record(StartupTrace::nowMicros() - start);
+        spawner.wait(pid, nullptr, 0);
+        total.record(StartupTrace::nowMicros() - start);
+    }
+    std::printf("%-8s %10llu %10llu %10llu %10llu\n", name,
+                static_cast<unsigned long long>(call.percentile(0.50)),
+                static_cast<unsigned long long>(call.percentile(0.99)),
+                static_cast<unsigned long long>(total.percentile(0.50)),
+                static_cast<unsigned long long>(total.percentile(0.99)));
+    return 0;
+}
+
+int usage() {
+    std::fprintf(stderr, "usage: spawn_bench [--ballast-mb N] [--runs N] [--exec PATH]\n");
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) return usage();
+        if (arg == "--ballast-mb") opt.ballast_mb = static_cast<size_t>(std::max(0, std::atoi(argv[++i])));
+        else if (arg == "--runs") opt.runs = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--exec") opt.exec = argv[++i];
+        else return usage();
+    }
+
+    // Same order as main(): helper first, then the process grows
+    std::string error;
+    if (!SpawnHelper::global().start(error)) {
+        std::fprintf(stderr, "spawn helper: %s\n", error.c_str());
+        return 1;
+    }
+    std::vector<char> ballast(opt.ballast_mb << 20);
+    for (size_t i = 0; i < ballast.size(); i += 4096) ballast[i] = static_cast<char>(i);
+
+    std::printf("%zu MiB resident ballast, %d runs of %s\n\n", opt.ballast_mb, opt.runs, opt.exec.c_str());
+    std::printf("%-8s %10s %10s %10s %10s\n", "us", "call p50", "call p99", "exit p50", "exit p99");
+    SpawnHelper direct;
+    int failures = measure("direct", direct, opt);
+    failures += measure("helper", SpawnHelper::global(), opt);
+    return failures == 0 ? 0 : 1;
+}